@@ -0,0 +1,198 @@
+"""
+基准回归比较: 对比结果存储中的两组运行，用 bootstrap 置信区间判断变化是否显著。
+
+    python compare_results.py                          # 最近两个 git 版本
+    python compare_results.py --baseline d99a468 --candidate HEAD-tag
+    python compare_results.py --benchmark ipc_bench --stat p99 --min-effect 0.02
+
+选择器按 git_rev 前缀、tag 或 run_id 匹配。相同 benchmark 且 config 完全一致的记录视为同一组:
+  - 带 samples 的指标: 分层 bootstrap，先有放回地抽取运行，再在每个抽中的运行内有放回地抽取样本，
+    合并后计算统计量 (同一运行内的请求延迟彼此相关，运行间的波动也计入置信区间)
+  - 仅有 value 的指标: 每次运行作为一个重复样本
+两种指标每侧都至少需要 2 次运行。
+相对变化的置信区间不含 0 且幅度不小于 --min-effect 时判定为显著；
+方向与指标的 better 相反即为回归，存在回归时退出码为 1。
+"""
+
+import argparse
+import json
+import random
+import sys
+
+import result_store
+
+
+def percentile(sorted_vals, q):
+    if not sorted_vals:
+        return 0.0
+    pos = q * (len(sorted_vals) - 1)
+    lo = int(pos)
+    hi = min(lo + 1, len(sorted_vals) - 1)
+    return sorted_vals[lo] + (sorted_vals[hi] - sorted_vals[lo]) * (pos - lo)
+
+
+def make_stat(name):
+    if name == "mean":
+        return lambda v: sum(v) / len(v)
+    q = {"p50": 0.5, "p90": 0.9, "p99": 0.99}[name]
+    return lambda v: percentile(sorted(v), q)
+
+
+def bootstrap_rel_change(base, cand, stat, iterations, confidence, rng):
+    """base/cand 为每次运行的样本列表 (仅有 value 的指标每次运行一个值)。
+    返回 (点估计, 下界, 上界)，均为相对变化 (cand - base) / base"""
+    def pooled(runs):
+        return [v for run in runs for v in run]
+
+    def resample(runs):
+        picked = [runs[rng.randrange(len(runs))] for _ in range(len(runs))]
+        return [v for run in picked for v in (run if len(run) == 1 else rng.choices(run, k=len(run)))]
+
+    b0 = stat(pooled(base))
+    if b0 == 0:
+        return None
+    point = (stat(pooled(cand)) - b0) / b0
+    diffs = []
+    for _ in range(iterations):
+        bs = stat(resample(base))
+        cs = stat(resample(cand))
+        if bs != 0:
+            diffs.append((cs - bs) / bs)
+    diffs.sort()
+    alpha = (1 - confidence) / 2
+    return point, percentile(diffs, alpha), percentile(diffs, 1 - alpha)
+
+
+def matches(record, selector):
+    return (record.get("git_rev", "").startswith(selector) or
+            record.get("tag") == selector or record.get("run_id") == selector)
+
+
+def default_selectors(records):
+    revs = []
+    for r in records:
+        rev = r.get("git_rev")
+        if rev in revs:
+            revs.remove(rev)
+        revs.append(rev)
+    if len(revs) < 2:
+        return None, None
+    return revs[-2], revs[-1]
+
+
+def group(records):
+    groups = {}
+    for r in records:
+        key = (r.get("benchmark"), json.dumps(r.get("config", {}), sort_keys=True))
+        groups.setdefault(key, []).append(r)
+    return groups
+
+
+def collect(runs, metric):
+    """返回 (每次运行的样本列表, uses_samples, better, unit)；仅有 value 的运行记为单元素列表"""
+    samples, values = [], []
+    better, unit = "lower", ""
+    for r in runs:
+        m = r.get("metrics", {}).get(metric)
+        if m is None:
+            continue
+        better, unit = m.get("better", better), m.get("unit", unit)
+        run_samples = [v for v in m.get("samples") or [] if v is not None]
+        if run_samples:
+            samples.append(run_samples)
+        elif m.get("value") is not None:
+            values.append([m["value"]])
+    if samples:
+        return samples, True, better, unit
+    return values, False, better, unit
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two benchmark runs with bootstrap CIs")
+    parser.add_argument("--store", default=None)
+    parser.add_argument("--baseline", default=None, help="git rev prefix, tag or run_id")
+    parser.add_argument("--candidate", default=None, help="git rev prefix, tag or run_id")
+    parser.add_argument("--benchmark", default=None)
+    parser.add_argument("--stat", default="mean", choices=["mean", "p50", "p90", "p99"],
+                        help="statistic compared for sample metrics")
+    parser.add_argument("--iterations", type=int, default=2000)
+    parser.add_argument("--confidence", type=float, default=0.95)
+    parser.add_argument("--min-effect", type=float, default=0.01,
+                        help="minimum relative change reported as significant (default 1%%)")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    records = result_store.load(args.store)
+    if args.benchmark:
+        records = [r for r in records if r.get("benchmark") == args.benchmark]
+    base_sel, cand_sel = args.baseline, args.candidate
+    if not base_sel or not cand_sel:
+        d_base, d_cand = default_selectors(records)
+        base_sel, cand_sel = base_sel or d_base, cand_sel or d_cand
+    if not base_sel or not cand_sel:
+        print("Need results from at least two revisions (or pass --baseline/--candidate).", file=sys.stderr)
+        return 2
+
+    base_groups = group([r for r in records if matches(r, base_sel)])
+    cand_groups = group([r for r in records if matches(r, cand_sel)])
+    common = sorted(set(base_groups) & set(cand_groups))
+    if not common:
+        print(f"No common benchmark/config between '{base_sel}' and '{cand_sel}'.", file=sys.stderr)
+        return 2
+
+    rng = random.Random(args.seed)
+    stat = make_stat(args.stat)
+    regressions = 0
+    print(f"Baseline: {base_sel}   Candidate: {cand_sel}   "
+          f"({int(args.confidence * 100)}% bootstrap CI, {args.iterations} iterations, min effect "
+          f"{args.min_effect * 100:.1f}%)\n")
+    header = f"{'metric':24} {'runs':>9} {'baseline':>12} {'candidate':>12} {'change':>9} {'CI':>21}  verdict"
+    for key in common:
+        bench, cfg = key
+        print(f"== {bench} {cfg}")
+        print(header)
+        base_runs, cand_runs = base_groups[key], cand_groups[key]
+        metrics = sorted(set().union(*(r.get("metrics", {}).keys() for r in base_runs)) &
+                         set().union(*(r.get("metrics", {}).keys() for r in cand_runs)))
+        for metric in metrics:
+            b, b_samples, better, unit = collect(base_runs, metric)
+            c, c_samples, _, _ = collect(cand_runs, metric)
+            if not b or not c:
+                continue
+            if b_samples != c_samples:
+                # 一侧带样本、另一侧只有 value 时按每次运行的均值比较
+                b = [[sum(run) / len(run)] for run in b]
+                c = [[sum(run) / len(run)] for run in c]
+            use_stat = stat if (b_samples and c_samples) else make_stat("mean")
+            n = f"{len(b)}/{len(c)}"
+            label = f"{metric} ({unit})" if unit else metric
+            b_all = [v for run in b for v in run]
+            c_all = [v for run in c for v in run]
+            if len(b) < 2 or len(c) < 2:
+                print(f"{label:24} {n:>9} {use_stat(b_all):12.4g} {use_stat(c_all):12.4g} {'':>9} {'':>21}  "
+                      f"n/a (need >= 2 runs per side)")
+                continue
+            res = bootstrap_rel_change(b, c, use_stat, args.iterations, args.confidence, rng)
+            if res is None:
+                continue
+            point, lo, hi = res
+            significant = (lo > 0 or hi < 0) and abs(point) >= args.min_effect
+            worse = (point < 0) if better == "higher" else (point > 0)
+            if not significant:
+                verdict = "no significant change"
+            elif worse:
+                verdict = "REGRESSION"
+                regressions += 1
+            else:
+                verdict = "improvement"
+            ci = f"[{lo * 100:+.2f}%, {hi * 100:+.2f}%]"
+            print(f"{label:24} {n:>9} {use_stat(b_all):12.4g} {use_stat(c_all):12.4g} {point * 100:+8.2f}% {ci:>21}  "
+                  f"{verdict}")
+        print()
+
+    print(f"{regressions} significant regression(s)")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,165 @@
+#pragma once
+
+// ============================================================
+//  基准结果存储 (JSON Lines)，与 result_store.py 的记录格式一致
+//  每次运行追加一行:
+//    {"run_id", "time", "git_rev", "git_dirty", "host", "tag", "benchmark",
+//     "config": {...}, "metrics": {name: {"value", "unit", "better", ["samples"]}}}
+//  存储路径: $KS_RESULTS，否则 <repo>/benchmark/results/results.jsonl
+//  比较: python benchmark/compare_results.py
+// ============================================================
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+class ResultRecord {
+public:
+    explicit ResultRecord(const std::string& benchmark) : benchmark_(benchmark) {}
+
+    void config(const std::string& key, const std::string& value) {
+        config_.push_back(std::make_pair(key, quote(value)));
+    }
+    void config(const std::string& key, const char* value) { config(key, std::string(value)); }
+    void config(const std::string& key, double value) { config_.push_back(std::make_pair(key, number(value))); }
+    void config(const std::string& key, long long value) { config_.push_back(std::make_pair(key, std::to_string(value))); }
+    void config(const std::string& key, int value) { config(key, static_cast<long long>(value)); }
+
+    // 标量指标；同一配置多次运行的值作为 bootstrap 的重复样本
+    void metric(const std::string& name, double value, const std::string& unit, bool higherIsBetter) {
+        metrics_.push_back(std::make_pair(name, body(value, unit, higherIsBetter)));
+    }
+
+    // 带原始样本的指标 (如每条请求的延迟)，样本过多时均匀抽取 maxSamples 个
+    void samples(const std::string& name, const std::vector<double>& values, const std::string& unit,
+                 bool higherIsBetter, size_t maxSamples = 2000) {
+        double sum = 0;
+        for (double v : values) sum += v;
+        std::string b = body(values.empty() ? 0 : sum / values.size(), unit, higherIsBetter);
+        b.pop_back();
+        b += ",\"samples\":[";
+        size_t n = std::min(values.size(), maxSamples);
+        for (size_t i = 0; i < n; i++) {
+            if (i) b += ",";
+            b += number(values[n == values.size() ? i : i * values.size() / n]);
+        }
+        b += "]}";
+        metrics_.push_back(std::make_pair(name, b));
+    }
+
+    // 追加到存储文件；path 为空时使用默认路径
+    bool append(const std::string& path = "") const {
+        std::string target = path.empty() ? defaultPath() : path;
+        size_t slash = target.rfind('/');
+        if (slash != std::string::npos) makeDirs(target.substr(0, slash));
+
+        FILE* f = fopen(target.c_str(), "a");
+        if (!f) {
+            fprintf(stderr, "[ResultStore] Failed to open %s: %s\n", target.c_str(), strerror(errno));
+            return false;
+        }
+        std::string line = toJson();
+        fprintf(f, "%s\n", line.c_str());
+        fclose(f);
+        fprintf(stderr, "[ResultStore] Appended %s result to %s\n", benchmark_.c_str(), target.c_str());
+        return true;
+    }
+
+    std::string toJson() const {
+        char timeBuf[32];
+        time_t now = time(nullptr);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%dT%H:%M:%S", &tm);
+        char host[256] = {0};
+        gethostname(host, sizeof(host) - 1);
+        const char* tag = getenv("KS_RESULT_TAG");
+
+        std::string rev = gitOutput("git rev-parse --short HEAD 2>/dev/null");
+        const char* revEnv = getenv("KS_GIT_REV");
+        if (revEnv && *revEnv) rev = revEnv;
+        bool dirty = !gitOutput("git status --porcelain --untracked-files=no 2>/dev/null").empty();
+
+        std::string s = "{\"run_id\":" + quote(std::string(timeBuf) + "-" + std::to_string(getpid())) +
+                        ",\"time\":" + quote(timeBuf) +
+                        ",\"git_rev\":" + quote(rev.empty() ? "unknown" : rev) +
+                        ",\"git_dirty\":" + (dirty ? "true" : "false") +
+                        ",\"host\":" + quote(host) +
+                        ",\"tag\":" + quote(tag ? tag : "") +
+                        ",\"benchmark\":" + quote(benchmark_) + ",\"config\":{";
+        for (size_t i = 0; i < config_.size(); i++) {
+            if (i) s += ",";
+            s += quote(config_[i].first) + ":" + config_[i].second;
+        }
+        s += "},\"metrics\":{";
+        for (size_t i = 0; i < metrics_.size(); i++) {
+            if (i) s += ",";
+            s += quote(metrics_[i].first) + ":" + metrics_[i].second;
+        }
+        s += "}}";
+        return s;
+    }
+
+private:
+    static std::string quote(const std::string& v) {
+        std::string out = "\"";
+        for (char c : v) {
+            if (c == '"' || c == '\\') { out += '\\'; out += c; }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else out += c;
+        }
+        return out + "\"";
+    }
+
+    static std::string number(double v) {
+        if (!std::isfinite(v)) return "null";
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.9g", v);
+        return buf;
+    }
+
+    static std::string body(double value, const std::string& unit, bool higherIsBetter) {
+        return "{\"value\":" + number(value) + ",\"unit\":" + quote(unit) +
+               ",\"better\":" + quote(higherIsBetter ? "higher" : "lower") + "}";
+    }
+
+    static std::string gitOutput(const char* cmd) {
+        std::string out;
+        FILE* p = popen(cmd, "r");
+        if (!p) return out;
+        char buf[256];
+        while (fgets(buf, sizeof(buf), p)) out += buf;
+        pclose(p);
+        while (!out.empty() && (out.back() == '\n' || out.back() == '\r')) out.pop_back();
+        return out;
+    }
+
+    static void makeDirs(const std::string& dir) {
+        for (size_t pos = 1; pos <= dir.size(); pos++) {
+            if (pos == dir.size() || dir[pos] == '/') mkdir(dir.substr(0, pos).c_str(), 0777);
+        }
+    }
+
+    static std::string defaultPath() {
+        const char* env = getenv("KS_RESULTS");
+        if (env && *env) return env;
+        std::string root = gitOutput("git rev-parse --show-toplevel 2>/dev/null");
+        return (root.empty() ? std::string(".") : root + "/benchmark/results") + "/results.jsonl";
+    }
+
+    std::string benchmark_;
+    std::vector<std::pair<std::string, std::string>> config_;
+    std::vector<std::pair<std::string, std::string>> metrics_;
+};
@@ -0,0 +1,182 @@
+"""
+基准结果存储 (JSON Lines)，与 result_store.h 的记录格式一致。
+
+每次运行追加一行:
+    {"run_id", "time", "git_rev", "git_dirty", "host", "tag", "benchmark",
+     "config": {...}, "metrics": {name: {"value", "unit", "better", ["samples"]}}}
+
+存储路径: $KS_RESULTS，否则 <repo>/benchmark/results/results.jsonl
+
+在脚本中使用:
+    import result_store
+    rec = result_store.Record("azure_replay", {"sample_interval": 2, "speedup": 1.1})
+    rec.metric("decode_tps", 6584.8, "tokens/s", higher_is_better=True)
+    rec.samples("ttft", ttft_list, "s", higher_is_better=False)
+    rec.append()
+
+命令行手工录入 (替代在绘图脚本里手抄数组):
+    python result_store.py add --benchmark intercept_overhead --config setting="w/ sglang" \
+        --metric prefill_throughput=23290.35:higher --metric decode_latency=0.01924:lower
+"""
+
+import argparse
+import json
+import os
+import socket
+import subprocess
+import sys
+import time
+
+MAX_SAMPLES = 2000
+
+
+def _git(*args):
+    try:
+        out = subprocess.run(["git"] + list(args), capture_output=True, text=True,
+                             cwd=os.path.dirname(os.path.abspath(__file__)))
+        return out.stdout.strip() if out.returncode == 0 else ""
+    except OSError:
+        return ""
+
+
+def default_path():
+    env = os.environ.get("KS_RESULTS")
+    if env:
+        return env
+    return os.path.join(os.path.dirname(os.path.abspath(__file__)), "results", "results.jsonl")
+
+
+def load(path=None):
+    """读取全部记录，忽略损坏的行"""
+    path = path or default_path()
+    records = []
+    if not os.path.exists(path):
+        return records
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                records.append(json.loads(line))
+            except json.JSONDecodeError:
+                continue
+    return records
+
+
+class Record:
+    def __init__(self, benchmark, config=None):
+        self.benchmark = benchmark
+        self.config = dict(config or {})
+        self.metrics = {}
+
+    def metric(self, name, value, unit="", higher_is_better=False):
+        self.metrics[name] = {"value": float(value), "unit": unit,
+                              "better": "higher" if higher_is_better else "lower"}
+
+    def samples(self, name, values, unit="", higher_is_better=False):
+        values = [float(v) for v in values]
+        if len(values) > MAX_SAMPLES:
+            step = len(values) / MAX_SAMPLES
+            values = [values[int(i * step)] for i in range(MAX_SAMPLES)]
+        self.metrics[name] = {"value": sum(values) / len(values) if values else 0.0, "unit": unit,
+                              "better": "higher" if higher_is_better else "lower",
+                              "samples": values}
+
+    def to_dict(self):
+        now = time.strftime("%Y-%m-%dT%H:%M:%S")
+        return {
+            "run_id": f"{now}-{os.getpid()}",
+            "time": now,
+            "git_rev": os.environ.get("KS_GIT_REV") or _git("rev-parse", "--short", "HEAD") or "unknown",
+            "git_dirty": bool(_git("status", "--porcelain", "--untracked-files=no")),
+            "host": socket.gethostname(),
+            "tag": os.environ.get("KS_RESULT_TAG", ""),
+            "benchmark": self.benchmark,
+            "config": self.config,
+            "metrics": self.metrics,
+        }
+
+    def append(self, path=None):
+        path = path or default_path()
+        os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+        with open(path, "a") as f:
+            f.write(json.dumps(self.to_dict(), separators=(",", ":")) + "\n")
+        print(f"[ResultStore] Appended {self.benchmark} result to {path}", file=sys.stderr)
+
+
+def record_serving(benchmark, config, duration, valid_df, all_intervals_s, path=None):
+    """test_azure / test_burstGPT 回放脚本的公共指标"""
+    rec = Record(benchmark, config)
+    rec.metric("requests_per_s", len(valid_df) / duration, "req/s", higher_is_better=True)
+    rec.metric("prefill_tps", valid_df["input_len"].sum() / duration, "tokens/s", higher_is_better=True)
+    rec.metric("decode_tps", valid_df["actual_output_tokens"].sum() / duration, "tokens/s", higher_is_better=True)
+    rec.samples("latency", valid_df["latency"].tolist(), "s")
+    rec.samples("ttft", valid_df["ttft"].tolist(), "s")
+    rec.samples("tpot", [v * 1000 for v in all_intervals_s], "ms")
+    rec.append(path)
+
+
+def record_pd(benchmark, config, duration, res_df, path=None):
+    """prefill-decode_disaggreation 回放脚本: TTFT 取自 prefill worker，TPOT 取自 decode worker"""
+    rec = Record(benchmark, config)
+    ok = res_df[res_df["status"] == 200]
+    rec.metric("requests_per_s", len(ok) / duration, "req/s", higher_is_better=True)
+    rec.metric("prefill_tps", res_df["input_len"].sum() / duration, "tokens/s", higher_is_better=True)
+    rec.metric("decode_tps", res_df["output_len"].sum() / duration, "tokens/s", higher_is_better=True)
+    prefill = res_df[res_df["role"] == "prefill_worker"]
+    if not prefill.empty:
+        rec.samples("ttft", prefill["ttft"].tolist(), "s")
+    intervals = []
+    for iv in res_df[res_df["role"] == "decode_worker"]["token_intervals"]:
+        intervals.extend(iv)
+    if intervals:
+        rec.samples("tpot", [v * 1000 for v in intervals], "ms")
+    rec.append(path)
+
+
+def _parse_kv(items):
+    out = {}
+    for item in items or []:
+        key, _, value = item.partition("=")
+        try:
+            out[key] = json.loads(value)
+        except json.JSONDecodeError:
+            out[key] = value
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark result store")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    add = sub.add_parser("add", help="append a manually measured result")
+    add.add_argument("--benchmark", required=True)
+    add.add_argument("--config", action="append", help="key=value")
+    add.add_argument("--metric", action="append", required=True,
+                     help="name=value[:higher|lower] (repeat the flag for more metrics)")
+    add.add_argument("--store", default=None)
+
+    ls = sub.add_parser("list", help="list stored runs")
+    ls.add_argument("--store", default=None)
+    ls.add_argument("--benchmark", default=None)
+
+    args = parser.parse_args()
+    if args.cmd == "add":
+        rec = Record(args.benchmark, _parse_kv(args.config))
+        for m in args.metric:
+            name, _, rest = m.partition("=")
+            value, _, better = rest.partition(":")
+            rec.metric(name, float(value), higher_is_better=(better == "higher"))
+        rec.append(args.store)
+    else:
+        for r in load(args.store):
+            if args.benchmark and r.get("benchmark") != args.benchmark:
+                continue
+            dirty = "+" if r.get("git_dirty") else ""
+            print(f"{r.get('time')}  {r.get('git_rev')}{dirty:1}  {r.get('tag', ''):12}  "
+                  f"{r.get('benchmark'):24}  {json.dumps(r.get('config', {}), sort_keys=True)}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,342 @@
+// ============================================================
+//  调度热路径的堆分配检查
+//  替换全局 operator new/delete 为计数版本，只统计被测会话线程上、预热之后的分配。
+//  在进程内启动被测传输的服务端与真实的 Scheduler (默认策略、开启决策录制、代价模型存储、耗时预测)，
+//  由客户端线程发送 kernel 请求 (部分带启动参数，token 数与 FLOP/字节数逐个 kernel 变化) 与遥测；
+//  会话线程每次接收前经过包装通道，预热消息处理完后开始计数，收到最后一条消息并处理完后停止。
+//  录制缓冲区为调度器的默认大小，计数阶段默认足够长，至少跨过一次录制检查点。
+//  稳态下 接收 -> 解析 -> 决策 -> 记日志 -> 回复 应当零分配，任一传输计到分配时退出码为 1
+//  (--trace 打印前几次分配的调用栈)。
+//  注册表与套接字名按 $USER 区分，测试前改为 ksalloc<pid>；日志与代价模型写在临时目录。
+// ============================================================
+
+#include "scheduler.h"
+#include "shm_client.h"
+#include "../test-ipc/transport_cases.h"
+#include "../result_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <execinfo.h>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// ===== 计数分配器 =====
+
+namespace {
+
+thread_local bool t_counting = false;
+std::atomic<uint64_t> g_allocs{0};
+std::atomic<uint64_t> g_allocBytes{0};
+bool g_trace = false;
+constexpr uint64_t TRACE_ALLOCS = 4;
+
+void noteAlloc(size_t size) {
+    if (!t_counting) return;
+    uint64_t n = g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (g_trace && n < TRACE_ALLOCS) {
+        // backtrace 已在 main 中预热，此处不再分配；打印期间不计数
+        t_counting = false;
+        void* frames[32];
+        int depth = backtrace(frames, 32);
+        fprintf(stderr, "---- allocation #%llu (%zu bytes) ----\n", static_cast<unsigned long long>(n + 1), size);
+        backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+        t_counting = true;
+    }
+}
+
+void* countedAlloc(size_t size) {
+    noteAlloc(size);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+} // namespace
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    noteAlloc(size);
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    noteAlloc(size);
+    return malloc(size ? size : 1);
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+namespace {
+
+struct Options {
+    std::vector<std::string> transports;        // 空表示全部
+    long long kernels = 0;                      // 计数阶段的 kernel 数，0 为至少跨过一次检查点
+    size_t recordEvents = DEFAULT_RECORD_EVENTS;
+    long long warmup = 1000;
+    int port = 29998;
+    bool record = false;
+};
+
+Options g_opt;
+
+const char* const MODEL = "llama-8b";
+
+// 名字都长于短字符串优化的容量，避免“恰好不分配”
+const char* const KERNELS[] = {
+    "void flashinfer::BatchPrefillWithRaggedKVCacheKernel<flashinfer::KernelTraits<(flashinfer::MaskMode)1, 128u>",
+    "void flashinfer::BatchDecodeWithPagedKVCacheKernel<(flashinfer::PosEncodingMode)0, 2u, 4u, 8u>",
+    "sm90_xmma_gemm_bf16bf16_bf16f32_f32_tn_n_tilesize128x128x64_warpgroupsize1x1x1_execute_segment_k_off_kernel",
+    "void flashinfer::norm::FusedAddRMSNormKernel<8u, __nv_bfloat16>",
+    "void flashinfer::activation::act_and_mul_kernel<__nv_bfloat16, &silu>",
+    "void at::native::vectorized_elementwise_kernel<4, at::native::FillFunctor<long>>",
+};
+const size_t NUM_KERNELS = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+// ===== 包装通道: 在会话线程上按消息序号开关计数 =====
+
+struct Probe {
+    long long startAt = 0;                      // 收到这么多条消息后开始计数
+    long long stopAt = 0;                       // 收到这么多条消息后停止
+    std::atomic<long long> received{0};
+    std::atomic<bool> ended{false};
+};
+
+class CountingChannel : public IChannel {
+public:
+    CountingChannel(std::unique_ptr<IChannel> inner, std::shared_ptr<Probe> probe)
+        : inner(std::move(inner)), probe(std::move(probe)) {}
+
+    ~CountingChannel() override {
+        t_counting = false;
+        probe->ended.store(true);
+    }
+
+    bool recvBlocking(std::string& outMsg) override {
+        // 上一条消息已处理完: 到达边界时切换计数 (本次接收本身也在计数范围内)
+        long long n = probe->received.load(std::memory_order_relaxed);
+        if (n == probe->startAt) t_counting = true;
+        stopAfterLast();
+        if (!inner->recvBlocking(outMsg)) return false;
+        probe->received.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    bool sendBlocking(const std::string& msg) override { return inner->sendBlocking(msg); }
+    bool isConnected() override {
+        // 会话循环可能不再调用 recvBlocking 就直接结束，结束处理不计入
+        stopAfterLast();
+        return inner->isConnected();
+    }
+    void setReady() override { inner->setReady(); }
+    void flush() override { inner->flush(); }
+    std::string getId() const override { return inner->getId(); }
+    std::string getType() const override { return inner->getType(); }
+    std::string getName() const override { return inner->getName(); }
+
+private:
+    void stopAfterLast() {
+        if (probe->received.load(std::memory_order_relaxed) >= probe->stopAt) t_counting = false;
+    }
+
+    std::unique_ptr<IChannel> inner;
+    std::shared_ptr<Probe> probe;
+};
+
+// ===== 客户端: 请求与遥测交替，三种启动参数组合轮换，形状逐个 kernel 不同 =====
+
+struct ClientResult {
+    bool ok = true;
+    std::string error;
+};
+
+void runClient(const TransportCase& t, long long kernels, ClientResult& result) {
+    ShmClient client("sglang", "alloc");
+    client.setTransport(t.clientSpec);
+    if (!client.connect(5000)) {
+        result.ok = false;
+        result.error = "connect failed";
+        return;
+    }
+    client.post(std::string("#M|") + MODEL + "|0");
+    std::string msg, response;
+    char launch[160];
+    for (long long i = 0; i < kernels; i++) {
+        const char* kernel = KERNELS[i % NUM_KERNELS];
+        // 1 ~ 8192 token，按 Knuth 乘法散列打乱；FLOP/字节数带着不规整的尾数，每个 kernel 的参数文本都不同
+        unsigned tokens = 1 + static_cast<unsigned>((static_cast<uint64_t>(i) * 2654435761u) % 8192);
+        double flops = tokens * 1.0e9 * (1 + (i % 997) / 997.0);
+        double bytes = tokens * 3.3e6 + i;
+        snprintf(launch, sizeof(launch), "grid=%ux1x1,block=128,tokens=%u,flops=%.17g,bytes=%.17g",
+                 (tokens + 127) / 128, tokens, flops, bytes);
+        // 0: 都不带参数；1: 只有请求带 (遥测沿用)；2: 都带
+        int mode = static_cast<int>(i % 3);
+        std::string reqId = std::to_string(i);
+        msg = std::string(kernel) + "|" + reqId + "|alloc|alloc";
+        if (mode != 0) msg += std::string("|") + launch;
+        if (!client.request(msg, response) || response.compare(0, reqId.size() + 3, reqId + "|1|") != 0) {
+            result.ok = false;
+            result.error = "bad response for kernel " + reqId + ": '" + response + "'";
+            break;
+        }
+        msg = std::string("#T|") + kernel + "|" + reqId + "|" + std::to_string(2000 + tokens * 3);
+        if (mode == 2) msg += std::string("|") + launch;
+        if (!client.post(msg)) {
+            result.ok = false;
+            result.error = "telemetry for kernel " + reqId + " failed";
+            break;
+        }
+    }
+    client.disconnect();
+}
+
+// 返回失败数 (跳过不计)
+int runTransport(const TransportCase& t, const std::string& costPath) {
+    std::unique_ptr<IIPCServer> server = t.makeServer();
+    if (!server->init()) {
+        printf("[%s] SKIP (server init failed)\n", t.name.c_str());
+        return 0;
+    }
+    long long total = g_opt.warmup + g_opt.kernels;
+    std::unique_ptr<Scheduler> scheduler(new Scheduler(createPolicy("default"), g_opt.recordEvents));
+    scheduler->openCostStore(costPath, 1024);
+
+    // 每个 kernel 两条消息 (请求 + 遥测)，之前一条模型声明
+    std::shared_ptr<Probe> probe = std::make_shared<Probe>();
+    probe->startAt = 1 + 2 * g_opt.warmup;
+    probe->stopAt = 1 + 2 * total;
+    Scheduler* s = scheduler.get();
+    server->start([s, probe](std::unique_ptr<IChannel> channel) {
+        s->onNewClient(std::unique_ptr<IChannel>(new CountingChannel(std::move(channel), probe)));
+    });
+
+    g_allocs.store(0);
+    g_allocBytes.store(0);
+    ClientResult client;
+    auto start = std::chrono::steady_clock::now();
+    runClient(t, total, client);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int i = 0; i < 1000 && !probe->ended.load(); i++) usleep(10000);
+    server->stop();
+    scheduler->stop();
+
+    uint64_t allocs = g_allocs.load(), bytes = g_allocBytes.load();
+    long long measured = std::max(0LL, (probe->received.load() - probe->startAt) / 2);
+    bool ok = client.ok && measured == g_opt.kernels && allocs == 0;
+    printf("[%s] %s  %lld kernels after %lld warmup, %llu allocations (%llu bytes), %.3f allocs/kernel, "
+           "%.0f kernels/s\n", t.name.c_str(), ok ? "PASS" : "FAIL", measured, g_opt.warmup,
+           static_cast<unsigned long long>(allocs), static_cast<unsigned long long>(bytes),
+           measured ? static_cast<double>(allocs) / measured : 0.0, total / seconds);
+    if (!client.ok) printf("[%s]   client: %s\n", t.name.c_str(), client.error.c_str());
+    else if (measured != g_opt.kernels) printf("[%s]   session saw %lld of %lld kernels\n", t.name.c_str(), measured,
+                                               g_opt.kernels);
+    printf("RESULT transport=%s kernels=%lld allocs=%llu bytes=%llu\n", t.name.c_str(), measured,
+           static_cast<unsigned long long>(allocs), static_cast<unsigned long long>(bytes));
+
+    if (g_opt.record) {
+        ResultRecord rec("alloc_test");
+        rec.config("transport", t.name);
+        rec.config("kernels", g_opt.kernels);
+        rec.metric("allocs_per_kernel", measured ? static_cast<double>(allocs) / measured : 0.0, "count", false);
+        rec.append();
+    }
+    return ok ? 0 : 1;
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --transport <name>   shm | memfd | tcp | unix | uring-tcp | uring-unix (repeatable, default all)\n"
+              << "  --kernels <n>        kernels checked after warmup (default: enough to cross a recorder\n"
+              << "                       checkpoint, recorder events / 8)\n"
+              << "  --record-events <n>  decision recorder capacity (default " << DEFAULT_RECORD_EVENTS << ")\n"
+              << "  --warmup <n>         kernels before counting starts (default 1000)\n"
+              << "  --port <n>           TCP port (default 29998)\n"
+              << "  --trace              print a backtrace for the first allocations\n"
+              << "  --record             append the result to the benchmark result store\n";
+}
+
+bool parseArgs(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"transport", required_argument, nullptr, 't'},
+        {"kernels", required_argument, nullptr, 'k'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"record-events", required_argument, nullptr, 'e'},
+        {"port", required_argument, nullptr, 'p'},
+        {"trace", no_argument, nullptr, 'T'},
+        {"record", no_argument, nullptr, 'R'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 't': g_opt.transports.push_back(optarg); break;
+        case 'k': g_opt.kernels = std::max(1LL, atoll(optarg)); break;
+        case 'w': g_opt.warmup = std::max(0LL, atoll(optarg)); break;
+        case 'e': g_opt.recordEvents = std::max(1ULL, strtoull(optarg, nullptr, 10)); break;
+        case 'p': g_opt.port = atoi(optarg); break;
+        case 'T': g_trace = true; break;
+        case 'R': g_opt.record = true; break;
+        default: return false;
+        }
+    }
+    // 每个 kernel 至少两条事件 (请求 + 遥测)，检查点每 1/4 缓冲区一次
+    if (g_opt.kernels == 0) g_opt.kernels = std::max<long long>(10000, g_opt.recordEvents / 8 + 1);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+    setenv("USER", ("ksalloc" + std::to_string(getpid())).c_str(), 1);
+    signal(SIGPIPE, SIG_IGN);
+    // backtrace 首次调用会加载 libgcc，提前触发
+    void* frame;
+    backtrace(&frame, 1);
+
+    // 会话日志写在 logs/ 下，切到临时目录
+    char dir[] = "/tmp/ksalloc.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+    printf("=== Hot-path allocations (logs in %s) ===\n", dir);
+
+    std::vector<TransportCase> cases = transportCases(g_opt.port);
+    for (const auto& name : g_opt.transports) {
+        bool known = false;
+        for (const auto& t : cases) known = known || t.name == name;
+        if (!known) {
+            std::cerr << "[AllocTest] Unknown transport: " << name << std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    int failures = 0;
+    for (const auto& t : cases) {
+        if (!g_opt.transports.empty() &&
+            std::find(g_opt.transports.begin(), g_opt.transports.end(), t.name) == g_opt.transports.end()) {
+            continue;
+        }
+        failures += runTransport(t, std::string(dir) + "/costs-" + t.name);
+    }
+    printf("%s: %d transport(s) allocated on the hot path\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,245 @@
+// ============================================================
+//  重 kernel 串行化与回填的效果 (虚拟时钟仿真)
+//  若干 prefill 客户端循环提交重 kernel，若干 decode 客户端循环提交小 kernel，
+//  每个客户端等上一个 kernel 做完、思考一段时间后再提交。GPU 模型:
+//      重 kernel 占满 SM，按放行顺序依次完成；前一个还没做完就放行的与之争抢，
+//      自身耗时按 --contention 放大 (缓存与 SM 互相挤占)；
+//      小 kernel 放行即在空闲 SM 上执行，不排队。
+//  策略看到的预测耗时为真实耗时加上相对噪声。同一负载依次用 default、serialize、backfill 策略运行，
+//  比较小 kernel 被扣住的时间与端到端延迟、重 kernel 被扣住的时间、回填数与占用的 slack。
+//  backfill 没有减少小 kernel 的等待，或一个也没有回填时退出码为 1。
+// ============================================================
+
+#include "backfill.h"
+#include "../result_store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int heavyClients = 2;
+    int smallClients = 4;
+    double durationMs = 10000;       // 虚拟时间
+    double noise = 0.1;              // 预测的相对噪声 (标准差)
+    double contention = 0.3;         // 重 kernel 并发时的耗时放大
+    bool record = false;
+};
+
+Options g_opt;
+
+const char* const HEAVY_KERNEL = "void flashinfer::BatchPrefillWithRaggedKVCacheKernel";
+const char* const SMALL_KERNEL = "void flashinfer::BatchDecodeWithPagedKVCacheKernel";
+
+struct SimClient {
+    std::string key;
+    bool heavy;
+    int64_t requestNs;               // 当前 kernel 的提交时刻
+    int64_t actualNs;
+};
+
+// 事件: 客户端提交 kernel，或被扣住的 kernel 到时放行
+struct Event {
+    int64_t tsNs;
+    uint64_t seq;
+    size_t client;
+    bool admit;
+    bool operator>(const Event& o) const { return tsNs != o.tsNs ? tsNs > o.tsNs : seq > o.seq; }
+};
+
+struct RunResult {
+    std::string policy;
+    uint64_t smallKernels = 0, heavyKernels = 0;
+    uint64_t smallWaited = 0, heavyHeld = 0, backfilled = 0;
+    double smallHoldMs = 0, heavyHoldMs = 0, slackMs = 0;
+    std::vector<double> smallLatencyUs;
+    std::vector<double> heavyLatencyMs;
+    std::string state;               // 策略的 describe()
+};
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+RunResult simulate(const std::string& policyName) {
+    RunResult r;
+    r.policy = policyName;
+    std::unique_ptr<IPolicy> policy = createPolicy(policyName);
+
+    // 每个策略用同一随机序列，负载相同
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::normal_distribution<double> noise(0, g_opt.noise);
+    auto heavyNs = [&]() { return static_cast<int64_t>((2 + 4 * unit(rng)) * 1e6); };      // 2-6 ms
+    auto smallNs = [&]() { return static_cast<int64_t>((20 + 180 * unit(rng)) * 1e3); };   // 20-200 us
+    auto thinkNs = [&](bool heavy) { return static_cast<int64_t>((heavy ? 1000 : 50) * (0.5 + unit(rng)) * 1e3); };
+
+    std::vector<SimClient> clients;
+    for (int i = 0; i < g_opt.heavyClients; i++) clients.push_back({"prefill:" + std::to_string(i), true, 0, 0});
+    for (int i = 0; i < g_opt.smallClients; i++) clients.push_back({"decode:" + std::to_string(i), false, 0, 0});
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t seq = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        policy->onClientAttach(clients[i].key, clients[i].heavy ? "prefill" : "decode", 0);
+        events.push({static_cast<int64_t>(i) * 10000, seq++, i, false});
+    }
+
+    const int64_t endNs = static_cast<int64_t>(g_opt.durationMs * 1e6);
+    int64_t heavyFreeNs = 0;         // 已放行的重 kernel 全部做完的时刻
+    uint64_t reqId = 0;
+    while (!events.empty()) {
+        Event ev = events.top();
+        events.pop();
+        SimClient& c = clients[ev.client];
+        if (!ev.admit) {
+            if (ev.tsNs >= endNs) continue;
+            c.requestNs = ev.tsNs;
+            c.actualNs = c.heavy ? heavyNs() : smallNs();
+            int64_t predicted = static_cast<int64_t>(c.actualNs * std::max(0.1, 1 + noise(rng)));
+            PolicyRequest req{c.key, c.heavy ? HEAVY_KERNEL : SMALL_KERNEL, std::to_string(++reqId), LaunchMeta(),
+                              predicted};
+            PolicyDecision d = policy->decide(req, ev.tsNs);
+            int64_t holdNs = std::max<int64_t>(0, d.holdNs);
+            if (c.heavy) {
+                r.heavyKernels++;
+                if (holdNs) r.heavyHeld++;
+                r.heavyHoldMs += holdNs / 1e6;
+            } else {
+                r.smallKernels++;
+                if (holdNs) r.smallWaited++;
+                r.smallHoldMs += holdNs / 1e6;
+            }
+            if (d.reason == "backfill") {
+                r.backfilled++;
+                r.slackMs += predicted / 1e6;
+            }
+            events.push({ev.tsNs + holdNs, seq++, ev.client, true});
+            continue;
+        }
+        // 放行: 在 GPU 上执行，做完后遥测并思考一段时间再提交下一个
+        int64_t finishNs = ev.tsNs + c.actualNs;
+        if (c.heavy) {
+            if (ev.tsNs < heavyFreeNs) {
+                c.actualNs = static_cast<int64_t>(c.actualNs * (1 + g_opt.contention));
+                finishNs = heavyFreeNs + c.actualNs;
+            }
+            heavyFreeNs = finishNs;
+        }
+        policy->onTelemetry(c.key, c.heavy ? HEAVY_KERNEL : SMALL_KERNEL, LaunchMeta(), c.actualNs, finishNs);
+        if (c.heavy) r.heavyLatencyMs.push_back((finishNs - c.requestNs) / 1e6);
+        else r.smallLatencyUs.push_back((finishNs - c.requestNs) / 1e3);
+        events.push({finishNs + thinkNs(c.heavy), seq++, ev.client, false});
+    }
+    r.state = policy->describe();
+    return r;
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --heavy-clients <n>  clients issuing prefill-sized kernels (default 2)\n"
+              << "  --small-clients <n>  clients issuing decode-sized kernels (default 4)\n"
+              << "  --duration-ms <ms>   simulated time (default 10000)\n"
+              << "  --noise <f>          relative prediction noise (default 0.1)\n"
+              << "  --contention <f>     slowdown of a heavy kernel admitted while another runs (default 0.3)\n"
+              << "  --record             append the result to the benchmark result store\n";
+}
+
+bool parseArgs(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"heavy-clients", required_argument, nullptr, 'H'},
+        {"small-clients", required_argument, nullptr, 'S'},
+        {"duration-ms", required_argument, nullptr, 'd'},
+        {"noise", required_argument, nullptr, 'n'},
+        {"contention", required_argument, nullptr, 'c'},
+        {"record", no_argument, nullptr, 'R'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 'H': g_opt.heavyClients = std::max(2, atoi(optarg)); break;
+        case 'S': g_opt.smallClients = std::max(1, atoi(optarg)); break;
+        case 'd': g_opt.durationMs = std::max(1.0, atof(optarg)); break;
+        case 'n': g_opt.noise = std::max(0.0, atof(optarg)); break;
+        case 'c': g_opt.contention = std::max(0.0, atof(optarg)); break;
+        case 'R': g_opt.record = true; break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<RunResult> runs;
+    for (const char* name : {"default", "serialize", "backfill"}) runs.push_back(simulate(name));
+    const RunResult& serialize = runs[1];
+    const RunResult& backfill = runs[2];
+
+    // ===== 报告 =====
+    printf("=== Backfill (%d heavy + %d small clients, %.0f ms simulated, noise %.0f%%) ===\n", g_opt.heavyClients,
+           g_opt.smallClients, g_opt.durationMs, g_opt.noise * 100);
+    printf("  %-10s %9s %9s %11s %10s %10s %9s %11s %9s %11s %9s\n", "policy", "small", "waited", "wait_ms",
+           "p50_us", "p99_us", "heavy", "held_ms", "p50_ms", "backfilled", "slack_ms");
+    for (const RunResult& r : runs) {
+        printf("  %-10s %9llu %9llu %11.1f %10.1f %10.1f %9llu %11.1f %9.2f %11llu %9.1f\n", r.policy.c_str(),
+               static_cast<unsigned long long>(r.smallKernels), static_cast<unsigned long long>(r.smallWaited),
+               r.smallHoldMs, percentile(r.smallLatencyUs, 0.5), percentile(r.smallLatencyUs, 0.99),
+               static_cast<unsigned long long>(r.heavyKernels), r.heavyHoldMs, percentile(r.heavyLatencyMs, 0.5),
+               static_cast<unsigned long long>(r.backfilled), r.slackMs);
+    }
+    printf("\n%s", backfill.state.c_str());
+
+    int failures = 0;
+    // 每个小 kernel 的平均等待，两种策略下提交的 kernel 数可能不同
+    double serializeWait = serialize.smallKernels ? serialize.smallHoldMs / serialize.smallKernels : 0;
+    double backfillWait = backfill.smallKernels ? backfill.smallHoldMs / backfill.smallKernels : 0;
+    if (backfill.backfilled == 0) {
+        printf("  FAIL: no kernel was backfilled\n");
+        failures++;
+    }
+    if (backfillWait >= serializeWait) {
+        printf("  FAIL: backfill does not reduce small-kernel waiting (%.3f vs %.3f ms/kernel)\n", backfillWait,
+               serializeWait);
+        failures++;
+    }
+    // 便于脚本解析的单行结果
+    printf("RESULT heavy=%d small=%d noise=%.3f serialize_wait_ms=%.4f backfill_wait_ms=%.4f backfilled=%llu "
+           "slack_ms=%.1f\n", g_opt.heavyClients, g_opt.smallClients, g_opt.noise, serializeWait, backfillWait,
+           static_cast<unsigned long long>(backfill.backfilled), backfill.slackMs);
+
+    if (g_opt.record) {
+        ResultRecord rec("backfill_bench");
+        rec.config("heavy_clients", g_opt.heavyClients);
+        rec.config("small_clients", g_opt.smallClients);
+        rec.config("duration_ms", g_opt.durationMs);
+        rec.config("noise", g_opt.noise);
+        rec.config("contention", g_opt.contention);
+        rec.metric("serialize_wait_ms", serializeWait, "ms", false);
+        rec.metric("backfill_wait_ms", backfillWait, "ms", false);
+        rec.metric("backfill_small_p99_us", percentile(backfill.smallLatencyUs, 0.99), "us", false);
+        rec.metric("backfilled", static_cast<double>(backfill.backfilled), "kernels", true);
+        rec.append();
+    }
+    return failures ? 1 : 0;
+}
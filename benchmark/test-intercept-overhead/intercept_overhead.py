@@ -2,12 +2,41 @@ import matplotlib.pyplot as plt
 import seaborn as sns
 import pandas as pd
 import numpy as np
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import result_store
 
 # Set style (removed Chinese font settings to rely on system defaults)
 sns.set_theme(style="whitegrid")
 
 # === 1. Data Preparation ===
-raw_data = [
+# 结果存储中 benchmark 为 intercept_overhead 的记录 (config.setting 区分设置，每次运行一条):
+#   python result_store.py add --benchmark intercept_overhead --config setting="w/ sglang" \
+#       --metric prefill_throughput=23290.35:higher --metric prefill_latency=1.40693 \
+#       --metric decode_throughput=3325.70:higher --metric decode_latency=0.01924
+# 存储中没有记录时使用下面的历史测量值
+SETTINGS = ['w/o intercept', 'w/ sglang', 'w/ pytorch', 'w/ all sides']
+
+
+def load_from_store():
+    runs = {}
+    for r in result_store.load():
+        if r.get("benchmark") == "intercept_overhead":
+            runs.setdefault(r.get("config", {}).get("setting"), []).append(r["metrics"])
+    rows = []
+    for setting in [s for s in SETTINGS if s in runs] + [s for s in runs if s not in SETTINGS]:
+        for phase in ('Prefill', 'Decode'):
+            for metric in ('Throughput', 'Latency'):
+                key = f"{phase.lower()}_{metric.lower()}"
+                values = [m[key]["value"] for m in runs[setting] if key in m]
+                if values:
+                    rows.append({'Setting': setting, 'Phase': phase, 'Metric': metric, 'Value': np.mean(values)})
+    return rows
+
+
+raw_data = load_from_store() or [
     # --- w/o intercept ---
     {'Setting': 'w/o intercept', 'Phase': 'Prefill', 'Metric': 'Throughput', 'Value': np.mean([24742.47, 40157.75, 23580.34, 40108.51])},
     {'Setting': 'w/o intercept', 'Phase': 'Prefill', 'Metric': 'Latency', 'Value': np.mean([1.32436, 0.81598, 1.38963, 0.81698])},
@@ -0,0 +1,73 @@
+#!/bin/bash
+# 大页通道对比: 64 个活跃通道下 4 KiB 页与 2 MiB 大页的 dTLB miss 与延迟
+#   ./hugepage_bench.sh [ipc_bench 参数...]        (默认 --clients 64 --kernels 20000)
+# 需要 hugetlbfs 挂载且预留足够大页: 每个通道 1 个 2 MiB 页，注册表 1 个
+#   sudo sysctl vm.nr_hugepages=80 && sudo mount -t hugetlbfs none /dev/hugepages
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SCHEDULER=${SCHEDULER:-$BENCH_DIR/../../server/scheduler}
+BENCH=$BENCH_DIR/ipc_bench
+ARGS=("$@")
+[ ${#ARGS[@]} -eq 0 ] && ARGS=(--clients 64 --kernels 20000)
+
+# 使用独立的注册表名，避免与正在运行的调度器互相干扰
+export USER="${USER:-nouser}_huge"
+
+SCHED_PID=""
+WORK_DIR=""
+
+start_scheduler() {
+    WORK_DIR=$(mktemp -d)
+    (cd "$WORK_DIR" && exec "$SCHEDULER" --record-events 0 "$@" > "$WORK_DIR/scheduler.log" 2>&1) &
+    SCHED_PID=$!
+    for _ in $(seq 1 100); do
+        grep -q "System running" "$WORK_DIR/scheduler.log" 2>/dev/null && return 0
+        sleep 0.05
+    done
+    echo "[Huge] scheduler failed to start" >&2
+    cat "$WORK_DIR/scheduler.log" >&2
+    return 1
+}
+
+stop_scheduler() {
+    if [ -n "$SCHED_PID" ]; then
+        kill -INT "$SCHED_PID" 2>/dev/null || true
+        wait "$SCHED_PID" 2>/dev/null || true
+        SCHED_PID=""
+    fi
+    [ -n "$WORK_DIR" ] && rm -rf "$WORK_DIR"
+    WORK_DIR=""
+}
+trap stop_scheduler EXIT
+
+results=()
+for variant in 4k huge; do
+    if [ "$variant" = huge ]; then
+        start_scheduler --huge-pages
+        grep -q "huge pages" "$WORK_DIR/scheduler.log" || echo "[Huge] no hugetlbfs available, 'huge' falls back to 4 KiB pages" >&2
+        export KS_HUGE_PAGES=1
+    else
+        start_scheduler
+        export KS_HUGE_PAGES=0
+    fi
+    line=$("$BENCH" --label "$variant" --server-pid "$SCHED_PID" "${ARGS[@]}" | grep '^RESULT')
+    stop_scheduler
+    echo "  $line"
+    results+=("$line")
+done
+
+printf '%s\n' "${results[@]}" | awk '
+    {
+        for (i = 2; i <= NF; i++) { split($i, kv, "="); f[$2, kv[1]] = kv[2] }
+        labels[++n] = $2
+    }
+    END {
+        printf "\n%-12s %12s %10s %10s %14s %14s\n", "variant", "kernels/s", "p50_us", "p99_us", "client_dtlb", "server_dtlb"
+        for (k = 1; k <= n; k++) {
+            l = labels[k]; split(l, lv, "=")
+            printf "%-12s %12s %10s %10s %14s %14s\n", lv[2], f[l, "throughput"], f[l, "p50_us"], f[l, "p99_us"],
+                f[l, "client_dtlb"], f[l, "server_dtlb"]
+        }
+    }'
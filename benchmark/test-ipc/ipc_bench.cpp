@@ -0,0 +1,472 @@
+// ============================================================
+//  IPC 往返延迟微基准
+//  启动若干合成客户端 (线程)，按代表性的 kernel 序列向调度器发送请求，
+//  统计每条 kernel 请求的往返延迟 (RTT) 与吞吐。
+//  kernel 序列默认模拟 Llama 类模型的 prefill/decode 步，
+//  也可以用 --kernel-file 回放调度器日志 (logs/*/process_*.log) 中记录的真实序列。
+// ============================================================
+
+#include "shm_client.h"
+#include "../result_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int clients = 1;
+    long long kernels = 100000;      // 每个客户端
+    long long warmup = 1000;
+    double rate = 0;                 // 每客户端 kernel/s，0 表示闭环
+    std::string clientType = "sglang";
+    std::string kernelFile;
+    std::string label = "shm";
+    bool record = false;
+    pid_t serverPid = 0;
+    uint32_t slots = 0;              // 0 表示使用客户端默认 ($KS_SLOT_COUNT 或 1024)
+    uint32_t slotSize = 0;
+    std::string transport;           // 空表示使用客户端默认 ($KS_TRANSPORT 或 shm)
+    std::string model;               // 空表示使用 $KS_MODEL (未设置则不声明)
+    bool telemetry = false;
+    bool launch = false;             // 请求与遥测附带合成的启动参数
+    int pipeline = 1;                // 每个客户端同时在途的请求数
+};
+
+Options g_opt;
+
+// ===== dTLB miss 计数 (perf_event_open，仅用户态) =====
+
+class TlbCounter {
+public:
+    ~TlbCounter() {
+        for (int fd : fds_) close(fd);
+    }
+
+    // inherit 为 true 时同时统计之后创建的线程 (线程退出时计数并入)
+    bool addTask(pid_t tid, bool inherit) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.inherit = inherit ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0));
+        if (fd == -1) return false;
+        fds_.push_back(fd);
+        return true;
+    }
+
+    // 进程当前的全部线程
+    bool addProcess(pid_t pid) {
+        std::string dir = "/proc/" + std::to_string(pid) + "/task";
+        DIR* d = opendir(dir.c_str());
+        if (!d) return false;
+        bool any = false;
+        while (struct dirent* e = readdir(d)) {
+            if (e->d_name[0] != '.') any = addTask(static_cast<pid_t>(atoi(e->d_name)), false) || any;
+        }
+        closedir(d);
+        return any;
+    }
+
+    void enable() {
+        for (int fd : fds_) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    void disable() {
+        for (int fd : fds_) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    // 不可用时返回 -1
+    long long read() const {
+        if (fds_.empty()) return -1;
+        long long total = 0;
+        for (int fd : fds_) {
+            long long v = 0;
+            if (::read(fd, &v, sizeof(v)) == sizeof(v)) total += v;
+        }
+        return total;
+    }
+
+private:
+    std::vector<int> fds_;
+};
+
+// 一个 decoder layer 的 kernel 序列 (prefill 与 decode 只有 attention 不同)
+const char* const LAYER_KERNELS[] = {
+    "void flashinfer::norm::FusedAddRMSNormKernel<8u, __nv_bfloat16>",
+    "sm90_xmma_gemm_bf16bf16_bf16f32_f32_tn_n_tilesize128x128x64_warpgroupsize1x1x1_execute_segment_k_off_kernel__5x_cublas",
+    "void flashinfer::BatchQKApplyRotaryPosIdsCosSinCacheKernel<true, 128u, 8u, 16u, __nv_bfloat16, long>",
+    nullptr,   // attention 占位
+    "sm90_xmma_gemm_bf16bf16_bf16f32_f32_tn_n_tilesize64x128x64_warpgroupsize1x1x1_execute_segment_k_off_kernel__5x_cublas",
+    "void flashinfer::norm::FusedAddRMSNormKernel<8u, __nv_bfloat16>",
+    "sm90_xmma_gemm_bf16bf16_bf16f32_f32_tn_n_tilesize128x256x64_warpgroupsize2x1x1_execute_segment_k_off_kernel__5x_cublas",
+    "void flashinfer::activation::act_and_mul_kernel<__nv_bfloat16, &silu>",
+    "sm90_xmma_gemm_bf16bf16_bf16f32_f32_tn_n_tilesize64x128x64_warpgroupsize1x1x1_execute_segment_k_off_kernel__5x_cublas",
+};
+const char* const PREFILL_ATTN =
+    "void flashinfer::BatchPrefillWithRaggedKVCacheKernel<flashinfer::KernelTraits<(flashinfer::MaskMode)1, 128u, 1u, 4u>";
+const char* const DECODE_ATTN =
+    "void flashinfer::BatchDecodeWithPagedKVCacheKernel<(flashinfer::PosEncodingMode)0, 2u, 4u, 8u, 16u, 1u, 8u>";
+const int NUM_LAYERS = 32;
+const int DECODE_STEPS_PER_PREFILL = 16;
+
+std::vector<std::string> builtinStream() {
+    std::vector<std::string> stream;
+    for (int step = 0; step < DECODE_STEPS_PER_PREFILL; step++) {
+        const char* attn = (step == 0) ? PREFILL_ATTN : DECODE_ATTN;
+        stream.push_back("void at::native::vectorized_elementwise_kernel<4, at::native::FillFunctor<long>>");
+        for (int layer = 0; layer < NUM_LAYERS; layer++) {
+            for (const char* k : LAYER_KERNELS) stream.push_back(k ? k : attn);
+        }
+        stream.push_back("void flashinfer::norm::RMSNormKernel<8u, __nv_bfloat16>");
+        stream.push_back("sm90_xmma_gemm_bf16bf16_bf16f32_f32_tn_n_tilesize128x256x64_warpgroupsize2x1x1_execute_segment_k_off_kernel__5x_cublas");
+        stream.push_back("void at::native::reduce_kernel<512, 1, at::native::ReduceOp<float, at::native::ArgMaxOps<float>>>");
+    }
+    return stream;
+}
+
+// 支持纯文本 (每行一个 kernel 名) 或调度器日志中的 "Kernel <id>: <name> from <client>" 行
+std::vector<std::string> loadStream(const std::string& path) {
+    std::vector<std::string> stream;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '=') continue;
+        if (line.compare(0, 7, "Kernel ") == 0) {
+            size_t colon = line.find(": ");
+            size_t from = line.rfind(" from ");
+            if (colon == std::string::npos || from == std::string::npos || from <= colon) continue;
+            line = line.substr(colon + 2, from - colon - 2);
+        }
+        stream.push_back(line);
+    }
+    return stream;
+}
+
+// --telemetry 上报的耗时: 按 kernel 名确定的 2~42 us，不同运行之间可比
+long long syntheticDurationNs(const std::string& kernel) {
+    unsigned long long h = 1469598103934665603ull;
+    for (char c : kernel) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    return 2000 + static_cast<long long>(h % 40000);
+}
+
+// --launch 的合成启动参数: 每轮 kernel 序列换一个 batch 规模 (prefill 512~4096 token，decode 16~128)，
+// 按 4096 隐藏维的 GEMM 估算 FLOP 与字节数
+uint32_t syntheticTokens(long long i, size_t streamLen, bool builtin) {
+    long long cycle = i / static_cast<long long>(streamLen);
+    uint32_t scale = static_cast<uint32_t>(1 + cycle % 8);
+    if (!builtin) return 16 * scale;
+    size_t step = static_cast<size_t>(i % static_cast<long long>(streamLen)) / (streamLen / DECODE_STEPS_PER_PREFILL);
+    return (step == 0 ? 512 : 16) * scale;
+}
+
+std::string syntheticLaunch(uint32_t tokens) {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "grid=%ux32x1,block=256,smem=49152,stream=7,tokens=%u,flops=%.0f,bytes=%.0f",
+             (tokens + 127) / 128, tokens, 2.0 * tokens * 4096 * 4096, 2.0 * (4096.0 * 4096 + 2.0 * tokens * 4096));
+    return buf;
+}
+
+// 带启动参数时耗时随 token 数线性增长
+long long syntheticDurationNs(const std::string& kernel, uint32_t tokens) {
+    long long base = syntheticDurationNs(kernel);
+    return tokens ? base + base * tokens / 256 : base;
+}
+
+struct ClientResult {
+    std::vector<double> rttUs;
+    double firstRttUs = 0;       // 会话的第一条请求 (不论是否预热)
+    long attachFaults = 0;       // 建立通道时客户端侧的缺页
+    bool ok = false;
+};
+
+std::atomic<int> g_ready(0);
+std::atomic<bool> g_go(false);
+
+void clientLoop(int index, const std::vector<std::string>* stream, ClientResult* result) {
+    const bool builtin = g_opt.kernelFile.empty();
+    std::string uniqueId = "bench" + std::to_string(index) + "_" + std::to_string(getpid());
+    ShmClient client(g_opt.clientType, uniqueId);
+    if (g_opt.slots || g_opt.slotSize) client.setGeometry(g_opt.slots, g_opt.slotSize);
+    if (!g_opt.transport.empty()) client.setTransport(g_opt.transport);
+    if (!g_opt.model.empty()) client.setModel(g_opt.model);
+    if (!client.connect(10000)) {
+        std::cerr << "[Bench] client " << index << " failed to connect" << std::endl;
+        g_ready.fetch_add(1);
+        return;
+    }
+    result->attachFaults = client.getChannelSegment().minorFaults + client.getChannelSegment().majorFaults;
+    g_ready.fetch_add(1);
+    while (!g_go.load()) std::this_thread::yield();
+
+    std::string response;
+    result->rttUs.reserve(static_cast<size_t>(g_opt.kernels));
+    const long long total = g_opt.warmup + g_opt.kernels;
+    const std::string clientId = std::to_string(getpid());
+    auto next = std::chrono::steady_clock::now();
+    const auto interval = g_opt.rate > 0
+        ? std::chrono::nanoseconds(static_cast<long long>(1e9 / g_opt.rate))
+        : std::chrono::nanoseconds(0);
+
+    if (g_opt.pipeline > 1) {
+        // 窗口内保持 pipeline 个在途请求，按应答里的 reqId 计算各自的 RTT
+        std::vector<std::chrono::steady_clock::time_point> sentAt(static_cast<size_t>(total));
+        long long sent = 0, received = 0;
+        char buf[1024];
+        while (received < total) {
+            while (sent < total && sent - received < g_opt.pipeline) {
+                const std::string& kernel = (*stream)[static_cast<size_t>(sent) % stream->size()];
+                std::string msg = kernel + "|" + std::to_string(sent) + "|" + clientId + "|" + uniqueId;
+                if (g_opt.launch) msg += "|" + syntheticLaunch(syntheticTokens(sent, stream->size(), builtin));
+                sentAt[static_cast<size_t>(sent)] = std::chrono::steady_clock::now();
+                if (!client.trySend(msg.data(), msg.size())) break;
+                sent++;
+            }
+            if (!client.recv(buf, sizeof(buf), 10000)) {
+                std::cerr << "[Bench] client " << index << " lost connection at " << received << std::endl;
+                return;
+            }
+            long long reqId = atoll(buf);
+            if (reqId < 0 || reqId >= sent) continue;
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                                  sentAt[static_cast<size_t>(reqId)]).count();
+            if (reqId == 0) result->firstRttUs = us;
+            if (reqId >= g_opt.warmup) result->rttUs.push_back(us);
+            received++;
+        }
+        client.disconnect();
+        result->ok = true;
+        return;
+    }
+
+    for (long long i = 0; i < total; i++) {
+        const std::string& kernel = (*stream)[static_cast<size_t>(i) % stream->size()];
+        std::string msg = kernel + "|" + std::to_string(i) + "|" + clientId + "|" + uniqueId;
+        uint32_t tokens = g_opt.launch ? syntheticTokens(i, stream->size(), builtin) : 0;
+        if (g_opt.launch) msg += "|" + syntheticLaunch(tokens);
+        if (g_opt.rate > 0) {
+            next += interval;
+            while (std::chrono::steady_clock::now() < next) std::this_thread::yield();
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        if (!client.request(msg, response)) {
+            std::cerr << "[Bench] client " << index << " lost connection at " << i << std::endl;
+            return;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        if (i == 0) result->firstRttUs = us;
+        if (i >= g_opt.warmup) result->rttUs.push_back(us);
+        if (g_opt.telemetry) {
+            std::string report = std::string(TELEMETRY_PREFIX) + "|" + kernel + "|" + std::to_string(i) + "|" +
+                                 std::to_string(syntheticDurationNs(kernel, tokens));
+            client.post(report);
+        }
+    }
+    client.disconnect();
+    result->ok = true;
+}
+
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    double pos = q * (sorted.size() - 1);
+    size_t lo = static_cast<size_t>(pos);
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --clients <n>        concurrent synthetic clients (default 1)\n"
+              << "  --kernels <n>        measured kernels per client (default 100000)\n"
+              << "  --warmup <n>         unmeasured kernels per client (default 1000)\n"
+              << "  --rate <r>           kernels/s per client, 0 = closed loop (default 0)\n"
+              << "  --type <t>           sglang | pytorch (default sglang)\n"
+              << "  --kernel-file <f>    replay kernel names from a file or scheduler log\n"
+              << "  --label <s>          label printed in the RESULT line\n"
+              << "  --record             append the result to the benchmark result store\n"
+              << "  --server-pid <pid>   also count the scheduler's dTLB misses\n"
+              << "  --slots <n>          ring slots per direction requested at registration\n"
+              << "  --slot-size <bytes>  slot size requested at registration\n"
+              << "  --transport <t>      shm | memfd | tcp[:host:port] | unix[:path] (default: $KS_TRANSPORT or shm)\n"
+              << "  --pipeline <n>       requests in flight per client (default 1)\n"
+              << "  --model <name>       declare the model after connecting (default: $KS_MODEL)\n"
+              << "  --telemetry          report a synthetic duration after every kernel\n"
+              << "  --launch             attach synthetic launch metadata (durations then scale with tokens)\n";
+}
+
+bool parseArgs(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"clients", required_argument, nullptr, 'c'},
+        {"kernels", required_argument, nullptr, 'k'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"type", required_argument, nullptr, 't'},
+        {"kernel-file", required_argument, nullptr, 'f'},
+        {"label", required_argument, nullptr, 'l'},
+        {"record", no_argument, nullptr, 'R'},
+        {"server-pid", required_argument, nullptr, 'p'},
+        {"slots", required_argument, nullptr, 'S'},
+        {"slot-size", required_argument, nullptr, 'Z'},
+        {"transport", required_argument, nullptr, 'T'},
+        {"model", required_argument, nullptr, 'M'},
+        {"telemetry", no_argument, nullptr, 'Y'},
+        {"pipeline", required_argument, nullptr, 'P'},
+        {"launch", no_argument, nullptr, 'L'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 'c': g_opt.clients = std::max(1, atoi(optarg)); break;
+        case 'k': g_opt.kernels = atoll(optarg); break;
+        case 'w': g_opt.warmup = atoll(optarg); break;
+        case 'r': g_opt.rate = atof(optarg); break;
+        case 't': g_opt.clientType = optarg; break;
+        case 'f': g_opt.kernelFile = optarg; break;
+        case 'l': g_opt.label = optarg; break;
+        case 'R': g_opt.record = true; break;
+        case 'p': g_opt.serverPid = static_cast<pid_t>(atoi(optarg)); break;
+        case 'S': g_opt.slots = static_cast<uint32_t>(atoi(optarg)); break;
+        case 'Z': g_opt.slotSize = static_cast<uint32_t>(atoi(optarg)); break;
+        case 'T': g_opt.transport = optarg; break;
+        case 'M': g_opt.model = optarg; break;
+        case 'Y': g_opt.telemetry = true; break;
+        case 'P': g_opt.pipeline = std::max(1, atoi(optarg)); break;
+        case 'L': g_opt.launch = true; break;
+        default: return false;
+        }
+    }
+    return g_opt.kernels > 0 && (g_opt.clientType == "sglang" || g_opt.clientType == "pytorch") &&
+           (g_opt.transport.empty() || ShmClient("sglang", "probe").setTransport(g_opt.transport));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> stream = g_opt.kernelFile.empty() ? builtinStream() : loadStream(g_opt.kernelFile);
+    if (stream.empty()) {
+        std::cerr << "[Bench] empty kernel stream" << std::endl;
+        return 1;
+    }
+
+    // 客户端计数器需在创建线程之前打开才能继承到各线程
+    TlbCounter clientTlb;
+    clientTlb.addTask(0, true);
+
+    std::vector<ClientResult> results(g_opt.clients);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < g_opt.clients; i++) {
+        threads.emplace_back(clientLoop, i, &stream, &results[i]);
+    }
+    while (g_ready.load() < g_opt.clients) usleep(1000);
+
+    // 所有会话建立后调度器的处理线程已全部存在
+    TlbCounter serverTlb;
+    if (g_opt.serverPid > 0 && !serverTlb.addProcess(g_opt.serverPid)) {
+        std::cerr << "[Bench] cannot count dTLB misses of pid " << g_opt.serverPid << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    clientTlb.enable();
+    serverTlb.enable();
+    g_go.store(true);
+    for (auto& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    clientTlb.disable();
+    serverTlb.disable();
+    long long clientMisses = clientTlb.read();
+    long long serverMisses = serverTlb.read();
+
+    std::vector<double> all;
+    int failed = 0;
+    double firstSum = 0, firstMax = 0;
+    long attachFaults = 0;
+    for (auto& r : results) {
+        if (!r.ok) failed++;
+        all.insert(all.end(), r.rttUs.begin(), r.rttUs.end());
+        firstSum += r.firstRttUs;
+        firstMax = std::max(firstMax, r.firstRttUs);
+        attachFaults += r.attachFaults;
+    }
+    if (all.empty()) {
+        std::cerr << "[Bench] no samples collected" << std::endl;
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+    double sum = 0;
+    for (double v : all) sum += v;
+
+    printf("=== IPC Round Trip (%s) ===\n", g_opt.label.c_str());
+    printf("  Clients    : %d (%d failed)\n", g_opt.clients, failed);
+    printf("  Kernels    : %zu measured, stream length %zu\n", all.size(), stream.size());
+    printf("  Throughput : %.0f kernels/s\n", all.size() / elapsed);
+    printf("  RTT (us)   : mean %.2f  p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+           sum / all.size(), percentile(all, 0.5), percentile(all, 0.9), percentile(all, 0.99),
+           percentile(all, 0.999), all.back());
+    printf("  First RTT  : mean %.2f  max %.2f us (client attach faults %ld)\n",
+           firstSum / g_opt.clients, firstMax, attachFaults);
+    // 包含预热阶段，用每条 kernel 的平均值比较
+    if (clientMisses >= 0 || serverMisses >= 0) {
+        size_t total = static_cast<size_t>(g_opt.clients) * (g_opt.warmup + g_opt.kernels);
+        printf("  dTLB miss  : client %lld (%.2f/kernel)  server %lld (%.2f/kernel)\n",
+               clientMisses, clientMisses >= 0 ? double(clientMisses) / total : -1.0,
+               serverMisses, serverMisses >= 0 ? double(serverMisses) / total : -1.0);
+    }
+    // 便于脚本解析的单行结果 (dTLB 计数不可用时为 -1)
+    printf("RESULT label=%s clients=%d kernels=%zu throughput=%.0f mean_us=%.3f p50_us=%.3f p99_us=%.3f p999_us=%.3f"
+           " client_dtlb=%lld server_dtlb=%lld\n",
+           g_opt.label.c_str(), g_opt.clients, all.size(), all.size() / elapsed, sum / all.size(),
+           percentile(all, 0.5), percentile(all, 0.99), percentile(all, 0.999), clientMisses, serverMisses);
+
+    if (g_opt.record) {
+        ResultRecord rec("ipc_bench");
+        rec.config("label", g_opt.label);
+        rec.config("clients", g_opt.clients);
+        rec.config("kernels", g_opt.kernels);
+        rec.config("rate", g_opt.rate);
+        rec.config("type", g_opt.clientType);
+        rec.config("huge_pages", hugePagesRequested() ? 1 : 0);
+        rec.config("slots", static_cast<long long>(g_opt.slots));
+        rec.config("slot_size", static_cast<long long>(g_opt.slotSize));
+        rec.config("transport", g_opt.transport.empty() ? std::string("default") : g_opt.transport);
+        rec.config("pipeline", static_cast<long long>(g_opt.pipeline));
+        rec.config("telemetry", g_opt.telemetry ? 1 : 0);
+        rec.config("launch", g_opt.launch ? 1 : 0);
+        rec.config("stream", g_opt.kernelFile.empty() ? std::string("builtin") : g_opt.kernelFile);
+        rec.metric("throughput", all.size() / elapsed, "kernels/s", true);
+        rec.samples("rtt", all, "us", false);
+        rec.metric("first_rtt", firstSum / g_opt.clients, "us", false);
+        if (clientMisses >= 0) rec.metric("client_dtlb_misses", double(clientMisses), "count", false);
+        if (serverMisses >= 0) rec.metric("server_dtlb_misses", double(serverMisses), "count", false);
+        rec.append();
+    }
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,636 @@
+// ============================================================
+//  IPC 传输一致性与延迟测试
+//  在进程内启动被测的 IIPCServer，以回显会话代替调度器 (收发循环与 Scheduler::clientHandler 相同)，
+//  用 ShmClient 经对应的传输连接，逐项检查:
+//      握手、顺序与不丢不重、多客户端并发、消费端停顿时的背压、
+//      正常断开与进程崩溃的检测延迟、同一身份重连，
+//  最后测不同速率与客户端数下的往返延迟。任一检查失败时退出码为 1。
+//  新传输只需在 transport_cases.h 的 transportCases() 中加一项 (服务端工厂 + 客户端传输描述)。
+//  注册表与套接字名按 $USER 区分，测试前改为 ksconf<pid>，不影响正在运行的调度器。
+// ============================================================
+
+#include "shm_client.h"
+#include "transport_cases.h"
+#include "../result_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::vector<std::string> transports;        // 空表示全部
+    long long messages = 20000;                 // 顺序检查的消息数 (并发检查按客户端均分)
+    int concurrentClients = 4;
+    std::vector<int> latencyClients = {1, 4};
+    std::vector<double> latencyRates = {0, 1000};
+    long long latencyKernels = 1000;
+    long long latencyWarmup = 100;
+    int port = 29999;
+    bool record = false;
+};
+
+Options g_opt;
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ===== 回显会话 (服务端) =====
+
+// 消息: "Q|<seq>|" 需要应答 "<seq>|1|OK" (与 kernel 请求同形，ShmClient::request 按 seq 匹配)，"#P|<seq>" 不需要；每个会话的 seq 从 0 连续递增
+struct Session {
+    std::string type;
+    std::string id;
+    std::atomic<int64_t> endNs{0};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> sendFailures{0};
+    std::string firstError;                      // 受 EchoHarness::mutex 保护
+};
+
+class EchoHarness {
+public:
+    EchoHarness() : running(true), stalled(false) {}
+
+    void attach(IIPCServer& server) {
+        server.start([this](std::unique_ptr<IChannel> channel) {
+            std::shared_ptr<Session> session = std::make_shared<Session>();
+            session->type = channel->getType();
+            session->id = channel->getId();
+            std::lock_guard<std::mutex> lock(mutex);
+            sessions.push_back(session);
+            threads.emplace_back(&EchoHarness::serve, this, std::move(channel), session);
+            cv.notify_all();
+        });
+    }
+
+    // 在 server.stop() 之后调用 (停止服务会结束空闲会话)
+    void join() {
+        running.store(false);
+        stalled.store(false);
+        std::vector<std::thread> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.swap(threads);
+        }
+        for (auto& t : pending) t.join();
+    }
+
+    // id 的第 nth 个会话 (从 0 计)
+    std::shared_ptr<Session> waitSession(const std::string& id, size_t nth, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::shared_ptr<Session> found;
+        cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() {
+            size_t seen = 0;
+            for (const auto& s : sessions) {
+                if (s->id == id && seen++ == nth) {
+                    found = s;
+                    return true;
+                }
+            }
+            return false;
+        });
+        return found;
+    }
+
+    bool waitEnded(const std::shared_ptr<Session>& s, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() { return s->endNs.load() != 0; });
+    }
+
+    std::string firstError(const std::shared_ptr<Session>& s) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return s->firstError;
+    }
+
+    std::atomic<bool> running;
+    std::atomic<bool> stalled;                   // 模拟消费端停顿: 取到消息后不处理
+
+private:
+    void serve(std::unique_ptr<IChannel> channel, std::shared_ptr<Session> s) {
+        channel->setReady();
+        uint64_t expected = 0;
+        std::string msg;
+        while (running.load() && channel->isConnected()) {
+            if (!channel->recvBlocking(msg)) continue;
+            while (stalled.load() && running.load()) {
+                channel->flush();
+                usleep(1000);
+            }
+            while (!msg.empty() && (msg.back() == '\n' || msg.back() == '\r')) msg.pop_back();
+            bool post = msg.compare(0, 3, "#P|") == 0;
+            bool request = msg.compare(0, 2, "Q|") == 0;
+            uint64_t seq = (post || request) ? strtoull(msg.c_str() + (post ? 3 : 2), nullptr, 10) : 0;
+            if ((!post && !request) || seq != expected) {
+                s->errors.fetch_add(1);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (s->firstError.empty()) {
+                    s->firstError = "expected #" + std::to_string(expected) + ", got '" + msg.substr(0, 40) + "'";
+                }
+            }
+            expected = seq + 1;
+            s->messages.fetch_add(1);
+            if (request && !channel->sendBlocking(std::to_string(seq) + "|1|OK\n")) s->sendFailures.fetch_add(1);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        s->endNs.store(nowNs());
+        cv.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::shared_ptr<Session>> sessions;
+    std::vector<std::thread> threads;
+};
+
+// ===== 客户端辅助 =====
+
+std::unique_ptr<ShmClient> makeClient(const TransportCase& t, const std::string& id) {
+    std::unique_ptr<ShmClient> client(new ShmClient("sglang", id));
+    client->setTransport(t.clientSpec);
+    return client;
+}
+
+/**
+ * @brief 发送 count 条消息 (每 postEvery 条中最后一条为不需应答的投递)，最多 window 条请求在途，
+ *        按序核对每条应答。seq 为本会话的下一个序号。
+ */
+bool exchange(ShmClient& client, uint64_t& seq, long long count, int postEvery, size_t window, long long& responses,
+              std::string& error) {
+    std::deque<uint64_t> outstanding;
+    char buf[256];
+    long long sent = 0;
+    while (sent < count || !outstanding.empty()) {
+        while (sent < count && outstanding.size() < window) {
+            bool post = postEvery > 0 && seq % postEvery == static_cast<uint64_t>(postEvery - 1);
+            std::string msg = post ? "#P|" + std::to_string(seq) : "Q|" + std::to_string(seq) + "|";
+            if (post) {
+                if (!client.post(msg)) {
+                    error = "post #" + std::to_string(seq) + " failed";
+                    return false;
+                }
+            } else {
+                if (!client.trySend(msg.data(), msg.size())) break;
+                outstanding.push_back(seq);
+            }
+            seq++;
+            sent++;
+        }
+        if (outstanding.empty()) {
+            // 环被投递消息占满，等服务端取走
+            if (!client.isConnected()) {
+                error = "connection lost";
+                return false;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        if (!client.recv(buf, sizeof(buf), 10000)) {
+            error = "no response for #" + std::to_string(outstanding.front());
+            return false;
+        }
+        uint64_t got = strtoull(buf, nullptr, 10);
+        if (got != outstanding.front()) {
+            error = "expected response #" + std::to_string(outstanding.front()) + ", got #" + std::to_string(got);
+            return false;
+        }
+        outstanding.pop_front();
+        responses++;
+    }
+    return true;
+}
+
+// ===== 检查项 =====
+
+struct Check {
+    enum Status { Pass, Fail, Skip } status = Pass;
+    std::string detail;
+};
+
+Check fail(const std::string& detail) {
+    Check c;
+    c.status = Check::Fail;
+    c.detail = detail;
+    return c;
+}
+
+Check pass(const std::string& detail) {
+    Check c;
+    c.detail = detail;
+    return c;
+}
+
+// 会话结束后核对服务端视角
+std::string sessionProblems(EchoHarness& h, const std::shared_ptr<Session>& s, uint64_t expectedMessages) {
+    if (s->errors.load()) return std::to_string(s->errors.load()) + " out-of-order messages (" + h.firstError(s) + ")";
+    if (s->sendFailures.load()) return std::to_string(s->sendFailures.load()) + " responses timed out";
+    if (s->messages.load() != expectedMessages) {
+        return "server saw " + std::to_string(s->messages.load()) + " of " + std::to_string(expectedMessages) +
+               " messages";
+    }
+    return std::string();
+}
+
+Check checkHandshake(const TransportCase& t, EchoHarness& h) {
+    std::unique_ptr<ShmClient> client = makeClient(t, "hello");
+    int64_t start = nowNs();
+    if (!client->connect(5000)) return fail("connect timed out");
+    double ms = (nowNs() - start) / 1e6;
+    std::shared_ptr<Session> s = h.waitSession("hello", 0, 2000);
+    if (!s) return fail("server did not report the session");
+    if (s->type != "sglang") return fail("session type '" + s->type + "'");
+    client->disconnect();
+    char detail[64];
+    snprintf(detail, sizeof(detail), "connected in %.2f ms", ms);
+    return pass(detail);
+}
+
+Check checkOrdering(const TransportCase& t, EchoHarness& h) {
+    std::unique_ptr<ShmClient> client = makeClient(t, "order");
+    if (!client->connect(5000)) return fail("connect failed");
+    uint64_t seq = 0;
+    long long responses = 0;
+    std::string error;
+    bool ok = exchange(*client, seq, g_opt.messages, 4, 32, responses, error);
+    client->disconnect();
+    if (!ok) return fail(error);
+    std::shared_ptr<Session> s = h.waitSession("order", 0, 2000);
+    if (!s || !h.waitEnded(s, 10000)) return fail("session did not end");
+    std::string problem = sessionProblems(h, s, seq);
+    if (!problem.empty()) return fail(problem);
+    return pass(std::to_string(seq) + " messages (" + std::to_string(responses) + " requests, window 32), "
+                "none lost, duplicated or reordered");
+}
+
+Check checkConcurrent(const TransportCase& t, EchoHarness& h) {
+    int n = g_opt.concurrentClients;
+    long long each = std::max(1LL, g_opt.messages / n);
+    std::vector<std::string> errors(n);
+    std::vector<uint64_t> sent(n, 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; i++) {
+        threads.emplace_back([&, i]() {
+            std::unique_ptr<ShmClient> client = makeClient(t, "conc" + std::to_string(i));
+            if (!client->connect(10000)) {
+                errors[i] = "connect failed";
+                return;
+            }
+            long long responses = 0;
+            if (!exchange(*client, sent[i], each, 8, 8, responses, errors[i]) && errors[i].empty()) {
+                errors[i] = "exchange failed";
+            }
+            client->disconnect();
+        });
+    }
+    for (auto& th : threads) th.join();
+    for (int i = 0; i < n; i++) {
+        if (!errors[i].empty()) return fail("client " + std::to_string(i) + ": " + errors[i]);
+        std::shared_ptr<Session> s = h.waitSession("conc" + std::to_string(i), 0, 2000);
+        if (!s || !h.waitEnded(s, 10000)) return fail("client " + std::to_string(i) + ": session did not end");
+        std::string problem = sessionProblems(h, s, sent[i]);
+        if (!problem.empty()) return fail("client " + std::to_string(i) + ": " + problem);
+    }
+    return pass(std::to_string(n) + " clients x " + std::to_string(each) + " messages, each session in order");
+}
+
+Check checkBackpressure(const TransportCase& t, EchoHarness& h) {
+    std::unique_ptr<ShmClient> client = makeClient(t, "pressure");
+    if (!client->connect(5000)) return fail("connect failed");
+    std::shared_ptr<Session> s = h.waitSession("pressure", 0, 2000);
+    if (!s) return fail("server did not report the session");
+
+    // 消费端停顿期间一直发送，直到被拒绝 (环满) 或达到上限
+    h.stalled.store(true);
+    long long cap = 4LL * std::max<uint32_t>(client->slotCount(), SPSC_QUEUE_SIZE);
+    long long accepted = 0;
+    bool refused = false;
+    while (accepted < cap) {
+        std::string msg = "Q|" + std::to_string(accepted) + "|";
+        if (!client->trySend(msg.data(), msg.size())) {
+            refused = true;
+            break;
+        }
+        accepted++;
+    }
+    char buf[256];
+    client->recv(buf, sizeof(buf), 1);            // 流式传输在 recv 时写出缓冲的请求
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    uint64_t duringStall = s->messages.load();
+    h.stalled.store(false);
+
+    for (long long i = 0; i < accepted; i++) {
+        if (!client->recv(buf, sizeof(buf), 10000)) {
+            client->disconnect();
+            return fail("no response for #" + std::to_string(i) + " after the consumer resumed");
+        }
+        if (strtoull(buf, nullptr, 10) != static_cast<uint64_t>(i)) {
+            client->disconnect();
+            return fail("expected response #" + std::to_string(i) + ", got '" + std::string(buf).substr(0, 20) + "'");
+        }
+    }
+    client->disconnect();
+    if (!h.waitEnded(s, 10000)) return fail("session did not end");
+    std::string problem = sessionProblems(h, s, static_cast<uint64_t>(accepted));
+    if (!problem.empty()) return fail(problem);
+    if (duringStall > 1) return fail("server processed " + std::to_string(duringStall) + " messages while stalled");
+    return pass(refused ? "producer refused after " + std::to_string(accepted) + " messages, all delivered on resume"
+                        : "buffered " + std::to_string(accepted) + " messages without refusal, all delivered on resume");
+}
+
+Check checkDisconnect(const TransportCase& t, EchoHarness& h) {
+    std::unique_ptr<ShmClient> client = makeClient(t, "bye");
+    if (!client->connect(5000)) return fail("connect failed");
+    uint64_t seq = 0;
+    long long responses = 0;
+    std::string error;
+    if (!exchange(*client, seq, 1, 0, 1, responses, error)) return fail(error);
+    std::shared_ptr<Session> s = h.waitSession("bye", 0, 2000);
+    int64_t start = nowNs();
+    client->disconnect();
+    if (!s || !h.waitEnded(s, 10000)) return fail("disconnect not detected within 10 s");
+    char detail[64];
+    snprintf(detail, sizeof(detail), "detected in %.2f ms", std::max<int64_t>(0, s->endNs.load() - start) / 1e6);
+    return pass(detail);
+}
+
+// 子进程连接、完成一次请求后直接退出 (不注销)
+Check checkCrash(const TransportCase& t, EchoHarness& h) {
+    pid_t child = fork();
+    if (child == 0) {
+        execl("/proc/self/exe", "ipc_conformance", "--crash-child", t.clientSpec.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    if (child < 0) return fail("fork failed");
+    std::shared_ptr<Session> s = h.waitSession("crash", 0, 5000);
+    int status = 0;
+    waitpid(child, &status, 0);
+    int64_t start = nowNs();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return fail("child could not complete a request");
+    if (!s) return fail("server did not report the session");
+    if (!h.waitEnded(s, 15000)) return fail("dead client not detected within 15 s");
+    char detail[64];
+    snprintf(detail, sizeof(detail), "detected in %.2f ms after exit",
+             std::max<int64_t>(0, s->endNs.load() - start) / 1e6);
+    return pass(detail);
+}
+
+int crashChild(const std::string& spec) {
+    ShmClient client("sglang", "crash");
+    client.setTransport(spec);
+    std::string response;
+    if (!client.connect(5000) || !client.request("Q|0|", response)) return 1;
+    _exit(0);
+}
+
+Check checkReconnect(const TransportCase& t, EchoHarness& h) {
+    const int cycles = 3;
+    std::unique_ptr<ShmClient> client = makeClient(t, "again");
+    for (int i = 0; i < cycles; i++) {
+        // 最后一轮换一个新对象 (客户端进程重启)，其余复用同一对象
+        if (i == cycles - 1) client = makeClient(t, "again");
+        if (!client->connect(5000)) return fail("connect #" + std::to_string(i) + " failed");
+        uint64_t seq = 0;
+        long long responses = 0;
+        std::string error;
+        if (!exchange(*client, seq, 100, 4, 4, responses, error)) return fail("cycle " + std::to_string(i) + ": " + error);
+        client->disconnect();
+        std::shared_ptr<Session> s = h.waitSession("again", static_cast<size_t>(i), 2000);
+        if (!s || !h.waitEnded(s, 10000)) return fail("cycle " + std::to_string(i) + ": session did not end");
+        std::string problem = sessionProblems(h, s, seq);
+        if (!problem.empty()) return fail("cycle " + std::to_string(i) + ": " + problem);
+    }
+    return pass(std::to_string(cycles) + " connect/exchange/disconnect cycles under one identity");
+}
+
+// ===== 延迟 =====
+
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    double pos = q * (sorted.size() - 1);
+    size_t lo = static_cast<size_t>(pos);
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+Check measureLatency(const TransportCase& t, int clients, double rate) {
+    std::vector<std::vector<double>> rtts(clients);
+    std::vector<std::string> errors(clients);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; i++) {
+        threads.emplace_back([&, i]() {
+            std::unique_ptr<ShmClient> client = makeClient(t, "lat" + std::to_string(i));
+            bool connected = client->connect(10000);
+            ready.fetch_add(1);
+            if (!connected) {
+                errors[i] = "connect failed";
+                return;
+            }
+            while (!go.load()) std::this_thread::yield();
+            std::string response;
+            long long total = g_opt.latencyWarmup + g_opt.latencyKernels;
+            rtts[i].reserve(static_cast<size_t>(g_opt.latencyKernels));
+            auto next = std::chrono::steady_clock::now();
+            auto interval = std::chrono::nanoseconds(rate > 0 ? static_cast<long long>(1e9 / rate) : 0);
+            for (long long k = 0; k < total; k++) {
+                if (rate > 0) {
+                    next += interval;
+                    while (std::chrono::steady_clock::now() < next) std::this_thread::yield();
+                }
+                int64_t t0 = nowNs();
+                if (!client->request("Q|" + std::to_string(k) + "|", response)) {
+                    errors[i] = "lost connection at #" + std::to_string(k);
+                    return;
+                }
+                if (k >= g_opt.latencyWarmup) rtts[i].push_back((nowNs() - t0) / 1e3);
+            }
+            client->disconnect();
+        });
+    }
+    while (ready.load() < clients) usleep(1000);
+    int64_t start = nowNs();
+    go.store(true);
+    for (auto& th : threads) th.join();
+    double elapsed = (nowNs() - start) / 1e9;
+
+    std::vector<double> all;
+    for (int i = 0; i < clients; i++) {
+        if (!errors[i].empty()) return fail("client " + std::to_string(i) + ": " + errors[i]);
+        all.insert(all.end(), rtts[i].begin(), rtts[i].end());
+    }
+    std::sort(all.begin(), all.end());
+    double p50 = percentile(all, 0.5), p99 = percentile(all, 0.99);
+    double throughput = all.size() / elapsed;
+    // 便于脚本解析的单行结果
+    printf("RESULT transport=%s clients=%d rate=%.0f kernels=%zu p50_us=%.3f p99_us=%.3f max_us=%.3f "
+           "throughput=%.0f\n", t.name.c_str(), clients, rate, all.size(), p50, p99, all.empty() ? 0 : all.back(),
+           throughput);
+    if (g_opt.record) {
+        ResultRecord rec("ipc_conformance");
+        rec.config("transport", t.name);
+        rec.config("clients", clients);
+        rec.config("rate", rate);
+        rec.config("kernels", g_opt.latencyKernels);
+        rec.metric("throughput", throughput, "kernels/s", true);
+        rec.samples("rtt", all, "us", false);
+        rec.append();
+    }
+    char detail[128];
+    snprintf(detail, sizeof(detail), "p50 %.1f us  p99 %.1f us  %.0f req/s", p50, p99, throughput);
+    return pass(detail);
+}
+
+// ===== 驱动 =====
+
+void report(const std::string& name, const Check& c, int& failures) {
+    const char* tag = c.status == Check::Pass ? "PASS" : c.status == Check::Fail ? "FAIL" : "SKIP";
+    printf("  [%s] %-22s %s\n", tag, name.c_str(), c.detail.c_str());
+    fflush(stdout);
+    if (c.status == Check::Fail) failures++;
+}
+
+int runTransport(const TransportCase& t) {
+    printf("=== %s ===\n", t.name.c_str());
+    std::unique_ptr<IIPCServer> server = t.makeServer();
+    if (!server->init()) {
+        Check skip;
+        skip.status = Check::Skip;
+        skip.detail = "server init failed (unsupported here)";
+        int ignored = 0;
+        report("init", skip, ignored);
+        return 0;
+    }
+    EchoHarness harness;
+    harness.attach(*server);
+
+    int failures = 0;
+    report("handshake", checkHandshake(t, harness), failures);
+    report("ordering", checkOrdering(t, harness), failures);
+    report("concurrent clients", checkConcurrent(t, harness), failures);
+    report("backpressure", checkBackpressure(t, harness), failures);
+    report("disconnect", checkDisconnect(t, harness), failures);
+    report("crash", checkCrash(t, harness), failures);
+    report("reconnect", checkReconnect(t, harness), failures);
+    for (int clients : g_opt.latencyClients) {
+        for (double rate : g_opt.latencyRates) {
+            std::string name = "latency c=" + std::to_string(clients) + " r=" + std::to_string(static_cast<long>(rate));
+            report(name, measureLatency(t, clients, rate), failures);
+        }
+    }
+    server->stop();
+    harness.join();
+    return failures;
+}
+
+template <typename T>
+std::vector<T> parseList(const std::string& s, T (*convert)(const char*)) {
+    std::vector<T> out;
+    std::istringstream in(s);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) out.push_back(convert(item.c_str()));
+    }
+    return out;
+}
+
+int toInt(const char* s) { return atoi(s); }
+double toDouble(const char* s) { return atof(s); }
+std::string toString(const char* s) { return s; }
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --transport <list>     shm,memfd,tcp,unix,uring-tcp,uring-unix (default: all)\n"
+              << "  --messages <n>         messages in the ordering check (default 20000)\n"
+              << "  --concurrent <n>       clients in the concurrency check (default 4)\n"
+              << "  --clients <list>       client counts for latency (default 1,4)\n"
+              << "  --rates <list>         per-client request rates for latency, 0 = closed loop (default 0,1000)\n"
+              << "  --kernels <n>          measured requests per latency client (default 1000)\n"
+              << "  --warmup <n>           unmeasured requests per latency client (default 100)\n"
+              << "  --port <n>             TCP port for the stream transports (default 29999)\n"
+              << "  --record               append latency results to the benchmark result store\n";
+}
+
+bool parseArgs(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"transport", required_argument, nullptr, 'T'},
+        {"messages", required_argument, nullptr, 'm'},
+        {"concurrent", required_argument, nullptr, 'n'},
+        {"clients", required_argument, nullptr, 'c'},
+        {"rates", required_argument, nullptr, 'r'},
+        {"kernels", required_argument, nullptr, 'k'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"port", required_argument, nullptr, 'p'},
+        {"record", no_argument, nullptr, 'R'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 'T': g_opt.transports = parseList<std::string>(optarg, toString); break;
+        case 'm': g_opt.messages = std::max(1LL, atoll(optarg)); break;
+        case 'n': g_opt.concurrentClients = std::max(1, atoi(optarg)); break;
+        case 'c': g_opt.latencyClients = parseList<int>(optarg, toInt); break;
+        case 'r': g_opt.latencyRates = parseList<double>(optarg, toDouble); break;
+        case 'k': g_opt.latencyKernels = std::max(1LL, atoll(optarg)); break;
+        case 'w': g_opt.latencyWarmup = std::max(0LL, atoll(optarg)); break;
+        case 'p': g_opt.port = atoi(optarg); break;
+        case 'R': g_opt.record = true; break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--crash-child") == 0) return crashChild(argv[2]);
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+    // 独立的注册表、memfd 与 Unix 套接字名 (子进程继承)
+    setenv("USER", ("ksconf" + std::to_string(getpid())).c_str(), 1);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<TransportCase> cases = transportCases(g_opt.port);
+    for (const auto& name : g_opt.transports) {
+        bool known = false;
+        for (const auto& t : cases) known = known || t.name == name;
+        if (!known) {
+            std::cerr << "[Conformance] Unknown transport: " << name << std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    int failures = 0;
+    for (const auto& t : cases) {
+        if (!g_opt.transports.empty() &&
+            std::find(g_opt.transports.begin(), g_opt.transports.end(), t.name) == g_opt.transports.end()) {
+            continue;
+        }
+        failures += runTransport(t);
+    }
+    printf("%s: %d failed check(s)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
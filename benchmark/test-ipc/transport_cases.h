@@ -0,0 +1,51 @@
+#pragma once
+
+// ============================================================
+//  被测传输表 (ipc_conformance 与 test-alloc/alloc_test 共用)
+//  每项为服务端工厂与对应的客户端传输描述 (ShmClient::setTransport)；
+//  新传输只需在 transportCases() 中加一项。TCP 类传输监听 LOCALHOST:port。
+// ============================================================
+
+#include "config.h"
+#include "ipc.h"
+#include "memfd_server.h"
+#include "shm_core.h"
+#include "stream_server.h"
+#include "uring_server.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct TransportCase {
+    std::string name;
+    std::function<std::unique_ptr<IIPCServer>()> makeServer;
+    std::string clientSpec;                      // ShmClient::setTransport
+};
+
+inline std::vector<TransportCase> transportCases(int port) {
+    StreamAddress tcp, unixAddr;
+    parseStreamAddress("tcp:" LOCALHOST ":" + std::to_string(port), tcp);
+    parseStreamAddress("unix", unixAddr);
+    std::string tcpSpec = "tcp:" + tcp.host + ":" + std::to_string(tcp.port);
+    std::vector<TransportCase> cases;
+    cases.push_back({"shm", []() { return std::unique_ptr<IIPCServer>(new ShmServer(false, SEG_POPULATE)); },
+                     "shm"});
+    cases.push_back({"memfd", []() { return std::unique_ptr<IIPCServer>(new MemfdServer(false, SEG_POPULATE)); },
+                     "memfd"});
+    cases.push_back({"tcp", [tcp]() {
+                         return std::unique_ptr<IIPCServer>(new StreamServer(std::vector<StreamAddress>{tcp}));
+                     }, tcpSpec});
+    cases.push_back({"unix", [unixAddr]() {
+                         return std::unique_ptr<IIPCServer>(new StreamServer(std::vector<StreamAddress>{unixAddr}));
+                     }, "unix"});
+    cases.push_back({"uring-tcp", [tcp]() {
+                         return std::unique_ptr<IIPCServer>(new UringServer(std::vector<StreamAddress>{tcp}, false));
+                     }, tcpSpec});
+    cases.push_back({"uring-unix", [unixAddr]() {
+                         return std::unique_ptr<IIPCServer>(
+                             new UringServer(std::vector<StreamAddress>{unixAddr}, false));
+                     }, "unix"});
+    return cases;
+}
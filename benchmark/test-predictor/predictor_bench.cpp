@@ -0,0 +1,214 @@
+// ============================================================
+//  kernel 耗时预测器的精度与查询开销
+//  用几类已知形状的合成 kernel (线性、超线性、延迟受限后转线性、只给 grid、不带启动参数)
+//  在线训练 LatencyPredictor，每个样本先预测再更新，与按 kernel 名求均值的基线比较相对误差；
+//  训练后测 predict() 的单次耗时。
+//  有形状的族误差不低于基线，或单次查询超过 --max-query-ns 时退出码为 1。
+// ============================================================
+
+#include "predictor.h"
+#include "../result_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    long long samples = 20000;       // 每个族
+    long long queries = 1000000;
+    double noise = 0.05;             // 耗时的相对噪声 (标准差)
+    double maxQueryNs = 1000;
+    bool record = false;
+};
+
+Options g_opt;
+
+const char* const MODEL = "llama-8b";
+
+// 一个合成 kernel 族: 规模在 [minSize, maxSize] 内按对数均匀抽取，耗时 (us) 为规模的已知函数
+struct SyntheticFamily {
+    const char* name;
+    const char* kernelType;
+    bool shaped;                     // 耗时随规模变化 (基线无法刻画)
+    bool useGrid;                    // 规模通过 grid 而不是 token 数给出
+    bool hasLaunch;
+    double minSize, maxSize;
+    double (*durationUs)(double size);
+};
+
+double gemmUs(double t) { return 3 + 0.02 * t; }
+double prefillAttnUs(double t) { return 5 + 1e-5 * t * t; }
+double normUs(double t) { return 2 + 0.001 * t; }
+double latencyBoundUs(double t) { return t <= 64 ? 8 : 8 + 0.05 * (t - 64); }
+double gridUs(double blocks) { return 1 + 0.01 * blocks; }
+double flatUs(double) { return 10; }
+
+const SyntheticFamily FAMILIES[] = {
+    {"gemm", "sm90_xmma_gemm_bf16bf16_bf16f32_f32_tn_n_tilesize128x128x64_warpgroupsize1x1x1_execute_segment_k_off_"
+             "kernel__5x_cublas", true, false, true, 1, 8192, gemmUs},
+    {"prefill_attn", "void flashinfer::BatchPrefillWithRaggedKVCacheKernel<flashinfer::KernelTraits<(flashinfer::"
+                     "MaskMode)1, 128u, 1u, 4u>", true, false, true, 256, 8192, prefillAttnUs},
+    {"norm", "void flashinfer::norm::FusedAddRMSNormKernel<8u, __nv_bfloat16>", true, false, true, 1, 8192, normUs},
+    {"latency_bound", "void flashinfer::activation::act_and_mul_kernel<__nv_bfloat16, &silu>", true, false, true, 1,
+     4096, latencyBoundUs},
+    {"grid_only", "void at::native::vectorized_elementwise_kernel<4, at::native::FillFunctor<long>>", true, true, true,
+     1, 4096, gridUs},
+    {"no_launch", "void at::native::reduce_kernel<512, 1, at::native::ReduceOp<float, at::native::ArgMaxOps<float>>>",
+     false, false, false, 1, 1, flatUs},
+};
+const size_t NUM_FAMILIES = sizeof(FAMILIES) / sizeof(FAMILIES[0]);
+
+LaunchMeta makeLaunch(const SyntheticFamily& f, double size) {
+    LaunchMeta launch;
+    if (!f.hasLaunch) return launch;
+    if (f.useGrid) {
+        launch.fields = LaunchMeta::Grid | LaunchMeta::Block;
+        launch.grid[0] = static_cast<uint32_t>(size);
+        launch.block[0] = 256;
+    } else {
+        launch.fields = LaunchMeta::Grid | LaunchMeta::Tokens;
+        launch.tokens = static_cast<uint32_t>(size);
+        launch.grid[0] = (launch.tokens + 127) / 128;
+    }
+    return launch;
+}
+
+struct FamilyResult {
+    double predictorError = 0;       // 后一半样本 (已收敛) 的平均相对误差
+    double baselineError = 0;
+    long long measured = 0;
+};
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --samples <n>        completions per family (default 20000)\n"
+              << "  --queries <n>        timed predict() calls (default 1000000)\n"
+              << "  --noise <f>          relative duration noise (default 0.05)\n"
+              << "  --max-query-ns <ns>  fail when a query takes longer on average (default 1000)\n"
+              << "  --record             append the result to the benchmark result store\n";
+}
+
+bool parseArgs(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"samples", required_argument, nullptr, 's'},
+        {"queries", required_argument, nullptr, 'q'},
+        {"noise", required_argument, nullptr, 'n'},
+        {"max-query-ns", required_argument, nullptr, 'm'},
+        {"record", no_argument, nullptr, 'R'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 's': g_opt.samples = std::max(2LL, atoll(optarg)); break;
+        case 'q': g_opt.queries = std::max(1LL, atoll(optarg)); break;
+        case 'n': g_opt.noise = std::max(0.0, atof(optarg)); break;
+        case 'm': g_opt.maxQueryNs = atof(optarg); break;
+        case 'R': g_opt.record = true; break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::normal_distribution<double> noise(0, g_opt.noise);
+    auto drawSize = [&](const SyntheticFamily& f) {
+        return std::floor(std::exp(std::log(f.minSize) + unit(rng) * (std::log(f.maxSize + 1) - std::log(f.minSize))));
+    };
+
+    // ===== 在线训练: 族之间交错，模拟真实的 kernel 序列 =====
+    LatencyPredictor predictor;
+    std::vector<FamilyResult> results(NUM_FAMILIES);
+    std::vector<double> baselineSum(NUM_FAMILIES, 0);
+    for (long long i = 0; i < g_opt.samples; i++) {
+        for (size_t k = 0; k < NUM_FAMILIES; k++) {
+            const SyntheticFamily& f = FAMILIES[k];
+            double size = drawSize(f);
+            LaunchMeta launch = makeLaunch(f, size);
+            double actualNs = f.durationUs(size) * 1000 * std::max(0.1, 1 + noise(rng));
+            int64_t predicted = predictor.predict(MODEL, f.kernelType, launch);
+            if (i >= g_opt.samples / 2) {
+                double baseline = baselineSum[k] / i;
+                results[k].predictorError += std::fabs(predicted - actualNs) / actualNs;
+                results[k].baselineError += std::fabs(baseline - actualNs) / actualNs;
+                results[k].measured++;
+            }
+            predictor.update(MODEL, f.kernelType, launch, static_cast<int64_t>(actualNs));
+            baselineSum[k] += actualNs;
+        }
+    }
+
+    // ===== 查询开销: 预先生成参数，计时循环里只调用 predict() =====
+    std::vector<std::pair<size_t, LaunchMeta>> queries(4096);
+    for (auto& q : queries) {
+        q.first = static_cast<size_t>(unit(rng) * NUM_FAMILIES) % NUM_FAMILIES;
+        q.second = makeLaunch(FAMILIES[q.first], drawSize(FAMILIES[q.first]));
+    }
+    const std::string model = MODEL;
+    std::vector<std::string> kernelTypes;
+    for (const auto& f : FAMILIES) kernelTypes.push_back(f.kernelType);
+    int64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < g_opt.queries; i++) {
+        const auto& q = queries[static_cast<size_t>(i) & (queries.size() - 1)];
+        checksum += predictor.predict(model, kernelTypes[q.first], q.second);
+    }
+    double queryNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                     g_opt.queries;
+
+    // ===== 报告 =====
+    int failures = 0;
+    printf("=== Latency Predictor (%lld samples/family, noise %.0f%%) ===\n", g_opt.samples, g_opt.noise * 100);
+    printf("  %-14s %12s %12s  %s\n", "family", "predictor%", "baseline%", "");
+    double predictorTotal = 0, baselineTotal = 0;
+    for (size_t k = 0; k < NUM_FAMILIES; k++) {
+        FamilyResult& r = results[k];
+        r.predictorError /= r.measured;
+        r.baselineError /= r.measured;
+        predictorTotal += r.predictorError;
+        baselineTotal += r.baselineError;
+        bool bad = FAMILIES[k].shaped && r.predictorError >= r.baselineError;
+        if (bad) failures++;
+        printf("  %-14s %12.2f %12.2f  %s\n", FAMILIES[k].name, r.predictorError * 100, r.baselineError * 100,
+               bad ? "FAIL (no better than the per-name mean)" : "");
+    }
+    bool slow = queryNs > g_opt.maxQueryNs;
+    if (slow) failures++;
+    printf("  Query      : %.1f ns/predict (limit %.0f)%s  [checksum %lld]\n", queryNs, g_opt.maxQueryNs,
+           slow ? "  FAIL" : "", static_cast<long long>(checksum % 1000));
+    printf("\n%s", predictor.describe().c_str());
+    // 便于脚本解析的单行结果
+    printf("RESULT samples=%lld noise=%.3f predictor_err=%.4f baseline_err=%.4f query_ns=%.1f\n", g_opt.samples,
+           g_opt.noise, predictorTotal / NUM_FAMILIES, baselineTotal / NUM_FAMILIES, queryNs);
+
+    if (g_opt.record) {
+        ResultRecord rec("predictor_bench");
+        rec.config("samples", g_opt.samples);
+        rec.config("noise", g_opt.noise);
+        rec.metric("predictor_error", predictorTotal / NUM_FAMILIES, "ratio", false);
+        rec.metric("baseline_error", baselineTotal / NUM_FAMILIES, "ratio", false);
+        rec.metric("query_ns", queryNs, "ns", false);
+        rec.append();
+    }
+    return failures ? 1 : 0;
+}
@@ -7,6 +7,10 @@ import random
 import json
 import numpy as np
 import sys
+import os
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import result_store
 
 # ================= CONFIGURATION AREA =================
 
@@ -23,6 +27,7 @@ SAMPLE_INTERVAL = 2     # Sampling: Pick 1 request every N rows
 SPEEDUP_FACTOR = 1.1    # Time Compression: >1.0 speeds up, <1.0 slows down
 
 MAX_REQUESTS = 10000     # Total trace rows to process
+RECORD_RESULTS = True  # 追加结果到 benchmark/results/results.jsonl (compare_results.py 比较)
 
 # --- SLO CONFIGURATION  ---
 SLO_TTFT = 1    # Seconds (Time To First Token 阈值, 仅适用于 Prefill Worker, Request级)
@@ -285,6 +290,10 @@ async def main():
         else:
             print("  No tokens generated.")
 
+    if RECORD_RESULTS:
+        result_store.record_pd("azure_pd_replay", {"trace": DATASET_PATH, "sample_interval": SAMPLE_INTERVAL, "speedup": SPEEDUP_FACTOR, "read_limit": READ_LIMIT, "max_requests": MAX_REQUESTS},
+                               benchmark_duration, res_df)
+
     filename = f"result_pd_speed{SPEEDUP_FACTOR}x.csv"
     res_df.drop(columns=['token_intervals'], errors='ignore').to_csv(filename, index=False)
     print(f"\nData saved to {filename}")
@@ -7,6 +7,10 @@ import random
 import json
 import numpy as np
 import sys
+import os
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import result_store
 
 # ================= CONFIGURATION AREA =================
 API_URL = "http://127.0.0.1:30001/v1/completions"
@@ -26,6 +30,7 @@ SAMPLE_INTERVAL = 1     # Sampling: Pick 1 request every N rows
 SPEEDUP_FACTOR = 50    # Time Compression
 
 MAX_REQUESTS = 6000
+RECORD_RESULTS = True  # 追加结果到 benchmark/results/results.jsonl (compare_results.py 比较)
 
 # ===================================================
 
@@ -305,6 +310,10 @@ async def main():
         print(f"  TTFT Violation Rate (> {SLO_TTFT}s)           : {ttft_violation_rate:.2f}% ({ttft_violation_count}/{count} Requests)")
         print(f"  TPOT Violation Rate (> {SLO_TPOT}s) : {tpot_violation_rate:.2f}% ({total_bad_intervals}/{total_intervals_count} Intervals)")
 
+        if RECORD_RESULTS:
+            result_store.record_serving("burstgpt_replay", {"trace": DATASET_PATH, "sample_interval": SAMPLE_INTERVAL, "speedup": SPEEDUP_FACTOR, "read_limit": READ_LIMIT, "max_requests": MAX_REQUESTS},
+                                        benchmark_duration, valid_df, all_intervals)
+
     else:
         print("No valid responses received.")
 
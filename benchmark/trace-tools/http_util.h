@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <netdb.h>
+#include <sys/socket.h>
+
+// ============================================================
+//  HTTP/SSE 辅助函数 (压测端与桩服务端共用)
+// ============================================================
+
+inline int64_t monoNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+inline int64_t wallNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+struct HttpUrl {
+    std::string host;
+    std::string port;
+    std::string path;
+};
+
+// 仅支持 http://host[:port]/path
+inline bool parseHttpUrl(const std::string& url, HttpUrl& out) {
+    const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme) != 0) return false;
+    std::string rest = url.substr(scheme.size());
+    size_t slash = rest.find('/');
+    std::string hostPort = rest.substr(0, slash);
+    out.path = (slash == std::string::npos) ? "/" : rest.substr(slash);
+    size_t colon = hostPort.rfind(':');
+    if (colon == std::string::npos) {
+        out.host = hostPort;
+        out.port = "80";
+    } else {
+        out.host = hostPort.substr(0, colon);
+        out.port = hostPort.substr(colon + 1);
+    }
+    return !out.host.empty();
+}
+
+// 解析一次地址，之后每个请求直接复用 sockaddr
+inline bool resolveHttpUrl(const HttpUrl& url, struct sockaddr_storage& addr, socklen_t& len) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    if (getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &res) != 0 || !res) return false;
+    memcpy(&addr, res->ai_addr, res->ai_addrlen);
+    len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return true;
+}
+
+// 在 JSON 文本中查找 "key": 后的值起始位置 (不做完整解析)
+inline const char* findJsonValue(const char* p, const char* end, const char* key) {
+    size_t klen = strlen(key);
+    while (p < end) {
+        const char* q = static_cast<const char*>(memchr(p, '"', static_cast<size_t>(end - p)));
+        if (!q || q + klen + 2 > end) return nullptr;
+        if (memcmp(q + 1, key, klen) == 0 && q[klen + 1] == '"') {
+            const char* v = q + klen + 2;
+            while (v < end && (*v == ' ' || *v == '\t')) v++;
+            if (v < end && *v == ':') {
+                v++;
+                while (v < end && (*v == ' ' || *v == '\t')) v++;
+                return v;
+            }
+        }
+        p = q + 1;
+    }
+    return nullptr;
+}
+
+// "key": 后为非空字符串时返回 true
+inline bool jsonHasNonEmptyString(const char* p, const char* end, const char* key) {
+    const char* v = findJsonValue(p, end, key);
+    return v && v + 1 < end && v[0] == '"' && v[1] != '"';
+}
+
+inline long long jsonIntValue(const char* p, const char* end, const char* key, long long def) {
+    const char* v = findJsonValue(p, end, key);
+    if (!v || v >= end) return def;
+    char* stop = nullptr;
+    long long val = strtoll(v, &stop, 10);
+    return stop == v ? def : val;
+}
+
+inline bool jsonBoolValue(const char* p, const char* end, const char* key, bool def) {
+    const char* v = findJsonValue(p, end, key);
+    if (!v || v >= end) return def;
+    if (end - v >= 4 && memcmp(v, "true", 4) == 0) return true;
+    if (end - v >= 5 && memcmp(v, "false", 5) == 0) return false;
+    return def;
+}
@@ -0,0 +1,772 @@
+// ============================================================
+//  开环 (open-loop) trace 回放压测工具
+//  采样语义与 test_azure/baseline.py、test_burstGPT/baseline.py 一致:
+//    读取前 READ_LIMIT 行 -> 按时间排序 -> 每 SAMPLE_INTERVAL 行取一条
+//    -> 截断到 MAX_REQUESTS -> 到达时间 = 相对时间戳 / SPEEDUP_FACTOR
+//  请求体在开始前全部生成好；到达时刻由独立的派发线程用
+//  clock_nanosleep(TIMER_ABSTIME) + 末段自旋精确触发，收发由 epoll 线程完成，
+//  所有时间戳为 CLOCK_MONOTONIC 纳秒。超过 --timeout 仍未结束的请求被关闭并计为失败 (status 0)。
+// ============================================================
+
+#include "trace.h"
+#include "http_util.h"
+#include "../result_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <getopt.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string tracePath;
+    std::string url = "http://127.0.0.1:30001/v1/completions";
+    std::string model = "/data/datasets/models-hf/Llama-3.1-8B-Instruct/";
+    long long readLimit = 200000;
+    long long sampleInterval = 2;
+    double speedup = 1.1;
+    long long maxRequests = 10000;
+    double sloTtft = 1.0;    // 秒
+    double sloTpot = 0.1;    // 秒
+    double timeout = 300;    // 秒，与 aiohttp 默认的总超时一致
+    int ioThreads = 2;
+    int64_t spinNs = 50000;
+    uint64_t seed = 0;
+    std::string output;
+    std::string tokenLog;
+    bool record = false;
+};
+
+const char* const VOCAB[] = {
+    "the", "be", "to", "of", "and", "a", "in", "that", "have", "I",
+    "it", "for", "not", "on", "with", "he", "as", "you", "do", "at",
+    "this", "but", "his", "by", "from", "they", "we", "say", "her", "she",
+    "or", "an", "will", "my", "one", "all", "would", "there", "their", "what",
+    "system", "model", "inference", "performance", "latency", "throughput", "gpu",
+    "compute", "memory", "cache", "token", "context", "decode", "prefill", "batch",
+    "queue", "request", "server", "client", "python", "async", "await", "test",
+    "analysis", "design", "implementation", "result", "discussion", "future", "work"
+};
+const size_t VOCAB_SIZE = sizeof(VOCAB) / sizeof(VOCAB[0]);
+
+struct Request {
+    int64_t offsetNs;
+    long long inputLen;
+    long long outputLen;
+    std::string wire;   // 完整的 HTTP 请求报文
+};
+
+struct Result {
+    int64_t dispatchNs = 0;
+    int64_t sentNs = 0;
+    int64_t firstTokenNs = 0;
+    int64_t endNs = 0;
+    int64_t wallSendNs = 0;
+    int status = 0;
+    bool timedOut = false;
+    std::vector<int64_t> tokenNs;
+};
+
+// 单个请求的连接状态机
+struct Conn {
+    enum Phase { Connecting, Sending, Headers, Body };
+    enum ChunkState { ChunkSize, ChunkData, ChunkDataEnd, ChunkTrailer };
+
+    size_t idx = 0;
+    int fd = -1;
+    Phase phase = Connecting;
+    size_t sent = 0;
+    std::string header;
+    bool chunked = false;
+    long long contentLeft = -1;   // -1 表示读到连接关闭
+    ChunkState chunkState = ChunkSize;
+    long long chunkLeft = 0;
+    std::string chunkLine;
+    std::string line;
+    bool streamDone = false;
+};
+
+Options g_opt;
+std::vector<Request> g_requests;
+std::vector<Result> g_results;
+std::vector<Conn> g_conns;
+std::atomic<size_t> g_finished(0);
+std::atomic<size_t> g_dispatched(0);
+std::atomic<size_t> g_registered(0);   // 前 n 个连接已交给 IO 线程 (或已结束)
+std::atomic<size_t> g_timedOut(0);
+std::atomic<bool> g_dispatchDone(false);
+int64_t g_startNs = 0;
+TraceFormat g_format = TraceFormat::Unknown;
+struct sockaddr_storage g_addr;
+socklen_t g_addrLen = 0;
+
+std::string randomHex(std::mt19937_64& rng, int bytes) {
+    static const char* digits = "0123456789abcdef";
+    std::string s;
+    for (int i = 0; i < bytes; i++) {
+        unsigned v = static_cast<unsigned>(rng() & 0xff);
+        s.push_back(digits[v >> 4]);
+        s.push_back(digits[v & 0xf]);
+    }
+    return s;
+}
+
+std::string buildPrompt(std::mt19937_64& rng, long long tokens) {
+    std::string prompt = "REQ_ID_" + randomHex(rng, 6) + ": ";
+    for (long long i = 0; i < tokens; i++) {
+        if (i) prompt.push_back(' ');
+        prompt += VOCAB[rng() % VOCAB_SIZE];
+    }
+    return prompt;
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out.push_back('\\'); out.push_back(c); }
+        else out.push_back(c);
+    }
+    return out;
+}
+
+std::string buildWire(const HttpUrl& url, const std::string& body) {
+    std::ostringstream ss;
+    ss << "POST " << url.path << " HTTP/1.1\r\n"
+       << "Host: " << url.host << ":" << url.port << "\r\n"
+       << "Content-Type: application/json\r\n"
+       << "Accept: text/event-stream\r\n"
+       << "Connection: close\r\n"
+       << "Content-Length: " << body.size() << "\r\n\r\n"
+       << body;
+    return ss.str();
+}
+
+// 与 Python 脚本相同：读取前 readLimit 行，排序，采样，截断
+bool loadTrace(const HttpUrl& url) {
+    MappedFile file;
+    if (!file.open(g_opt.tracePath)) {
+        std::cerr << "[LoadGen] Failed to open trace: " << g_opt.tracePath << std::endl;
+        return false;
+    }
+    TraceParser parser;
+    if (!parser.init(file.data(), file.size())) {
+        std::cerr << "[LoadGen] Unrecognized trace header" << std::endl;
+        return false;
+    }
+
+    std::vector<TraceRow> rows;
+    TraceRow row;
+    while ((g_opt.readLimit <= 0 || static_cast<long long>(rows.size()) < g_opt.readLimit) && parser.next(row)) {
+        rows.push_back(row);
+    }
+    std::stable_sort(rows.begin(), rows.end(), [](const TraceRow& a, const TraceRow& b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    std::vector<TraceRow> picked;
+    long long step = g_opt.sampleInterval > 1 ? g_opt.sampleInterval : 1;
+    for (size_t i = 0; i < rows.size(); i += step) {
+        picked.push_back(rows[i]);
+        if (g_opt.maxRequests > 0 && static_cast<long long>(picked.size()) >= g_opt.maxRequests) break;
+    }
+    if (picked.empty()) {
+        std::cerr << "[LoadGen] No requests after sampling" << std::endl;
+        return false;
+    }
+
+    g_format = parser.format();
+    std::cout << "Loaded " << rows.size() << " rows (" << traceFormatName(parser.format())
+              << ", skipped " << parser.skipped() << " malformed)" << std::endl;
+
+    std::mt19937_64 rng(g_opt.seed ? g_opt.seed : std::random_device()());
+    double base = picked.front().timestamp;
+    g_requests.resize(picked.size());
+    for (size_t i = 0; i < picked.size(); i++) {
+        Request& r = g_requests[i];
+        // 缺失值的处理与 test_burstGPT/baseline.py 保持一致 (默认 10)
+        r.inputLen = picked[i].inputTokens >= 0 ? picked[i].inputTokens : 10;
+        r.outputLen = picked[i].outputTokens >= 0 ? picked[i].outputTokens : 10;
+        r.offsetNs = static_cast<int64_t>((picked[i].timestamp - base) / g_opt.speedup * 1e9);
+
+        std::ostringstream body;
+        body << "{\"model\":\"" << jsonEscape(g_opt.model) << "\","
+             << "\"prompt\":\"" << buildPrompt(rng, r.inputLen) << "\","
+             << "\"max_tokens\":" << r.outputLen << ","
+             << "\"temperature\":0,\"ignore_eos\":true,\"stream\":true}";
+        r.wire = buildWire(url, body.str());
+    }
+    return true;
+}
+
+// ======================= 连接处理 =======================
+
+void finishConn(Conn& c, int64_t now) {
+    Result& r = g_results[c.idx];
+    r.endNs = now;
+    if (c.fd >= 0) {
+        close(c.fd);
+        c.fd = -1;
+    }
+    std::string().swap(c.header);
+    std::string().swap(c.line);
+    g_finished.fetch_add(1, std::memory_order_release);
+}
+
+void onSseLine(Conn& c, const char* p, size_t n, int64_t now) {
+    if (n && p[n - 1] == '\r') n--;
+    if (n < 6 || memcmp(p, "data: ", 6) != 0) return;
+    p += 6;
+    n -= 6;
+    if (n == 6 && memcmp(p, "[DONE]", 6) == 0) {
+        c.streamDone = true;
+        return;
+    }
+    if (jsonHasNonEmptyString(p, p + n, "text")) {
+        Result& r = g_results[c.idx];
+        if (r.tokenNs.empty()) r.firstTokenNs = now;
+        r.tokenNs.push_back(now);
+    }
+}
+
+void feedSse(Conn& c, const char* p, size_t n, int64_t now) {
+    while (n > 0) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', n));
+        if (!nl) {
+            c.line.append(p, n);
+            return;
+        }
+        size_t len = static_cast<size_t>(nl - p);
+        if (c.line.empty()) {
+            onSseLine(c, p, len, now);
+        } else {
+            c.line.append(p, len);
+            onSseLine(c, c.line.data(), c.line.size(), now);
+            c.line.clear();
+        }
+        p = nl + 1;
+        n -= len + 1;
+    }
+}
+
+// Transfer-Encoding: chunked 解码
+void feedChunked(Conn& c, const char* p, size_t n, int64_t now) {
+    while (n > 0) {
+        switch (c.chunkState) {
+        case Conn::ChunkSize:
+        case Conn::ChunkTrailer: {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', n));
+            size_t len = nl ? static_cast<size_t>(nl - p) : n;
+            c.chunkLine.append(p, len);
+            if (!nl) return;
+            p = nl + 1;
+            n -= len + 1;
+            if (c.chunkState == Conn::ChunkSize) {
+                c.chunkLeft = strtoll(c.chunkLine.c_str(), nullptr, 16);
+                c.chunkState = c.chunkLeft > 0 ? Conn::ChunkData : Conn::ChunkTrailer;
+                if (c.chunkLeft == 0) c.contentLeft = 0;
+            }
+            c.chunkLine.clear();
+            break;
+        }
+        case Conn::ChunkData: {
+            size_t take = std::min(static_cast<size_t>(c.chunkLeft), n);
+            feedSse(c, p, take, now);
+            p += take;
+            n -= take;
+            c.chunkLeft -= static_cast<long long>(take);
+            if (c.chunkLeft == 0) c.chunkState = Conn::ChunkDataEnd;
+            break;
+        }
+        case Conn::ChunkDataEnd: {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', n));
+            if (!nl) return;
+            n -= static_cast<size_t>(nl - p) + 1;
+            p = nl + 1;
+            c.chunkState = Conn::ChunkSize;
+            break;
+        }
+        }
+    }
+}
+
+void feedBody(Conn& c, const char* p, size_t n, int64_t now) {
+    if (c.chunked) {
+        feedChunked(c, p, n, now);
+        return;
+    }
+    if (c.contentLeft >= 0) {
+        n = std::min(n, static_cast<size_t>(c.contentLeft));
+        c.contentLeft -= static_cast<long long>(n);
+    }
+    feedSse(c, p, n, now);
+}
+
+bool headerIs(const std::string& h, size_t pos, size_t end, const char* name, const char* value) {
+    size_t nlen = strlen(name);
+    if (end - pos < nlen || strncasecmp(h.c_str() + pos, name, nlen) != 0) return false;
+    if (!value) return true;
+    std::string rest = h.substr(pos + nlen, end - pos - nlen);
+    for (char& ch : rest) ch = static_cast<char>(tolower(ch));
+    return rest.find(value) != std::string::npos;
+}
+
+void feedHeaders(Conn& c, const char* p, size_t n, int64_t now) {
+    c.header.append(p, n);
+    size_t hend = c.header.find("\r\n\r\n");
+    if (hend == std::string::npos) return;
+
+    Result& r = g_results[c.idx];
+    size_t sp = c.header.find(' ');
+    r.status = sp == std::string::npos ? 0 : atoi(c.header.c_str() + sp + 1);
+
+    size_t pos = c.header.find("\r\n") + 2;
+    while (pos < hend) {
+        size_t eol = c.header.find("\r\n", pos);
+        if (headerIs(c.header, pos, eol, "transfer-encoding:", "chunked")) c.chunked = true;
+        if (headerIs(c.header, pos, eol, "content-length:", nullptr)) {
+            c.contentLeft = atoll(c.header.c_str() + pos + strlen("content-length:"));
+        }
+        pos = eol + 2;
+    }
+    c.phase = Conn::Body;
+    std::string rest = c.header.substr(hend + 4);
+    c.header.clear();
+    if (!rest.empty()) feedBody(c, rest.data(), rest.size(), now);
+}
+
+// 返回 false 表示连接已结束
+bool onReadable(Conn& c) {
+    char buf[65536];
+    while (true) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        int64_t now = monoNowNs();
+        if (n > 0) {
+            if (c.phase == Conn::Headers) feedHeaders(c, buf, static_cast<size_t>(n), now);
+            else feedBody(c, buf, static_cast<size_t>(n), now);
+            if (c.phase == Conn::Body && (c.streamDone || c.contentLeft == 0)) {
+                finishConn(c, now);
+                return false;
+            }
+            continue;
+        }
+        if (n == 0) {
+            finishConn(c, now);
+            return false;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+        if (errno == EINTR) continue;
+        finishConn(c, now);
+        return false;
+    }
+}
+
+bool onWritable(Conn& c, int epfd) {
+    if (c.phase == Conn::Connecting) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            finishConn(c, monoNowNs());
+            return false;
+        }
+        c.phase = Conn::Sending;
+    }
+    const std::string& wire = g_requests[c.idx].wire;
+    while (c.sent < wire.size()) {
+        ssize_t n = send(c.fd, wire.data() + c.sent, wire.size() - c.sent, MSG_NOSIGNAL);
+        if (n > 0) { c.sent += static_cast<size_t>(n); continue; }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n < 0 && errno == EINTR) continue;
+        finishConn(c, monoNowNs());
+        return false;
+    }
+    g_results[c.idx].sentNs = monoNowNs();
+    c.phase = Conn::Headers;
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &c;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+    return true;
+}
+
+// 每个 IO 线程负责下标相差 slots 的一列连接。派发时刻随下标递增，截止时刻也递增，
+// 所以从最早的未结束连接往后扫，遇到第一个未到期的即可停下
+void expireConns(size_t slots, size_t& cursor, int64_t now) {
+    size_t registered = g_registered.load(std::memory_order_acquire);
+    int64_t timeoutNs = static_cast<int64_t>(g_opt.timeout * 1e9);
+    for (; cursor < registered; cursor += slots) {
+        Conn& c = g_conns[cursor];
+        if (c.fd < 0) continue;
+        if (now - g_results[cursor].dispatchNs < timeoutNs) break;
+        g_results[cursor].status = 0;
+        g_results[cursor].timedOut = true;
+        g_timedOut.fetch_add(1, std::memory_order_relaxed);
+        finishConn(c, now);
+    }
+}
+
+void ioLoop(int epfd, size_t slot, size_t slots) {
+    struct epoll_event events[256];
+    size_t cursor = slot;
+    while (!(g_dispatchDone.load(std::memory_order_acquire) &&
+             g_finished.load(std::memory_order_acquire) == g_dispatched.load(std::memory_order_acquire))) {
+        if (g_opt.timeout > 0) expireConns(slots, cursor, monoNowNs());
+        int n = epoll_wait(epfd, events, 256, 50);
+        for (int i = 0; i < n; i++) {
+            Conn& c = *static_cast<Conn*>(events[i].data.ptr);
+            if (c.fd < 0) continue;
+            if (c.phase <= Conn::Sending) {
+                if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) onWritable(c, epfd);
+            } else if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                onReadable(c);
+            }
+        }
+    }
+}
+
+// ======================= 派发 =======================
+
+void sleepUntilNs(int64_t target) {
+    int64_t wake = target - g_opt.spinNs;
+    if (monoNowNs() < wake) {
+        struct timespec ts;
+        ts.tv_sec = wake / 1000000000LL;
+        ts.tv_nsec = wake % 1000000000LL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+    }
+    while (monoNowNs() < target) {
+        __asm__ __volatile__("pause" ::: "memory");
+    }
+}
+
+void dispatchOne(size_t i, const std::vector<int>& epfds) {
+    Conn& c = g_conns[i];
+    Result& r = g_results[i];
+    c.idx = i;
+    r.dispatchNs = monoNowNs();
+    r.wallSendNs = wallNowNs();
+
+    int fd = socket(g_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    g_dispatched.fetch_add(1, std::memory_order_release);
+    if (fd == -1) {
+        finishConn(c, monoNowNs());
+        return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    c.fd = fd;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&g_addr), g_addrLen) == -1 && errno != EINPROGRESS) {
+        finishConn(c, monoNowNs());
+        return;
+    }
+    // epoll_ctl 线程安全：直接登记到目标 IO 线程的 epoll 上
+    struct epoll_event ev;
+    ev.events = EPOLLOUT;
+    ev.data.ptr = &c;
+    epoll_ctl(epfds[i % epfds.size()], EPOLL_CTL_ADD, fd, &ev);
+}
+
+void dispatchLoop(const std::vector<int>& epfds) {
+    for (size_t i = 0; i < g_requests.size(); i++) {
+        sleepUntilNs(g_startNs + g_requests[i].offsetNs);
+        dispatchOne(i, epfds);
+        g_registered.store(i + 1, std::memory_order_release);
+    }
+    g_dispatchDone.store(true, std::memory_order_release);
+}
+
+// ======================= 统计 =======================
+
+double quantile(std::vector<double> v, double q) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    double pos = q * (v.size() - 1);
+    size_t lo = static_cast<size_t>(pos);
+    size_t hi = std::min(lo + 1, v.size() - 1);
+    return v[lo] + (v[hi] - v[lo]) * (pos - lo);
+}
+
+double mean(const std::vector<double>& v) {
+    if (v.empty()) return 0;
+    double s = 0;
+    for (double x : v) s += x;
+    return s / v.size();
+}
+
+void writeResults() {
+    std::string path = g_opt.output;
+    if (path.empty()) {
+        std::ostringstream ss;
+        ss << "result_sample" << g_opt.sampleInterval << "_speed" << g_opt.speedup << "x.csv";
+        path = ss.str();
+    }
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        std::cerr << "[LoadGen] Failed to write " << path << std::endl;
+        return;
+    }
+    fprintf(f, "send_time,input_len,expected_output_len,actual_output_tokens,latency,ttft,status,"
+               "ttft_violated,bad_token_intervals_count,scheduled_ns,dispatch_ns,sent_ns,first_token_ns,end_ns\n");
+    for (size_t i = 0; i < g_requests.size(); i++) {
+        const Request& q = g_requests[i];
+        const Result& r = g_results[i];
+        double ttft = r.firstTokenNs ? (r.firstTokenNs - r.dispatchNs) / 1e9 : 0.0;
+        int bad = 0;
+        for (size_t k = 1; k < r.tokenNs.size(); k++) {
+            if ((r.tokenNs[k] - r.tokenNs[k - 1]) / 1e9 > g_opt.sloTpot) bad++;
+        }
+        fprintf(f, "%.6f,%lld,%lld,%zu,%.9f,%.9f,%d,%s,%d,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 "\n",
+                r.wallSendNs / 1e9, q.inputLen, q.outputLen, r.tokenNs.size(),
+                (r.endNs - r.dispatchNs) / 1e9, ttft, r.status,
+                ttft > g_opt.sloTtft ? "True" : "False", bad,
+                q.offsetNs, r.dispatchNs - g_startNs,
+                r.sentNs ? r.sentNs - g_startNs : 0,
+                r.firstTokenNs ? r.firstTokenNs - g_startNs : 0,
+                r.endNs - g_startNs);
+    }
+    fclose(f);
+    std::cout << "Results written to " << path << std::endl;
+
+    if (!g_opt.tokenLog.empty()) {
+        FILE* t = fopen(g_opt.tokenLog.c_str(), "w");
+        if (t) {
+            fprintf(t, "request,token,t_ns\n");
+            for (size_t i = 0; i < g_results.size(); i++) {
+                for (size_t k = 0; k < g_results[i].tokenNs.size(); k++) {
+                    fprintf(t, "%zu,%zu,%" PRId64 "\n", i, k, g_results[i].tokenNs[k] - g_startNs);
+                }
+            }
+            fclose(t);
+        }
+    }
+}
+
+void printSummary(double duration) {
+    std::vector<double> lat, ttft, intervalsMs, lagUs;
+    long long inTokens = 0, outTokens = 0;
+    size_t ttftViolations = 0, badIntervals = 0;
+    for (size_t i = 0; i < g_requests.size(); i++) {
+        const Result& r = g_results[i];
+        lagUs.push_back((r.dispatchNs - g_startNs - g_requests[i].offsetNs) / 1e3);
+        if (r.status != 200) continue;
+        lat.push_back((r.endNs - r.dispatchNs) / 1e9);
+        double t = r.firstTokenNs ? (r.firstTokenNs - r.dispatchNs) / 1e9 : 0.0;
+        ttft.push_back(t);
+        if (t > g_opt.sloTtft) ttftViolations++;
+        inTokens += g_requests[i].inputLen;
+        outTokens += static_cast<long long>(r.tokenNs.size());
+        for (size_t k = 1; k < r.tokenNs.size(); k++) {
+            double iv = (r.tokenNs[k] - r.tokenNs[k - 1]) / 1e9;
+            intervalsMs.push_back(iv * 1000);
+            if (iv > g_opt.sloTpot) badIntervals++;
+        }
+    }
+
+    printf("\n=============================================\n");
+    printf("  RESULTS (Sample: 1/%lld, Speed: %gx)\n", g_opt.sampleInterval, g_opt.speedup);
+    printf("=============================================\n");
+    printf("[Arrival Precision] dispatch lag vs. schedule\n");
+    printf("  P50: %.1f us  P99: %.1f us  Max: %.1f us\n",
+           quantile(lagUs, 0.5), quantile(lagUs, 0.99), lagUs.empty() ? 0.0 : *std::max_element(lagUs.begin(), lagUs.end()));
+    if (lat.empty()) {
+        printf("No valid requests.\n");
+        return;
+    }
+    size_t count = lat.size();
+    printf("Total Successful Requests: %zu\n", count);
+    if (g_timedOut.load()) printf("Timed Out Requests     : %zu (> %gs, counted as failed)\n", g_timedOut.load(), g_opt.timeout);
+    printf("Benchmark Duration     : %.2f s\n", duration);
+    printf("Total Input Tokens     : %lld\n", inTokens);
+    printf("Total Output Tokens    : %lld\n", outTokens);
+    printf("Total Token Intervals  : %zu (Excludes first token)\n", intervalsMs.size());
+
+    printf("\n[Throughput System-wide]\n");
+    printf("  Requests/s      : %.2f req/s\n", count / duration);
+    printf("  Prefill Tokens/s: %.2f tokens/s\n", inTokens / duration);
+    printf("  Decode Tokens/s : %.2f tokens/s\n", outTokens / duration);
+
+    printf("\n[E2E Latency]\n");
+    printf("  Avg: %.4f s\n  P50: %.4f s\n  P90: %.4f s\n  P99: %.4f s\n",
+           mean(lat), quantile(lat, 0.5), quantile(lat, 0.9), quantile(lat, 0.99));
+    printf("\n[TTFT - Time To First Token]\n");
+    printf("  Avg: %.4f s\n  P50: %.4f s\n  P90: %.4f s\n  P99: %.4f s\n",
+           mean(ttft), quantile(ttft, 0.5), quantile(ttft, 0.9), quantile(ttft, 0.99));
+    printf("\n[Global TPOT - Inter-Token Latency]\n");
+    printf("  Avg: %.2f ms\n  P50: %.2f ms\n  P90: %.2f ms\n  P99: %.2f ms\n",
+           mean(intervalsMs), quantile(intervalsMs, 0.5), quantile(intervalsMs, 0.9), quantile(intervalsMs, 0.99));
+
+    double tpotRate = intervalsMs.empty() ? 0.0 : 100.0 * badIntervals / intervalsMs.size();
+    printf("\n[SLO Violation Rates]\n");
+    printf("  TTFT Violation Rate (> %gs)           : %.2f%% (%zu/%zu Requests)\n",
+           g_opt.sloTtft, 100.0 * ttftViolations / count, ttftViolations, count);
+    printf("  TPOT Violation Rate (> %gs) : %.2f%% (%zu/%zu Intervals)\n",
+           g_opt.sloTpot, tpotRate, badIntervals, intervalsMs.size());
+
+    if (g_opt.record) {
+        std::string trace = g_opt.tracePath.substr(g_opt.tracePath.rfind('/') + 1);
+        // 与 Python 回放脚本同名同配置 (azure_replay / burstgpt_replay)，两边的结果可以直接对比
+        ResultRecord rec(std::string(traceFormatName(g_format)) + "_replay");
+        rec.config("trace", trace);
+        rec.config("sample_interval", g_opt.sampleInterval);
+        rec.config("speedup", g_opt.speedup);
+        rec.config("read_limit", g_opt.readLimit);
+        rec.config("max_requests", g_opt.maxRequests);
+        rec.metric("requests_per_s", count / duration, "req/s", true);
+        rec.metric("prefill_tps", inTokens / duration, "tokens/s", true);
+        rec.metric("decode_tps", outTokens / duration, "tokens/s", true);
+        rec.metric("ttft_violation_rate", 100.0 * ttftViolations / count, "%", false);
+        rec.metric("tpot_violation_rate", tpotRate, "%", false);
+        rec.samples("latency", lat, "s", false);
+        rec.samples("ttft", ttft, "s", false);
+        rec.samples("tpot", intervalsMs, "ms", false);
+        rec.samples("dispatch_lag", lagUs, "us", false);
+        rec.append();
+    }
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --trace <csv> [options]\n"
+              << "  --url <url>              (default http://127.0.0.1:30001/v1/completions)\n"
+              << "  --model <name>\n"
+              << "  --read-limit <n>         rows read from the trace head (default 200000, 0 = all)\n"
+              << "  --sample-interval <n>    pick 1 request every n rows (default 2)\n"
+              << "  --speedup <f>            time compression factor (default 1.1)\n"
+              << "  --max-requests <n>       (default 10000)\n"
+              << "  --slo-ttft <s> --slo-tpot <s>\n"
+              << "  --timeout <s>            per-request deadline, counted as failed (default 300, 0 = none)\n"
+              << "  --io-threads <n>         epoll threads (default 2)\n"
+              << "  --spin-us <n>            busy-wait window before each arrival (default 50)\n"
+              << "  --seed <n>               prompt RNG seed\n"
+              << "  --output <csv>           per-request results\n"
+              << "  --token-log <csv>        per-token timestamps (ns)\n"
+              << "  --record                 append the result to the benchmark result store\n";
+}
+
+bool parseArgs(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"trace", required_argument, nullptr, 't'},
+        {"url", required_argument, nullptr, 'u'},
+        {"model", required_argument, nullptr, 'm'},
+        {"read-limit", required_argument, nullptr, 'r'},
+        {"sample-interval", required_argument, nullptr, 'i'},
+        {"speedup", required_argument, nullptr, 's'},
+        {"max-requests", required_argument, nullptr, 'n'},
+        {"slo-ttft", required_argument, nullptr, 'T'},
+        {"slo-tpot", required_argument, nullptr, 'P'},
+        {"timeout", required_argument, nullptr, 'D'},
+        {"io-threads", required_argument, nullptr, 'j'},
+        {"spin-us", required_argument, nullptr, 'w'},
+        {"seed", required_argument, nullptr, 'S'},
+        {"output", required_argument, nullptr, 'o'},
+        {"token-log", required_argument, nullptr, 'k'},
+        {"record", no_argument, nullptr, 'R'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 't': g_opt.tracePath = optarg; break;
+        case 'u': g_opt.url = optarg; break;
+        case 'm': g_opt.model = optarg; break;
+        case 'r': g_opt.readLimit = atoll(optarg); break;
+        case 'i': g_opt.sampleInterval = atoll(optarg); break;
+        case 's': g_opt.speedup = atof(optarg); break;
+        case 'n': g_opt.maxRequests = atoll(optarg); break;
+        case 'T': g_opt.sloTtft = atof(optarg); break;
+        case 'P': g_opt.sloTpot = atof(optarg); break;
+        case 'D': g_opt.timeout = std::max(0.0, atof(optarg)); break;
+        case 'j': g_opt.ioThreads = std::max(1, atoi(optarg)); break;
+        case 'w': g_opt.spinNs = atoll(optarg) * 1000; break;
+        case 'S': g_opt.seed = strtoull(optarg, nullptr, 10); break;
+        case 'o': g_opt.output = optarg; break;
+        case 'k': g_opt.tokenLog = optarg; break;
+        case 'R': g_opt.record = true; break;
+        default: return false;
+        }
+    }
+    return !g_opt.tracePath.empty() && g_opt.speedup > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    HttpUrl url;
+    if (!parseHttpUrl(g_opt.url, url) || !resolveHttpUrl(url, g_addr, g_addrLen)) {
+        std::cerr << "[LoadGen] Invalid or unresolvable URL: " << g_opt.url << std::endl;
+        return 1;
+    }
+    if (!loadTrace(url)) return 1;
+
+    // 开环压测会同时保持大量连接
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    size_t total = g_requests.size();
+    g_results.resize(total);
+    g_conns.resize(total);
+
+    printf("\n=== Benchmark Config ===\n");
+    printf("Sample Interval : Every %lldth request\n", g_opt.sampleInterval);
+    printf("Speedup Factor  : %gx\n", g_opt.speedup);
+    printf("Actual Requests : %zu\n", total);
+    printf("Trace Span      : %.2f s (after speedup)\n", g_requests.back().offsetNs / 1e9);
+    printf("Mode            : Streaming, open-loop\n");
+    printf("SLO Thresholds  : TTFT < %gs, TPOT < %gs\n", g_opt.sloTtft, g_opt.sloTpot);
+
+    std::vector<int> epfds;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < g_opt.ioThreads; i++) {
+        int epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd == -1) {
+            perror("epoll_create1");
+            return 1;
+        }
+        epfds.push_back(epfd);
+    }
+    for (size_t i = 0; i < epfds.size(); i++) workers.emplace_back(ioLoop, epfds[i], i, epfds.size());
+
+    printf("Starting requests...\n");
+    g_startNs = monoNowNs() + 100000000LL;   // 预留 100ms 让 IO 线程就绪
+    std::thread dispatcher(dispatchLoop, std::cref(epfds));
+
+    while (!g_dispatchDone.load() || g_finished.load() < g_dispatched.load()) {
+        usleep(500000);
+        size_t done = g_finished.load();
+        printf("\r[Progress]: %zu/%zu (%.1f%%) requests finished.", done, total, 100.0 * done / total);
+        fflush(stdout);
+    }
+    dispatcher.join();
+    for (auto& t : workers) t.join();
+    for (int epfd : epfds) close(epfd);
+
+    int64_t endNs = 0;
+    for (const Result& r : g_results) endNs = std::max(endNs, r.endNs);
+    double duration = (endNs - g_startNs) / 1e9;
+    printf("\nAll tasks completed in %.2f seconds.\n", duration);
+
+    writeResults();
+    printSummary(duration);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// ============================================================
+//  固定内存的分位数草图 (DDSketch 思路: 对数分桶，相对误差有界)
+// ============================================================
+
+/**
+ * @brief 非负值分位数草图
+ * 值 x 落入桶 ceil(log_gamma(x))，gamma = (1+a)/(1-a)，
+ * 任意分位数估计的相对误差不超过 a。桶数固定，内存恒定。
+ */
+class QuantileSketch {
+public:
+    static constexpr int NUM_BUCKETS = 4096;
+
+    explicit QuantileSketch(double relativeAccuracy = 0.01)
+        : gamma_((1 + relativeAccuracy) / (1 - relativeAccuracy)),
+          logGamma_(std::log(gamma_)),
+          // 最小可区分值，保证桶下标非负
+          minIndexable_(std::pow(gamma_, -NUM_BUCKETS / 2.0)),
+          zeroCount_(0), count_(0), sum_(0), min_(0), max_(0) {
+        memset(buckets_, 0, sizeof(buckets_));
+    }
+
+    void add(double x) {
+        if (count_ == 0 || x < min_) min_ = x;
+        if (count_ == 0 || x > max_) max_ = x;
+        count_++;
+        sum_ += x;
+        if (x <= minIndexable_) {
+            zeroCount_++;
+            return;
+        }
+        buckets_[index(x)]++;
+    }
+
+    // q ∈ [0, 1]
+    double quantile(double q) const {
+        if (count_ == 0) return 0;
+        if (q <= 0) return min_;
+        if (q >= 1) return max_;
+        uint64_t rank = static_cast<uint64_t>(q * (count_ - 1));
+        if (rank < zeroCount_) return min_ > 0 ? min_ : 0;
+        uint64_t seen = zeroCount_;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += buckets_[i];
+            if (seen > rank) {
+                double v = 2 * std::pow(gamma_, i - NUM_BUCKETS / 2) / (1 + gamma_);
+                return v < min_ ? min_ : (v > max_ ? max_ : v);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return count_; }
+    double sum() const { return sum_; }
+    double mean() const { return count_ ? sum_ / count_ : 0; }
+    double min() const { return min_; }
+    double max() const { return max_; }
+
+private:
+    int index(double x) const {
+        int i = static_cast<int>(std::ceil(std::log(x) / logGamma_)) + NUM_BUCKETS / 2;
+        return i < 0 ? 0 : (i >= NUM_BUCKETS ? NUM_BUCKETS - 1 : i);
+    }
+
+    double gamma_;
+    double logGamma_;
+    double minIndexable_;
+    uint64_t buckets_[NUM_BUCKETS];
+    uint64_t zeroCount_;
+    uint64_t count_;
+    double sum_;
+    double min_;
+    double max_;
+};
+
+// Welford 在线均值/方差
+class RunningStats {
+public:
+    RunningStats() : n_(0), mean_(0), m2_(0) {}
+
+    void add(double x) {
+        n_++;
+        double d = x - mean_;
+        mean_ += d / n_;
+        m2_ += d * (x - mean_);
+    }
+
+    uint64_t count() const { return n_; }
+    double mean() const { return mean_; }
+    double variance() const { return n_ > 1 ? m2_ / (n_ - 1) : 0; }
+    double stddev() const { return std::sqrt(variance()); }
+
+private:
+    uint64_t n_;
+    double mean_;
+    double m2_;
+};
@@ -0,0 +1,205 @@
+// ============================================================
+//  本地 SGLang 桩服务 (用于在无 GPU 环境下验证压测工具)
+//  支持 POST /v1/completions 与 /generate，流式 (SSE, chunked) 与非流式响应；
+//  首 token 延迟 = ttft + prefill_us_per_token * prompt 长度，之后每 tpot 输出一个 token
+// ============================================================
+
+#include "http_util.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <getopt.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+struct Options {
+    int port = 30001;
+    double ttftMs = 20;
+    double tpotMs = 5;
+    double prefillUsPerToken = 0;
+};
+
+Options g_opt;
+std::atomic<long long> g_served(0);
+
+bool sendAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool sendChunk(int fd, const std::string& payload) {
+    char head[32];
+    int hn = snprintf(head, sizeof(head), "%zx\r\n", payload.size());
+    return sendAll(fd, head, static_cast<size_t>(hn)) &&
+           sendAll(fd, payload.data(), payload.size()) &&
+           sendAll(fd, "\r\n", 2);
+}
+
+void sleepMs(double ms) {
+    if (ms > 0) usleep(static_cast<useconds_t>(ms * 1000));
+}
+
+// 读取完整请求 (请求头 + Content-Length 指定的请求体)
+bool readRequest(int fd, std::string& head, std::string& body) {
+    std::string buf;
+    char tmp[65536];
+    size_t hend = std::string::npos;
+    long long contentLength = 0;
+    while (true) {
+        if (hend == std::string::npos) {
+            hend = buf.find("\r\n\r\n");
+            if (hend != std::string::npos) {
+                head = buf.substr(0, hend);
+                const char* p = strcasestr(head.c_str(), "content-length:");
+                if (p) contentLength = atoll(p + strlen("content-length:"));
+            }
+        }
+        if (hend != std::string::npos && static_cast<long long>(buf.size() - hend - 4) >= contentLength) {
+            body = buf.substr(hend + 4, static_cast<size_t>(contentLength));
+            return true;
+        }
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf.append(tmp, static_cast<size_t>(n));
+    }
+}
+
+void serve(int fd) {
+    std::string head, body;
+    if (!readRequest(fd, head, body)) {
+        close(fd);
+        return;
+    }
+    const char* b = body.data();
+    const char* e = b + body.size();
+    bool generate = head.find(" /generate") != std::string::npos;
+    bool completions = head.find(" /v1/completions") != std::string::npos;
+    if (!generate && !completions) {
+        const char* nf = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        sendAll(fd, nf, strlen(nf));
+        close(fd);
+        return;
+    }
+
+    long long maxTokens = generate ? jsonIntValue(b, e, "max_new_tokens", 16) : jsonIntValue(b, e, "max_tokens", 16);
+    bool stream = jsonBoolValue(b, e, "stream", false);
+    // prompt 以空格分词近似 token 数
+    long long promptTokens = 0;
+    for (const char* p = b; p < e; p++) {
+        if (*p == ' ') promptTokens++;
+    }
+
+    sleepMs(g_opt.ttftMs + g_opt.prefillUsPerToken * promptTokens / 1000.0);
+
+    if (!stream) {
+        std::string text;
+        for (long long i = 0; i < maxTokens; i++) text += " tok";
+        std::string payload = generate
+            ? "{\"text\":\"" + text + "\",\"meta_info\":{\"completion_tokens\":" + std::to_string(maxTokens) + "}}"
+            : "{\"id\":\"stub\",\"object\":\"text_completion\",\"choices\":[{\"index\":0,\"text\":\"" + text + "\",\"finish_reason\":\"length\"}]}";
+        sleepMs(g_opt.tpotMs * (maxTokens > 0 ? maxTokens - 1 : 0));
+        std::string resp = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: " +
+                           std::to_string(payload.size()) + "\r\n\r\n" + payload;
+        sendAll(fd, resp.data(), resp.size());
+    } else {
+        const char* hdr = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                          "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+        bool ok = sendAll(fd, hdr, strlen(hdr));
+        std::string cumulative;
+        for (long long i = 0; ok && i < maxTokens; i++) {
+            if (i) sleepMs(g_opt.tpotMs);
+            std::string event;
+            if (generate) {
+                // SGLang 原生接口返回累计文本
+                cumulative += " tok";
+                event = "data: {\"text\":\"" + cumulative + "\",\"meta_info\":{\"completion_tokens\":" +
+                        std::to_string(i + 1) + "}}\n\n";
+            } else {
+                event = "data: {\"id\":\"stub\",\"object\":\"text_completion\",\"choices\":[{\"index\":0,"
+                        "\"text\":\" tok\",\"finish_reason\":null}]}\n\n";
+            }
+            ok = sendChunk(fd, event);
+        }
+        if (ok) ok = sendChunk(fd, "data: [DONE]\n\n");
+        if (ok) sendAll(fd, "0\r\n\r\n", 5);
+    }
+    g_served.fetch_add(1);
+    close(fd);
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--port 30001] [--ttft-ms 20] [--tpot-ms 5] [--prefill-us-per-token 0]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"port", required_argument, nullptr, 'p'},
+        {"ttft-ms", required_argument, nullptr, 'f'},
+        {"tpot-ms", required_argument, nullptr, 't'},
+        {"prefill-us-per-token", required_argument, nullptr, 'x'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 'p': g_opt.port = atoi(optarg); break;
+        case 'f': g_opt.ttftMs = atof(optarg); break;
+        case 't': g_opt.tpotMs = atof(optarg); break;
+        case 'x': g_opt.prefillUsPerToken = atof(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(g_opt.port));
+    if (bind(lfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 || listen(lfd, 4096) == -1) {
+        perror("[Stub] bind/listen");
+        return 1;
+    }
+    std::cout << "[Stub] Listening on 127.0.0.1:" << g_opt.port << " (ttft " << g_opt.ttftMs
+              << " ms, tpot " << g_opt.tpotMs << " ms)" << std::endl;
+
+    while (true) {
+        int fd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // fd 耗尽: 等在途请求结束一些再接受，不空转
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            perror("[Stub] accept");
+            break;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::thread(serve, fd).detach();
+    }
+    close(lfd);
+    return 0;
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================
+//  Trace CSV 解析 (Azure LLM Inference Trace / BurstGPT)
+//  与 test_azure/*.py、test_burstGPT/*.py 读取的 CSV 格式一致
+// ============================================================
+
+// 只读 mmap 整个文件，由调用方顺序扫描
+class MappedFile {
+public:
+    MappedFile() : data_(nullptr), size_(0), released_(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        struct stat st;
+        if (fstat(fd, &st) == -1 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) return false;
+        madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(ptr);
+        size_ = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    void close() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+        released_ = 0;
+    }
+
+    // 归还 [0, upTo) 范围内已扫描过的页，使单次扫描的常驻内存保持恒定
+    void release(size_t upTo) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t end = upTo / page * page;
+        if (data_ && end > released_) {
+            madvise(const_cast<char*>(data_) + released_, end - released_, MADV_DONTNEED);
+            released_ = end;
+        }
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t released_;
+};
+
+enum class TraceFormat { Unknown, Azure, BurstGPT };
+
+inline const char* traceFormatName(TraceFormat f) {
+    switch (f) {
+        case TraceFormat::Azure:    return "azure";
+        case TraceFormat::BurstGPT: return "burstgpt";
+        default:                    return "unknown";
+    }
+}
+
+// 一行请求记录；token 数缺失 (NaN/空) 时为 -1
+struct TraceRow {
+    double timestamp;
+    long long inputTokens;
+    long long outputTokens;
+};
+
+// 解析十进制数 (支持符号、小数和指数)，不要求以 '\0' 结尾
+inline bool parseNumber(const char* p, const char* end, double& out) {
+    while (p < end && (*p == ' ' || *p == '"')) p++;
+    while (end > p && (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\r')) end--;
+    if (p == end) return false;
+
+    bool neg = false;
+    if (*p == '-' || *p == '+') { neg = (*p == '-'); p++; }
+
+    double value = 0;
+    bool digits = false;
+    while (p < end && *p >= '0' && *p <= '9') { value = value * 10 + (*p - '0'); p++; digits = true; }
+    if (p < end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while (p < end && *p >= '0' && *p <= '9') { value += (*p - '0') * scale; scale *= 0.1; p++; digits = true; }
+    }
+    if (!digits) return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool eneg = false;
+        if (p < end && (*p == '-' || *p == '+')) { eneg = (*p == '-'); p++; }
+        int e = 0;
+        while (p < end && *p >= '0' && *p <= '9') { e = e * 10 + (*p - '0'); p++; }
+        double m = 1;
+        for (int i = 0; i < e; i++) m *= 10;
+        value = eneg ? value / m : value * m;
+    }
+    if (p != end) return false;
+    out = neg ? -value : value;
+    return true;
+}
+
+// 公历日期 -> 自 1970-01-01 起的天数 (Howard Hinnant 的 days_from_civil)
+inline long long daysFromCivil(long long y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const long long era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long long>(doe) - 719468;
+}
+
+// 解析 "2023-11-16 18:15:46.6805900" (小数部分可选) -> Unix 秒，按 UTC 处理
+inline bool parseDateTime(const char* p, const char* end, double& out) {
+    while (p < end && (*p == ' ' || *p == '"')) p++;
+    while (end > p && (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\r')) end--;
+
+    int fields[6] = {0, 0, 0, 0, 0, 0};
+    int idx = 0;
+    bool any = false;
+    while (p < end && idx < 6) {
+        if (*p >= '0' && *p <= '9') {
+            fields[idx] = fields[idx] * 10 + (*p - '0');
+            any = true;
+        } else if (*p == '-' || *p == ' ' || *p == ':' || *p == 'T') {
+            if (!any) return false;
+            idx++;
+            any = false;
+        } else if (*p == '.') {
+            break;
+        } else {
+            return false;
+        }
+        p++;
+    }
+    if (idx != 5 || !any) return false;
+
+    double frac = 0;
+    if (p < end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while (p < end && *p >= '0' && *p <= '9') { frac += (*p - '0') * scale; scale *= 0.1; p++; }
+    }
+    long long days = daysFromCivil(fields[0], fields[1], fields[2]);
+    out = static_cast<double>(days * 86400LL + fields[3] * 3600LL + fields[4] * 60LL + fields[5]) + frac;
+    return true;
+}
+
+/**
+ * @brief 基于内存区间的流式 CSV 行解析器
+ * 根据表头自动识别格式:
+ *   Azure    : TIMESTAMP,ContextTokens,GeneratedTokens
+ *   BurstGPT : Timestamp,Model,Request tokens,Response tokens,Total tokens,Log Type
+ */
+class TraceParser {
+public:
+    TraceParser()
+        : begin_(nullptr), end_(nullptr), cur_(nullptr), headerEnd_(nullptr), lineBegin_(nullptr), lineEnd_(nullptr),
+          format_(TraceFormat::Unknown), tsCol_(-1), inCol_(-1), outCol_(-1), skipped_(0) {}
+
+    // 读取表头；失败表示无法识别列
+    bool init(const char* data, size_t size) {
+        begin_ = data;
+        end_ = data + size;
+        cur_ = data;
+        const char* lineEnd = findLineEnd(cur_);
+        headerEnd_ = lineEnd;
+
+        int col = 0;
+        const char* f = cur_;
+        while (f <= lineEnd) {
+            const char* fe = findFieldEnd(f, lineEnd);
+            std::string name = trimField(f, fe);
+            if (name == "TIMESTAMP") { tsCol_ = col; format_ = TraceFormat::Azure; }
+            else if (name == "Timestamp") { tsCol_ = col; format_ = TraceFormat::BurstGPT; }
+            else if (name == "ContextTokens" || name == "Request tokens") inCol_ = col;
+            else if (name == "GeneratedTokens" || name == "Response tokens") outCol_ = col;
+            col++;
+            f = fe + 1;
+        }
+        cur_ = advance(lineEnd);
+        return tsCol_ >= 0 && inCol_ >= 0 && outCol_ >= 0;
+    }
+
+    // 读取下一条记录；格式错误的行计入 skipped() 并跳过
+    bool next(TraceRow& row) {
+        while (cur_ < end_) {
+            const char* lineEnd = findLineEnd(cur_);
+            lineBegin_ = cur_;
+            lineEnd_ = lineEnd;
+            const char* line = cur_;
+            cur_ = advance(lineEnd);
+            if (lineEnd == line || (lineEnd - line == 1 && *line == '\r')) continue;
+            if (parseLine(line, lineEnd, row)) return true;
+            skipped_++;
+        }
+        return false;
+    }
+
+    TraceFormat format() const { return format_; }
+    long long skipped() const { return skipped_; }
+    size_t offset() const { return static_cast<size_t>(cur_ - begin_); }
+
+    // 最近一次 next() 返回的原始行 (不含换行符)，用于原样输出子 trace
+    const char* lineBegin() const { return lineBegin_; }
+    const char* lineEnd() const { return lineEnd_; }
+    // 表头原始行
+    const char* headerBegin() const { return begin_; }
+    const char* headerEnd() const { return headerEnd_; }
+
+private:
+    const char* findLineEnd(const char* p) const {
+        const void* nl = memchr(p, '\n', static_cast<size_t>(end_ - p));
+        return nl ? static_cast<const char*>(nl) : end_;
+    }
+
+    const char* advance(const char* lineEnd) const {
+        return lineEnd < end_ ? lineEnd + 1 : end_;
+    }
+
+    static const char* findFieldEnd(const char* p, const char* lineEnd) {
+        bool quoted = false;
+        while (p < lineEnd) {
+            if (*p == '"') quoted = !quoted;
+            else if (*p == ',' && !quoted) return p;
+            p++;
+        }
+        return lineEnd;
+    }
+
+    static std::string trimField(const char* p, const char* e) {
+        while (p < e && (*p == ' ' || *p == '"' || *p == '\xef' || *p == '\xbb' || *p == '\xbf')) p++;
+        while (e > p && (e[-1] == ' ' || e[-1] == '"' || e[-1] == '\r')) e--;
+        return std::string(p, e);
+    }
+
+    static long long parseTokens(const char* p, const char* e) {
+        double v;
+        if (!parseNumber(p, e, v) || v < 0) return -1;
+        return static_cast<long long>(v);
+    }
+
+    bool parseLine(const char* line, const char* lineEnd, TraceRow& row) const {
+        bool haveTs = false;
+        row.inputTokens = -1;
+        row.outputTokens = -1;
+        int col = 0;
+        const char* f = line;
+        while (f <= lineEnd) {
+            const char* fe = findFieldEnd(f, lineEnd);
+            if (col == tsCol_) {
+                haveTs = (format_ == TraceFormat::Azure) ? parseDateTime(f, fe, row.timestamp)
+                                                         : parseNumber(f, fe, row.timestamp);
+            } else if (col == inCol_) {
+                row.inputTokens = parseTokens(f, fe);
+            } else if (col == outCol_) {
+                row.outputTokens = parseTokens(f, fe);
+            }
+            col++;
+            f = fe + 1;
+        }
+        return haveTs;
+    }
+
+    const char* begin_;
+    const char* end_;
+    const char* cur_;
+    const char* headerEnd_;
+    const char* lineBegin_;
+    const char* lineEnd_;
+    TraceFormat format_;
+    int tsCol_;
+    int inCol_;
+    int outCol_;
+    long long skipped_;
+};
@@ -0,0 +1,343 @@
+// ============================================================
+//  流式 trace 画像工具 (替代 test_azure/profile/profile_rawdata.py)
+//  mmap + 单遍扫描，内存占用与 trace 大小无关:
+//    - 到达率时间序列 (按桶输出 CSV，容忍小范围乱序)
+//    - 输入/输出 token 长度、RPS、到达间隔的分位数 (QuantileSketch)
+//    - 突发性指标: 到达间隔 CV、Goh-Barabasi 突发度、多时间尺度的分散指数
+//    - 按采样间隔/时间窗口抽取子 trace (原样保留行格式，可直接交给回放脚本)
+// ============================================================
+
+#include "trace.h"
+#include "sketch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+
+namespace {
+
+struct Options {
+    std::string tracePath;
+    double bucketSec = 1.0;
+    int reorderBuckets = 60;        // 允许的乱序范围 (桶)
+    std::string seriesPath;
+    std::string samplePath;
+    long long sampleInterval = 1;
+    double sampleStart = 0;          // 相对 trace 起点的秒数
+    double sampleDuration = -1;      // <0 表示直到结尾
+    long long sampleMax = 0;         // 0 表示不限
+};
+
+Options g_opt;
+
+// 多时间尺度的分散指数 (Index of Dispersion = Var/Mean)
+// 泊松到达时约为 1，越大越突发
+struct DispersionScale {
+    int buckets;
+    long long acc = 0;
+    int filled = 0;
+    RunningStats stats;
+
+    explicit DispersionScale(int b) : buckets(b) {}
+
+    void add(long long count) {
+        acc += count;
+        if (++filled == buckets) {
+            stats.add(static_cast<double>(acc));
+            acc = 0;
+            filled = 0;
+        }
+    }
+};
+
+/**
+ * @brief 按固定宽度时间桶统计到达数
+ * 使用环形缓冲暂存最近 reorderBuckets 个桶，超出窗口的桶按顺序输出；
+ * 空桶同样输出，与 pandas resample('1s').size() 的语义一致。
+ */
+class ArrivalSeries {
+public:
+    static constexpr int RING = 4096;
+
+    ArrivalSeries(double bucketSec, int window, FILE* out)
+        : bucketSec_(bucketSec), window_(window < RING - 1 ? window : RING - 1), out_(out),
+          started_(false), head_(0), maxSeen_(0), late_(0), emitted_(0), rps_(0.005),
+          scales_{DispersionScale(1), DispersionScale(10), DispersionScale(60), DispersionScale(600)} {
+        memset(ring_, 0, sizeof(ring_));
+        if (out_) fprintf(out_, "bucket_start,requests,input_tokens,output_tokens\n");
+    }
+
+    void add(double ts, long long in, long long out) {
+        long long b = static_cast<long long>(ts / bucketSec_);
+        if (!started_) {
+            started_ = true;
+            head_ = b;
+            maxSeen_ = b;
+        }
+        if (b < head_) {
+            late_++;
+            return;
+        }
+        if (b > maxSeen_) {
+            maxSeen_ = b;
+            flushUntil(maxSeen_ - window_);
+        }
+        Bucket& k = ring_[b % RING];
+        k.requests++;
+        k.inputTokens += in > 0 ? in : 0;
+        k.outputTokens += out > 0 ? out : 0;
+    }
+
+    void finish() {
+        if (started_) flushUntil(maxSeen_ + 1);
+        if (out_) fflush(out_);
+    }
+
+    const QuantileSketch& rps() const { return rps_; }
+    long long late() const { return late_; }
+    long long emitted() const { return emitted_; }
+    double bucketSec() const { return bucketSec_; }
+    const DispersionScale& scale(int i) const { return scales_[i]; }
+    static int numScales() { return 4; }
+
+private:
+    struct Bucket {
+        long long requests;
+        long long inputTokens;
+        long long outputTokens;
+    };
+
+    void flushUntil(long long limit) {
+        while (head_ < limit) {
+            Bucket& k = ring_[head_ % RING];
+            if (out_) {
+                fprintf(out_, "%.3f,%lld,%lld,%lld\n", head_ * bucketSec_, k.requests, k.inputTokens, k.outputTokens);
+            }
+            rps_.add(k.requests / bucketSec_);
+            for (int i = 0; i < numScales(); i++) scales_[i].add(k.requests);
+            memset(&k, 0, sizeof(k));
+            head_++;
+            emitted_++;
+        }
+    }
+
+    double bucketSec_;
+    int window_;
+    FILE* out_;
+    bool started_;
+    long long head_;
+    long long maxSeen_;
+    long long late_;
+    long long emitted_;
+    Bucket ring_[RING];
+    QuantileSketch rps_;
+    DispersionScale scales_[4];
+};
+
+void printTokenRow(const char* name, const QuantileSketch& s) {
+    printf("  %-16s mean %9.1f  p50 %8.0f  p90 %8.0f  p95 %8.0f  p99 %8.0f  p99.9 %8.0f  max %8.0f\n",
+           name, s.mean(), s.quantile(0.5), s.quantile(0.9), s.quantile(0.95), s.quantile(0.99),
+           s.quantile(0.999), s.max());
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --trace <csv> [options]\n"
+              << "  --bucket <sec>            arrival-rate bucket width (default 1)\n"
+              << "  --reorder-buckets <n>     tolerated out-of-order span in buckets (default 60)\n"
+              << "  --series <csv>            write arrival-rate time series\n"
+              << "  --sample-out <csv>        write a sampled sub-trace (same format as input)\n"
+              << "  --sample-interval <n>     keep 1 of every n rows (default 1)\n"
+              << "  --sample-start <sec>      window start relative to trace start (default 0)\n"
+              << "  --sample-duration <sec>   window length (default: until end)\n"
+              << "  --sample-max <n>          max rows in sub-trace (default unlimited)\n";
+}
+
+bool parseArgs(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"trace", required_argument, nullptr, 't'},
+        {"bucket", required_argument, nullptr, 'b'},
+        {"reorder-buckets", required_argument, nullptr, 'r'},
+        {"series", required_argument, nullptr, 's'},
+        {"sample-out", required_argument, nullptr, 'o'},
+        {"sample-interval", required_argument, nullptr, 'i'},
+        {"sample-start", required_argument, nullptr, 'S'},
+        {"sample-duration", required_argument, nullptr, 'D'},
+        {"sample-max", required_argument, nullptr, 'n'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 't': g_opt.tracePath = optarg; break;
+        case 'b': g_opt.bucketSec = atof(optarg); break;
+        case 'r': g_opt.reorderBuckets = atoi(optarg); break;
+        case 's': g_opt.seriesPath = optarg; break;
+        case 'o': g_opt.samplePath = optarg; break;
+        case 'i': g_opt.sampleInterval = atoll(optarg); break;
+        case 'S': g_opt.sampleStart = atof(optarg); break;
+        case 'D': g_opt.sampleDuration = atof(optarg); break;
+        case 'n': g_opt.sampleMax = atoll(optarg); break;
+        default: return false;
+        }
+    }
+    return !g_opt.tracePath.empty() && g_opt.bucketSec > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+
+    MappedFile file;
+    if (!file.open(g_opt.tracePath)) {
+        std::cerr << "[Profile] Failed to open trace: " << g_opt.tracePath << std::endl;
+        return 1;
+    }
+    TraceParser parser;
+    if (!parser.init(file.data(), file.size())) {
+        std::cerr << "[Profile] Unrecognized trace header" << std::endl;
+        return 1;
+    }
+
+    FILE* series = nullptr;
+    if (!g_opt.seriesPath.empty() && !(series = fopen(g_opt.seriesPath.c_str(), "w"))) {
+        std::cerr << "[Profile] Failed to open " << g_opt.seriesPath << std::endl;
+        return 1;
+    }
+    FILE* sample = nullptr;
+    if (!g_opt.samplePath.empty()) {
+        if (!(sample = fopen(g_opt.samplePath.c_str(), "w"))) {
+            std::cerr << "[Profile] Failed to open " << g_opt.samplePath << std::endl;
+            return 1;
+        }
+        fwrite(parser.headerBegin(), 1, static_cast<size_t>(parser.headerEnd() - parser.headerBegin()), sample);
+        fputc('\n', sample);
+    }
+
+    QuantileSketch inputTokens, outputTokens, interArrival;
+    RunningStats iatStats;
+    ArrivalSeries arrivals(g_opt.bucketSec, g_opt.reorderBuckets, series);
+
+    long long rows = 0, missing = 0, shortGen = 0, longCtx = 0, reordered = 0;
+    long long totalIn = 0, totalOut = 0;
+    long long eligible = 0, sampled = 0;
+    double firstTs = 0, lastTs = 0, minTs = 0, maxTs = 0;
+    const size_t RELEASE_STEP = 16u << 20;
+    size_t nextRelease = RELEASE_STEP;
+
+    TraceRow row;
+    while (parser.next(row)) {
+        if (rows == 0) {
+            firstTs = lastTs = minTs = maxTs = row.timestamp;
+        }
+        rows++;
+
+        if (row.inputTokens < 0 || row.outputTokens < 0) missing++;
+        if (row.inputTokens >= 0) {
+            inputTokens.add(static_cast<double>(row.inputTokens));
+            totalIn += row.inputTokens;
+            if (row.inputTokens > 8000) longCtx++;
+        }
+        if (row.outputTokens >= 0) {
+            outputTokens.add(static_cast<double>(row.outputTokens));
+            totalOut += row.outputTokens;
+            if (row.outputTokens <= 5) shortGen++;
+        }
+
+        if (row.timestamp >= lastTs) {
+            if (rows > 1) {
+                double iat = row.timestamp - lastTs;
+                interArrival.add(iat);
+                iatStats.add(iat);
+            }
+            lastTs = row.timestamp;
+        } else {
+            reordered++;
+        }
+        if (row.timestamp < minTs) minTs = row.timestamp;
+        if (row.timestamp > maxTs) maxTs = row.timestamp;
+        arrivals.add(row.timestamp, row.inputTokens, row.outputTokens);
+
+        if (sample) {
+            double rel = row.timestamp - firstTs;
+            bool inWindow = rel >= g_opt.sampleStart &&
+                            (g_opt.sampleDuration < 0 || rel < g_opt.sampleStart + g_opt.sampleDuration);
+            if (inWindow && (g_opt.sampleMax <= 0 || sampled < g_opt.sampleMax)) {
+                if (eligible++ % (g_opt.sampleInterval > 1 ? g_opt.sampleInterval : 1) == 0) {
+                    fwrite(parser.lineBegin(), 1, static_cast<size_t>(parser.lineEnd() - parser.lineBegin()), sample);
+                    fputc('\n', sample);
+                    sampled++;
+                }
+            }
+        }
+
+        if (parser.offset() >= nextRelease) {
+            file.release(parser.offset());
+            nextRelease += RELEASE_STEP;
+        }
+    }
+    arrivals.finish();
+    if (series) fclose(series);
+    if (sample) fclose(sample);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    printf("=== [0] Scan ===\n");
+    printf("  File        : %s (%s, %.1f MiB)\n", g_opt.tracePath.c_str(), traceFormatName(parser.format()),
+           file.size() / 1048576.0);
+    printf("  Rows        : %lld (malformed %lld, missing tokens %lld, out-of-order %lld)\n",
+           rows, parser.skipped(), missing, reordered);
+    printf("  Elapsed     : %.2f s (%.0f MiB/s), max RSS %.1f MiB\n",
+           elapsed, file.size() / 1048576.0 / (elapsed > 0 ? elapsed : 1), ru.ru_maxrss / 1024.0);
+    if (rows == 0) return 0;
+
+    printf("\n=== [1] Token Statistics ===\n");
+    printTokenRow("ContextTokens", inputTokens);
+    printTokenRow("GeneratedTokens", outputTokens);
+    printf("  Total Input Tokens : %lld\n", totalIn);
+    printf("  Total Output Tokens: %lld\n", totalOut);
+    if (totalOut > 0) printf("  Prefill / Decode   : %.2f : 1\n", static_cast<double>(totalIn) / totalOut);
+
+    double span = maxTs - minTs;
+    const QuantileSketch& rps = arrivals.rps();
+    printf("\n=== [2] Arrival Rate (bucket %.3g s) ===\n", arrivals.bucketSec());
+    printf("  Span        : %.1f s (%.2f days), %lld buckets, %lld late rows\n",
+           span, span / 86400, arrivals.emitted(), arrivals.late());
+    printf("  Avg RPS     : %.2f\n", span > 0 ? rows / span : 0.0);
+    printf("  RPS         : mean %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f\n",
+           rps.mean(), rps.quantile(0.5), rps.quantile(0.95), rps.quantile(0.99), rps.max());
+    if (rps.mean() > 0) printf("  Peak / Mean : %.2f\n", rps.max() / rps.mean());
+
+    printf("\n=== [3] Burstiness ===\n");
+    double mu = iatStats.mean(), sigma = iatStats.stddev();
+    printf("  Inter-arrival (s): mean %.4f  p50 %.4f  p99 %.4f  max %.3f\n",
+           mu, interArrival.quantile(0.5), interArrival.quantile(0.99), interArrival.max());
+    printf("  CV of inter-arrival : %.3f (Poisson = 1)\n", mu > 0 ? sigma / mu : 0.0);
+    printf("  Burstiness B        : %.3f (-1 periodic, 0 Poisson, 1 bursty)\n",
+           (sigma + mu) > 0 ? (sigma - mu) / (sigma + mu) : 0.0);
+    for (int i = 0; i < ArrivalSeries::numScales(); i++) {
+        const DispersionScale& s = arrivals.scale(i);
+        if (s.stats.count() < 2) continue;
+        printf("  Index of dispersion @ %6.0f s : %.2f\n", s.buckets * arrivals.bucketSec(),
+               s.stats.mean() > 0 ? s.stats.variance() / s.stats.mean() : 0.0);
+    }
+
+    printf("\n=== [4] Special Features ===\n");
+    printf("  Short generations (<=5 tokens): %.2f%%\n", outputTokens.count() ? 100.0 * shortGen / outputTokens.count() : 0.0);
+    printf("  Long contexts (>8000 tokens)  : %lld\n", longCtx);
+
+    if (!g_opt.seriesPath.empty()) printf("\nTime series written to %s\n", g_opt.seriesPath.c_str());
+    if (!g_opt.samplePath.empty()) printf("Sub-trace (%lld rows) written to %s\n", sampled, g_opt.samplePath.c_str());
+    return 0;
+}
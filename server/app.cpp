@@ -2,30 +2,540 @@
 #include "logger.h"
 #include "shm_core.h"
 #include "scheduler.h"
+#include "recorder.h"
+#include "control.h"
+#include "memfd_server.h"
+#include "memfd_proto.h"
+#include "stream_server.h"
+#include "uring_server.h"
+#include "federation.h"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
-std::atomic<bool> g_app_running(true);
+struct AppOptions {
+    std::string policy = "default";
+    size_t recordEvents = DEFAULT_RECORD_EVENTS;
+    std::string recordFile = "scheduler.rec";
+    double recordWindowSec = 0;      // 0 表示导出整个环形缓冲区
+    std::string replayFile;
+    bool hugePages = false;
+    bool prefault = true;
+    bool lockPages = true;
+    uint32_t maxSlots = MAX_SLOT_COUNT;
+    uint32_t maxSlotSize = MAX_SLOT_SIZE;
+    size_t maxClients = DEFAULT_REGISTERED_CLIENTS;
+    int leaseMs = CLIENT_LEASE_MS;
+    bool restart = false;
+    std::string configFile;
+    std::string controlPath = defaultControlPath();
+    int statusIntervalSec = 60;      // 0 表示不打印周期状态
+    bool memfd = false;
+    std::string memfdPath = defaultMemfdSocketPath();
+    std::string listen;                          // 逗号分隔的流式监听地址，空表示不开启
+    std::string streamIo = "auto";               // auto | uring | epoll
+    bool uringSqpoll = false;
+    std::string gossip;                          // UDP gossip 监听 "[<host>:]<port>"，空表示不加入联邦
+    std::string peers;                           // 逗号分隔的种子节点
+    std::string nodeId;                          // 默认 <hostname>:<port>
+    uint32_t gpus = 1;
+    int gossipIntervalMs = GOSSIP_INTERVAL_MS;
+    std::string costStore = "scheduler.costs";   // 空表示不保存代价模型
+    size_t costEntries = DEFAULT_COST_ENTRIES;
+    std::string statsShm = statsShmName();        // 空表示不发布统计共享内存
+};
 
-void signalHandler(int signum) {
-    std::cout << "\n[Main] Received signal " << signum << ", shutting down..." << std::endl;
-    g_app_running = false;
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --config <path>          read options from a file (one 'option = value' per line);\n"
+              << "                           command-line options take precedence, SIGHUP re-reads it\n"
+              << "  --policy <name>          scheduling policy: default, serialize, backfill (default: default)\n"
+              << "  --record-events <n>      decision recording ring size, 0 = off (default "
+              << DEFAULT_RECORD_EVENTS << ")\n"
+              << "  --record-file <path>     recording dump path, written on SIGUSR1 and exit (default scheduler.rec)\n"
+              << "  --record-window <sec>    only dump the last <sec> seconds (default: whole ring)\n"
+              << "  --replay <path>          replay a recording through the policy and verify decisions\n"
+              << "  --huge-pages             place the registry on 2 MiB hugetlbfs pages (clients: KS_HUGE_PAGES=1)\n"
+              << "  --no-prefault            do not prefault channel mappings at attach\n"
+              << "  --no-mlock               do not mlock channel mappings\n"
+              << "  --max-slots <n>          largest ring a client may request (default " << MAX_SLOT_COUNT << ")\n"
+              << "  --max-slot-size <bytes>  largest slot a client may request (default " << MAX_SLOT_SIZE << ")\n"
+              << "  --max-clients <n>        registry capacity, up to " << MAX_REGISTERED_CLIENTS
+              << " (default " << DEFAULT_REGISTERED_CLIENTS << ")\n"
+              << "  --lease-ms <ms>          reclaim a dead client's slot after this much silence (default "
+              << CLIENT_LEASE_MS << ")\n"
+              << "  --restart                reattach to the registry and clients left by a previous scheduler\n"
+              << "                           (stop the old one with SIGUSR2 to keep them, or after a crash)\n"
+              << "  --control <path>         control socket (default " << defaultControlPath() << ")\n"
+              << "  --status-interval <sec>  print a status line periodically, 0 = off (default 60)\n"
+              << "  --memfd                  also accept memfd channel registrations over a Unix socket\n"
+              << "                           (clients: KS_TRANSPORT=memfd)\n"
+              << "  --memfd-socket <path>    memfd registration socket (default " << defaultMemfdSocketPath() << ")\n"
+              << "  --listen <addr>[,...]    also serve clients over tcp[:<host>:<port>] or unix[:<path>]\n"
+              << "                           (default port " << SCHEDULER_PORT << " on " << LOCALHOST
+              << "; clients: KS_TRANSPORT=<addr>)\n"
+              << "  --stream-io <backend>    auto | uring | epoll (default auto: io_uring, epoll without it)\n"
+              << "  --uring-sqpoll           let a kernel thread poll the io_uring submission queue\n"
+              << "  --gossip [<host>:]<port> exchange load summaries with other schedulers over UDP\n"
+              << "                           (host defaults to " << LOCALHOST << "; --peer alone implies port " << SCHEDULER_PORT
+              << ")\n"
+              << "  --peer <host:port>[,...] seed schedulers to join the federation through\n"
+              << "  --node-id <name>         name in the cluster view (default <hostname>:<port>)\n"
+              << "  --gpus <n>               GPUs on this node, for the utilization estimate (default 1)\n"
+              << "  --gossip-interval <ms>   gossip round interval (default " << GOSSIP_INTERVAL_MS << ")\n"
+              << "  --cost-store <path>      persistent kernel cost model, '' = off (default scheduler.costs)\n"
+              << "  --cost-entries <n>       cost store capacity when creating it (default " << DEFAULT_COST_ENTRIES
+              << ")\n"
+              << "  --stats-shm <name>       per-client statistics for ksrouter, '' = off (default " << statsShmName()
+              << ")\n";
 }
 
-int main() {
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
+static bool isTrue(const std::string& v) {
+    return v.empty() || v == "1" || v == "true" || v == "yes" || v == "on";
+}
+
+// 按长选项名设置一项 (命令行与配置文件共用)
+static bool setOption(AppOptions& opt, const std::string& name, const std::string& value) {
+    if (name == "policy") opt.policy = value;
+    else if (name == "record-events") opt.recordEvents = strtoull(value.c_str(), nullptr, 10);
+    else if (name == "record-file") opt.recordFile = value;
+    else if (name == "record-window") opt.recordWindowSec = atof(value.c_str());
+    else if (name == "replay") opt.replayFile = value;
+    else if (name == "huge-pages") opt.hugePages = isTrue(value);
+    else if (name == "no-prefault") opt.prefault = !isTrue(value);
+    else if (name == "no-mlock") opt.lockPages = !isTrue(value);
+    else if (name == "max-slots") opt.maxSlots = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+    else if (name == "max-slot-size") opt.maxSlotSize = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+    else if (name == "max-clients") opt.maxClients = strtoull(value.c_str(), nullptr, 10);
+    else if (name == "lease-ms") opt.leaseMs = atoi(value.c_str());
+    else if (name == "restart") opt.restart = isTrue(value);
+    else if (name == "control") opt.controlPath = value;
+    else if (name == "status-interval") opt.statusIntervalSec = atoi(value.c_str());
+    else if (name == "memfd") opt.memfd = isTrue(value);
+    else if (name == "memfd-socket") opt.memfdPath = value;
+    else if (name == "listen") opt.listen = value;
+    else if (name == "stream-io") opt.streamIo = value;
+    else if (name == "uring-sqpoll") opt.uringSqpoll = isTrue(value);
+    else if (name == "gossip") opt.gossip = value;
+    else if (name == "peer") opt.peers = value;
+    else if (name == "node-id") opt.nodeId = value;
+    else if (name == "gpus") opt.gpus = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+    else if (name == "gossip-interval") opt.gossipIntervalMs = atoi(value.c_str());
+    else if (name == "cost-store") opt.costStore = value;
+    else if (name == "cost-entries") opt.costEntries = strtoull(value.c_str(), nullptr, 10);
+    else if (name == "stats-shm") opt.statsShm = value;
+    else return false;
+    return true;
+}
+
+// 配置文件: 每行 "option = value" (或 "option value")，'#' 之后为注释，无参数选项写 "huge-pages = true"
+static bool loadConfigFile(const std::string& path, AppOptions& opt) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "[Main] Cannot read config " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) line[eq] = ' ';
+        std::istringstream fields(line);
+        std::string name, value;
+        if (!(fields >> name)) continue;
+        fields >> value;
+        if (name == "config" || !setOption(opt, name, value)) {
+            std::cerr << "[Main] " << path << ":" << lineNo << ": unknown option '" << name << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 默认值 -> 配置文件 -> 命令行；SIGHUP 时用同样的 argv 重新解析
+static bool parseArgs(int argc, char** argv, AppOptions& opt) {
+    static struct option longOpts[] = {
+        {"config", required_argument, nullptr, 0},
+        {"policy", required_argument, nullptr, 0},
+        {"record-events", required_argument, nullptr, 0},
+        {"record-file", required_argument, nullptr, 0},
+        {"record-window", required_argument, nullptr, 0},
+        {"replay", required_argument, nullptr, 0},
+        {"huge-pages", no_argument, nullptr, 0},
+        {"no-prefault", no_argument, nullptr, 0},
+        {"no-mlock", no_argument, nullptr, 0},
+        {"max-slots", required_argument, nullptr, 0},
+        {"max-slot-size", required_argument, nullptr, 0},
+        {"max-clients", required_argument, nullptr, 0},
+        {"lease-ms", required_argument, nullptr, 0},
+        {"restart", no_argument, nullptr, 0},
+        {"control", required_argument, nullptr, 0},
+        {"status-interval", required_argument, nullptr, 0},
+        {"memfd", no_argument, nullptr, 0},
+        {"memfd-socket", required_argument, nullptr, 0},
+        {"listen", required_argument, nullptr, 0},
+        {"stream-io", required_argument, nullptr, 0},
+        {"uring-sqpoll", no_argument, nullptr, 0},
+        {"gossip", required_argument, nullptr, 0},
+        {"peer", required_argument, nullptr, 0},
+        {"node-id", required_argument, nullptr, 0},
+        {"gpus", required_argument, nullptr, 0},
+        {"gossip-interval", required_argument, nullptr, 0},
+        {"cost-store", required_argument, nullptr, 0},
+        {"cost-entries", required_argument, nullptr, 0},
+        {"stats-shm", required_argument, nullptr, 0},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    std::vector<std::pair<std::string, std::string>> cli;
+    std::string configFile;
+    int c, index;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "h", longOpts, &index)) != -1) {
+        if (c != 0) return false;
+        std::string name = longOpts[index].name;
+        std::string value = optarg ? optarg : "";
+        if (name == "config") configFile = value;
+        else cli.emplace_back(name, value);
+    }
+    if (!configFile.empty() && !loadConfigFile(configFile, opt)) return false;
+    for (const auto& kv : cli) setOption(opt, kv.first, kv.second);
+    opt.configFile = configFile;
+    return opt.streamIo == "auto" || opt.streamIo == "uring" || opt.streamIo == "epoll";
+}
+
+// ===== 事件循环 =====
+// 主线程阻塞在 epoll 上: signalfd (信号在这里同步处理，不再有异步信号处理函数)、
+// timerfd (周期状态) 与控制套接字。
+
+class App {
+public:
+    App(int argc, char** argv, const AppOptions& opt, Scheduler& scheduler, ShmServer& ipcServer,
+        MemfdServer* memfdServer, IIPCServer* streamServer, Federation* federation)
+        : argc_(argc), argv_(argv), opt_(opt), scheduler_(scheduler), ipcServer_(ipcServer),
+          memfdServer_(memfdServer), streamServer_(streamServer), federation_(federation) {}
+
+    int run(int signalFd);
+
+private:
+    void onSignal(int signo);
+    std::string onCommand(const std::string& line);
+    void reload();
+    std::string status();
+    void stop(bool handOff) {
+        running_ = false;
+        handOff_ = handOff;
+        stopAt_ = std::chrono::steady_clock::now();
+    }
+    int64_t recordWindowNs() const { return static_cast<int64_t>(opt_.recordWindowSec * 1e9); }
+
+    int argc_;
+    char** argv_;
+    AppOptions opt_;
+    Scheduler& scheduler_;
+    ShmServer& ipcServer_;
+    MemfdServer* memfdServer_;
+    IIPCServer* streamServer_;
+    Federation* federation_;
+    ControlSocket control_;
+    bool running_ = true;
+    bool handOff_ = false;
+    std::chrono::steady_clock::time_point stopAt_;
+};
+
+int App::run(int signalFd) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (ep == -1 || timerFd == -1) {
+        perror("[Main] epoll/timerfd");
+        return 1;
+    }
+    if (opt_.statusIntervalSec > 0) {
+        struct itimerspec its;
+        std::memset(&its, 0, sizeof(its));
+        its.it_value.tv_sec = opt_.statusIntervalSec;
+        its.it_interval.tv_sec = opt_.statusIntervalSec;
+        timerfd_settime(timerFd, 0, &its, nullptr);
+    }
+    if (!control_.listen(opt_.controlPath)) {
+        std::cerr << "[Main] Control socket unavailable at " << opt_.controlPath << std::endl;
+    }
+
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    for (int fd : {signalFd, timerFd, control_.fd()}) {
+        if (fd == -1) continue;
+        ev.data.fd = fd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    std::cout << "[Main] System running. Press Ctrl+C to exit." << std::endl;
+    struct epoll_event events[8];
+    while (running_) {
+        int n = epoll_wait(ep, events, 8, -1);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == signalFd) {
+                struct signalfd_siginfo si;
+                while (read(signalFd, &si, sizeof(si)) == sizeof(si)) {
+                    onSignal(static_cast<int>(si.ssi_signo));
+                }
+            } else if (fd == timerFd) {
+                uint64_t expirations;
+                if (read(timerFd, &expirations, sizeof(expirations)) > 0) {
+                    std::cout << "[Main] " << status() << std::endl;
+                }
+            } else if (fd == control_.fd()) {
+                std::string command;
+                int conn;
+                while ((conn = control_.accept(command)) != -1) {
+                    ControlSocket::reply(conn, onCommand(command));
+                }
+            }
+        }
+    }
+    close(timerFd);
+    close(ep);
+
+    // 排空: 停止接入新客户端并撤销全部通道，会话应答完手上的请求后退出
+    std::cout << "[Main] Stopping services..." << std::endl;
+    if (handOff_) {
+        std::cout << "[Main] Handing off registry to the next scheduler" << std::endl;
+        ipcServer_.handOff();
+    }
+    ipcServer_.stop();
+    if (memfdServer_) memfdServer_->stop();
+    if (streamServer_) streamServer_->stop();
+    if (federation_) federation_->stop();
+    scheduler_.stop();
+    auto drainUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - stopAt_).count();
+    std::cout << "[Main] Drained in " << drainUs / 1000.0 << " ms, reclaimed "
+              << ipcServer_.reclaimedSlots() << " stale client slots" << std::endl;
+    if (opt_.recordEvents > 0) {
+        scheduler_.dumpRecording(opt_.recordFile, recordWindowNs());
+    }
+    return 0;
+}
+
+void App::onSignal(int signo) {
+    switch (signo) {
+    case SIGUSR1:
+        scheduler_.dumpRecording(opt_.recordFile, recordWindowNs());
+        break;
+    case SIGHUP:
+        reload();
+        break;
+    case SIGUSR2:
+        // 交接: 退出但保留注册表与通道，由 --restart 启动的新调度器接管
+        std::cout << "\n[Main] Received signal " << signo << ", handing off..." << std::endl;
+        stop(true);
+        break;
+    default:
+        std::cout << "\n[Main] Received signal " << signo << ", shutting down..." << std::endl;
+        stop(false);
+        break;
+    }
+}
+
+std::string App::onCommand(const std::string& line) {
+    std::istringstream in(line);
+    std::vector<std::string> args;
+    std::string word;
+    while (in >> word) args.push_back(word);
+    const std::string command = args.empty() ? std::string() : args[0];
+
+    if (command == "status") return status() + "\n";
+    if (command == "clients") return scheduler_.listClients();
+    if (command == "predictor") return scheduler_.describePredictor();
+    if (command == "policy" && args.size() == 1) {
+        std::string state = scheduler_.describePolicy();
+        return state.empty() ? "policy " + scheduler_.policyName() + " (no state)\n" : state;
+    }
+    if (command == "cluster") {
+        if (!federation_) return "error: not federated (start with --gossip or --peer)\n";
+        return federation_->describeCluster();
+    }
+    if (command == "stats") {
+        std::ostringstream ss;
+        ss << scheduler_.statistics() << "reclaimed " << ipcServer_.reclaimedSlots() << "\n";
+        if (federation_) ss << "cluster " << federation_->summary() << " nodes up (" << federation_->nodeId() << ")\n";
+        return ss.str();
+    }
+    if (command == "reload") {
+        reload();
+        return "reloaded, " + status() + "\n";
+    }
+    if (command == "dump") {
+        if (!scheduler_.dumpRecording(opt_.recordFile, recordWindowNs())) return "error: dump failed\n";
+        return "dumped " + opt_.recordFile + "\n";
+    }
+    if (command == "stop" || command == "handoff") {
+        std::cout << "[Main] Control request: " << command << std::endl;
+        stop(command == "handoff");
+        return "stopping\n";
+    }
+    if (command == "policy" && args.size() == 2) {
+        std::unique_ptr<IPolicy> policy = createPolicy(args[1]);
+        if (!policy) return "error: unknown policy '" + args[1] + "'\n";
+        scheduler_.replacePolicy(std::move(policy));
+        opt_.policy = args[1];
+        std::cout << "[Main] Control request: policy " << args[1] << std::endl;
+        return "policy " + args[1] + "\n";
+    }
+    if (command == "trace" && args.size() == 2 && (args[1] == "on" || args[1] == "off")) {
+        if (opt_.recordEvents == 0) return "error: recording is disabled (--record-events 0)\n";
+        scheduler_.setRecording(args[1] == "on");
+        return "trace " + args[1] + "\n";
+    }
+    // set <client> key=value... | pause <client> | resume <client> | reset <client>
+    if ((command == "set" && args.size() >= 3) ||
+        ((command == "pause" || command == "resume" || command == "reset") && args.size() == 2)) {
+        std::string clientKey, error;
+        if (!scheduler_.resolveClient(args[1], clientKey, error)) return "error: " + error + "\n";
+        ClientControl control = scheduler_.getClientControl(clientKey);
+        if (command == "pause") control.paused = true;
+        else if (command == "resume") control.paused = false;
+        else if (command == "reset") control = ClientControl();
+        for (size_t i = 2; i < args.size(); i++) {
+            if (!parseControlField(args[i], control)) {
+                return "error: bad field '" + args[i] + "' (weight=<w> priority=<p> quota=<kernels/s> paused=0|1)\n";
+            }
+            // 权重与优先级由策略解释，当前策略不解释的不接受 (恢复默认值总是可以)
+            std::string key = args[i].substr(0, args[i].find('='));
+            bool custom = (key == "weight" && control.weight != 1.0) || (key == "priority" && control.priority != 0);
+            if (custom && !scheduler_.policyHonours(key)) {
+                return "error: " + key + " not supported by policy " + scheduler_.policyName() + "\n";
+            }
+        }
+        scheduler_.setClientControl(clientKey, control);
+        std::cout << "[Main] Control request: " << clientKey << " " << formatControl(control) << std::endl;
+        return clientKey + " " + formatControl(control) + "\n";
+    }
+    return "error: unknown command '" + line + "'\n" + CONTROL_USAGE;
+}
+
+std::string App::status() {
+    std::ostringstream ss;
+    ss << "policy=" << scheduler_.policyName() << " sessions=" << scheduler_.getActiveCount()
+       << " reclaimed=" << ipcServer_.reclaimedSlots();
+    if (federation_) ss << " cluster=" << federation_->summary();
+    return ss.str();
+}
+
+// 重新读取配置并应用可在线修改的项，不断开客户端
+void App::reload() {
+    AppOptions next;
+    if (!parseArgs(argc_, argv_, next)) {
+        std::cerr << "[Main] Reload failed, keeping current configuration" << std::endl;
+        return;
+    }
+    // 策略未变时保留在用的实例 (serialize/backfill 的预约与计数不随重载丢失)
+    if (next.policy != scheduler_.policyName()) {
+        std::unique_ptr<IPolicy> policy = createPolicy(next.policy);
+        if (!policy) {
+            std::cerr << "[Main] Reload failed: unknown policy " << next.policy << std::endl;
+            return;
+        }
+        scheduler_.replacePolicy(std::move(policy));
+    }
+    ipcServer_.setLease(next.leaseMs);
+    ipcServer_.setChannelLimits(next.maxSlots, next.maxSlotSize);
+    if (memfdServer_) memfdServer_->setChannelLimits(next.maxSlots, next.maxSlotSize);
+
+    if (next.maxClients != opt_.maxClients || next.hugePages != opt_.hugePages || next.prefault != opt_.prefault ||
+        next.lockPages != opt_.lockPages || next.recordEvents != opt_.recordEvents ||
+        next.controlPath != opt_.controlPath || next.statusIntervalSec != opt_.statusIntervalSec ||
+        next.memfd != opt_.memfd || next.memfdPath != opt_.memfdPath || next.listen != opt_.listen ||
+        next.streamIo != opt_.streamIo || next.uringSqpoll != opt_.uringSqpoll || next.gossip != opt_.gossip ||
+        next.peers != opt_.peers || next.nodeId != opt_.nodeId || next.gpus != opt_.gpus ||
+        next.gossipIntervalMs != opt_.gossipIntervalMs ||
+        next.costStore != opt_.costStore ||
+        next.costEntries != opt_.costEntries || next.statsShm != opt_.statsShm) {
+        std::cout << "[Main] Registry, mapping, recording-size, control, status, cost-store, transport and "
+                     "federation options take effect on restart"
+                  << std::endl;
+    }
+    opt_.policy = next.policy;
+    opt_.leaseMs = next.leaseMs;
+    opt_.maxSlots = next.maxSlots;
+    opt_.maxSlotSize = next.maxSlotSize;
+    opt_.recordFile = next.recordFile;
+    opt_.recordWindowSec = next.recordWindowSec;
+    std::cout << "[Main] Reloaded" << (opt_.configFile.empty() ? "" : " " + opt_.configFile) << ": policy "
+              << opt_.policy << ", lease " << opt_.leaseMs << " ms, channels up to " << opt_.maxSlots << "x"
+              << opt_.maxSlotSize << std::endl;
+}
+
+int main(int argc, char** argv) {
+    AppOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 回放模式: 不启动 IPC，只校验录制的决策
+    if (!opt.replayFile.empty()) {
+        return replayRecording(opt.replayFile);
+    }
+
+    std::unique_ptr<IPolicy> policy = createPolicy(opt.policy);
+    if (!policy) {
+        std::cerr << "[Main] Unknown policy: " << opt.policy << std::endl;
+        return 1;
+    }
+
+    // 在创建任何线程之前屏蔽信号 (子线程继承)，统一由主线程通过 signalfd 读取
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int signo : {SIGINT, SIGTERM, SIGHUP, SIGUSR1, SIGUSR2}) sigaddset(&mask, signo);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    int signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd == -1) {
+        perror("[Main] signalfd");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
 
     // 初始化核心调度器
-    Scheduler scheduler;
+    Scheduler scheduler(std::move(policy), opt.recordEvents);
+    if (!opt.costStore.empty() && !scheduler.openCostStore(opt.costStore, opt.costEntries)) {
+        std::cerr << "[Main] Cost store unavailable, starting with a cold model" << std::endl;
+    }
+    if (!opt.statsShm.empty()) scheduler.openStatsShm(opt.statsShm);
+
+    // 锁定通道内存需要足够的 RLIMIT_MEMLOCK (每个通道 512 KiB)
+    struct rlimit rl;
+    if (opt.lockPages && getrlimit(RLIMIT_MEMLOCK, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_MEMLOCK, &rl);
+    }
 
     // 初始化 IPC 服务 (使用共享内存实现)
-    ShmServer ipcServer;
-    
+    ShmServer ipcServer(opt.hugePages, (opt.prefault ? SEG_POPULATE : 0) | (opt.lockPages ? SEG_MLOCK : 0));
+    ipcServer.setChannelLimits(opt.maxSlots, opt.maxSlotSize);
+    ipcServer.setMaxClients(opt.maxClients);
+    ipcServer.setLease(opt.leaseMs);
+    ipcServer.setRestart(opt.restart);
+
     std::cout << "[Main] Initializing IPC..." << std::endl;
     if (!ipcServer.init()) {
         std::cerr << "[Main] Failed to init IPC" << std::endl;
@@ -36,15 +546,81 @@ int main() {
         scheduler.onNewClient(std::move(channel));
     });
 
-    std::cout << "[Main] System running. Press Ctrl+C to exit." << std::endl;
-    while (g_app_running) {
-        sleep(1000);
+    // 可选: memfd 注册路径与注册表并行
+    std::unique_ptr<MemfdServer> memfdServer;
+    if (opt.memfd) {
+        memfdServer.reset(new MemfdServer(opt.hugePages, (opt.prefault ? SEG_POPULATE : 0) | (opt.lockPages ? SEG_MLOCK : 0)));
+        memfdServer->setSocketPath(opt.memfdPath);
+        memfdServer->setChannelLimits(opt.maxSlots, opt.maxSlotSize);
+        if (!memfdServer->init()) {
+            std::cerr << "[Main] Failed to init memfd registration" << std::endl;
+            return 1;
+        }
+        memfdServer->start([&scheduler](std::unique_ptr<IChannel> channel) {
+            scheduler.onNewClient(std::move(channel));
+        });
     }
 
-    std::cout << "[Main] Stopping services..." << std::endl;
-    ipcServer.stop();
-    scheduler.stop();
+    // 可选: TCP / Unix 流套接字 (无法共享 /dev/shm 的容器)
+    std::unique_ptr<IIPCServer> streamServer;
+    if (!opt.listen.empty()) {
+        std::vector<StreamAddress> addresses;
+        std::istringstream specs(opt.listen);
+        std::string spec;
+        while (std::getline(specs, spec, ',')) {
+            StreamAddress addr;
+            if (!parseStreamAddress(spec, addr)) {
+                std::cerr << "[Main] Bad --listen address: " << spec << std::endl;
+                return 1;
+            }
+            addresses.push_back(addr);
+        }
+        // 优先 io_uring；内核不支持时 (auto) 退回 epoll
+        if (opt.streamIo != "epoll") {
+            std::unique_ptr<UringServer> uring(new UringServer(addresses, opt.uringSqpoll));
+            if (uring->init()) {
+                streamServer = std::move(uring);
+            } else if (opt.streamIo == "uring") {
+                return 1;
+            } else {
+                std::cout << "[Main] Serving stream sockets with epoll" << std::endl;
+            }
+        }
+        if (!streamServer) {
+            streamServer.reset(new StreamServer(addresses));
+            if (!streamServer->init()) return 1;
+        }
+        streamServer->start([&scheduler](std::unique_ptr<IChannel> channel) {
+            scheduler.onNewClient(std::move(channel));
+        });
+    }
+
+    // 可选: 与其他节点的调度器交换负载摘要
+    std::unique_ptr<Federation> federation;
+    if (!opt.gossip.empty() || !opt.peers.empty()) {
+        std::string bind = opt.gossip.empty() ? std::to_string(SCHEDULER_PORT) : opt.gossip;
+        std::string nodeId = opt.nodeId;
+        if (nodeId.empty()) {
+            char host[256] = "localhost";
+            gethostname(host, sizeof(host) - 1);
+            nodeId = std::string(host) + ":" + bind.substr(bind.rfind(':') + 1);
+        }
+        std::vector<std::string> peers;
+        std::istringstream specs(opt.peers);
+        std::string peer;
+        while (std::getline(specs, peer, ',')) {
+            if (!peer.empty()) peers.push_back(peer);
+        }
+        federation.reset(new Federation(nodeId, [&scheduler]() { return scheduler.loadCounters(); }, opt.gpus,
+                                        opt.gossipIntervalMs));
+        if (!federation->init(bind, peers)) return 1;
+        federation->start();
+    }
+
+    App app(argc, argv, opt, scheduler, ipcServer, memfdServer.get(), streamServer.get(), federation.get());
+    int rc = app.run(signalFd);
+    close(signalFd);
 
     std::cout << "[Main] Bye." << std::endl;
-    return 0;
-}
\ No newline at end of file
+    return rc;
+}
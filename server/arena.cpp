@@ -0,0 +1,155 @@
+#include "arena.h"
+
+#include <linux/mempolicy.h>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// 块开头的链接头占用的字节 (保持后续分配按 max_align_t 对齐)
+constexpr size_t CHUNK_HEADER = 64;
+
+struct ChunkPool {
+    std::mutex mutex;
+    std::map<int, std::vector<void*>> free;  // 节点 -> 空闲块
+    size_t liveArenas = 0;
+    size_t liveBytes = 0;
+    uint64_t mapped = 0;
+    uint64_t reused = 0;
+};
+
+ChunkPool& chunkPool() {
+    static ChunkPool pool;
+    return pool;
+}
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+int currentNode() {
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+    return static_cast<int>(node);
+}
+
+// 映射并在当前线程逐页写入；MPOL_LOCAL 使页面落在触发缺页的 CPU 所在节点，
+// 即使进程整体以 numactl --interleave 等策略运行。不支持 NUMA 的内核上 mbind 失败，忽略
+void* mapLocal(size_t bytes) {
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+    syscall(SYS_mbind, p, bytes, MPOL_LOCAL, nullptr, 0, 0);
+    volatile char* bytesOut = static_cast<volatile char*>(p);
+    for (size_t off = 0; off < bytes; off += pageSize()) bytesOut[off] = 0;
+    return p;
+}
+
+} // namespace
+
+ArenaPoolStats arenaPoolStats() {
+    ChunkPool& pool = chunkPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    ArenaPoolStats s;
+    s.liveArenas = pool.liveArenas;
+    s.liveBytes = pool.liveBytes;
+    for (const auto& entry : pool.free) s.pooledChunks += entry.second.size();
+    s.mapped = pool.mapped;
+    s.reused = pool.reused;
+    return s;
+}
+
+SessionArena::SessionArena() {
+    ChunkPool& pool = chunkPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.liveArenas++;
+}
+
+SessionArena::~SessionArena() {
+    release();
+    ChunkPool& pool = chunkPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.liveArenas--;
+}
+
+void* SessionArena::allocate(size_t size, size_t align) {
+    uintptr_t mask = static_cast<uintptr_t>(align) - 1;
+    uintptr_t p = (reinterpret_cast<uintptr_t>(cur_) + mask) & ~mask;
+    if (!cur_ || p + size > reinterpret_cast<uintptr_t>(end_)) {
+        Chunk* chunk = addChunk(size + align);
+        p = (reinterpret_cast<uintptr_t>(chunk) + CHUNK_HEADER + mask) & ~mask;
+        if (chunk->node < 0) {
+            // 单独映射的大块只放这一个对象，当前块剩余的空间继续使用
+            used_ += size;
+            return reinterpret_cast<void*>(p);
+        }
+        end_ = reinterpret_cast<char*>(chunk) + chunk->size;
+    }
+    cur_ = reinterpret_cast<char*>(p + size);
+    used_ += size;
+    return reinterpret_cast<void*>(p);
+}
+
+SessionArena::Chunk* SessionArena::addChunk(size_t minBytes) {
+    size_t need = minBytes + CHUNK_HEADER;
+    ChunkPool& pool = chunkPool();
+    void* mem = nullptr;
+    size_t size = SESSION_ARENA_CHUNK;
+    int node = -1;
+    if (need <= SESSION_ARENA_CHUNK / 2) {
+        // 不超过半个块的请求从池中取整块；更大的单独映射，不浪费当前块剩下的空间
+        node = currentNode();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        auto it = pool.free.find(node);
+        if (it != pool.free.end() && !it->second.empty()) {
+            mem = it->second.back();
+            it->second.pop_back();
+            pool.reused++;
+        }
+    } else {
+        size = (need + pageSize() - 1) / pageSize() * pageSize();
+    }
+    bool fresh = !mem;
+    if (fresh) {
+        mem = mapLocal(size);
+        if (!mem) throw std::bad_alloc();
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (fresh && node >= 0) pool.mapped++;
+        pool.liveBytes += size;
+    }
+    if (node_ < 0) node_ = node >= 0 ? node : currentNode();
+
+    Chunk* chunk = static_cast<Chunk*>(mem);
+    chunk->next = chunks_;
+    chunk->size = size;
+    chunk->node = node;
+    chunks_ = chunk;
+    reserved_ += size;
+    return chunk;
+}
+
+void SessionArena::release() {
+    ChunkPool& pool = chunkPool();
+    std::vector<Chunk*> unmap;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        for (Chunk* c = chunks_; c;) {
+            Chunk* next = c->next;
+            pool.liveBytes -= c->size;
+            if (c->node >= 0 && pool.free[c->node].size() < ARENA_POOL_CHUNKS) pool.free[c->node].push_back(c);
+            else unmap.push_back(c);
+            c = next;
+        }
+    }
+    for (Chunk* c : unmap) munmap(c, c->size);
+    chunks_ = nullptr;
+    cur_ = end_ = nullptr;
+    used_ = reserved_ = 0;
+    node_ = -1;
+}
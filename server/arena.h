@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+
+// ============================================================
+//  会话内存区 (单调分配)
+//  每个会话线程在接入时建立一个 SessionArena，会话期间的状态从中顺序切出，不单独释放；
+//  会话结束时整体归还。内存按块 (SESSION_ARENA_CHUNK) 向全局块池申请:
+//  池按 NUMA 节点分开，优先取当前 CPU 所在节点上已缺页的空闲块；池空时 mmap 新块，
+//  设为 MPOL_LOCAL 并由会话线程逐页写入，页面落在会话线程所在的节点上。
+//  归还的块回到原节点的池中 (每节点最多 ARENA_POOL_CHUNKS 个，多余的 munmap)，
+//  频繁接入、断开的客户端不再每次都走 mmap 与缺页。
+//  超过半个块的分配单独映射一段，结束时直接 munmap。非线程安全，只由所属会话线程使用。
+// ============================================================
+
+constexpr size_t SESSION_ARENA_CHUNK = 16 * 1024;
+constexpr size_t ARENA_POOL_CHUNKS = 256;
+
+/**
+ * @brief 块池的当前状态 (ksctl stats)
+ */
+struct ArenaPoolStats {
+    size_t liveArenas = 0;       // 尚未释放的会话内存区
+    size_t liveBytes = 0;        // 其占用的映射字节数
+    size_t pooledChunks = 0;     // 各节点池中的空闲块
+    uint64_t mapped = 0;         // 累计 mmap 的块数 (池未命中)
+    uint64_t reused = 0;         // 累计从池中取得的块数
+};
+
+ArenaPoolStats arenaPoolStats();
+
+class SessionArena {
+public:
+    SessionArena();
+    ~SessionArena();
+
+    SessionArena(const SessionArena&) = delete;
+    SessionArena& operator=(const SessionArena&) = delete;
+
+    // 失败时抛出 std::bad_alloc
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    // 在内存区中构造对象；析构由调用方在 release 前显式调用 (平凡析构的类型可以省略)
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // 一次归还全部块，之后可以继续分配
+    void release();
+
+    size_t used() const { return used_; }            // 已切出的字节
+    size_t reserved() const { return reserved_; }    // 占用的映射字节
+    int node() const { return node_; }                // 首块所在的 NUMA 节点
+
+private:
+    // 每块开头的链接头
+    struct Chunk {
+        Chunk* next;
+        size_t size;
+        int node;                // 池化块的节点，单独映射的大块为 -1
+    };
+
+    Chunk* addChunk(size_t minBytes);
+
+    Chunk* chunks_ = nullptr;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+    int node_ = -1;
+};
+
+/**
+ * @brief 从 SessionArena 分配的 STL 分配器 (deallocate 不做事，内存随内存区一起归还)
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(SessionArena& arena) : arena_(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+
+private:
+    template <typename U> friend class ArenaAllocator;
+    SessionArena* arena_;
+};
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
@@ -0,0 +1,162 @@
+#include "backfill.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+BackfillPolicy::BackfillPolicy(bool backfill) : backfill_(backfill) {}
+
+void BackfillPolicy::onClientAttach(const std::string& clientKey, const std::string&, int64_t) {
+    clients_[clientKey].attached++;
+}
+
+void BackfillPolicy::onClientDetach(const std::string& clientKey, int64_t) {
+    auto it = clients_.find(clientKey);
+    if (it != clients_.end() && --it->second.attached <= 0) clients_.erase(it);
+}
+
+void BackfillPolicy::onClientControl(const std::string& clientKey, const ClientControl& control, int64_t) {
+    if (control.priority != 0) priorities_[clientKey] = control.priority;
+    else priorities_.erase(clientKey);
+}
+
+void BackfillPolicy::expire(int64_t nowNs) {
+    size_t started = 0;
+    while (started < reservations_.size() && reservations_[started] <= nowNs) started++;
+    if (started) reservations_.erase(reservations_.begin(), reservations_.begin() + started);
+}
+
+PolicyDecision BackfillPolicy::decide(const PolicyRequest& req, int64_t nowNs) {
+    expire(nowNs);
+    ClientCounters& c = clients_[req.clientKey];
+    c.kernels++;
+    int64_t predicted = req.predictedNs;
+    if (predicted <= 0) return {true, "OK"};
+
+    if (predicted >= BACKFILL_HEAVY_NS) {
+        c.heavy++;
+        int64_t start = std::max(nowNs, heavyEnd_);
+        bool own = req.clientKey == heavyClient_;
+        heavyEnd_ = start + predicted;
+        heavyClient_ = req.clientKey;
+        if (start == nowNs || own) return {true, "heavy"};
+        // 预约到前一个重 kernel 预计结束时；新的空档从现在开始
+        if (reservations_.empty()) backfillEnd_ = nowNs;
+        reservations_.push_back(start);
+        c.held++;
+        c.heldNs += start - nowNs;
+        return {true, "held", start - nowNs};
+    }
+
+    if (reservations_.empty()) return {true, "OK"};
+    int64_t reservation = reservations_.front();
+    if (backfill_) {
+        int64_t begin = std::max(nowNs, backfillEnd_);
+        if (begin + predicted <= reservation) {
+            backfillEnd_ = begin + predicted;
+            c.backfilled++;
+            c.slackUsedNs += predicted;
+            return {true, "backfill"};
+        }
+    }
+    auto prio = priorities_.find(req.clientKey);
+    if (prio != priorities_.end() && prio->second > 0) {
+        c.prioritized++;
+        return {true, "priority"};
+    }
+    // 放不进 slack: 扣到预约的重 kernel 开始时，不推迟它
+    c.waited++;
+    c.heldNs += reservation - nowNs;
+    return {true, "wait", reservation - nowNs};
+}
+
+void BackfillPolicy::onTick(int64_t nowNs) {
+    expire(nowNs);
+}
+
+void BackfillPolicy::saveState(std::string& out) const {
+    std::ostringstream ss;
+    ss << "heavy " << heavyEnd_ << " " << backfillEnd_ << "\n"
+       << "holder " << heavyClient_ << "\n"
+       << "reservations " << reservations_.size();
+    for (int64_t r : reservations_) ss << " " << r;
+    ss << "\n";
+    for (const auto& entry : clients_) {
+        const ClientCounters& c = entry.second;
+        ss << "client " << c.attached << " " << c.kernels << " " << c.heavy << " " << c.held << " " << c.waited << " "
+           << c.backfilled << " " << c.prioritized << " " << c.slackUsedNs << " " << c.heldNs << " " << entry.first
+           << "\n";
+    }
+    for (const auto& entry : priorities_) ss << "priority " << entry.second << " " << entry.first << "\n";
+    out = ss.str();
+}
+
+bool BackfillPolicy::loadState(const std::string& in) {
+    heavyEnd_ = backfillEnd_ = 0;
+    heavyClient_.clear();
+    reservations_.clear();
+    clients_.clear();
+    priorities_.clear();
+    std::istringstream lines(in);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "heavy") {
+            fields >> heavyEnd_ >> backfillEnd_;
+        } else if (kind == "holder") {
+            // 客户端名是行的其余部分
+            heavyClient_ = line.size() > 7 ? line.substr(7) : std::string();
+            continue;
+        } else if (kind == "reservations") {
+            size_t n = 0;
+            fields >> n;
+            for (size_t i = 0; i < n && fields; i++) {
+                int64_t r;
+                fields >> r;
+                reservations_.push_back(r);
+            }
+        } else if (kind == "client") {
+            ClientCounters c;
+            fields >> c.attached >> c.kernels >> c.heavy >> c.held >> c.waited >> c.backfilled >> c.prioritized >>
+                c.slackUsedNs >> c.heldNs;
+            std::string key;
+            fields.get();
+            std::getline(fields, key);
+            if (key.empty()) return false;
+            clients_[key] = c;
+            continue;
+        } else if (kind == "priority") {
+            int p = 0;
+            fields >> p;
+            std::string key;
+            fields.get();
+            std::getline(fields, key);
+            if (fields.fail() || key.empty()) return false;
+            priorities_[key] = p;
+            continue;
+        } else {
+            return false;
+        }
+        if (fields.fail()) return false;
+    }
+    return true;
+}
+
+std::string BackfillPolicy::describe() const {
+    std::ostringstream ss;
+    ss << name() << ": heavy >= " << BACKFILL_HEAVY_NS / 1000 << " us predicted, " << reservations_.size()
+       << " held reservation(s)\n";
+    ss << std::left << std::setw(36) << "CLIENT" << std::right << std::setw(10) << "KERNELS" << std::setw(8)
+       << "HEAVY" << std::setw(8) << "HELD" << std::setw(8) << "WAITED" << std::setw(11) << "BACKFILLED"
+       << std::setw(10) << "PRIORITY" << std::setw(10) << "SLACK_ms" << std::setw(10) << "HELD_ms" << "\n";
+    for (const auto& entry : clients_) {
+        const ClientCounters& c = entry.second;
+        ss << std::left << std::setw(36) << entry.first << std::right << std::setw(10) << c.kernels << std::setw(8)
+           << c.heavy << std::setw(8) << c.held << std::setw(8) << c.waited << std::setw(11) << c.backfilled
+           << std::setw(10) << c.prioritized << std::fixed << std::setprecision(1) << std::setw(10) << c.slackUsedNs / 1e6 << std::setw(10)
+           << c.heldNs / 1e6 << "\n";
+    }
+    return ss.str();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "policy.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// ============================================================
+//  重 kernel 串行化与回填 (EASY backfilling)
+//  预测耗时 (PolicyRequest::predictedNs) 不小于 BACKFILL_HEAVY_NS 的为重 kernel (大批量 prefill 等)。
+//  不同客户端的重 kernel 按预测耗时串行: 前一个重 kernel 预计结束之前到达的，预约到其结束时刻开始，
+//  在此之前扣住回复；同一客户端的重 kernel 由其自身的 stream 排队，不扣。
+//  有重 kernel 被扣住时，最早的预约开始时刻之前的空档称为 slack:
+//      serialize: 其他有预测的 kernel 一律扣到该预约开始，不推迟它；
+//      backfill : 预测耗时能在预约开始之前做完的小 kernel 立即放行 (按序占用 slack)，放不下的才扣住。
+//  没有预测的 kernel (该族还没有样本) 不参与，直接放行。
+//  只用决策时的预测排时间线，遥测不改变已作出的预约；每个客户端累计回填数与占用的 slack。
+//  优先级 (ksctl set priority=<p>) 大于 0 的客户端的小 kernel 不扣，放不进 slack 也立即放行；不解释权重。
+// ============================================================
+
+constexpr int64_t BACKFILL_HEAVY_NS = 1000000;       // 重 kernel 的预测耗时下限
+
+class BackfillPolicy : public IPolicy {
+public:
+    // backfill 为 false 时即 serialize 策略
+    explicit BackfillPolicy(bool backfill);
+
+    const char* name() const override { return backfill_ ? "backfill" : "serialize"; }
+    void onClientAttach(const std::string& clientKey, const std::string& clientType, int64_t nowNs) override;
+    void onClientDetach(const std::string& clientKey, int64_t nowNs) override;
+    PolicyDecision decide(const PolicyRequest& req, int64_t nowNs) override;
+    void onTelemetry(const std::string&, const std::string&, const LaunchMeta&, int64_t, int64_t) override {}
+    void onTick(int64_t nowNs) override;
+    void onClientControl(const std::string& clientKey, const ClientControl& control, int64_t nowNs) override;
+    bool honoursControl(const std::string& field) const override { return field == "priority"; }
+    void onKernelPrior(const std::string&, const std::string&, const KernelCost&, int64_t) override {}
+    void saveState(std::string& out) const override;
+    bool loadState(const std::string& in) override;
+    std::string describe() const override;
+
+private:
+    struct ClientCounters {
+        int attached = 0;
+        uint64_t kernels = 0;
+        uint64_t heavy = 0;
+        uint64_t held = 0;           // 被扣住的重 kernel
+        uint64_t waited = 0;         // 放不进 slack 而被扣住的小 kernel
+        uint64_t backfilled = 0;
+        uint64_t prioritized = 0;    // 因优先级放行的小 kernel
+        int64_t slackUsedNs = 0;     // 回填 kernel 的预测耗时之和
+        int64_t heldNs = 0;          // 全部扣住时间
+    };
+
+    // 丢弃已经开始的预约
+    void expire(int64_t nowNs);
+
+    bool backfill_;
+    int64_t heavyEnd_ = 0;                  // 最后一个重 kernel 的预计结束时刻
+    std::string heavyClient_;               // 其所属客户端
+    std::vector<int64_t> reservations_;     // 被扣住的重 kernel 的开始时刻 (递增)
+    int64_t backfillEnd_ = 0;               // 已放行的回填 kernel 预计做完的时刻
+    std::map<std::string, ClientCounters> clients_;
+    std::map<std::string, int> priorities_;    // 非 0 的优先级，与接入状态无关
+};
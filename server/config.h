@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <cstring>
 #include <chrono>
+#include <cstdlib>
 
 // ============================================================
 //  常量定义 (保持不变)
@@ -17,13 +18,98 @@ constexpr size_t SPSC_QUEUE_SIZE = 1024;
 constexpr size_t SPSC_MSG_SIZE = 256;
 constexpr size_t CACHE_LINE_SIZE = 64;
 
+// 通道几何由客户端在注册时选择 (ChannelHeader)，调度器按下列上下限校验；
+// 默认几何与旧的固定布局 (SPSC_QUEUE_SIZE x SPSC_MSG_SIZE) 相同
+constexpr uint32_t CHANNEL_MAGIC = 0x4843534b;            // "KSCH"
+constexpr uint32_t CHANNEL_LAYOUT_VERSION = 2;            // 1 为旧的 ClientChannelStruct
+constexpr uint32_t MIN_SLOT_COUNT = 2;
+constexpr uint32_t MAX_SLOT_COUNT = 65536;
+constexpr uint32_t MIN_SLOT_SIZE = 64;
+constexpr uint32_t MAX_SLOT_SIZE = 4096;
+constexpr uint64_t MAX_CHANNEL_BYTES = 64ull << 20;
+
+// 流式传输 (TCP / Unix 流套接字): 单帧上限与最大槽位一致；输出缓冲超过阈值时不等批次结束立即写出
+constexpr uint32_t STREAM_MAX_FRAME = MAX_SLOT_SIZE;
+constexpr size_t STREAM_FLUSH_BYTES = 64 * 1024;
+// 会话线程等待输入的超时，到期后返回让会话检查调度器是否仍在运行
+constexpr int STREAM_POLL_MS = 100;
+// 客户端不读应答、写不出去多久后断开；连上后多久没发完 HELLO 即断开
+constexpr int STREAM_SEND_TIMEOUT_MS = 5000;
+constexpr int STREAM_HELLO_TIMEOUT_MS = 5000;
+// io_uring 后端: 队列深度、接收缓冲区个数 (2 的幂) 与大小、SQPOLL 线程空闲多久后休眠
+constexpr unsigned URING_ENTRIES = 256;
+constexpr unsigned URING_BUFFERS = 256;
+constexpr unsigned URING_BUFFER_BYTES = 16 * 1024;
+constexpr unsigned URING_SQPOLL_IDLE_MS = 50;
+
+// 联邦 (节点间 UDP gossip，默认端口 SCHEDULER_PORT): 每轮发给 GOSSIP_FANOUT 个成员，
+// 一个报文最多带 GOSSIP_ENTRIES 个节点的负载；超过 SUSPECT 没有更新视为下线，超过 FORGET 删除
+constexpr int GOSSIP_INTERVAL_MS = 500;
+constexpr size_t GOSSIP_FANOUT = 3;
+constexpr size_t GOSSIP_ENTRIES = 8;
+constexpr size_t GOSSIP_MAX_DATAGRAM = 1400;
+constexpr int GOSSIP_SUSPECT_MS = 3000;
+constexpr int GOSSIP_FORGET_MS = 60000;
+constexpr size_t GOSSIP_MAX_MEMBERS = 256;
+// 请求路由器 (ksrouter): 默认监听端口，读取统计共享内存的间隔，调度器停止发布多久后视为失联，
+// 连接失败的后端多久内不再优先选择，请求头与请求体的大小上限，
+// 客户端连接的收发超时，等后端响应 (非流式生成整段返回) 的超时，并发连接上限，accept 耗尽 fd 时的退避
+constexpr int ROUTER_PORT = 30000;
+constexpr int ROUTER_REFRESH_MS = 50;
+constexpr int ROUTER_STALE_MS = 1000;
+constexpr int ROUTER_RETRY_MS = 1000;
+constexpr size_t ROUTER_MAX_HEADER = 64 * 1024;
+constexpr long long ROUTER_MAX_BODY = 16ll * 1024 * 1024;
+constexpr int ROUTER_CLIENT_TIMEOUT_MS = 30000;
+constexpr int ROUTER_BACKEND_TIMEOUT_MS = 600000;
+constexpr int ROUTER_MAX_CONNECTIONS = 1024;
+constexpr int ROUTER_ACCEPT_BACKOFF_MS = 100;
+
 #define SHM_NAME_SCHEDULER "/kernel_scheduler_registry"
 #define SHM_NAME_PREFIX_PYTORCH "/ks_pytorch_"
 #define SHM_NAME_PREFIX_SGLANG  "/ks_sglang_"
 #define SHM_NAME_PYTORCH "/kernel_scheduler_pytorch"
 #define SHM_NAME_SGLANG  "/kernel_scheduler_sglang"
+// 控制套接字: CONTROL_SOCKET_PREFIX + 用户后缀 + ".sock"
+#define CONTROL_SOCKET_PREFIX "/tmp/kernel_scheduler"
+
+constexpr uint32_t REGISTRY_MAGIC = 0x4753524b;           // "KRSG"
+constexpr uint32_t REGISTRY_LAYOUT_VERSION = 2;
+
+// 注册表按段组织: 每段 64 个条目，对应一个 64 位分配位图字
+constexpr size_t REGISTRY_SEGMENT_SLOTS = 64;
+constexpr size_t MAX_REGISTRY_SEGMENTS = 64;
+constexpr size_t MAX_REGISTERED_CLIENTS = REGISTRY_SEGMENT_SLOTS * MAX_REGISTRY_SEGMENTS;
+constexpr size_t DEFAULT_REGISTERED_CLIENTS = 1024;
+
+// 调度器重启期间客户端等待 scheduler_ready 恢复的默认时长 (KS_REATTACH_MS)
+constexpr int CLIENT_REATTACH_MS = 10000;
+
+// 客户端租约: 心跳超过租约且进程已不存在时回收其条目与通道
+constexpr int CLIENT_LEASE_MS = 5000;
+constexpr int REAPER_INTERVAL_MS = 1000;
 
-constexpr size_t MAX_REGISTERED_CLIENTS = 64;
+// 策略定时器周期
+constexpr int POLICY_TICK_MS = 10;
+// 暂停/限流中的会话重新检查控制参数与会话状态的间隔
+constexpr int CONTROL_WAIT_MS = 50;
+// 统计共享内存的发布间隔 (路由器等消费者的刷新粒度)
+constexpr int STATS_PUBLISH_MS = 50;
+// 决策录制环形缓冲区默认容量 (事件数，每条 40 字节)
+constexpr size_t DEFAULT_RECORD_EVENTS = 1 << 20;
+// kernel 请求: "kernelType|reqId|clientId|uniqueId[|launch]"，响应 "reqId|allow|reason"
+// launch 为可选的启动参数 "grid=AxBxC,block=AxBxC,smem=N,stream=N,tokens=N,flops=F,bytes=B" (字段均可省略，
+// 见 parseLaunchMeta)；遥测同样可在末尾附带，未附带时沿用同一 reqId 请求的参数
+// 遥测消息: "#T|kernelType|reqId|durationNs[|launch]"，不需要响应
+#define TELEMETRY_PREFIX "#T"
+// 模型声明: "#M|model|0"，连接后发送一次，不需要响应；未声明时以客户端类型作为模型名
+#define MODEL_PREFIX "#M"
+
+// 共享内存对象按用户隔离，调度器与客户端使用相同的后缀
+inline std::string get_user_suffix() {
+    const char* u = std::getenv("USER");
+    return (u && *u) ? std::string("_") + u : "_nouser";
+}
 
 // ============================================================
 //  数据结构 (POD, 用于共享内存布局)
@@ -35,6 +121,7 @@ struct SPSCQueue {
     alignas(CACHE_LINE_SIZE) char buffer[SPSC_QUEUE_SIZE][SPSC_MSG_SIZE];
 };
 
+// 布局版本 1: 固定几何，head/tail 存放取模后的下标
 struct ClientChannelStruct {
     SPSCQueue request_queue;
     SPSCQueue response_queue;
@@ -42,12 +129,36 @@ struct ClientChannelStruct {
     alignas(CACHE_LINE_SIZE) std::atomic<bool> scheduler_ready;
 };
 
+// 布局版本 2: 头部之后依次是请求槽与响应槽 (各 slot_count * slot_size 字节)。
+// head/tail 为自由递增计数，下标 = 计数 & (slot_count - 1)。
+// magic 与旧布局的 request_queue.head (始终 < SPSC_QUEUE_SIZE) 位于同一偏移，据此区分版本。
+struct ChannelHeader {
+    uint32_t magic;
+    uint32_t layout_version;
+    uint32_t slot_count;          // 2 的幂
+    uint32_t slot_size;           // 含结尾 '\0'
+    uint64_t total_size;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> client_connected;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> scheduler_ready;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> request_head;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> request_tail;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> response_head;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> response_tail;
+};
+
+inline uint64_t channelBytes(uint32_t slotCount, uint32_t slotSize) {
+    return sizeof(ChannelHeader) + 2ull * slotCount * slotSize;
+}
+
 struct ClientRegistryEntry {
     alignas(CACHE_LINE_SIZE) std::atomic<bool> active;
     char shm_name[64];
     char client_type[16];
     char unique_id[64];
     alignas(CACHE_LINE_SIZE) std::atomic<int64_t> client_pid;
+    std::atomic<uint64_t> generation;     // 每次注册加一，区分复用同一条目的先后客户端
+    std::atomic<uint64_t> client_start;   // 进程启动时间 (/proc/<pid>/stat)，识别 pid 复用
+    // 客户端每次请求刷新 (CLOCK_MONOTONIC ns)，调度器据此判断租约是否过期
     alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> last_heartbeat;
     
     void init() {
@@ -56,20 +167,78 @@ struct ClientRegistryEntry {
         std::memset(client_type, 0, sizeof(client_type));
         std::memset(unique_id, 0, sizeof(unique_id));
         client_pid.store(0, std::memory_order_relaxed);
+        generation.store(0, std::memory_order_relaxed);
+        client_start.store(0, std::memory_order_relaxed);
         last_heartbeat.store(0, std::memory_order_relaxed);
     }
 };
 
+// 一个注册表段。客户端用 CAS 在 alloc_bits 上抢占条目，发布 active 后在 pending_bits 中置位，
+// 调度器 exchange 取走 pending_bits，只访问有新注册的条目。
+// 位图放在条目之后，段 0 的条目因此落在旧版固定注册表 entries[] 的偏移上
+struct RegistrySegment {
+    ClientRegistryEntry entries[REGISTRY_SEGMENT_SLOTS];
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> alloc_bits;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> pending_bits;
+
+    void init() {
+        alloc_bits.store(0, std::memory_order_relaxed);
+        pending_bits.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < REGISTRY_SEGMENT_SLOTS; i++) {
+            entries[i].init();
+        }
+    }
+};
+
+// 注册表头部。前两个缓存行与段 0 沿用旧版固定布局 (scheduler_ready / version / entries[64])，
+// 新增字段放在段 0 之后的独立缓存行里，其后紧跟其余 segment_capacity - 1 个段 (见 registryBytes / registrySegmentAt)。
+// 旧布局的就绪标志 legacy_ready 始终为 false: 旧版客户端只会等待，不会在新注册表上抢占条目。
+// 整个映射按容量一次建好 (默认 16 段，约 320 KiB)，客户端只在前 segment_count 段中分配，
+// 开放的段都满了时由客户端 CAS 增加 segment_count
+// 重启 (--restart) 时据 magic / layout_version 判断能否沿用已有注册表；
+// generation 每次有调度器接管注册表时加一
 struct ClientRegistry {
-    alignas(CACHE_LINE_SIZE) std::atomic<bool> scheduler_ready;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> legacy_ready;
     alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> version;
-    ClientRegistryEntry entries[MAX_REGISTERED_CLIENTS];
+    // 调度器接受的通道几何上限，与 version 同一缓存行，不改变段 0 的偏移
+    uint32_t max_slot_count;
+    uint32_t max_slot_size;
+    RegistrySegment segment0;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> scheduler_ready;
+    uint32_t magic;
+    uint32_t layout_version;
+    std::atomic<uint32_t> generation;
+    std::atomic<int64_t> scheduler_pid;      // 当前服务的调度器，交接或退出时清零
+    alignas(CACHE_LINE_SIZE) uint32_t segment_capacity;
+    std::atomic<uint32_t> segment_count;
+    std::atomic<uint64_t> reclaimed_slots;   // 回收的崩溃客户端条目数
+    // 有待处理注册的段 (第 i 位对应段 i)
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> pending_segments;
 
-    void init() {
+    void init(uint32_t capacity) {
+        legacy_ready.store(false, std::memory_order_relaxed);
         scheduler_ready.store(false, std::memory_order_relaxed);
+        magic = REGISTRY_MAGIC;
+        layout_version = REGISTRY_LAYOUT_VERSION;
+        generation.store(1, std::memory_order_relaxed);
+        scheduler_pid.store(0, std::memory_order_relaxed);
         version.store(0, std::memory_order_relaxed);
-        for (size_t i = 0; i < MAX_REGISTERED_CLIENTS; i++) {
-            entries[i].init();
-        }
+        max_slot_count = MAX_SLOT_COUNT;
+        max_slot_size = MAX_SLOT_SIZE;
+        segment_capacity = capacity;
+        segment_count.store(1, std::memory_order_relaxed);
+        reclaimed_slots.store(0, std::memory_order_relaxed);
+        pending_segments.store(0, std::memory_order_relaxed);
     }
-};
\ No newline at end of file
+};
+static_assert(MAX_REGISTRY_SEGMENTS <= 64, "pending_segments is a single 64-bit word");
+
+// 段 0 内嵌在头部中，其余段紧跟头部
+inline size_t registryBytes(uint32_t segments) {
+    return sizeof(ClientRegistry) + static_cast<size_t>(segments ? segments - 1 : 0) * sizeof(RegistrySegment);
+}
+
+inline RegistrySegment* registrySegmentAt(ClientRegistry* registry, uint32_t index) {
+    if (index == 0) return &registry->segment0;
+    return reinterpret_cast<RegistrySegment*>(reinterpret_cast<char*>(registry) + sizeof(ClientRegistry)) + index - 1;
+}
@@ -0,0 +1,128 @@
+#include "control.h"
+#include "config.h"
+
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool fillAddr(const std::string& path, struct sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+void setTimeout(int fd, int ms) {
+    struct timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+const char* const CONTROL_USAGE =
+    "commands:\n"
+    "  status                           one-line summary\n"
+    "  clients                          online clients: phase, kernels, rate since the last listing, controls\n"
+    "  stats                            aggregate statistics\n"
+    "  predictor                        latency predictor error per kernel family\n"
+    "  cluster                          load summaries of all federated schedulers (--gossip / --peer)\n"
+    "  set <client> key=value...        weight=<w> priority=<p> quota=<kernels/s, 0 = unlimited> paused=0|1\n"
+    "  pause <client> | resume <client> hold or release the client's kernels\n"
+    "  reset <client>                   drop all controls for the client\n"
+    "  policy [<name>]                  show the policy's state, or switch to a new policy instance\n"
+    "  trace on|off                     pause or resume decision recording\n"
+    "  dump                             write the decision recording\n"
+    "  reload                           re-read the configuration (as SIGHUP)\n"
+    "  stop | handoff                   shut down, or hand the registry to a --restart scheduler\n"
+    "<client> is <type>:<id>, or an online client's <id> when unique\n";
+
+std::string defaultControlPath() {
+    return std::string(CONTROL_SOCKET_PREFIX) + get_user_suffix() + ".sock";
+}
+
+ControlSocket::~ControlSocket() {
+    if (fd_ != -1) {
+        close(fd_);
+        unlink(path_.c_str());
+    }
+}
+
+bool ControlSocket::listen(const std::string& path) {
+    struct sockaddr_un addr;
+    if (!fillAddr(path, addr)) return false;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) return false;
+    unlink(path.c_str());
+    mode_t old = umask(0077);
+    bool ok = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 && ::listen(fd, 16) == 0;
+    umask(old);
+    if (!ok) {
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    path_ = path;
+    return true;
+}
+
+int ControlSocket::accept(std::string& command) {
+    int conn = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (conn == -1) return -1;
+    setTimeout(conn, 100);
+    command.clear();
+    char buf[256];
+    while (command.find('\n') == std::string::npos && command.size() < 4096) {
+        ssize_t n = recv(conn, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        command.append(buf, static_cast<size_t>(n));
+    }
+    size_t end = command.find_first_of("\r\n");
+    if (end != std::string::npos) command.resize(end);
+    return conn;
+}
+
+void ControlSocket::reply(int conn, const std::string& text) {
+    writeAll(conn, text.data(), text.size());
+    close(conn);
+}
+
+bool controlRequest(const std::string& path, const std::string& command, std::string& response) {
+    struct sockaddr_un addr;
+    if (!fillAddr(path, addr)) return false;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return false;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return false;
+    }
+    setTimeout(fd, 5000);
+    std::string line = command + "\n";
+    bool ok = writeAll(fd, line.data(), line.size());
+    response.clear();
+    char buf[4096];
+    ssize_t n;
+    while (ok && (n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        response.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+
+// ============================================================
+//  控制套接字 (Unix 域流套接字，仅属主可访问)
+//  每个连接发送一行命令并收到一段文本回复后关闭，由主线程的事件循环处理。
+//  命令见 CONTROL_USAGE，命令行工具为 ksctl。错误回复以 "error:" 开头。
+// ============================================================
+
+// 默认路径: /tmp/kernel_scheduler_<user>.sock
+std::string defaultControlPath();
+
+// 命令说明 (调度器对未知命令的回复与 ksctl --help 共用)
+extern const char* const CONTROL_USAGE;
+
+class ControlSocket {
+public:
+    ControlSocket() : fd_(-1) {}
+    ~ControlSocket();
+
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+
+    // 监听 path (已存在的残留套接字会被替换)
+    bool listen(const std::string& path);
+    int fd() const { return fd_; }
+
+    // 接受一个连接并读取一行命令 (读超时 100 ms)，返回连接 fd，失败返回 -1
+    int accept(std::string& command);
+
+    // 回复并关闭连接
+    static void reply(int conn, const std::string& text);
+
+private:
+    int fd_;
+    std::string path_;
+};
+
+/**
+ * @brief 发送一条命令并读取回复 (客户端侧)
+ * @return 连接失败时返回 false
+ */
+bool controlRequest(const std::string& path, const std::string& command, std::string& response);
@@ -0,0 +1,259 @@
+#include "cost_store.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t fnv1a(const void* data, size_t len, uint64_t h = 1469598103934665603ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t keyHash(const std::string& model, const std::string& family) {
+    uint64_t h = fnv1a(model.data(), model.size());
+    h = fnv1a("\0", 1, h);
+    h = fnv1a(family.data(), family.size(), h);
+    return h ? h : 1;
+}
+
+// 校验和覆盖 checksum 之后的全部字段
+uint32_t entryChecksum(const CostEntry& e) {
+    const char* begin = reinterpret_cast<const char*>(&e.keyHash);
+    const char* end = reinterpret_cast<const char*>(&e) + sizeof(CostEntry);
+    uint64_t h = fnv1a(begin, static_cast<size_t>(end - begin));
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+size_t fileBytes(size_t capacity) {
+    return sizeof(CostStoreHeader) + capacity * sizeof(CostEntry);
+}
+
+// 写入开始/结束 (单写者)
+void beginWrite(CostEntry& e) {
+    e.seq.store(e.seq.load(std::memory_order_relaxed) | 1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void endWrite(CostEntry& e) {
+    e.checksum = entryChecksum(e);
+    uint32_t seq = e.seq.load(std::memory_order_relaxed);
+    e.seq.store(seq + 1 == 0 ? 2 : seq + 1, std::memory_order_release);
+}
+
+void copyField(char* dst, size_t cap, const std::string& src) {
+    std::memset(dst, 0, cap);
+    std::memcpy(dst, src.data(), std::min(src.size(), cap - 1));
+}
+
+} // namespace
+
+CostStore::CostStore()
+    : fd_(-1), base_(nullptr), length_(0), header_(nullptr), entries_(nullptr), discarded_(0), fullWarned_(false) {}
+
+CostStore::~CostStore() {
+    close();
+}
+
+bool CostStore::open(const std::string& path, size_t capacity) {
+    close();
+    if (capacity == 0) return false;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd == -1 && errno == ENOENT) {
+        // 新文件: 在临时文件上写好头部再 rename，其他进程看到的要么没有文件，要么是完整的空表
+        std::string tmp = path + ".tmp" + std::to_string(getpid());
+        int tfd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (tfd == -1) {
+            perror("[CostStore] create");
+            return false;
+        }
+        // 文件其余部分由 ftruncate 填零，即 used = 0 与全部空条目
+        uint32_t fields[4] = {COST_STORE_MAGIC, COST_STORE_VERSION, static_cast<uint32_t>(capacity),
+                              static_cast<uint32_t>(sizeof(CostEntry))};
+        bool ok = ftruncate(tfd, static_cast<off_t>(fileBytes(capacity))) == 0 &&
+                  pwrite(tfd, fields, sizeof(fields), 0) == static_cast<ssize_t>(sizeof(fields)) &&
+                  fsync(tfd) == 0 && rename(tmp.c_str(), path.c_str()) == 0;
+        ::close(tfd);
+        if (!ok) {
+            perror("[CostStore] initialize");
+            unlink(tmp.c_str());
+            return false;
+        }
+        fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    }
+    if (fd == -1) {
+        perror("[CostStore] open");
+        return false;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        std::cerr << "[CostStore] " << path << " is in use by another scheduler" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    struct stat st;
+    CostStoreHeader header;
+    if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        header.magic != COST_STORE_MAGIC || header.version != COST_STORE_VERSION ||
+        header.entrySize != sizeof(CostEntry) || header.capacity == 0 ||
+        static_cast<size_t>(st.st_size) < fileBytes(header.capacity)) {
+        std::cerr << "[CostStore] " << path << " is not a compatible cost store" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    length_ = fileBytes(header.capacity);
+    base_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base_ == MAP_FAILED) {
+        perror("[CostStore] mmap");
+        base_ = nullptr;
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    header_ = static_cast<CostStoreHeader*>(base_);
+    entries_ = reinterpret_cast<CostEntry*>(static_cast<char*>(base_) + sizeof(CostStoreHeader));
+    return validate();
+}
+
+// 丢弃写到一半或校验失败的条目，并重新统计已用条目数
+bool CostStore::validate() {
+    uint64_t used = 0;
+    discarded_ = 0;
+    for (uint32_t i = 0; i < header_->capacity; i++) {
+        CostEntry& e = entries_[i];
+        uint32_t seq = e.seq.load(std::memory_order_acquire);
+        if (seq == 0) continue;
+        if ((seq & 1u) || e.checksum != entryChecksum(e)) {
+            // 保留为墓碑 (keyHash = 0) 以免打断探测链，同时不再被任何键匹配
+            std::memset(reinterpret_cast<char*>(&e) + sizeof(e.seq), 0, sizeof(CostEntry) - sizeof(e.seq));
+            e.checksum = entryChecksum(e);
+            e.seq.store(2, std::memory_order_release);
+            discarded_++;
+        }
+        used++;
+    }
+    header_->used.store(used, std::memory_order_relaxed);
+    if (discarded_) sync(false);
+    return true;
+}
+
+void CostStore::close() {
+    if (base_) {
+        sync(false);
+        munmap(base_, length_);
+    }
+    if (fd_ != -1) ::close(fd_);
+    fd_ = -1;
+    base_ = nullptr;
+    header_ = nullptr;
+    entries_ = nullptr;
+    length_ = 0;
+    cache_.clear();
+}
+
+CostEntry* CostStore::find(const std::string& model, const std::string& family, bool create) {
+    uint64_t hash = keyHash(model, family);
+    uint32_t capacity = header_->capacity;
+    for (uint32_t probe = 0; probe < capacity; probe++) {
+        CostEntry& e = entries_[(hash + probe) % capacity];
+        uint32_t seq = e.seq.load(std::memory_order_acquire);
+        if (seq == 0) {
+            if (!create) return nullptr;
+            beginWrite(e);
+            e.keyHash = hash;
+            copyField(e.model, sizeof(e.model), model);
+            copyField(e.family, sizeof(e.family), family);
+            e.count = e.soloCount = e.sharedCount = 0;
+            e.meanNs = e.m2 = e.soloMeanNs = e.sharedMeanNs = 0;
+            e.updatedSec = 0;
+            endWrite(e);
+            header_->used.fetch_add(1, std::memory_order_relaxed);
+            return &e;
+        }
+        if (e.keyHash == hash && model.compare(0, sizeof(e.model) - 1, e.model) == 0 &&
+            family.compare(0, sizeof(e.family) - 1, e.family) == 0) {
+            return &e;
+        }
+    }
+    if (create && !fullWarned_) {
+        fullWarned_ = true;
+        std::cerr << "[CostStore] Store is full (" << capacity << " entries), new kernel families are not kept"
+                  << std::endl;
+    }
+    return nullptr;
+}
+
+void CostStore::update(const std::string& model, const std::string& kernelType, int64_t durationNs, bool shared) {
+    if (!header_ || durationNs <= 0) return;
+    auto& byKernel = cache_[model];
+    auto it = byKernel.find(kernelType);
+    CostEntry* e;
+    if (it != byKernel.end()) {
+        e = it->second;
+    } else {
+        e = find(model, kernelFamily(kernelType), true);
+        if (!e) return;
+        byKernel.emplace(kernelType, e);
+    }
+
+    double x = static_cast<double>(durationNs);
+    beginWrite(*e);
+    e->count++;
+    double delta = x - e->meanNs;
+    e->meanNs += delta / static_cast<double>(e->count);
+    e->m2 += delta * (x - e->meanNs);
+    if (shared) {
+        e->sharedCount++;
+        e->sharedMeanNs += (x - e->sharedMeanNs) / static_cast<double>(e->sharedCount);
+    } else {
+        e->soloCount++;
+        e->soloMeanNs += (x - e->soloMeanNs) / static_cast<double>(e->soloCount);
+    }
+    e->updatedSec = static_cast<int64_t>(time(nullptr));
+    endWrite(*e);
+}
+
+void CostStore::forEachFamily(const std::string& model,
+                              const std::function<void(const std::string&, const KernelCost&)>& fn) const {
+    if (!header_) return;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < header_->capacity; i++) {
+        const CostEntry& e = entries_[i];
+        if (e.keyHash && model.compare(0, sizeof(e.model) - 1, e.model) == 0) total += e.count;
+    }
+    if (total == 0) return;
+    for (uint32_t i = 0; i < header_->capacity; i++) {
+        const CostEntry& e = entries_[i];
+        if (!e.keyHash || e.count == 0 || model.compare(0, sizeof(e.model) - 1, e.model) != 0) continue;
+        KernelCost cost;
+        cost.count = e.count;
+        cost.meanNs = e.meanNs;
+        cost.stddevNs = e.count > 1 ? std::sqrt(e.m2 / static_cast<double>(e.count - 1)) : 0;
+        cost.interference = (e.soloCount && e.sharedCount && e.soloMeanNs > 0) ? e.sharedMeanNs / e.soloMeanNs : 1.0;
+        cost.frequency = static_cast<double>(e.count) / static_cast<double>(total);
+        fn(std::string(e.family, strnlen(e.family, sizeof(e.family))), cost);
+    }
+}
+
+void CostStore::sync(bool async) {
+    if (base_) msync(base_, length_, async ? MS_ASYNC : MS_SYNC);
+}
+
+size_t CostStore::size() const {
+    return header_ ? static_cast<size_t>(header_->used.load(std::memory_order_relaxed)) : 0;
+}
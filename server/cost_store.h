@@ -0,0 +1,97 @@
+#pragma once
+
+#include "policy.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// ============================================================
+//  kernel 代价模型存储 (跨会话、跨重启保留)
+//  文件 = CostStoreHeader + capacity 个 CostEntry，整体 mmap (MAP_SHARED)，
+//  以 (模型, kernel 族) 为键开放寻址、线性探测。
+//  每个条目自带 seqlock 与校验和: 写入时 seq 先变奇数、写完字段与校验和后再变偶数，
+//  进程或机器在写入中途崩溃时，加载阶段发现 seq 为奇数或校验和不符就丢弃该条目。
+//  只有调度器一个写者 (flock 排他)，更新在策略锁内串行执行。
+// ============================================================
+
+constexpr uint32_t COST_STORE_MAGIC = 0x4b53434d;   // "KSCM"
+constexpr uint32_t COST_STORE_VERSION = 1;
+constexpr size_t DEFAULT_COST_ENTRIES = 16384;
+// 周期性 msync 的间隔
+constexpr int COST_SYNC_MS = 5000;
+
+// 头部前 16 字节依次为 magic / version / capacity / entrySize
+struct CostStoreHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t entrySize;
+    std::atomic<uint64_t> used;
+    uint64_t reserved[5];
+};
+
+struct CostEntry {
+    std::atomic<uint32_t> seq;       // 奇数表示写入中，0 表示空条目
+    uint32_t checksum;               // checksum 之后全部字段的 FNV-1a
+    uint64_t keyHash;
+    char model[48];
+    char family[128];
+    uint64_t count;
+    double meanNs;
+    double m2;                       // Welford 平方差和
+    uint64_t soloCount;              // 只有一个活跃会话时的样本
+    double soloMeanNs;
+    uint64_t sharedCount;            // 与其他会话并发时的样本
+    double sharedMeanNs;
+    int64_t updatedSec;              // 最后一次更新 (CLOCK_REALTIME 秒)
+};
+static_assert(sizeof(CostEntry) == 256, "CostEntry layout");
+
+class CostStore {
+public:
+    CostStore();
+    ~CostStore();
+
+    CostStore(const CostStore&) = delete;
+    CostStore& operator=(const CostStore&) = delete;
+
+    /**
+     * @brief 打开或新建存储文件
+     * 新文件先写到临时文件再 rename，避免留下只初始化了一半的文件；
+     * 已有文件的容量以文件为准。加载时丢弃写坏的条目。
+     */
+    bool open(const std::string& path, size_t capacity);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    // 记录一个样本；shared 表示采样时还有其他会话在提交 kernel
+    void update(const std::string& model, const std::string& kernelType, int64_t durationNs, bool shared);
+
+    // 遍历某个模型的全部 kernel 族 (frequency 为该族占此模型样本的比例)
+    void forEachFamily(const std::string& model,
+                       const std::function<void(const std::string& family, const KernelCost& cost)>& fn) const;
+
+    // 把脏页写回 (async 为 false 时等待完成)
+    void sync(bool async);
+
+    size_t size() const;
+    size_t capacity() const { return header_ ? header_->capacity : 0; }
+    size_t discarded() const { return discarded_; }
+
+private:
+    CostEntry* find(const std::string& model, const std::string& family, bool create);
+    bool validate();
+
+    int fd_;
+    void* base_;
+    size_t length_;
+    CostStoreHeader* header_;
+    CostEntry* entries_;
+    size_t discarded_;
+    bool fullWarned_;
+    // kernel 名 -> 条目 (每个模型一张表)，免去热路径上的归一化与探测
+    std::unordered_map<std::string, std::unordered_map<std::string, CostEntry*>> cache_;
+};
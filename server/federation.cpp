@@ -0,0 +1,408 @@
+#include "federation.h"
+#include "config.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netdb.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const char GOSSIP_MAGIC[] = "KSG1";
+
+int64_t monoNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// "<host>:<port>" 或 "<port>"，host 为空时使用 defaultHost；host 只接受数字形式的 IPv4 地址
+bool parseAddress(const std::string& spec, const char* defaultHost, struct sockaddr_in& out, std::string* hostOut) {
+    size_t colon = spec.rfind(':');
+    std::string host = colon == std::string::npos ? std::string(defaultHost) : spec.substr(0, colon);
+    std::string port = colon == std::string::npos ? spec : spec.substr(colon + 1);
+    if (host.empty()) host = defaultHost;
+    if (hostOut) *hostOut = host;
+    std::memset(&out, 0, sizeof(out));
+    int p = atoi(port.c_str());
+    if (p <= 0 || p >= 65536) return false;
+    out.sin_family = AF_INET;
+    out.sin_port = htons(static_cast<uint16_t>(p));
+    return inet_pton(AF_INET, host.c_str(), &out.sin_addr) == 1;
+}
+
+// 同上，但 host 也可以是主机名 (getaddrinfo 可能因 DNS 阻塞，只用于启动时的 --gossip / --peer)
+bool resolve(const std::string& spec, const char* defaultHost, struct sockaddr_in& out) {
+    std::string host;
+    if (parseAddress(spec, defaultHost, out, &host)) return true;
+    if (out.sin_port == 0) return false;
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) return false;
+    out.sin_addr = reinterpret_cast<struct sockaddr_in*>(res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+    return true;
+}
+
+std::string addressText(const struct sockaddr_in& addr) {
+    char ip[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+std::vector<std::string> splitBy(const std::string& s, char delimiter) {
+    std::vector<std::string> out;
+    std::istringstream in(s);
+    std::string field;
+    while (std::getline(in, field, delimiter)) out.push_back(field);
+    return out;
+}
+
+// 节点名不能含报文分隔符
+std::string sanitize(std::string name) {
+    for (char& c : name) {
+        if (c == '|' || c == '\n' || c == ' ') c = '_';
+    }
+    return name;
+}
+
+} // namespace
+
+std::string formatNodeLoad(const NodeLoad& load) {
+    std::ostringstream ss;
+    ss << "sessions=" << load.sessions << ",prefill=" << load.prefill << ",decode=" << load.decode
+       << ",waiting=" << load.waiting << std::fixed << std::setprecision(1) << ",rate=" << load.kernelRate
+       << std::setprecision(3) << ",util=" << load.utilization << ",headroom=" << load.headroom
+       << ",gpus=" << load.gpus;
+    return ss.str();
+}
+
+bool parseNodeLoad(const std::string& text, NodeLoad& load) {
+    for (const std::string& field : splitBy(text, ',')) {
+        size_t eq = field.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = field.substr(0, eq);
+        const char* value = field.c_str() + eq + 1;
+        if (key == "sessions") load.sessions = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (key == "prefill") load.prefill = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (key == "decode") load.decode = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (key == "waiting") load.waiting = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (key == "rate") load.kernelRate = atof(value);
+        else if (key == "util") load.utilization = atof(value);
+        else if (key == "headroom") load.headroom = atof(value);
+        else if (key == "gpus") load.gpus = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        // 未知键忽略，便于以后增加字段
+    }
+    return true;
+}
+
+Federation::Federation(const std::string& nodeId, std::function<LoadCounters()> sample, uint32_t gpus,
+                       int intervalMs)
+    : nodeId_(sanitize(nodeId)), sample_(std::move(sample)), gpus_(std::max(1u, gpus)),
+      intervalMs_(std::max(10, intervalMs)), fd_(-1), stopFd_(-1), seq_(0), lastSampleNs_(0),
+      rng_(std::random_device()()), running_(false) {
+    // 重启后 seq 从 0 开始，用启动时间区分新旧实例
+    incarnation_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Federation::~Federation() {
+    stop();
+    if (fd_ != -1) close(fd_);
+    if (stopFd_ != -1) close(stopFd_);
+}
+
+bool Federation::init(const std::string& bind, const std::vector<std::string>& peers) {
+    struct sockaddr_in addr;
+    if (!resolve(bind, LOCALHOST, addr)) {
+        std::cerr << "[Federation] Bad gossip address: " << bind << std::endl;
+        return false;
+    }
+    for (const auto& peer : peers) {
+        struct sockaddr_in seed;
+        if (!resolve(peer, LOCALHOST, seed)) {
+            std::cerr << "[Federation] Bad peer address: " << peer << std::endl;
+            return false;
+        }
+        seeds_.emplace_back(addressText(seed), seed);
+    }
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ == -1 || stopFd_ == -1 || ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "[Federation] Cannot bind " << addressText(addr) << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    bindAddress_ = addressText(addr);
+
+    Member& self = members_[nodeId_];
+    self.address = bindAddress_;
+    self.addr = addr;
+    self.incarnation = incarnation_;
+    self.load.gpus = gpus_;
+    self.verified = true;
+    std::cout << "[Federation] Node " << nodeId_ << " gossiping on udp:" << bindAddress_ << " with "
+              << seeds_.size() << " seed peer(s)" << std::endl;
+    return true;
+}
+
+void Federation::start() {
+    running_.store(true);
+    thread_ = std::thread(&Federation::loop, this);
+}
+
+void Federation::stop() {
+    if (!running_.exchange(false)) return;
+    uint64_t one = 1;
+    ssize_t ignored = write(stopFd_, &one, sizeof(one));
+    (void)ignored;
+    if (thread_.joinable()) thread_.join();
+}
+
+void Federation::loop() {
+    int64_t intervalNs = intervalMs_ * 1000000ll;
+    int64_t nextNs = monoNowNs();
+    lastCounters_ = sample_();
+    lastSampleNs_ = nextNs;
+    while (running_.load()) {
+        int64_t now = monoNowNs();
+        if (now >= nextNs) {
+            sampleSelf(now);
+            gossip(now);
+            nextNs = now + intervalNs;
+        }
+        struct pollfd fds[2];
+        fds[0].fd = fd_;
+        fds[0].events = POLLIN;
+        fds[1].fd = stopFd_;
+        fds[1].events = POLLIN;
+        int timeoutMs = static_cast<int>((nextNs - now) / 1000000) + 1;
+        int n = poll(fds, 2, timeoutMs);
+        if (n > 0 && (fds[0].revents & POLLIN)) receive(monoNowNs());
+    }
+}
+
+void Federation::sampleSelf(int64_t nowNs) {
+    LoadCounters c = sample_();
+    double seconds = (nowNs - lastSampleNs_) / 1e9;
+    NodeLoad load;
+    load.sessions = c.sessions;
+    load.prefill = c.prefill;
+    load.decode = c.decode;
+    load.waiting = c.waiting;
+    load.gpus = gpus_;
+    if (seconds > 0) {
+        load.kernelRate = (c.kernels - lastCounters_.kernels) / seconds;
+        load.utilization = (c.busyNs - lastCounters_.busyNs) / 1e9 / seconds / gpus_;
+    }
+    load.headroom = std::max(0.0, 1.0 - load.utilization);
+    lastCounters_ = c;
+    lastSampleNs_ = nowNs;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Member& self = members_[nodeId_];
+    self.seq = ++seq_;
+    self.load = load;
+    self.updatedNs = nowNs;
+}
+
+bool Federation::isUp(const Member& m, int64_t nowNs) const {
+    return nowNs - m.updatedNs <= GOSSIP_SUSPECT_MS * 1000000ll;
+}
+
+void Federation::gossip(int64_t nowNs) {
+    std::vector<struct sockaddr_in> targets;
+    std::string datagram;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 清理长期失联的成员
+        for (auto it = members_.begin(); it != members_.end();) {
+            if (it->first != nodeId_ && nowNs - it->second.updatedNs > GOSSIP_FORGET_MS * 1000000ll) {
+                std::cout << "[Federation] Forgot node " << it->first << std::endl;
+                it = members_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // 目标: 随机 GOSSIP_FANOUT 个已验证的在线成员，外加一个下线成员、只听转述的成员
+        // 或还没对上号的种子作为探测 (加入集群，或重新联系重启后不知道我们的节点)
+        std::vector<std::string> known;
+        std::vector<struct sockaddr_in> probes;
+        for (const auto& m : members_) {
+            if (m.first == nodeId_) continue;
+            known.push_back(m.second.address);
+            if (m.second.verified && isUp(m.second, nowNs)) targets.push_back(m.second.addr);
+            else probes.push_back(m.second.addr);
+        }
+        for (const auto& seed : seeds_) {
+            if (seed.first != bindAddress_ && std::find(known.begin(), known.end(), seed.first) == known.end()) {
+                probes.push_back(seed.second);
+            }
+        }
+        std::shuffle(targets.begin(), targets.end(), rng_);
+        if (targets.size() > GOSSIP_FANOUT) targets.resize(GOSSIP_FANOUT);
+        if (!probes.empty()) {
+            targets.push_back(probes[std::uniform_int_distribution<size_t>(0, probes.size() - 1)(rng_)]);
+        }
+
+        // 内容: 本节点，加上随机挑选的已验证在线成员 (不转述别人转述来的地址)
+        std::vector<const std::pair<const std::string, Member>*> entries;
+        for (const auto& m : members_) {
+            if (m.first != nodeId_ && m.second.verified && isUp(m.second, nowNs)) entries.push_back(&m);
+        }
+        std::shuffle(entries.begin(), entries.end(), rng_);
+        const Member& self = members_[nodeId_];
+        datagram = std::string(GOSSIP_MAGIC) + "|" + nodeId_ + "\n" + nodeId_ + "|-|" +
+                   std::to_string(self.incarnation) + "|" + std::to_string(self.seq) + "|" +
+                   formatNodeLoad(self.load) + "\n";
+        for (size_t i = 0; i < entries.size() && i + 1 < GOSSIP_ENTRIES; i++) {
+            const Member& m = entries[i]->second;
+            std::string line = entries[i]->first + "|" + m.address + "|" + std::to_string(m.incarnation) + "|" +
+                               std::to_string(m.seq) + "|" + formatNodeLoad(m.load) + "\n";
+            if (datagram.size() + line.size() > GOSSIP_MAX_DATAGRAM) break;
+            datagram += line;
+        }
+    }
+    for (const auto& target : targets) {
+        sendto(fd_, datagram.data(), datagram.size(), 0, reinterpret_cast<const struct sockaddr*>(&target),
+               sizeof(target));
+    }
+}
+
+void Federation::receive(int64_t nowNs) {
+    char buf[GOSSIP_MAX_DATAGRAM + 1];
+    for (;;) {
+        struct sockaddr_in from;
+        socklen_t len = sizeof(from);
+        ssize_t n = recvfrom(fd_, buf, sizeof(buf) - 1, 0, reinterpret_cast<struct sockaddr*>(&from), &len);
+        if (n < 0) break;
+        merge(std::string(buf, static_cast<size_t>(n)), from, nowNs);
+    }
+}
+
+void Federation::merge(const std::string& datagram, const struct sockaddr_in& from, int64_t nowNs) {
+    std::vector<std::string> lines = splitBy(datagram, '\n');
+    const std::string header = std::string(GOSSIP_MAGIC) + "|";
+    if (lines.empty() || lines[0].compare(0, header.size(), header) != 0) return;
+    std::string sender = lines[0].substr(header.size());
+
+    // 先在锁外解析全部条目；成员地址必须是数字形式的 host:port (报文未经鉴权，不做 DNS 查询)
+    struct Entry {
+        std::string nodeId;
+        struct sockaddr_in addr;
+        uint64_t incarnation;
+        uint64_t seq;
+        NodeLoad load;
+        bool self;              // 发送者自己的条目，地址为报文源地址
+    };
+    std::vector<Entry> entries;
+    for (size_t i = 1; i < lines.size(); i++) {
+        std::vector<std::string> f = splitBy(lines[i], '|');
+        if (f.size() != 5 || f[0].empty() || f[0] == nodeId_) continue;
+        Entry e;
+        e.nodeId = f[0];
+        e.incarnation = strtoull(f[2].c_str(), nullptr, 10);
+        e.seq = strtoull(f[3].c_str(), nullptr, 10);
+        if (!parseNodeLoad(f[4], e.load)) continue;
+        // 发送者自己的地址一律取源地址，不信报文里写的
+        e.self = e.nodeId == sender;
+        e.addr = from;
+        if (!e.self && !parseAddress(f[1], LOCALHOST, e.addr, nullptr)) continue;
+        entries.push_back(e);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Entry& e : entries) {
+        auto it = members_.find(e.nodeId);
+        bool fresh = it == members_.end();
+        if (!fresh && (e.incarnation < it->second.incarnation ||
+                       (e.incarnation == it->second.incarnation && e.seq <= it->second.seq))) {
+            continue;
+        }
+        if (fresh && !makeRoom()) continue;
+        Member& m = members_[e.nodeId];
+        bool wasUp = !fresh && isUp(m, nowNs);
+        // 已验证的地址只被节点自己的报文改写，转述的地址不能把它指向别处
+        if (e.self || !m.verified) {
+            m.address = addressText(e.addr);
+            m.addr = e.addr;
+        }
+        if (e.self) m.verified = true;
+        m.incarnation = e.incarnation;
+        m.seq = e.seq;
+        m.load = e.load;
+        m.updatedNs = nowNs;
+        if (!wasUp) std::cout << "[Federation] Node " << e.nodeId << " (" << m.address << ") is up" << std::endl;
+    }
+}
+
+// 成员已满时腾出一个位置: 淘汰最久没更新的未验证成员；全部已验证则不再接纳新节点
+bool Federation::makeRoom() {
+    if (members_.size() < GOSSIP_MAX_MEMBERS) return true;
+    auto victim = members_.end();
+    for (auto it = members_.begin(); it != members_.end(); ++it) {
+        if (it->second.verified) continue;
+        if (victim == members_.end() || it->second.updatedNs < victim->second.updatedNs) victim = it;
+    }
+    if (victim == members_.end()) return false;
+    members_.erase(victim);
+    return true;
+}
+
+std::string Federation::describeCluster() {
+    int64_t now = monoNowNs();
+    std::ostringstream ss;
+    ss << std::left << std::setw(24) << "NODE" << std::setw(22) << "ADDRESS" << std::setw(6) << "STATE"
+       << std::right << std::setw(8) << "AGE_ms" << std::setw(9) << "SESSIONS" << std::setw(8) << "PREFILL"
+       << std::setw(7) << "DECODE" << std::setw(8) << "WAITING" << std::setw(11) << "RATE/s" << std::setw(7)
+       << "UTIL" << std::setw(9) << "HEADROOM" << std::setw(5) << "GPUS" << "\n";
+
+    size_t nodes = 0, up = 0;
+    uint32_t sessions = 0, waiting = 0, gpus = 0;
+    double rate = 0, busyGpus = 0, minHeadroom = 1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : members_) {
+        const Member& m = entry.second;
+        bool alive = entry.first == nodeId_ || isUp(m, now);
+        nodes++;
+        ss << std::left << std::setw(24) << (entry.first == nodeId_ ? entry.first + "*" : entry.first)
+           << std::setw(22) << m.address << std::setw(6) << (alive ? "up" : "down") << std::right << std::setw(8)
+           << (now - m.updatedNs) / 1000000 << std::setw(9) << m.load.sessions << std::setw(8) << m.load.prefill
+           << std::setw(7) << m.load.decode << std::setw(8) << m.load.waiting << std::setw(11) << std::fixed
+           << std::setprecision(1) << m.load.kernelRate << std::setw(7) << std::setprecision(3)
+           << m.load.utilization << std::setw(9) << m.load.headroom << std::setw(5) << m.load.gpus << "\n";
+        if (!alive) continue;
+        up++;
+        sessions += m.load.sessions;
+        waiting += m.load.waiting;
+        rate += m.load.kernelRate;
+        gpus += m.load.gpus;
+        busyGpus += m.load.utilization * m.load.gpus;
+        minHeadroom = std::min(minHeadroom, m.load.headroom);
+    }
+    ss << "total nodes=" << nodes << " up=" << up << " sessions=" << sessions << " waiting=" << waiting
+       << std::fixed << std::setprecision(1) << " rate=" << rate << std::setprecision(3)
+       << " util=" << (gpus ? busyGpus / gpus : 0) << " min_headroom=" << minHeadroom << " gpus=" << gpus << "\n";
+    return ss.str();
+}
+
+std::string Federation::summary() {
+    int64_t now = monoNowNs();
+    size_t up = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : members_) {
+        if (entry.first == nodeId_ || isUp(entry.second, now)) up++;
+    }
+    return std::to_string(up) + "/" + std::to_string(members_.size());
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "scheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================
+//  调度器联邦 (节点间 UDP gossip)
+//  每个节点周期性地把自己与已知节点的负载摘要发给随机挑选的几个成员，
+//  收到的摘要按 (incarnation, seq) 取最新，成员关系随摘要传播，只需给出一个种子节点即可加入。
+//  报文为文本:
+//      KSG1|<发送者>\n
+//      <节点>|<地址>|<incarnation>|<seq>|sessions=..,prefill=..,...\n   (每个节点一行)
+//  发送者自己那一行的地址为 "-"，由接收方取报文的源地址。
+//  UDP 没有鉴权，只应监听在集群内网上。报文里别的节点的地址只是转述: 这样的成员每轮最多探测一次，
+//  直到收到它自己从该地址发来的报文才成为 gossip 目标并被转述给别人；成员数不超过 GOSSIP_MAX_MEMBERS。
+// ============================================================
+
+// 一个节点的负载摘要
+struct NodeLoad {
+    uint32_t sessions = 0;
+    uint32_t prefill = 0;
+    uint32_t decode = 0;
+    uint32_t waiting = 0;       // 被暂停或配额挡住的会话 (排队深度)
+    double kernelRate = 0;      // kernel/s
+    double utilization = 0;     // 每 GPU 平均忙碌比例: 遥测耗时之和 / 时间 / GPU 数
+    double headroom = 1;        // 1 - utilization，不小于 0
+    uint32_t gpus = 1;
+};
+
+std::string formatNodeLoad(const NodeLoad& load);
+bool parseNodeLoad(const std::string& text, NodeLoad& load);
+
+class Federation {
+public:
+    /**
+     * @param nodeId   节点名，集群内唯一 (默认 <hostname>:<port>)
+     * @param sample   读取本节点的累计计数
+     * @param gpus     本节点 GPU 数，用于把遥测耗时折算成每 GPU 利用率
+     */
+    Federation(const std::string& nodeId, std::function<LoadCounters()> sample, uint32_t gpus, int intervalMs);
+    ~Federation();
+
+    Federation(const Federation&) = delete;
+    Federation& operator=(const Federation&) = delete;
+
+    /**
+     * @brief 绑定 UDP 端口并解析种子节点
+     * @param bind  "<port>" 或 "<host>:<port>" (host 默认 127.0.0.1，跨机器需显式给出地址)
+     * @param peers 种子节点 "<host>:<port>"
+     */
+    bool init(const std::string& bind, const std::vector<std::string>& peers);
+    void start();
+    void stop();
+
+    const std::string& nodeId() const { return nodeId_; }
+
+    // 集群视图 (控制命令 cluster): 每个节点一行，最后一行为汇总
+    std::string describeCluster();
+    // 一行汇总 (stats 与周期状态)
+    std::string summary();
+
+private:
+    struct Member {
+        std::string address;          // "ip:port"
+        struct sockaddr_in addr;
+        uint64_t incarnation = 0;
+        uint64_t seq = 0;
+        NodeLoad load;
+        int64_t updatedNs = 0;        // 本地收到新版本的时间
+        bool verified = false;        // 收到过它自己发来的报文，address 即报文源地址
+    };
+
+    void loop();
+    void sampleSelf(int64_t nowNs);
+    void gossip(int64_t nowNs);
+    void receive(int64_t nowNs);
+    void merge(const std::string& datagram, const struct sockaddr_in& from, int64_t nowNs);
+    bool isUp(const Member& m, int64_t nowNs) const;
+    bool makeRoom();
+
+    std::string nodeId_;
+    std::function<LoadCounters()> sample_;
+    uint32_t gpus_;
+    int intervalMs_;
+    int fd_;
+    int stopFd_;
+    std::string bindAddress_;
+    std::vector<std::pair<std::string, struct sockaddr_in>> seeds_;
+
+    // 本节点的摘要版本与上次采样
+    uint64_t incarnation_;
+    uint64_t seq_;
+    LoadCounters lastCounters_;
+    int64_t lastSampleNs_;
+
+    std::mutex mutex_;                         // 保护 members_ (控制命令读取)
+    std::map<std::string, Member> members_;    // 含本节点
+    std::mt19937 rng_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
@@ -21,6 +21,10 @@ public:
     // 标记调度器已准备好服务此通道 (握手用)
     virtual void setReady() = 0;
 
+    // 写出攒批的应答。批量写出的传输在 recvBlocking 取空输入时自动调用；
+    // 调度器在会话要长时间等待 (暂停、限流) 之前也会调用
+    virtual void flush() {}
+
     // 获取元数据
     virtual std::string getId() const = 0;
     virtual std::string getType() const = 0;
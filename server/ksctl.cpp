@@ -0,0 +1,46 @@
+#include "control.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// ============================================================
+//  ksctl: 调度器控制套接字的命令行客户端
+//  ksctl [--socket <path>] <command> [args...]
+//  参数以空格拼成一行命令发送，打印回复；连接失败或回复以 "error:" 开头时退出码为 1
+// ============================================================
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--socket <path>] <command> [args...]\n"
+              << "  --socket <path>  control socket (default " << defaultControlPath() << ")\n"
+              << CONTROL_USAGE;
+}
+
+int main(int argc, char** argv) {
+    std::string path = defaultControlPath();
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0 ? 0 : 2;
+        }
+    }
+    if (i >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    std::string command = argv[i];
+    for (i++; i < argc; i++) command += std::string(" ") + argv[i];
+
+    std::string response;
+    if (!controlRequest(path, command, response)) {
+        std::cerr << "ksctl: cannot reach the scheduler at " << path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cout << response;
+    if (!response.empty() && response.back() != '\n') std::cout << std::endl;
+    return response.compare(0, 6, "error:") == 0 ? 1 : 0;
+}
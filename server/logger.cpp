@@ -32,9 +32,14 @@ Logger::~Logger() {
 }
 
 void Logger::write(const std::string& message) {
+    write(message.data(), message.size());
+}
+
+void Logger::write(const char* data, size_t len) {
     std::lock_guard<std::mutex> lock(opMutex_);
     if (fileStream_.is_open()) {
-        fileStream_ << message << "\n";
+        fileStream_.write(data, static_cast<std::streamsize>(len));
+        fileStream_ << "\n";
         fileStream_.flush(); 
     }
 }
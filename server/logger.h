@@ -24,6 +24,7 @@ public:
 
     // 核心功能
     void write(const std::string& message);
+    void write(const char* data, size_t len);
     void recordKernelStat(const std::string& kernelType);
     void kernelIdIncrement();
     long long getKernelId() const;
@@ -0,0 +1,61 @@
+#include "memfd_proto.h"
+#include "config.h"
+
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+std::string defaultMemfdSocketPath() {
+    return std::string(CONTROL_SOCKET_PREFIX) + get_user_suffix() + ".chan";
+}
+
+bool sendMessage(int sock, const std::string& msg, int fd) {
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(msg.data());
+    iov.iov_len = msg.size();
+    struct msghdr mh;
+    std::memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    if (fd >= 0) {
+        std::memset(control, 0, sizeof(control));
+        mh.msg_control = control;
+        mh.msg_controllen = sizeof(control);
+        struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    }
+    return sendmsg(sock, &mh, MSG_NOSIGNAL) == static_cast<ssize_t>(msg.size());
+}
+
+bool recvMessage(int sock, std::string& msg, int* fd, size_t maxLen) {
+    std::vector<char> buf(maxLen);
+    struct iovec iov;
+    iov.iov_base = buf.data();
+    iov.iov_len = buf.size();
+    struct msghdr mh;
+    std::memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    char control[CMSG_SPACE(sizeof(int))];
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof(control);
+
+    if (fd) *fd = -1;
+    ssize_t n = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+    if (n <= 0) return false;
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        int received;
+        std::memcpy(&received, CMSG_DATA(cm), sizeof(int));
+        if (fd) *fd = received;
+        else close(received);
+    }
+    msg.assign(buf.data(), static_cast<size_t>(n));
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+// ============================================================
+//  memfd 通道注册协议 (Unix 域 SOCK_SEQPACKET 套接字)
+//  客户端: "REG|<type>|<uniqueId>|<slotCount>|<slotSize>"
+//  调度器: "OK|<slotCount>|<slotSize>" 并通过 SCM_RIGHTS 附带已格式化、已预取的通道 memfd，
+//          或 "ERR|<原因>"。
+//  注册连接在通道生命周期内保持打开: 任一端关闭即视为断开，不需要轮询注册表；
+//  通道没有名字，最后一个 fd 与映射释放后由内核回收。
+// ============================================================
+
+// 默认路径: /tmp/kernel_scheduler_<user>.chan
+std::string defaultMemfdSocketPath();
+
+// 发送一条消息，fd >= 0 时通过 SCM_RIGHTS 附带
+bool sendMessage(int sock, const std::string& msg, int fd = -1);
+
+// 接收一条消息 (最长 maxLen)；fd 非空时接收附带的 fd (没有则为 -1)
+bool recvMessage(int sock, std::string& msg, int* fd = nullptr, size_t maxLen = 512);
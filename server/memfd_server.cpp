@@ -0,0 +1,231 @@
+#include "memfd_server.h"
+#include "memfd_proto.h"
+#include "shm_core.h"
+#include "spsc_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+uint32_t floorPow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p <= v / 2) p <<= 1;
+    return p;
+}
+
+std::vector<std::string> splitFields(const std::string& s) {
+    std::vector<std::string> out;
+    std::istringstream in(s);
+    std::string field;
+    while (std::getline(in, field, '|')) out.push_back(field);
+    return out;
+}
+
+} // namespace
+
+MemfdServer::MemfdServer(bool hugePages, int flags)
+    : useHugePages(hugePages), segmentFlags(flags), maxSlotCount(MAX_SLOT_COUNT), maxSlotSize(MAX_SLOT_SIZE),
+      socketPath(defaultMemfdSocketPath()), listenFd(-1), epollFd(-1), wakeFd(-1), running(false) {}
+
+MemfdServer::~MemfdServer() {
+    stop();
+    for (auto& conn : connections) close(conn.first);
+    connections.clear();
+    if (listenFd != -1) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (epollFd != -1) close(epollFd);
+    if (wakeFd != -1) close(wakeFd);
+}
+
+void MemfdServer::setChannelLimits(uint32_t slotCount, uint32_t slotSize) {
+    maxSlotCount = std::max(MIN_SLOT_COUNT, std::min(slotCount, MAX_SLOT_COUNT));
+    maxSlotSize = std::max(MIN_SLOT_SIZE, std::min(slotSize, MAX_SLOT_SIZE));
+}
+
+bool MemfdServer::init() {
+    struct sockaddr_un addr;
+    if (socketPath.size() >= sizeof(addr.sun_path)) return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd == -1) {
+        perror("[MemfdServer] socket");
+        return false;
+    }
+    unlink(socketPath.c_str());
+    // 只允许同一用户注册，不再需要 0666 的共享内存对象
+    mode_t old = umask(0077);
+    bool ok = bind(listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 && listen(listenFd, 64) == 0;
+    umask(old);
+    if (!ok) {
+        perror("[MemfdServer] bind");
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    std::cout << "[MemfdServer] Listening on " << socketPath << std::endl;
+    return true;
+}
+
+void MemfdServer::start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) {
+    callback = onNewClient;
+    running.store(true);
+    loopThread = std::thread(&MemfdServer::eventLoop, this);
+}
+
+void MemfdServer::stop() {
+    running.store(false);
+    if (wakeFd != -1) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+    if (loopThread.joinable()) loopThread.join();
+    // 结束所有会话
+    std::lock_guard<std::mutex> lock(connMutex);
+    for (auto& conn : connections) {
+        if (conn.second) conn.second->store(true, std::memory_order_relaxed);
+    }
+}
+
+void MemfdServer::eventLoop() {
+    struct epoll_event events[32];
+    while (running.load()) {
+        int n = epoll_wait(epollFd, events, 32, -1);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) continue;
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            bool registered;
+            {
+                std::lock_guard<std::mutex> lock(connMutex);
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                registered = static_cast<bool>(it->second);
+            }
+            // 已注册的连接上任何事件都意味着客户端关闭 (或违反协议)
+            if (registered || (events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR))) {
+                dropConnection(fd);
+            } else {
+                registerClient(fd);
+            }
+        }
+    }
+}
+
+void MemfdServer::acceptClients() {
+    int conn;
+    while ((conn = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        {
+            std::lock_guard<std::mutex> lock(connMutex);
+            connections[conn] = nullptr;
+        }
+        struct epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = conn;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, conn, &ev);
+    }
+}
+
+void MemfdServer::registerClient(int conn) {
+    std::string msg;
+    if (!recvMessage(conn, msg)) {
+        dropConnection(conn);
+        return;
+    }
+    struct ucred cred;
+    socklen_t credLen = sizeof(cred);
+    std::vector<std::string> f = splitFields(msg);
+    std::string error;
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &credLen) != 0) {
+        error = "no peer credentials";
+    } else if (f.size() != 5 || f[0] != "REG" || (f[1] != "sglang" && f[1] != "pytorch") || f[2].empty()) {
+        error = "malformed registration";
+    }
+
+    // 在上限内收紧客户端请求的几何
+    uint32_t slotCount = 0, slotSize = 0;
+    if (error.empty()) {
+        slotCount = floorPow2(std::min(std::max(static_cast<uint32_t>(strtoul(f[3].c_str(), nullptr, 10)),
+                                                MIN_SLOT_COUNT), maxSlotCount.load()));
+        slotSize = std::min(std::max(static_cast<uint32_t>(strtoul(f[4].c_str(), nullptr, 10)), MIN_SLOT_SIZE),
+                            maxSlotSize.load());
+        if (!validGeometry(slotCount, slotSize, maxSlotCount, maxSlotSize)) error = "invalid geometry";
+    }
+
+    std::string name = error.empty() ? f[1] + "_" + f[2] + "_" + std::to_string(cred.pid) : std::string();
+    ShmSegment seg;
+    int memfd = -1;
+    if (error.empty() &&
+        !createMemfdSegment("ks_" + name, channelBytes(slotCount, slotSize), useHugePages, seg, segmentFlags, memfd)) {
+        error = "memfd allocation failed";
+    }
+    if (!error.empty()) {
+        std::cerr << "[MemfdServer] Rejected registration: " << error << std::endl;
+        sendMessage(conn, "ERR|" + error);
+        dropConnection(conn);
+        return;
+    }
+
+    ChannelView view;
+    formatChannel(seg.addr, slotCount, slotSize, view);
+    bool sent = sendMessage(conn, "OK|" + std::to_string(slotCount) + "|" + std::to_string(slotSize), memfd);
+    close(memfd);
+    if (!sent) {
+        unmapSegment(seg);
+        dropConnection(conn);
+        return;
+    }
+
+    std::shared_ptr<std::atomic<bool>> revoked(new std::atomic<bool>(false));
+    {
+        std::lock_guard<std::mutex> lock(connMutex);
+        connections[conn] = revoked;
+    }
+    std::cout << "[MemfdServer] Attached memfd:" << name << " (uid " << cred.uid << "): " << slotCount << "x"
+              << slotSize << " slots, " << seg.length / 1024 << " KiB"
+              << (seg.hugePages ? ", huge pages" : "") << (seg.locked ? ", locked" : "") << std::endl;
+
+    auto channel = std::unique_ptr<IChannel>(new ShmChannel(
+        seg, view, "memfd:" + name, f[1], f[2], static_cast<pid_t>(cred.pid), revoked));
+    if (callback) callback(std::move(channel));
+}
+
+void MemfdServer::dropConnection(int conn) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn, nullptr);
+    close(conn);
+    std::lock_guard<std::mutex> lock(connMutex);
+    auto it = connections.find(conn);
+    if (it == connections.end()) return;
+    if (it->second) it->second->store(true, std::memory_order_relaxed);
+    connections.erase(it);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ipc.h"
+#include "config.h"
+#include "shm_segment.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+/**
+ * @brief memfd 通道的注册服务 (协议见 memfd_proto.h)
+ * 与 ShmServer 并行运行，产生的通道同样是 ShmChannel，调度器不区分来源。
+ * 客户端连接即唤醒 (epoll)，调度器创建并预取通道后把 memfd 交给客户端；
+ * 客户端身份取自 SO_PEERCRED，注册连接断开时撤销通道。
+ */
+class MemfdServer : public IIPCServer {
+public:
+    explicit MemfdServer(bool hugePages = false, int segmentFlags = SEG_PIN);
+    ~MemfdServer();
+
+    // 在 init 之前调用
+    void setSocketPath(const std::string& path) { socketPath = path; }
+    void setChannelLimits(uint32_t maxSlotCount, uint32_t maxSlotSize);
+
+    bool init() override;
+    void start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) override;
+    void stop() override;
+
+private:
+    void eventLoop();
+    void acceptClients();
+    void registerClient(int conn);
+    void dropConnection(int conn);
+
+    bool useHugePages;
+    int segmentFlags;
+    std::atomic<uint32_t> maxSlotCount;
+    std::atomic<uint32_t> maxSlotSize;
+    std::string socketPath;
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> running;
+    std::thread loopThread;
+    std::function<void(std::unique_ptr<IChannel>)> callback;
+
+    // 注册连接 fd -> 通道撤销标志 (尚未注册完成时为空)
+    std::mutex connMutex;
+    std::unordered_map<int, std::shared_ptr<std::atomic<bool>>> connections;
+};
@@ -0,0 +1,99 @@
+#!/bin/bash
+# PGO 训练与前后对比 (由 Makefile 的 pgo-train / pgo-compare 调用)
+#   ./pgo.sh train   <scheduler-instr> [ipc_bench 参数...]
+#   ./pgo.sh compare <baseline> <optimized> [ipc_bench 参数...]
+
+set -e
+
+SERVER_DIR=$(cd "$(dirname "$0")" && pwd)
+BENCH=${BENCH:-$SERVER_DIR/../benchmark/test-ipc/ipc_bench}
+REPS=${PGO_COMPARE_REPS:-3}
+
+# 使用独立的注册表名，避免与正在运行的调度器互相干扰
+export USER="${USER:-nouser}_pgo"
+REGISTRY="/dev/shm/kernel_scheduler_registry_${USER}"
+
+SCHED_PID=""
+WORK_DIR=""
+
+start_scheduler() {
+    local bin
+    bin=$(realpath "$1")
+    WORK_DIR=$(mktemp -d)
+    (cd "$WORK_DIR" && exec "$bin" > "$WORK_DIR/scheduler.log" 2>&1) &
+    SCHED_PID=$!
+    for _ in $(seq 1 100); do
+        [ -e "$REGISTRY" ] && return 0
+        sleep 0.05
+    done
+    echo "[PGO] scheduler failed to start: $bin" >&2
+    cat "$WORK_DIR/scheduler.log" >&2
+    return 1
+}
+
+stop_scheduler() {
+    if [ -n "$SCHED_PID" ]; then
+        kill -INT "$SCHED_PID" 2>/dev/null || true
+        wait "$SCHED_PID" 2>/dev/null || true
+        SCHED_PID=""
+    fi
+    [ -n "$WORK_DIR" ] && rm -rf "$WORK_DIR"
+    WORK_DIR=""
+}
+trap stop_scheduler EXIT
+
+cmd_train() {
+    local bin=$1; shift
+    echo "[PGO] Training $bin with: $*"
+    start_scheduler "$bin"
+    # 多客户端的 sglang 流 + 单客户端的 pytorch 流，覆盖并发与会话建立/销毁路径
+    "$BENCH" --label train "$@"
+    "$BENCH" --label train-pytorch --type pytorch --clients 1 --kernels 2000 --warmup 0
+    stop_scheduler
+    echo "[PGO] Profile written next to objects (*.gcda)"
+}
+
+cmd_compare() {
+    local base=$1 opt=$2; shift 2
+    local results=()
+    for ((r = 1; r <= REPS; r++)); do
+        for variant in base pgo; do
+            local bin=$base
+            [ "$variant" = pgo ] && bin=$opt
+            start_scheduler "$bin"
+            local line
+            line=$("$BENCH" --label "$variant" "$@" | grep '^RESULT')
+            stop_scheduler
+            echo "  [$variant rep $r] $line"
+            results+=("$line")
+        done
+    done
+
+    printf '%s\n' "${results[@]}" | awk -v reps="$REPS" '
+        {
+            for (i = 2; i <= NF; i++) { split($i, kv, "="); f[kv[1]] = kv[2] }
+            v = f["label"]; n[v]++
+            tp[v] += f["throughput"]; mean[v] += f["mean_us"]; p50[v] += f["p50_us"]; p99[v] += f["p99_us"]
+        }
+        END {
+            printf "\n%-8s %14s %12s %12s %12s\n", "variant", "kernels/s", "mean_us", "p50_us", "p99_us"
+            split("base pgo", order, " ")
+            for (k = 1; k <= 2; k++) {
+                v = order[k]
+                printf "%-8s %14.0f %12.3f %12.3f %12.3f\n", v, tp[v] / n[v], mean[v] / n[v], p50[v] / n[v], p99[v] / n[v]
+            }
+            printf "\nPGO+LTO vs baseline: p50 %+.2f%%, p99 %+.2f%%, throughput %+.2f%% (mean of %d runs)\n",
+                (p50["pgo"] - p50["base"]) / p50["base"] * 100,
+                (p99["pgo"] - p99["base"]) / p99["base"] * 100,
+                (tp["pgo"] - tp["base"]) / tp["base"] * 100, reps
+        }'
+}
+
+case "$1" in
+    train)   shift; cmd_train "$@" ;;
+    compare) shift; cmd_compare "$@" ;;
+    *)
+        echo "Usage: $0 train <scheduler-instr> [bench args] | compare <baseline> <optimized> [bench args]" >&2
+        exit 1
+        ;;
+esac
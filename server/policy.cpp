@@ -0,0 +1,235 @@
+#include "policy.h"
+
+#include "backfill.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+// ======================= DefaultPolicy =======================
+
+PolicyDecision DefaultPolicy::decide(const PolicyRequest& req, int64_t nowNs) {
+    // 核心调度算法
+    return {true, "OK"};
+}
+
+// ======================= KernelCost =======================
+
+std::string kernelFamily(const std::string& kernelType) {
+    size_t end = kernelType.find_first_of("<(");
+    if (end == std::string::npos) end = kernelType.size();
+    size_t begin = kernelType.rfind(' ', end == 0 ? 0 : end - 1);
+    begin = (begin == std::string::npos) ? 0 : begin + 1;
+    return begin < end ? kernelType.substr(begin, end - begin) : kernelType;
+}
+
+std::string formatKernelCost(const KernelCost& cost) {
+    std::ostringstream ss;
+    ss.precision(17);
+    ss << "count=" << cost.count << ",mean=" << cost.meanNs << ",stddev=" << cost.stddevNs
+       << ",interference=" << cost.interference << ",frequency=" << cost.frequency;
+    return ss.str();
+}
+
+KernelCost parseKernelCost(const std::string& text) {
+    KernelCost cost;
+    std::istringstream fields(text);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        size_t eq = field.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = field.substr(0, eq);
+        const char* value = field.c_str() + eq + 1;
+        if (key == "count") cost.count = strtoull(value, nullptr, 10);
+        else if (key == "mean") cost.meanNs = strtod(value, nullptr);
+        else if (key == "stddev") cost.stddevNs = strtod(value, nullptr);
+        else if (key == "interference") cost.interference = strtod(value, nullptr);
+        else if (key == "frequency") cost.frequency = strtod(value, nullptr);
+    }
+    return cost;
+}
+
+// ======================= LaunchMeta =======================
+
+namespace {
+
+// 值拷到栈上的缓冲区再转换: 消息里的字段不以 NUL 结尾，strto* 可能越过字段末尾
+bool copyValue(const char* begin, const char* end, char (&buf)[32]) {
+    size_t len = static_cast<size_t>(end - begin);
+    if (len == 0 || len >= sizeof(buf)) return false;
+    std::memcpy(buf, begin, len);
+    buf[len] = '\0';
+    return true;
+}
+
+bool parseUnsigned(const char* begin, const char* end, uint64_t limit, uint64_t& out) {
+    char buf[32];
+    if (!copyValue(begin, end, buf) || buf[0] < '0' || buf[0] > '9') return false;
+    char* stop = nullptr;
+    unsigned long long v = strtoull(buf, &stop, 10);
+    if (*stop || v > limit) return false;
+    out = v;
+    return true;
+}
+
+bool parseEstimate(const char* begin, const char* end, double& out) {
+    char buf[32];
+    if (!copyValue(begin, end, buf)) return false;
+    char* stop = nullptr;
+    double v = strtod(buf, &stop);
+    if (*stop || !(v >= 0) || v > 1e300) return false;
+    out = v;
+    return true;
+}
+
+// "4096x8x1"，省略的维度为 1
+bool parseDims(const char* begin, const char* end, uint32_t (&dims)[3]) {
+    uint32_t parsed[3] = {1, 1, 1};
+    for (int i = 0; i < 3; i++) {
+        const char* sep = static_cast<const char*>(memchr(begin, 'x', static_cast<size_t>(end - begin)));
+        const char* stop = sep ? sep : end;
+        uint64_t v;
+        if (!parseUnsigned(begin, stop, 0xffffffffull, v) || v == 0) return false;
+        parsed[i] = static_cast<uint32_t>(v);
+        if (!sep) {
+            std::memcpy(dims, parsed, sizeof(parsed));
+            return true;
+        }
+        begin = sep + 1;
+    }
+    return false;
+}
+
+bool keyIs(const char* begin, const char* end, const char* key) {
+    size_t len = strlen(key);
+    return static_cast<size_t>(end - begin) == len && std::memcmp(begin, key, len) == 0;
+}
+
+} // namespace
+
+bool parseLaunchMeta(const char* begin, const char* end, LaunchMeta& out) {
+    out = LaunchMeta();
+    while (begin < end) {
+        const char* comma = static_cast<const char*>(memchr(begin, ',', static_cast<size_t>(end - begin)));
+        const char* fieldEnd = comma ? comma : end;
+        const char* eq = static_cast<const char*>(memchr(begin, '=', static_cast<size_t>(fieldEnd - begin)));
+        if (fieldEnd == begin) {
+            begin = fieldEnd + 1;
+            continue;
+        }
+        if (!eq) {
+            out = LaunchMeta();
+            return false;
+        }
+        const char* value = eq + 1;
+        uint64_t v = 0;
+        bool ok = true;
+        if (keyIs(begin, eq, "grid")) {
+            ok = parseDims(value, fieldEnd, out.grid);
+            out.fields |= LaunchMeta::Grid;
+        } else if (keyIs(begin, eq, "block")) {
+            ok = parseDims(value, fieldEnd, out.block);
+            out.fields |= LaunchMeta::Block;
+        } else if (keyIs(begin, eq, "smem")) {
+            ok = parseUnsigned(value, fieldEnd, 0xffffffffull, v);
+            out.sharedBytes = static_cast<uint32_t>(v);
+            out.fields |= LaunchMeta::SharedMem;
+        } else if (keyIs(begin, eq, "stream")) {
+            ok = parseUnsigned(value, fieldEnd, ~0ull, v);
+            out.stream = v;
+            out.fields |= LaunchMeta::Stream;
+        } else if (keyIs(begin, eq, "tokens")) {
+            ok = parseUnsigned(value, fieldEnd, 0xffffffffull, v);
+            out.tokens = static_cast<uint32_t>(v);
+            out.fields |= LaunchMeta::Tokens;
+        } else if (keyIs(begin, eq, "flops")) {
+            ok = parseEstimate(value, fieldEnd, out.flops);
+            out.fields |= LaunchMeta::Flops;
+        } else if (keyIs(begin, eq, "bytes")) {
+            ok = parseEstimate(value, fieldEnd, out.bytes);
+            out.fields |= LaunchMeta::Bytes;
+        }
+        if (!ok) {
+            out = LaunchMeta();
+            return false;
+        }
+        begin = fieldEnd + 1;
+    }
+    return true;
+}
+
+std::string formatLaunchMeta(const LaunchMeta& launch) {
+    std::string out;
+    formatLaunchMeta(launch, out);
+    return out;
+}
+
+void formatLaunchMeta(const LaunchMeta& launch, std::string& out) {
+    char buf[256];
+    size_t len = 0;
+    // 字段全部给出时不超过 210 字节
+    if (launch.has(LaunchMeta::Grid)) {
+        len += snprintf(buf + len, sizeof(buf) - len, ",grid=%ux%ux%u", launch.grid[0], launch.grid[1], launch.grid[2]);
+    }
+    if (launch.has(LaunchMeta::Block)) {
+        len += snprintf(buf + len, sizeof(buf) - len, ",block=%ux%ux%u", launch.block[0], launch.block[1],
+                        launch.block[2]);
+    }
+    if (launch.has(LaunchMeta::SharedMem)) len += snprintf(buf + len, sizeof(buf) - len, ",smem=%u", launch.sharedBytes);
+    if (launch.has(LaunchMeta::Stream)) {
+        len += snprintf(buf + len, sizeof(buf) - len, ",stream=%llu", static_cast<unsigned long long>(launch.stream));
+    }
+    if (launch.has(LaunchMeta::Tokens)) len += snprintf(buf + len, sizeof(buf) - len, ",tokens=%u", launch.tokens);
+    // %.17g 保证往返不失真 (录制回放需要逐位相同的输入)
+    if (launch.has(LaunchMeta::Flops)) len += snprintf(buf + len, sizeof(buf) - len, ",flops=%.17g", launch.flops);
+    if (launch.has(LaunchMeta::Bytes)) len += snprintf(buf + len, sizeof(buf) - len, ",bytes=%.17g", launch.bytes);
+    if (len) out.assign(buf + 1, len - 1);
+    else out.clear();
+}
+
+// ======================= ClientControl =======================
+
+std::string formatControl(const ClientControl& control) {
+    std::ostringstream ss;
+    ss << "weight=" << control.weight << ",priority=" << control.priority << ",quota=" << control.quota
+       << ",paused=" << (control.paused ? 1 : 0);
+    return ss.str();
+}
+
+bool parseControlField(const std::string& field, ClientControl& control) {
+    size_t eq = field.find('=');
+    if (eq == std::string::npos || eq + 1 == field.size()) return false;
+    std::string key = field.substr(0, eq);
+    const char* value = field.c_str() + eq + 1;
+    char* end = nullptr;
+    if (key == "weight") {
+        double w = strtod(value, &end);
+        if (*end || !(w > 0)) return false;
+        control.weight = w;
+    } else if (key == "priority") {
+        long p = strtol(value, &end, 10);
+        if (*end) return false;
+        control.priority = static_cast<int>(p);
+    } else if (key == "quota") {
+        long long q = strtoll(value, &end, 10);
+        if (*end || q < 0 || q > 0xffffffffll) return false;
+        control.quota = static_cast<uint32_t>(q);
+    } else if (key == "paused") {
+        long v = strtol(value, &end, 10);
+        if (*end) return false;
+        control.paused = v != 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ======================= Factory =======================
+
+std::unique_ptr<IPolicy> createPolicy(const std::string& name) {
+    if (name == "default") return std::unique_ptr<IPolicy>(new DefaultPolicy());
+    if (name == "serialize") return std::unique_ptr<IPolicy>(new BackfillPolicy(false));
+    if (name == "backfill") return std::unique_ptr<IPolicy>(new BackfillPolicy(true));
+    return nullptr;
+}
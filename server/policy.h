@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// ============================================================
+//  调度策略接口
+//  Scheduler 在同一把锁下串行调用策略的全部入口，因此策略实现无需自行加锁。
+//  策略的所有输入都通过参数传入 (包括 nowNs)，不得读取真实时钟或随机源，
+//  这样录制的输入序列在回放时能得到完全相同的决策。
+// ============================================================
+
+/**
+ * @brief kernel 启动参数 (可选，客户端附在请求或遥测消息的末尾字段，格式见 config.h)
+ * 只有 fields 中置位的字段有效；token 数与 FLOP/字节数是客户端的估计。
+ */
+struct LaunchMeta {
+    enum Field : uint32_t {
+        Grid = 1 << 0,
+        Block = 1 << 1,
+        SharedMem = 1 << 2,
+        Stream = 1 << 3,
+        Tokens = 1 << 4,
+        Flops = 1 << 5,
+        Bytes = 1 << 6,
+    };
+
+    uint32_t fields = 0;
+    uint32_t grid[3] = {1, 1, 1};
+    uint32_t block[3] = {1, 1, 1};
+    uint32_t sharedBytes = 0;     // 动态共享内存
+    uint32_t tokens = 0;          // 本次 batch 的 token 数
+    uint64_t stream = 0;
+    double flops = 0;
+    double bytes = 0;
+
+    bool has(Field f) const { return (fields & f) != 0; }
+    bool empty() const { return fields == 0; }
+    uint64_t blocks() const { return static_cast<uint64_t>(grid[0]) * grid[1] * grid[2]; }
+    uint64_t threadsPerBlock() const { return static_cast<uint64_t>(block[0]) * block[1] * block[2]; }
+};
+
+struct PolicyRequest {
+    std::string clientKey;    // "<type>:<uniqueId>"
+    std::string kernelType;
+    std::string reqId;
+    LaunchMeta launch;
+    int64_t predictedNs;      // 调度器按启动参数预测的耗时 (见 predictor.h)，0 表示还没有依据
+};
+
+struct PolicyDecision {
+    bool allow;
+    std::string reason;
+    int64_t holdNs;           // 先扣住这么久再回复 (客户端的 kernel 随之等待)；聚合初始化省略时为 0
+};
+
+/**
+ * @brief 运维通过控制套接字为单个客户端设置的参数
+ * 暂停与配额由 Scheduler 在会话线程里执行；权重与优先级交给策略解释，
+ * 当前策略不解释的字段 (IPolicy::honoursControl) 在设置时被拒绝。
+ */
+struct ClientControl {
+    double weight = 1.0;
+    int priority = 0;
+    uint32_t quota = 0;       // kernel/s，0 表示不限
+    bool paused = false;
+
+    bool isDefault() const { return weight == 1.0 && priority == 0 && quota == 0 && !paused; }
+};
+
+/**
+ * @brief 某个模型上一类 kernel 的历史代价 (来自代价模型存储，见 cost_store.h)
+ */
+struct KernelCost {
+    uint64_t count = 0;
+    double meanNs = 0;
+    double stddevNs = 0;
+    double interference = 1.0;    // 与其他会话并发时的平均耗时 / 独占时的平均耗时
+    double frequency = 0;         // 占该模型 kernel 样本的比例
+};
+
+// kernel 族: 去掉返回类型与模板/参数列表，"void ns::Foo<8u, bf16>" -> "ns::Foo"
+std::string kernelFamily(const std::string& kernelType);
+
+// "count=..,mean=..,stddev=..,interference=..,frequency=.."，用于录制
+std::string formatKernelCost(const KernelCost& cost);
+KernelCost parseKernelCost(const std::string& text);
+
+// 解析 "grid=4096x1x1,block=128,smem=49152,stream=7,tokens=4096,flops=1.2e12,bytes=3.4e9"，
+// 字段均可省略，维度可只给前几维，未知键忽略 (便于客户端先行增加字段)。
+// 在 [begin, end) 上原地解析，不分配内存；格式错误时返回 false，out 为空
+bool parseLaunchMeta(const char* begin, const char* end, LaunchMeta& out);
+// 只输出已提供的字段，与 parseLaunchMeta 互逆；用于录制、日志与客户端拼装消息
+std::string formatLaunchMeta(const LaunchMeta& launch);
+// 写入 out (覆盖原内容)，复用其容量，热路径上不分配内存
+void formatLaunchMeta(const LaunchMeta& launch, std::string& out);
+
+// "weight=1.5,priority=2,quota=100,paused=0"，用于录制与控制命令回显
+std::string formatControl(const ClientControl& control);
+
+// 解析一个 "key=value" 字段并写入 control，未知键或非法值返回 false
+bool parseControlField(const std::string& field, ClientControl& control);
+
+class IPolicy {
+public:
+    virtual ~IPolicy() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual void onClientAttach(const std::string& clientKey, const std::string& clientType, int64_t nowNs) = 0;
+    virtual void onClientDetach(const std::string& clientKey, int64_t nowNs) = 0;
+
+    // 对一条 kernel 请求做出决策
+    virtual PolicyDecision decide(const PolicyRequest& req, int64_t nowNs) = 0;
+
+    // 客户端上报的 kernel 执行耗时；launch 为该 kernel 的启动参数 (未提供时为空)
+    virtual void onTelemetry(const std::string& clientKey, const std::string& kernelType, const LaunchMeta& launch,
+                             int64_t durationNs, int64_t nowNs) = 0;
+
+    // 周期定时器
+    virtual void onTick(int64_t nowNs) = 0;
+
+    // 客户端控制参数变更 (运维命令，或带着已有参数重新接入)
+    virtual void onClientControl(const std::string& clientKey, const ClientControl& control, int64_t nowNs) = 0;
+    // 策略是否解释控制字段 "weight" / "priority"
+    virtual bool honoursControl(const std::string&) const { return false; }
+
+    // 客户端接入 (或声明模型) 时，逐个 kernel 族给出该模型的历史代价，作为冷启动的先验
+    virtual void onKernelPrior(const std::string& clientKey, const std::string& family, const KernelCost& cost,
+                               int64_t nowNs) = 0;
+
+    // 序列化/恢复内部状态，用于录制检查点
+    virtual void saveState(std::string& out) const = 0;
+    virtual bool loadState(const std::string& in) = 0;
+
+    // 策略自身的状态表 (ksctl policy)，没有时为空
+    virtual std::string describe() const { return std::string(); }
+};
+
+/**
+ * @brief 默认策略: 放行所有 kernel
+ */
+class DefaultPolicy : public IPolicy {
+public:
+    const char* name() const override { return "default"; }
+
+    void onClientAttach(const std::string&, const std::string&, int64_t) override {}
+    void onClientDetach(const std::string&, int64_t) override {}
+    PolicyDecision decide(const PolicyRequest& req, int64_t nowNs) override;
+    void onTelemetry(const std::string&, const std::string&, const LaunchMeta&, int64_t, int64_t) override {}
+    void onTick(int64_t) override {}
+    void onClientControl(const std::string&, const ClientControl&, int64_t) override {}
+    void onKernelPrior(const std::string&, const std::string&, const KernelCost&, int64_t) override {}
+    void saveState(std::string& out) const override { out.clear(); }
+    bool loadState(const std::string&) override { return true; }
+};
+
+// 按名称创建策略，未知名称返回 nullptr
+std::unique_ptr<IPolicy> createPolicy(const std::string& name);
@@ -0,0 +1,189 @@
+#include "predictor.h"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+int bucketOf(double size) {
+    if (size < 2) return 0;
+    uint64_t x = size >= 9.2e18 ? ~0ull : static_cast<uint64_t>(size);
+    int b = 63 - __builtin_clzll(x);
+    return b < PREDICTOR_BUCKETS ? b : PREDICTOR_BUCKETS - 1;
+}
+
+struct Point {
+    double x = 0, y = 0;
+    bool valid = false;
+};
+
+} // namespace
+
+double launchSize(const LaunchMeta& launch) {
+    if (launch.has(LaunchMeta::Tokens) && launch.tokens > 0) return launch.tokens;
+    if (launch.has(LaunchMeta::Grid)) return static_cast<double>(launch.blocks());
+    return 0;
+}
+
+LatencyPredictor::LatencyPredictor() {}
+
+LatencyPredictor::~LatencyPredictor() {}
+
+LatencyPredictor::Family* LatencyPredictor::lookup(const std::string& model, const std::string& kernelType,
+                                                   bool create) {
+    auto m = cache_.find(model);
+    if (m != cache_.end()) {
+        auto k = m->second.find(kernelType);
+        if (k != m->second.end() && (k->second || !create)) return k->second;
+    }
+    std::pair<std::string, std::string> key(model, kernelFamily(kernelType));
+    auto it = families_.find(key);
+    Family* f = nullptr;
+    if (it != families_.end()) {
+        f = it->second.get();
+    } else if (create) {
+        std::unique_ptr<Family> next(new Family());
+        next->model = key.first;
+        next->family = key.second;
+        f = next.get();
+        families_.emplace(key, std::move(next));
+        // 之前查不到而缓存为空的同模型 kernel 名可能属于这个新族
+        auto& byKernel = cache_[model];
+        for (auto e = byKernel.begin(); e != byKernel.end();) {
+            if (!e->second) e = byKernel.erase(e);
+            else ++e;
+        }
+    }
+    // 查不到的也缓存 (空指针)，没有遥测的客户端不必每次重新归一化
+    cache_[model][kernelType] = f;
+    return f;
+}
+
+double LatencyPredictor::estimate(const Family& f, double size) {
+    const Bucket& all = f.overall;
+    double fallback = all.w > 0 ? all.sy / all.w : 0;
+    if (size <= 0) return fallback;
+
+    int k = bucketOf(size);
+    const Bucket& b = f.buckets[k];
+    if (b.w >= PREDICTOR_MIN_FIT_WEIGHT) {
+        double mx = b.sx / b.w, my = b.sy / b.w;
+        double var = b.sxx / b.w - mx * mx;
+        // 规模的标准差不到均值的 5% 时斜率不可信
+        if (var > 0.0025 * mx * mx) {
+            double y = my + (b.sxy / b.w - mx * my) / var * (size - mx);
+            if (y > 0) return y;
+        }
+    }
+
+    // 各桶的均值点构成分段线性函数: 左侧取不大于 size 的最近两点，右侧取大于 size 的最近两点
+    Point left[2], right[2];
+    for (int i = k, n = 0; i >= 0 && n < 2; i--) {
+        const Bucket& c = f.buckets[i];
+        if (c.w <= 0 || c.sx / c.w > size) continue;
+        left[n].x = c.sx / c.w;
+        left[n].y = c.sy / c.w;
+        left[n++].valid = true;
+    }
+    for (int i = k, n = 0; i < PREDICTOR_BUCKETS && n < 2; i++) {
+        const Bucket& c = f.buckets[i];
+        if (c.w <= 0 || c.sx / c.w <= size) continue;
+        right[n].x = c.sx / c.w;
+        right[n].y = c.sy / c.w;
+        right[n++].valid = true;
+    }
+    if (left[0].valid && right[0].valid) {
+        double t = (size - left[0].x) / (right[0].x - left[0].x);
+        return left[0].y + t * (right[0].y - left[0].y);
+    }
+    const Point* near = left[0].valid ? left : right;
+    if (!near[0].valid) return fallback;
+    if (!near[1].valid) return near[0].y;
+    // 外推: 耗时不随规模减小，斜率为负时按最近点取常数
+    double slope = (near[0].y - near[1].y) / (near[0].x - near[1].x);
+    if (slope <= 0) return near[0].y;
+    double y = near[0].y + slope * (size - near[0].x);
+    // 向小规模外推到负值时改为按比例缩放
+    return y > 0 ? y : near[0].y * size / near[0].x;
+}
+
+int64_t LatencyPredictor::predict(const std::string& model, const std::string& kernelType, const LaunchMeta& launch) {
+    Family* f = lookup(model, kernelType, false);
+    if (!f || f->samples == 0) return 0;
+    return static_cast<int64_t>(std::llround(estimate(*f, launchSize(launch))));
+}
+
+void LatencyPredictor::update(const std::string& model, const std::string& kernelType, const LaunchMeta& launch,
+                              int64_t durationNs) {
+    if (durationNs <= 0) return;
+    Family* f = lookup(model, kernelType, true);
+    double size = launchSize(launch);
+    double y = static_cast<double>(durationNs);
+    if (f->samples > 0) {
+        double p = estimate(*f, size);
+        if (p > 0) {
+            double error = std::fabs(p - y) / y;
+            f->errorSum += error;
+            f->biasSum += (p - y) / y;
+            f->recentError = f->predicted ? f->recentError + PREDICTOR_RECENT_ALPHA * (error - f->recentError) : error;
+            f->predicted++;
+        }
+    }
+    f->samples++;
+
+    auto add = [size, y](Bucket& b) {
+        b.w = b.w * PREDICTOR_DECAY + 1;
+        b.sx = b.sx * PREDICTOR_DECAY + size;
+        b.sy = b.sy * PREDICTOR_DECAY + y;
+        b.sxx = b.sxx * PREDICTOR_DECAY + size * size;
+        b.sxy = b.sxy * PREDICTOR_DECAY + size * y;
+    };
+    add(f->overall);
+    if (size > 0) add(f->buckets[bucketOf(size)]);
+}
+
+std::vector<PredictorError> LatencyPredictor::errors() const {
+    std::vector<PredictorError> out;
+    out.reserve(families_.size());
+    for (const auto& entry : families_) {
+        const Family& f = *entry.second;
+        PredictorError e;
+        e.model = f.model;
+        e.family = f.family;
+        e.samples = f.samples;
+        e.predicted = f.predicted;
+        for (const Bucket& b : f.buckets) {
+            if (b.w > 0) e.buckets++;
+        }
+        if (f.predicted) {
+            e.meanError = f.errorSum / f.predicted;
+            e.bias = f.biasSum / f.predicted;
+            e.recentError = f.recentError;
+        }
+        out.push_back(e);
+    }
+    return out;
+}
+
+std::string LatencyPredictor::describe() const {
+    std::ostringstream ss;
+    ss << std::left << std::setw(16) << "MODEL" << std::right << std::setw(10) << "SAMPLES" << std::setw(9) << "BUCKETS"
+       << std::setw(9) << "ERR%" << std::setw(9) << "RECENT%" << std::setw(9) << "BIAS%" << "  FAMILY\n";
+    for (const PredictorError& e : errors()) {
+        ss << std::left << std::setw(16) << e.model << std::right << std::setw(10) << e.samples << std::setw(9)
+           << e.buckets << std::fixed << std::setprecision(1) << std::setw(9) << e.meanError * 100 << std::setw(9)
+           << e.recentError * 100 << std::setw(9) << e.bias * 100 << "  " << e.family << "\n";
+    }
+    return ss.str();
+}
+
+double LatencyPredictor::recentError() const {
+    double sum = 0, weight = 0;
+    for (const auto& entry : families_) {
+        const Family& f = *entry.second;
+        sum += f.recentError * f.predicted;
+        weight += f.predicted;
+    }
+    return weight > 0 ? sum / weight : 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "policy.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ============================================================
+//  形状感知的 kernel 耗时预测器
+//  每个 (模型, kernel 族) 一个模型，自变量为启动参数给出的规模: token 数，未提供时用 grid 的 block 数。
+//  按 log2(规模) 分桶，每桶在线维护带遗忘的加权最小二乘 (耗时 = a + b * 规模)。
+//  预测时优先用所在桶的直线；桶内规模太集中拟合不出斜率时，在相邻有样本的桶的均值点之间
+//  分段线性插值 (两端之外沿最外侧两点的斜率外推)。没有规模的 kernel 退回族内均值。
+//  每个完成样本在更新之前先做一次预测，按族累计相对误差。
+//  非线程安全，由 Scheduler 在策略锁内调用；对已见过的 kernel 名，预测只做两次哈希查找和一次桶扫描。
+// ============================================================
+
+constexpr int PREDICTOR_BUCKETS = 33;            // log2(规模) 0..32
+constexpr double PREDICTOR_DECAY = 0.995;        // 每个新样本让同桶旧样本的权重乘以该值 (半衰期约 140 个样本)
+constexpr double PREDICTOR_MIN_FIT_WEIGHT = 4;   // 桶内拟合直线所需的最小权重
+constexpr double PREDICTOR_RECENT_ALPHA = 0.05;  // 近期误差的 EWMA 系数
+
+/**
+ * @brief 一个族的预测误差 (相对误差 = |预测 - 实际| / 实际)
+ */
+struct PredictorError {
+    std::string model;
+    std::string family;
+    uint64_t samples = 0;        // 完成样本数
+    uint64_t predicted = 0;      // 其中更新前已有预测的样本数
+    int buckets = 0;             // 有样本的规模桶
+    double meanError = 0;        // 全部已预测样本的平均相对误差
+    double recentError = 0;      // 近期 (EWMA)
+    double bias = 0;             // 平均 (预测 - 实际) / 实际，正值表示高估
+};
+
+class LatencyPredictor {
+public:
+    LatencyPredictor();
+    ~LatencyPredictor();
+
+    LatencyPredictor(const LatencyPredictor&) = delete;
+    LatencyPredictor& operator=(const LatencyPredictor&) = delete;
+
+    // 预测耗时 (ns)；该族还没有样本时返回 0
+    int64_t predict(const std::string& model, const std::string& kernelType, const LaunchMeta& launch);
+
+    // 记录一个完成样本，先按更新前的模型计入误差
+    void update(const std::string& model, const std::string& kernelType, const LaunchMeta& launch,
+                int64_t durationNs);
+
+    // 按 (模型, 族) 排序的误差表
+    std::vector<PredictorError> errors() const;
+    // 表格形式 (ksctl predictor)
+    std::string describe() const;
+
+    size_t families() const { return families_.size(); }
+    // 全部族按已预测样本数加权的近期误差
+    double recentError() const;
+
+private:
+    // 带遗忘的加权和
+    struct Bucket {
+        double w = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    };
+
+    struct Family {
+        std::string model;
+        std::string family;
+        Bucket buckets[PREDICTOR_BUCKETS];
+        Bucket overall;          // 全部样本 (含没有规模的)
+        uint64_t samples = 0;
+        uint64_t predicted = 0;
+        double errorSum = 0;
+        double biasSum = 0;
+        double recentError = 0;
+    };
+
+    Family* lookup(const std::string& model, const std::string& kernelType, bool create);
+    static double estimate(const Family& f, double size);
+
+    std::map<std::pair<std::string, std::string>, std::unique_ptr<Family>> families_;
+    // 模型 -> kernel 名 -> 族，免去热路径上的归一化
+    std::unordered_map<std::string, std::unordered_map<std::string, Family*>> cache_;
+};
+
+// 启动参数中的规模: token 数，其次 grid 的 block 数；都没有时为 0
+double launchSize(const LaunchMeta& launch);
@@ -0,0 +1,362 @@
+#include "recorder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+const char RECORD_MAGIC[8] = {'K', 'S', 'R', 'E', 'C', '0', '0', '1'};
+// 2: 增加 Control 事件; 3: 增加 Prior 事件; 4: 增加 Launch 事件; 5: 增加 Hold 事件;
+// 6: Launch 事件的参数不再驻留为文本，LaunchMeta 原样紧跟在事件之后。仍可读取旧版本
+const uint32_t RECORD_VERSION = 6;
+static_assert(sizeof(LaunchMeta) == 64, "LaunchMeta is written to recordings as is");
+
+bool writeAll(FILE* f, const void* data, size_t len) {
+    return len == 0 || fwrite(data, 1, len, f) == len;
+}
+
+bool writeString(FILE* f, const std::string& s) {
+    uint32_t len = static_cast<uint32_t>(s.size());
+    return writeAll(f, &len, sizeof(len)) && writeAll(f, s.data(), s.size());
+}
+
+bool readAll(FILE* f, void* data, size_t len) {
+    return len == 0 || fread(data, 1, len, f) == len;
+}
+
+bool readString(FILE* f, std::string& s) {
+    uint32_t len;
+    if (!readAll(f, &len, sizeof(len)) || len > (64u << 20)) return false;
+    s.resize(len);
+    return len == 0 || readAll(f, &s[0], len);
+}
+
+} // namespace
+
+// ======================= DecisionRecorder =======================
+
+DecisionRecorder::DecisionRecorder(size_t capacity)
+    : ring_(capacity), launches_(capacity ? capacity / 2 + 1 : 0), launchNext_(0), next_(0),
+      checkpointInterval_(capacity > 4 ? capacity / 4 : 1), active_(true), cpFirst_(0), cpCount_(0) {
+    // 起点仍在缓冲区内的检查点，加上正在被覆盖的一个
+    if (capacity) checkpoints_.resize(capacity / checkpointInterval_ + 2);
+}
+
+void DecisionRecorder::start(const IPolicy& policy) {
+    if (!enabled()) return;
+    cpFirst_ = cpCount_ = 0;
+    policy.saveState(pushCheckpoint().state);
+}
+
+DecisionRecorder::Checkpoint& DecisionRecorder::pushCheckpoint() {
+    if (cpCount_ == checkpoints_.size()) {
+        cpFirst_ = (cpFirst_ + 1) % checkpoints_.size();
+        cpCount_--;
+    }
+    Checkpoint& cp = checkpoints_[(cpFirst_ + cpCount_++) % checkpoints_.size()];
+    cp.seq = next_;
+    return cp;
+}
+
+void DecisionRecorder::setActive(bool active, const IPolicy& policy) {
+    if (active && !active_) {
+        active_ = true;
+        start(policy);
+    } else if (!active) {
+        active_ = false;
+    }
+}
+
+RecordEvent& DecisionRecorder::push(RecordType type, int64_t nowNs) {
+    RecordEvent& ev = ring_[next_ % ring_.size()];
+    std::memset(&ev, 0, sizeof(ev));
+    ev.seq = next_++;
+    ev.tsNs = nowNs;
+    ev.type = type;
+    return ev;
+}
+
+uint32_t DecisionRecorder::intern(const std::string& s) {
+    auto it = stringIds_.find(s);
+    if (it != stringIds_.end()) return it->second;
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(s);
+    stringIds_.emplace(s, id);
+    return id;
+}
+
+void DecisionRecorder::pushLaunch(int64_t nowNs, const std::string& clientKey, const LaunchMeta& launch,
+                                  int64_t predictedNs) {
+    RecordEvent& ev = push(RecordType::Launch, nowNs);
+    ev.arg = predictedNs;
+    ev.client = intern(clientKey);
+    ev.str = static_cast<uint32_t>(launchNext_++ % launches_.size());
+    launches_[ev.str] = launch;
+}
+
+void DecisionRecorder::recordAttach(int64_t nowNs, const std::string& clientKey, const std::string& clientType) {
+    if (!recording()) return;
+    RecordEvent& ev = push(RecordType::Attach, nowNs);
+    ev.client = intern(clientKey);
+    ev.str = intern(clientType);
+}
+
+void DecisionRecorder::recordDetach(int64_t nowNs, const std::string& clientKey) {
+    if (!recording()) return;
+    RecordEvent& ev = push(RecordType::Detach, nowNs);
+    ev.client = intern(clientKey);
+}
+
+void DecisionRecorder::recordRequest(int64_t nowNs, const PolicyRequest& req, const PolicyDecision& decision) {
+    if (!recording()) return;
+    if (!req.launch.empty() || req.predictedNs) pushLaunch(nowNs, req.clientKey, req.launch, req.predictedNs);
+    RecordEvent& ev = push(RecordType::Request, nowNs);
+    ev.arg = strtoll(req.reqId.c_str(), nullptr, 10);
+    ev.client = intern(req.clientKey);
+    ev.str = intern(req.kernelType);
+    ev.reason = intern(decision.reason);
+    ev.allow = decision.allow ? 1 : 0;
+    if (decision.holdNs) {
+        RecordEvent& hold = push(RecordType::Hold, nowNs);
+        hold.arg = decision.holdNs;
+        hold.client = ev.client;
+    }
+}
+
+void DecisionRecorder::recordTelemetry(int64_t nowNs, const std::string& clientKey, const std::string& kernelType,
+                                       const LaunchMeta& launch, int64_t durationNs) {
+    if (!recording()) return;
+    if (!launch.empty()) pushLaunch(nowNs, clientKey, launch, 0);
+    RecordEvent& ev = push(RecordType::Telemetry, nowNs);
+    ev.arg = durationNs;
+    ev.client = intern(clientKey);
+    ev.str = intern(kernelType);
+}
+
+void DecisionRecorder::recordTick(int64_t nowNs) {
+    if (!recording()) return;
+    push(RecordType::Tick, nowNs);
+}
+
+void DecisionRecorder::recordControl(int64_t nowNs, const std::string& clientKey, const ClientControl& control) {
+    if (!recording()) return;
+    RecordEvent& ev = push(RecordType::Control, nowNs);
+    ev.client = intern(clientKey);
+    ev.str = intern(formatControl(control));
+}
+
+void DecisionRecorder::recordPrior(int64_t nowNs, const std::string& clientKey, const std::string& family,
+                                   const KernelCost& cost) {
+    if (!recording()) return;
+    RecordEvent& ev = push(RecordType::Prior, nowNs);
+    ev.client = intern(clientKey);
+    ev.str = intern(family);
+    ev.reason = intern(formatKernelCost(cost));
+}
+
+void DecisionRecorder::maybeCheckpoint(const IPolicy& policy) {
+    if (!recording() || next_ - checkpoint(cpCount_ - 1).seq < checkpointInterval_) return;
+    policy.saveState(pushCheckpoint().state);
+    // 只保留起点仍在环形缓冲区内的检查点
+    uint64_t oldest = next_ > ring_.size() ? next_ - ring_.size() : 0;
+    while (cpCount_ > 1 && checkpoint(0).seq < oldest) {
+        cpFirst_ = (cpFirst_ + 1) % checkpoints_.size();
+        cpCount_--;
+    }
+}
+
+bool DecisionRecorder::dump(const std::string& path, const std::string& policyName, int64_t windowNs) const {
+    if (!enabled()) return false;
+    uint64_t oldest = next_ > ring_.size() ? next_ - ring_.size() : 0;
+
+    // 窗口起点对应的事件序号
+    uint64_t windowSeq = oldest;
+    if (windowNs > 0 && next_ > 0) {
+        int64_t cutoff = ring_[(next_ - 1) % ring_.size()].tsNs - windowNs;
+        while (windowSeq < next_ && ring_[windowSeq % ring_.size()].tsNs < cutoff) windowSeq++;
+    }
+
+    // 选取不晚于窗口起点的最近检查点；若都已被覆盖则取最早的一个
+    const Checkpoint* cp = nullptr;
+    for (size_t i = 0; i < cpCount_; i++) {
+        const Checkpoint& c = checkpoint(i);
+        if (c.seq < oldest) continue;
+        if (!cp || c.seq <= windowSeq) cp = &c;
+        if (c.seq >= windowSeq) break;
+    }
+    if (!cp) {
+        std::cerr << "[Recorder] No usable checkpoint in the ring" << std::endl;
+        return false;
+    }
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        perror("fopen recording");
+        return false;
+    }
+    uint64_t count = next_ - cp->seq;
+    uint32_t stringCount = static_cast<uint32_t>(strings_.size());
+    bool ok = writeAll(f, RECORD_MAGIC, sizeof(RECORD_MAGIC)) &&
+              writeAll(f, &RECORD_VERSION, sizeof(RECORD_VERSION)) &&
+              writeString(f, policyName) &&
+              writeAll(f, &stringCount, sizeof(stringCount));
+    for (uint32_t i = 0; ok && i < stringCount; i++) ok = writeString(f, strings_[i]);
+    ok = ok && writeAll(f, &cp->seq, sizeof(cp->seq)) && writeString(f, cp->state) &&
+         writeAll(f, &count, sizeof(count));
+    for (uint64_t s = cp->seq; ok && s < next_; s++) {
+        const RecordEvent& ev = ring_[s % ring_.size()];
+        ok = writeAll(f, &ev, sizeof(RecordEvent));
+        if (ok && ev.type == RecordType::Launch) ok = writeAll(f, &launches_[ev.str], sizeof(LaunchMeta));
+    }
+    if (fclose(f) != 0) ok = false;
+
+    std::cout << "[Recorder] " << (ok ? "Dumped " : "Failed to dump ") << count
+              << " events (from #" << cp->seq << ") to " << path << std::endl;
+    return ok;
+}
+
+// ======================= Replay =======================
+
+int replayRecording(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        perror("fopen recording");
+        return 2;
+    }
+    std::unique_ptr<FILE, int (*)(FILE*)> guard(f, fclose);
+
+    char magic[sizeof(RECORD_MAGIC)];
+    uint32_t version = 0, stringCount = 0;
+    std::string policyName, state;
+    uint64_t startSeq = 0, count = 0;
+    if (!readAll(f, magic, sizeof(magic)) || memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0 ||
+        !readAll(f, &version, sizeof(version)) || version < 1 || version > RECORD_VERSION ||
+        !readString(f, policyName) || !readAll(f, &stringCount, sizeof(stringCount))) {
+        std::cerr << "[Replay] Not a recording (or unsupported version): " << path << std::endl;
+        return 2;
+    }
+    std::vector<std::string> strings(stringCount);
+    for (uint32_t i = 0; i < stringCount; i++) {
+        if (!readString(f, strings[i])) {
+            std::cerr << "[Replay] Truncated string table" << std::endl;
+            return 2;
+        }
+    }
+    if (!readAll(f, &startSeq, sizeof(startSeq)) || !readString(f, state) || !readAll(f, &count, sizeof(count))) {
+        std::cerr << "[Replay] Truncated checkpoint" << std::endl;
+        return 2;
+    }
+
+    std::unique_ptr<IPolicy> policy = createPolicy(policyName);
+    if (!policy) {
+        std::cerr << "[Replay] Unknown policy: " << policyName << std::endl;
+        return 2;
+    }
+    if (!policy->loadState(state)) {
+        std::cerr << "[Replay] Policy rejected the checkpoint state" << std::endl;
+        return 2;
+    }
+
+    auto str = [&strings](uint32_t id) -> const std::string& {
+        static const std::string empty;
+        return id < strings.size() ? strings[id] : empty;
+    };
+
+    std::cout << "[Replay] Policy '" << policyName << "', " << count << " events from #" << startSeq << std::endl;
+    uint64_t requests = 0, mismatches = 0, replayed = 0;
+    LaunchMeta launch;       // 由 Launch 事件设置，交给紧随其后的请求或遥测
+    int64_t predictedNs = 0;
+    int64_t holdNs = 0;      // 上一个回放决策的扣住时长，应由紧随其后的 Hold 事件核对
+    uint64_t holdSeq = 0;
+    auto holdMismatch = [&](int64_t recorded) {
+        if (mismatches++ < 10) {
+            std::cout << "  MISMATCH #" << holdSeq << ": recorded hold " << recorded << " ns, replayed " << holdNs
+                      << " ns" << std::endl;
+        }
+    };
+    RecordEvent ev;
+    for (; replayed < count && readAll(f, &ev, sizeof(ev)); replayed++) {
+        if (ev.type == RecordType::Hold) {
+            if (ev.arg != holdNs) holdMismatch(ev.arg);
+            holdNs = 0;
+            continue;
+        }
+        if (holdNs) {
+            holdMismatch(0);
+            holdNs = 0;
+        }
+        switch (ev.type) {
+        case RecordType::Attach:
+            policy->onClientAttach(str(ev.client), str(ev.str), ev.tsNs);
+            break;
+        case RecordType::Detach:
+            policy->onClientDetach(str(ev.client), ev.tsNs);
+            break;
+        case RecordType::Telemetry:
+            policy->onTelemetry(str(ev.client), str(ev.str), launch, ev.arg, ev.tsNs);
+            launch = LaunchMeta();
+            predictedNs = 0;
+            break;
+        case RecordType::Launch: {
+            if (version >= 6) {
+                if (!readAll(f, &launch, sizeof(launch))) {
+                    std::cerr << "[Replay] Truncated launch parameters at #" << ev.seq << std::endl;
+                    return 2;
+                }
+            } else {
+                const std::string& text = str(ev.str);
+                parseLaunchMeta(text.data(), text.data() + text.size(), launch);
+            }
+            predictedNs = ev.arg;
+            break;
+        }
+        case RecordType::Tick:
+            policy->onTick(ev.tsNs);
+            break;
+        case RecordType::Control: {
+            ClientControl control;
+            std::istringstream fields(str(ev.str));
+            std::string field;
+            while (std::getline(fields, field, ',')) parseControlField(field, control);
+            policy->onClientControl(str(ev.client), control, ev.tsNs);
+            break;
+        }
+        case RecordType::Prior:
+            policy->onKernelPrior(str(ev.client), str(ev.str), parseKernelCost(str(ev.reason)), ev.tsNs);
+            break;
+        case RecordType::Request: {
+            PolicyRequest req{str(ev.client), str(ev.str), std::to_string(ev.arg), launch, predictedNs};
+            launch = LaunchMeta();
+            predictedNs = 0;
+            PolicyDecision d = policy->decide(req, ev.tsNs);
+            requests++;
+            if (d.allow != (ev.allow != 0) || d.reason != str(ev.reason)) {
+                if (mismatches++ < 10) {
+                    std::cout << "  MISMATCH #" << ev.seq << " " << req.clientKey << " req " << req.reqId
+                              << ": recorded " << int(ev.allow) << "|" << str(ev.reason)
+                              << ", replayed " << int(d.allow) << "|" << d.reason << std::endl;
+                }
+            }
+            holdNs = d.holdNs;
+            holdSeq = ev.seq;
+            break;
+        }
+        default:
+            std::cerr << "[Replay] Unknown event type " << int(ev.type) << " at #" << ev.seq << std::endl;
+            return 2;
+        }
+    }
+    if (replayed != count) {
+        std::cerr << "[Replay] Truncated event stream (" << replayed << "/" << count << ")" << std::endl;
+        return 2;
+    }
+    if (holdNs) holdMismatch(0);
+
+    std::cout << "[Replay] " << replayed << " events, " << requests << " decisions, "
+              << mismatches << " mismatches" << std::endl;
+    return mismatches ? 1 : 0;
+}
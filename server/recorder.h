@@ -0,0 +1,113 @@
+#pragma once
+
+#include "policy.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================
+//  策略输入录制与确定性回放
+//  录制: 策略的每次调用 (attach/detach/请求/遥测/定时器) 连同时间戳和决策写入
+//        固定容量的环形缓冲区，字符串驻留为 id，单条事件 40 字节，可常开。
+//        环形缓冲区覆盖旧事件，因此周期性保存策略状态检查点 (同样循环使用，复用状态字符串的容量)，
+//        导出时从仍在缓冲区内的最早检查点开始。
+//        请求带有启动参数或耗时预测、遥测带有启动参数时，紧挨着先写一条 Launch 事件
+//        (参数原样存入并行的 LaunchMeta 环，不驻留；预测值记在 arg，回放时原样交给策略)。
+//        每条 Launch 事件后面至少跟一条别的事件，所以启动参数环只需事件环一半的容量。
+//        决策要求扣住回复时，紧跟 Request 再写一条 Hold 事件。
+//  回放: 按录制顺序把输入喂给新建的同名策略 (虚拟时钟即录制的时间戳)，
+//        逐条比对决策。
+// ============================================================
+
+enum class RecordType : uint8_t {
+    Attach = 1,
+    Detach = 2,
+    Request = 3,
+    Telemetry = 4,
+    Tick = 5,
+    Control = 6,
+    Prior = 7,
+    Launch = 8,          // 紧随其后的 Request/Telemetry 的启动参数与预测耗时
+    Hold = 9,            // 紧接着的前一条 Request 的扣住时长
+};
+
+struct RecordEvent {
+    uint64_t seq;
+    int64_t tsNs;
+    int64_t arg;         // Request: reqId; Telemetry: 耗时 ns; Launch: 预测耗时 ns; Hold: 扣住时长 ns
+    uint32_t client;     // 字符串 id
+    uint32_t str;        // Attach: clientType; Request/Telemetry: kernelType; Control: formatControl(); Prior: 族;
+                         // Launch: 启动参数环中的下标 (录制文件里参数紧跟在该事件之后)
+    uint32_t reason;     // Request: 决策原因; Prior: formatKernelCost()
+    RecordType type;
+    uint8_t allow;
+    uint8_t reserved[2];
+};
+static_assert(sizeof(RecordEvent) == 40, "RecordEvent layout");
+
+/**
+ * @brief 策略输入录制器
+ * 非线程安全，由 Scheduler 在策略锁内调用。
+ */
+class DecisionRecorder {
+public:
+    // capacity 为 0 表示关闭录制
+    explicit DecisionRecorder(size_t capacity);
+
+    bool enabled() const { return !ring_.empty(); }
+    bool recording() const { return enabled() && active_; }
+
+    // 在第一条事件之前调用，保存初始检查点
+    void start(const IPolicy& policy);
+
+    // 暂停/恢复录制 (运维命令)。恢复时重新保存检查点，导出从恢复点开始，不跨越空档
+    void setActive(bool active, const IPolicy& policy);
+
+    void recordAttach(int64_t nowNs, const std::string& clientKey, const std::string& clientType);
+    void recordDetach(int64_t nowNs, const std::string& clientKey);
+    void recordRequest(int64_t nowNs, const PolicyRequest& req, const PolicyDecision& decision);
+    void recordTelemetry(int64_t nowNs, const std::string& clientKey, const std::string& kernelType,
+                         const LaunchMeta& launch, int64_t durationNs);
+    void recordTick(int64_t nowNs);
+    void recordControl(int64_t nowNs, const std::string& clientKey, const ClientControl& control);
+    void recordPrior(int64_t nowNs, const std::string& clientKey, const std::string& family, const KernelCost& cost);
+
+    // 在事件之后调用，按间隔保存检查点
+    void maybeCheckpoint(const IPolicy& policy);
+
+    // 导出最近的事件 (windowNs > 0 时只保留窗口内且不早于检查点的事件)
+    bool dump(const std::string& path, const std::string& policyName, int64_t windowNs) const;
+
+private:
+    struct Checkpoint {
+        uint64_t seq;
+        std::string state;
+    };
+
+    RecordEvent& push(RecordType type, int64_t nowNs);
+    // 占用下一个检查点槽位 (满了覆盖最旧的)，state 保留原有容量
+    Checkpoint& pushCheckpoint();
+    const Checkpoint& checkpoint(size_t i) const { return checkpoints_[(cpFirst_ + i) % checkpoints_.size()]; }
+    void pushLaunch(int64_t nowNs, const std::string& clientKey, const LaunchMeta& launch, int64_t predictedNs);
+    uint32_t intern(const std::string& s);
+
+    std::vector<RecordEvent> ring_;
+    std::vector<LaunchMeta> launches_;     // Launch 事件的启动参数，按 launchNext_ 循环使用
+    uint64_t launchNext_;
+    uint64_t next_;
+    uint64_t checkpointInterval_;
+    bool active_;
+    std::vector<Checkpoint> checkpoints_;  // 循环使用，有效的为从 cpFirst_ 起的 cpCount_ 个
+    size_t cpFirst_;
+    size_t cpCount_;
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> stringIds_;
+};
+
+/**
+ * @brief 回放录制文件并校验决策
+ * @return 0 决策全部一致；1 存在不一致；2 文件或策略错误
+ */
+int replayRecording(const std::string& path);
@@ -0,0 +1,589 @@
+#include "config.h"
+#include "shm_segment.h"
+#include "stats_shm.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// ============================================================
+//  ksrouter: 面向 SGLang 实例的 HTTP 请求路由器
+//  接收 POST /generate 与 /v1/completions，按调度器发布的实时负载挑选后端，原样转发请求并把响应
+//  (含 SSE 流) 边收边回给客户端。负载来自调度器的统计共享内存 (stats_shm.h)，只读映射、原地读取，
+//  每个后端通过 --backend <url>=<client> 对应到调度器里的客户端 (uniqueId、完整 clientKey 或模型名)。
+//  打分 (越小越好):
+//      利用率 (遥测耗时 / 时间 / 会话数，即 1 - SLO 余量)
+//    + 被暂停或配额挡住的会话 + 阶段不符 (max_tokens 不超过 --prefill-tokens 的请求视为 prefill)
+//    + 路由器自己在途的请求数
+//  调度器未运行或后端没有对应客户端时只按在途请求数分配。GET /router/status 返回后端表。
+// ============================================================
+
+namespace {
+
+// 打分权重
+const double WAITING_PENALTY = 1.0;      // 每个被挡住的会话
+const double PAUSED_PENALTY = 10.0;      // 被 ksctl pause 的后端只在别无选择时使用
+const double PHASE_PENALTY = 0.5;        // 后端当前阶段与请求不符
+const double INFLIGHT_WEIGHT = 0.1;      // 每个在途请求
+const double FAILED_PENALTY = 100.0;     // ROUTER_RETRY_MS 内连接失败过的后端
+// 利用率的指数平滑系数 (每次刷新)
+const double UTIL_ALPHA = 0.3;
+
+struct Options {
+    std::string host = LOCALHOST;
+    int port = ROUTER_PORT;
+    std::vector<std::string> backends;
+    std::string statsShm = statsShmName();
+    int refreshMs = ROUTER_REFRESH_MS;
+    int staleMs = ROUTER_STALE_MS;
+    long long prefillTokens = 1;
+};
+
+struct Backend {
+    std::string url;                     // http://host:port
+    std::string client;                  // 对应的调度器客户端，空表示不匹配
+    struct sockaddr_storage addr;
+    socklen_t addrLen = 0;
+    std::atomic<int> inflight{0};
+    std::atomic<uint64_t> routed{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> failedNs{0};   // 最近一次失败 (CLOCK_MONOTONIC)
+};
+
+// 刷新线程计算的后端负载
+struct BackendLoad {
+    bool matched = false;
+    uint32_t sessions = 0;
+    uint32_t prefill = 0;
+    uint32_t decode = 0;
+    uint32_t waiting = 0;
+    bool paused = false;
+    double utilization = 0;
+    double kernelRate = 0;
+};
+
+// 不可变快照，整体替换 (std::atomic_load/atomic_store)
+struct LoadView {
+    bool live = false;                   // 调度器在 --stale-ms 内发布过
+    std::vector<BackendLoad> loads;
+};
+
+Options g_opt;
+std::vector<std::unique_ptr<Backend>> g_backends;
+std::shared_ptr<const LoadView> g_view = std::make_shared<LoadView>();
+std::atomic<uint64_t> g_rotate(0);
+std::atomic<int> g_connections(0);        // 正在服务的客户端连接
+
+// ===== HTTP 辅助 =====
+
+// 收发超时后 recv/send 返回 EAGAIN，按连接断开处理
+void setTimeout(int fd, int ms) {
+    struct timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool sendAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+void sendSimple(int fd, const std::string& status, const std::string& body) {
+    std::string resp = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: " +
+                       std::to_string(body.size()) + "\r\n\r\n" + body;
+    sendAll(fd, resp.data(), resp.size());
+}
+
+enum class ReadResult { Ok, Closed, BadRequest, HeaderTooLarge, BodyTooLarge };
+
+// Content-Length 的值: 只接受十进制数字 (前后可有空白)，否则返回 -1
+long long parseContentLength(const char* p) {
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p < '0' || *p > '9') return -1;
+    long long v = 0;
+    for (; *p >= '0' && *p <= '9'; p++) {
+        if (v > ROUTER_MAX_BODY) return ROUTER_MAX_BODY + 1;     // 防止溢出，超限即可判定
+        v = v * 10 + (*p - '0');
+    }
+    while (*p == ' ' || *p == '\t') p++;
+    return *p == '\0' || *p == '\r' ? v : -1;
+}
+
+// 读取完整请求 (请求头 + Content-Length 指定的请求体)；不支持分块编码的请求体。
+// 请求头超过 ROUTER_MAX_HEADER、请求体超过 ROUTER_MAX_BODY 时不再读取
+ReadResult readRequest(int fd, std::string& head, std::string& body) {
+    std::string buf;
+    char tmp[65536];
+    size_t hend = std::string::npos;
+    size_t scanned = 0;                  // 已查找过结束标记的位置，下次从这里 (回退 3 字节) 继续
+    long long contentLength = 0;
+    while (true) {
+        if (hend == std::string::npos) {
+            hend = buf.find("\r\n\r\n", scanned);
+            scanned = buf.size() < 3 ? 0 : buf.size() - 3;
+            if (hend == std::string::npos && buf.size() > ROUTER_MAX_HEADER) return ReadResult::HeaderTooLarge;
+            if (hend != std::string::npos) {
+                if (hend > ROUTER_MAX_HEADER) return ReadResult::HeaderTooLarge;
+                head = buf.substr(0, hend);
+                const char* p = strcasestr(head.c_str(), "\r\ncontent-length:");
+                if (p) {
+                    contentLength = parseContentLength(p + strlen("\r\ncontent-length:"));
+                    if (contentLength < 0) return ReadResult::BadRequest;
+                    if (contentLength > ROUTER_MAX_BODY) return ReadResult::BodyTooLarge;
+                }
+                // curl 对较大的请求体先发 Expect: 100-continue 并等待
+                if (strcasestr(head.c_str(), "\r\nexpect: 100-continue") &&
+                    static_cast<long long>(buf.size() - hend - 4) < contentLength) {
+                    const char* cont = "HTTP/1.1 100 Continue\r\n\r\n";
+                    if (!sendAll(fd, cont, strlen(cont))) return ReadResult::Closed;
+                }
+            }
+        }
+        if (hend != std::string::npos && static_cast<long long>(buf.size() - hend - 4) >= contentLength) {
+            body = buf.substr(hend + 4, static_cast<size_t>(contentLength));
+            return ReadResult::Ok;
+        }
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return ReadResult::Closed;
+        buf.append(tmp, static_cast<size_t>(n));
+    }
+}
+
+// 转发给后端的请求头: 去掉逐跳头部，改为 Connection: close (后端写完响应即关闭，路由器据此结束转发)
+std::string rewriteHead(const std::string& head) {
+    std::istringstream in(head);
+    std::string line, out;
+    bool first = true;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!first) {
+            std::string name = line.substr(0, line.find(':'));
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            if (name == "connection" || name == "keep-alive" || name == "proxy-connection" || name == "expect") {
+                continue;
+            }
+        }
+        first = false;
+        out += line + "\r\n";
+    }
+    return out + "Connection: close\r\n\r\n";
+}
+
+// 在 JSON 文本中查找 "key": 后的整数 (不做完整解析)，没有时返回 def
+long long jsonInt(const std::string& body, const char* key, long long def) {
+    std::string quoted = std::string("\"") + key + "\"";
+    size_t pos = body.find(quoted);
+    if (pos == std::string::npos) return def;
+    pos += quoted.size();
+    while (pos < body.size() && (body[pos] == ' ' || body[pos] == '\t')) pos++;
+    if (pos >= body.size() || body[pos] != ':') return def;
+    const char* v = body.c_str() + pos + 1;
+    char* stop = nullptr;
+    long long val = strtoll(v, &stop, 10);
+    return stop == v ? def : val;
+}
+
+// ===== 负载 =====
+
+bool matches(const Backend& b, const ClientStats& c) {
+    if (b.client.empty()) return false;
+    if (b.client == c.clientKey || b.client == c.model) return true;
+    size_t colon = c.clientKey.find(':');
+    return colon != std::string::npos && c.clientKey.compare(colon + 1, std::string::npos, b.client) == 0;
+}
+
+void refreshLoop() {
+    StatsReader reader;
+    std::vector<ClientStats> clients;
+    size_t n = g_backends.size();
+    std::vector<uint64_t> lastKernels(n, 0), lastBusy(n, 0);
+    std::vector<double> utilization(n, 0);
+    uint64_t lastNs = 0;
+    bool wasLive = false;
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(g_opt.refreshMs));
+        uint64_t now = monotonicNs();
+        if (!reader.isOpen()) reader.open(g_opt.statsShm);
+        uint64_t publishedNs = 0;
+        bool live = reader.snapshot(clients, publishedNs) &&
+                    now - std::min(now, publishedNs) <= static_cast<uint64_t>(g_opt.staleMs) * 1000000ull;
+        // 调度器重启时段被重建，旧映射不再更新，下一轮重新打开
+        if (!live) reader.close();
+        if (live != wasLive) {
+            std::cout << "[Router] Scheduler statistics " << (live ? "available" : "unavailable") << " ("
+                      << g_opt.statsShm << ")" << std::endl;
+            wasLive = live;
+        }
+
+        std::shared_ptr<LoadView> view = std::make_shared<LoadView>();
+        view->live = live;
+        view->loads.resize(n);
+        double seconds = lastNs ? (now - lastNs) / 1e9 : 0;
+        for (size_t i = 0; i < n && live; i++) {
+            BackendLoad& l = view->loads[i];
+            uint64_t kernels = 0, busyNs = 0;
+            for (const auto& c : clients) {
+                if (!matches(*g_backends[i], c)) continue;
+                l.matched = true;
+                l.sessions += c.sessions;
+                l.waiting += c.waiting;
+                l.paused = l.paused || c.paused;
+                if (c.phase == static_cast<int>(ClientPhase::Prefill)) l.prefill += c.sessions;
+                if (c.phase == static_cast<int>(ClientPhase::Decode)) l.decode += c.sessions;
+                kernels += c.kernels;
+                busyNs += c.busyNs;
+            }
+            // 计数只覆盖在线会话，会话结束时会变小，这一轮不计速率
+            if (seconds > 0 && kernels >= lastKernels[i] && busyNs >= lastBusy[i]) {
+                l.kernelRate = (kernels - lastKernels[i]) / seconds;
+                double busy = (busyNs - lastBusy[i]) / 1e9 / seconds / std::max(1u, l.sessions);
+                utilization[i] += UTIL_ALPHA * (std::min(1.0, busy) - utilization[i]);
+            }
+            if (!l.matched) utilization[i] = 0;
+            l.utilization = utilization[i];
+            lastKernels[i] = kernels;
+            lastBusy[i] = busyNs;
+        }
+        lastNs = now;
+        std::atomic_store(&g_view, std::shared_ptr<const LoadView>(view));
+    }
+}
+
+// prefill 请求只要首 token (PD 分离时发往 prefill 节点)，其余按 decode 处理
+int choose(bool prefill, const std::vector<bool>& tried) {
+    std::shared_ptr<const LoadView> view = std::atomic_load(&g_view);
+    size_t n = g_backends.size();
+    // 从轮转位置开始比较，分数相同时轮流选择
+    size_t start = static_cast<size_t>(g_rotate.fetch_add(1, std::memory_order_relaxed) % n);
+    uint64_t now = monotonicNs();
+    int best = -1;
+    double bestScore = 0;
+    for (size_t k = 0; k < n; k++) {
+        size_t i = (start + k) % n;
+        if (tried[i]) continue;
+        double score = INFLIGHT_WEIGHT * g_backends[i]->inflight.load(std::memory_order_relaxed);
+        uint64_t failedNs = g_backends[i]->failedNs.load(std::memory_order_relaxed);
+        if (failedNs && now - failedNs < ROUTER_RETRY_MS * 1000000ull) score += FAILED_PENALTY;
+        if (view->live && view->loads[i].matched) {
+            const BackendLoad& l = view->loads[i];
+            score += l.utilization + WAITING_PENALTY * l.waiting + (l.paused ? PAUSED_PENALTY : 0);
+            bool phasePrefill = l.prefill > l.decode;
+            bool phaseDecode = l.decode > l.prefill;
+            if ((prefill && phaseDecode) || (!prefill && phasePrefill)) score += PHASE_PENALTY;
+        }
+        if (best < 0 || score < bestScore) {
+            best = static_cast<int>(i);
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+std::string describe() {
+    std::shared_ptr<const LoadView> view = std::atomic_load(&g_view);
+    std::ostringstream ss;
+    ss << "scheduler " << (view->live ? "live" : "unavailable") << " (" << g_opt.statsShm << ")\n";
+    ss << std::left << std::setw(28) << "BACKEND" << std::setw(16) << "CLIENT" << std::right << std::setw(9)
+       << "INFLIGHT" << std::setw(9) << "ROUTED" << std::setw(8) << "FAILED" << std::setw(9) << "SESSIONS"
+       << std::setw(9) << "PHASE" << std::setw(8) << "WAITING" << std::setw(7) << "UTIL" << std::setw(9)
+       << "HEADROOM" << std::setw(10) << "RATE/s" << "\n";
+    for (size_t i = 0; i < g_backends.size(); i++) {
+        const Backend& b = *g_backends[i];
+        ss << std::left << std::setw(28) << b.url << std::setw(16) << (b.client.empty() ? "-" : b.client) << std::right
+           << std::setw(9) << b.inflight.load() << std::setw(9) << b.routed.load() << std::setw(8) << b.failed.load();
+        const BackendLoad* l = view->live && view->loads[i].matched ? &view->loads[i] : nullptr;
+        if (!l) {
+            ss << std::setw(9) << "-" << std::setw(9) << "-" << std::setw(8) << "-" << std::setw(7) << "-"
+               << std::setw(9) << "-" << std::setw(10) << "-" << "\n";
+            continue;
+        }
+        const char* phase = l->prefill > l->decode ? "prefill" : l->decode > l->prefill ? "decode" : "-";
+        ss << std::setw(9) << l->sessions << std::setw(9) << (l->paused ? "paused" : phase) << std::setw(8)
+           << l->waiting << std::fixed << std::setprecision(3) << std::setw(7) << l->utilization << std::setw(9)
+           << 1 - l->utilization << std::setprecision(1) << std::setw(10) << l->kernelRate << "\n";
+    }
+    return ss.str();
+}
+
+// ===== 转发 =====
+
+enum class ForwardResult { Done, BackendFailed, ClientGone };
+
+// 转发一个请求并把响应流回客户端；后端在返回任何字节之前失败时可换下一个后端重试
+ForwardResult forward(int clientFd, Backend& b, const std::string& head, const std::string& body) {
+    int fd = socket(b.addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return ForwardResult::BackendFailed;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setTimeout(fd, ROUTER_BACKEND_TIMEOUT_MS);
+    std::string request = rewriteHead(head) + body;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&b.addr), b.addrLen) != 0 ||
+        !sendAll(fd, request.data(), request.size())) {
+        close(fd);
+        return ForwardResult::BackendFailed;
+    }
+
+    // 先收齐响应头，在状态行之后插入 X-KS-Backend，其后的字节 (含 SSE 分块) 收到即转发
+    std::string pending;
+    bool headDone = false;
+    char buf[65536];
+    ForwardResult result = ForwardResult::Done;
+    while (true) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (!headDone && pending.empty()) result = ForwardResult::BackendFailed;
+            else if (!headDone && !sendAll(clientFd, pending.data(), pending.size())) result = ForwardResult::ClientGone;
+            break;
+        }
+        if (headDone) {
+            if (!sendAll(clientFd, buf, static_cast<size_t>(n))) {
+                result = ForwardResult::ClientGone;
+                break;
+            }
+            continue;
+        }
+        pending.append(buf, static_cast<size_t>(n));
+        size_t lineEnd = pending.find("\r\n");
+        if (lineEnd == std::string::npos) continue;
+        pending.insert(lineEnd + 2, "X-KS-Backend: " + b.url + "\r\n");
+        headDone = true;
+        if (!sendAll(clientFd, pending.data(), pending.size())) {
+            result = ForwardResult::ClientGone;
+            break;
+        }
+        pending.clear();
+    }
+    // 客户端断开时直接关闭，后端随之中止生成
+    close(fd);
+    return result;
+}
+
+void serve(int fd) {
+    std::string head, body;
+    ReadResult read = readRequest(fd, head, body);
+    if (read != ReadResult::Ok) {
+        if (read == ReadResult::BadRequest) sendSimple(fd, "400 Bad Request", "bad Content-Length\n");
+        if (read == ReadResult::HeaderTooLarge) {
+            sendSimple(fd, "431 Request Header Fields Too Large", "request header exceeds " +
+                       std::to_string(ROUTER_MAX_HEADER) + " bytes\n");
+        }
+        if (read == ReadResult::BodyTooLarge) {
+            sendSimple(fd, "413 Payload Too Large", "request body exceeds " + std::to_string(ROUTER_MAX_BODY) +
+                       " bytes\n");
+        }
+        close(fd);
+        return;
+    }
+    // 请求行: <method> <target> <version>，两个空格都必须在第一行内
+    size_t lineEnd = std::min(head.find("\r\n"), head.size());
+    size_t methodEnd = head.find(' ');
+    size_t targetEnd = methodEnd < lineEnd ? head.find(' ', methodEnd + 1) : std::string::npos;
+    if (methodEnd == 0 || targetEnd >= lineEnd || targetEnd == methodEnd + 1) {
+        sendSimple(fd, "400 Bad Request", "malformed request line\n");
+        close(fd);
+        return;
+    }
+    std::string method = head.substr(0, methodEnd);
+    std::string target = head.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    std::string path = target.substr(0, target.find('?'));
+
+    if (method == "GET" && path == "/router/status") {
+        sendSimple(fd, "200 OK", describe());
+        close(fd);
+        return;
+    }
+    bool generate = path == "/generate";
+    if (method != "POST" || (!generate && path != "/v1/completions")) {
+        sendSimple(fd, "404 Not Found", "ksrouter serves POST /generate, POST /v1/completions and "
+                                        "GET /router/status\n");
+        close(fd);
+        return;
+    }
+
+    long long maxTokens = jsonInt(body, generate ? "max_new_tokens" : "max_tokens", -1);
+    bool prefill = maxTokens >= 0 && maxTokens <= g_opt.prefillTokens;
+    std::vector<bool> tried(g_backends.size(), false);
+    bool served = false;
+    for (size_t attempt = 0; attempt < g_backends.size() && !served; attempt++) {
+        int i = choose(prefill, tried);
+        if (i < 0) break;
+        tried[i] = true;
+        Backend& b = *g_backends[i];
+        b.inflight.fetch_add(1, std::memory_order_relaxed);
+        ForwardResult r = forward(fd, b, head, body);
+        b.inflight.fetch_sub(1, std::memory_order_relaxed);
+        if (r == ForwardResult::BackendFailed) {
+            b.failed.fetch_add(1, std::memory_order_relaxed);
+            b.failedNs.store(monotonicNs(), std::memory_order_relaxed);
+            continue;
+        }
+        b.routed.fetch_add(1, std::memory_order_relaxed);
+        served = true;
+    }
+    if (!served) sendSimple(fd, "502 Bad Gateway", "no backend available\n");
+    close(fd);
+}
+
+void serveConnection(int fd) {
+    serve(fd);
+    g_connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// "<url>[=<client>]"，url 为 http://host[:port]，不带路径 (请求路径原样转发)
+bool addBackend(const std::string& spec) {
+    std::unique_ptr<Backend> b(new Backend());
+    size_t eq = spec.find('=');
+    b->url = spec.substr(0, eq);
+    if (eq != std::string::npos) b->client = spec.substr(eq + 1);
+    const std::string scheme = "http://";
+    if (b->url.compare(0, scheme.size(), scheme) != 0) return false;
+    std::string hostPort = b->url.substr(scheme.size());
+    hostPort = hostPort.substr(0, hostPort.find('/'));
+    b->url = scheme + hostPort;
+    size_t colon = hostPort.rfind(':');
+    std::string host = colon == std::string::npos ? hostPort : hostPort.substr(0, colon);
+    std::string port = colon == std::string::npos ? "80" : hostPort.substr(colon + 1);
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    if (host.empty() || getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res) return false;
+    std::memcpy(&b->addr, res->ai_addr, res->ai_addrlen);
+    b->addrLen = res->ai_addrlen;
+    freeaddrinfo(res);
+    g_backends.push_back(std::move(b));
+    return true;
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --backend <url>[=<client>] [--backend ...] [options]\n"
+              << "  --backend <url>[=<client>] SGLang instance, e.g. http://127.0.0.1:30001=1; <client> is the\n"
+              << "                           instance's UNIQUE_ID, a full <type>:<uniqueId> or a model name\n"
+              << "  --host <addr>            listen address (default " << LOCALHOST << ")\n"
+              << "  --port <n>               listen port (default " << ROUTER_PORT << ")\n"
+              << "  --stats-shm <name>       scheduler statistics segment (default " << statsShmName() << ")\n"
+              << "  --refresh-ms <ms>        statistics refresh interval (default " << ROUTER_REFRESH_MS << ")\n"
+              << "  --stale-ms <ms>          ignore statistics older than this (default " << ROUTER_STALE_MS << ")\n"
+              << "  --prefill-tokens <n>     requests asking for at most n tokens count as prefill (default 1)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    static struct option longOpts[] = {
+        {"backend", required_argument, nullptr, 'b'},
+        {"host", required_argument, nullptr, 'H'},
+        {"port", required_argument, nullptr, 'p'},
+        {"stats-shm", required_argument, nullptr, 's'},
+        {"refresh-ms", required_argument, nullptr, 'r'},
+        {"stale-ms", required_argument, nullptr, 'S'},
+        {"prefill-tokens", required_argument, nullptr, 'P'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOpts, nullptr)) != -1) {
+        switch (c) {
+        case 'b': g_opt.backends.push_back(optarg); break;
+        case 'H': g_opt.host = optarg; break;
+        case 'p': g_opt.port = atoi(optarg); break;
+        case 's': g_opt.statsShm = optarg; break;
+        case 'r': g_opt.refreshMs = std::max(1, atoi(optarg)); break;
+        case 'S': g_opt.staleMs = atoi(optarg); break;
+        case 'P': g_opt.prefillTokens = atoll(optarg); break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    for (const auto& spec : g_opt.backends) {
+        if (!addBackend(spec)) {
+            std::cerr << "[Router] Bad backend: " << spec << std::endl;
+            return 1;
+        }
+    }
+    if (g_backends.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(g_opt.port));
+    if (inet_pton(AF_INET, g_opt.host.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "[Router] Bad listen address: " << g_opt.host << std::endl;
+        return 1;
+    }
+    if (bind(lfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 || listen(lfd, 4096) == -1) {
+        perror("[Router] bind/listen");
+        return 1;
+    }
+    std::cout << "[Router] Listening on " << g_opt.host << ":" << g_opt.port << ", " << g_backends.size()
+              << " backend(s)" << std::endl;
+    for (const auto& b : g_backends) {
+        std::cout << "[Router]   " << b->url << " -> " << (b->client.empty() ? "(no scheduler client)" : b->client)
+                  << std::endl;
+    }
+    std::thread(refreshLoop).detach();
+
+    while (true) {
+        int fd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // fd 或内存耗尽: 等在途连接关闭一些再接受，不空转
+                std::this_thread::sleep_for(std::chrono::milliseconds(ROUTER_ACCEPT_BACKOFF_MS));
+                continue;
+            }
+            perror("[Router] accept");
+            break;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setTimeout(fd, ROUTER_CLIENT_TIMEOUT_MS);
+        if (g_connections.fetch_add(1, std::memory_order_relaxed) >= ROUTER_MAX_CONNECTIONS) {
+            g_connections.fetch_sub(1, std::memory_order_relaxed);
+            sendSimple(fd, "503 Service Unavailable", "too many connections (" +
+                       std::to_string(ROUTER_MAX_CONNECTIONS) + ")\n");
+            close(fd);
+            continue;
+        }
+        std::thread(serveConnection, fd).detach();
+    }
+    close(lfd);
+    return 0;
+}
@@ -1,10 +1,50 @@
 #include "logger.h"
 #include "scheduler.h"
+#include "config.h"
+#include "shm_segment.h"
+#include "arena.h"
 
 #include <sstream>
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-Scheduler::Scheduler() {}
+static int64_t monoNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* phaseName(ClientPhase phase) {
+    switch (phase) {
+    case ClientPhase::Prefill: return "prefill";
+    case ClientPhase::Decode: return "decode";
+    default: return "-";
+    }
+}
+
+// 只看 attention kernel: flashinfer 的 BatchPrefill*/BatchDecode*，flash-attn 的 flash_fwd_kernel / splitkv，
+// vLLM 的 paged_attention；其余 kernel 两个阶段都会出现，不改变阶段
+ClientPhase inferPhase(const std::string& kernelType) {
+    if (kernelType.find("Decode") != std::string::npos || kernelType.find("decode") != std::string::npos ||
+        kernelType.find("splitkv") != std::string::npos || kernelType.find("paged_attention") != std::string::npos) {
+        return ClientPhase::Decode;
+    }
+    if (kernelType.find("Prefill") != std::string::npos || kernelType.find("prefill") != std::string::npos ||
+        kernelType.find("flash_fwd_kernel") != std::string::npos) {
+        return ClientPhase::Prefill;
+    }
+    return ClientPhase::Unknown;
+}
+
+Scheduler::Scheduler(std::unique_ptr<IPolicy> p, size_t recordEvents)
+    : policy(std::move(p)), recorder(recordEvents), controls(std::make_shared<const ControlTable>()) {
+    recorder.start(*policy);
+    tickThread = std::thread(&Scheduler::tickLoop, this);
+}
 
 Scheduler::~Scheduler() {
     stop();
@@ -12,6 +52,8 @@ Scheduler::~Scheduler() {
 
 void Scheduler::stop() {
     running = false;
+    if (tickThread.joinable())
+        tickThread.join();
     std::lock_guard<std::mutex> lock(threadsMutex);
     for (auto& t : workers) {
         if (t.joinable())
@@ -21,44 +63,531 @@ void Scheduler::stop() {
 }
 
 size_t Scheduler::getActiveCount() {
-    std::lock_guard<std::mutex> lock(threadsMutex);
-    return workers.size(); 
+    return activeSessions.load();
+}
+
+void Scheduler::replacePolicy(std::unique_ptr<IPolicy> next) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    int64_t now = monoNowNs();
+    policy = std::move(next);
+    recorder.start(*policy);
+    for (const auto& client : attached) {
+        for (int i = 0; i < client.second.second; i++) {
+            policy->onClientAttach(client.first, client.second.first, now);
+            recorder.recordAttach(now, client.first, client.second.first);
+        }
+    }
+    std::shared_ptr<const ControlTable> table = std::atomic_load(&controls);
+    for (const auto& entry : table->clients) {
+        policy->onClientControl(entry.first, entry.second, now);
+        recorder.recordControl(now, entry.first, entry.second);
+    }
+    for (const auto& client : attached) {
+        auto it = models.find(client.first);
+        deliverPriors(client.first, it != models.end() ? it->second : client.second.first, now);
+    }
+    recorder.maybeCheckpoint(*policy);
+}
+
+std::string Scheduler::policyName() {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return policy->name();
+}
+
+bool Scheduler::policyHonours(const std::string& field) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return policy->honoursControl(field);
+}
+
+// ===== 策略调用 (policyMutex 内串行执行) =====
+
+PolicyDecision Scheduler::makeDecision(PolicyRequest& req, const std::string& model) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    int64_t now = monoNowNs();
+    req.predictedNs = predictor.predict(model, req.kernelType, req.launch);
+    PolicyDecision decision = policy->decide(req, now);
+    recorder.recordRequest(now, req, decision);
+    recorder.maybeCheckpoint(*policy);
+    return decision;
+}
+
+void Scheduler::reportTelemetry(const std::string& clientKey, const std::string& model, const std::string& kernelType,
+                                const LaunchMeta& launch, int64_t durationNs) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    int64_t now = monoNowNs();
+    policy->onTelemetry(clientKey, kernelType, launch, durationNs, now);
+    recorder.recordTelemetry(now, clientKey, kernelType, launch, durationNs);
+    recorder.maybeCheckpoint(*policy);
+    costStore.update(model, kernelType, durationNs, activeSessions.load(std::memory_order_relaxed) > 1);
+    predictor.update(model, kernelType, launch, durationNs);
+    if (durationNs > 0) busyNs.fetch_add(static_cast<uint64_t>(durationNs), std::memory_order_relaxed);
+}
+
+void Scheduler::attachClient(const std::string& clientKey, const std::string& clientType) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    int64_t now = monoNowNs();
+    policy->onClientAttach(clientKey, clientType, now);
+    recorder.recordAttach(now, clientKey, clientType);
+    // 重新接入的客户端沿用之前设置的控制参数
+    std::shared_ptr<const ControlTable> table = std::atomic_load(&controls);
+    auto it = table->clients.find(clientKey);
+    if (it != table->clients.end()) {
+        policy->onClientControl(clientKey, it->second, now);
+        recorder.recordControl(now, clientKey, it->second);
+    }
+    auto& client = attached[clientKey];
+    client.first = clientType;
+    client.second++;
+    if (client.second == 1) {
+        models[clientKey] = clientType;
+        deliverPriors(clientKey, clientType, now);
+    }
+    recorder.maybeCheckpoint(*policy);
+}
+
+void Scheduler::setClientModel(const std::string& clientKey, const std::string& model) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    auto it = models.find(clientKey);
+    if (it == models.end() || it->second == model) return;
+    it->second = model;
+    size_t families = deliverPriors(clientKey, model, monoNowNs());
+    recorder.maybeCheckpoint(*policy);
+    std::cout << "[Scheduler] " << clientKey << " runs model " << model << ", " << families
+              << " kernel families known" << std::endl;
+}
+
+size_t Scheduler::deliverPriors(const std::string& clientKey, const std::string& model, int64_t nowNs) {
+    size_t families = 0;
+    costStore.forEachFamily(model, [&](const std::string& family, const KernelCost& cost) {
+        policy->onKernelPrior(clientKey, family, cost, nowNs);
+        recorder.recordPrior(nowNs, clientKey, family, cost);
+        families++;
+    });
+    return families;
+}
+
+bool Scheduler::openCostStore(const std::string& path, size_t capacity) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    if (!costStore.open(path, capacity)) return false;
+    std::cout << "[Scheduler] Cost store " << path << ": " << costStore.size() << "/" << costStore.capacity()
+              << " entries";
+    if (costStore.discarded()) std::cout << ", discarded " << costStore.discarded() << " torn entries";
+    std::cout << std::endl;
+    return true;
+}
+
+void Scheduler::detachClient(const std::string& clientKey) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    int64_t now = monoNowNs();
+    policy->onClientDetach(clientKey, now);
+    recorder.recordDetach(now, clientKey);
+    auto it = attached.find(clientKey);
+    if (it != attached.end() && --it->second.second <= 0) {
+        attached.erase(it);
+        models.erase(clientKey);
+    }
+    recorder.maybeCheckpoint(*policy);
+}
+
+void Scheduler::tickLoop() {
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLICY_TICK_MS));
+        int64_t now = monoNowNs();
+        {
+            std::lock_guard<std::mutex> lock(policyMutex);
+            policy->onTick(now);
+            recorder.recordTick(now);
+            recorder.maybeCheckpoint(*policy);
+            // 代价存储的脏页异步写回；进程崩溃不丢数据 (页缓存仍在)，这里只缩小掉电时的损失
+            if (now - costSyncNs >= COST_SYNC_MS * 1000000ll) {
+                costSyncNs = now;
+                costStore.sync(true);
+            }
+        }
+        if (now - statsPublishNs >= STATS_PUBLISH_MS * 1000000ll) {
+            statsPublishNs = now;
+            publishStats(now);
+        }
+    }
+}
+
+bool Scheduler::openStatsShm(const std::string& name) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (!statsPublisher.open(name)) return false;
+    std::cout << "[Scheduler] Publishing client statistics to " << name << std::endl;
+    return true;
+}
+
+void Scheduler::publishStats(int64_t nowNs) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (!statsPublisher.isOpen()) return;
+    // 同一客户端的多个会话合并为一个条目
+    std::map<std::string, ClientStats> byClient;
+    {
+        std::lock_guard<std::mutex> sessionsLock(sessionsMutex);
+        for (const auto& entry : sessions) {
+            const SessionStats& s = *entry.second;
+            ClientStats& c = byClient[s.clientKey];
+            c.clientKey = s.clientKey;
+            int phase = s.phase.load(std::memory_order_relaxed);
+            if (phase != 0) c.phase = phase;
+            c.sessions++;
+            if (s.waiting.load(std::memory_order_relaxed)) c.waiting++;
+            if (s.paused.load(std::memory_order_relaxed)) c.paused = true;
+            c.kernels += s.kernels.load(std::memory_order_relaxed);
+            c.busyNs += s.busyNs.load(std::memory_order_relaxed);
+        }
+    }
+    std::vector<ClientStats> clients;
+    {
+        std::lock_guard<std::mutex> policyLock(policyMutex);
+        for (auto& entry : byClient) {
+            auto it = models.find(entry.first);
+            if (it != models.end()) entry.second.model = it->second;
+            clients.push_back(entry.second);
+        }
+    }
+    statsPublisher.publish(clients, static_cast<uint64_t>(nowNs));
+}
+
+bool Scheduler::dumpRecording(const std::string& path, int64_t windowNs) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return recorder.dump(path, policy->name(), windowNs);
+}
+
+void Scheduler::setRecording(bool on) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    recorder.setActive(on, *policy);
+}
+
+bool Scheduler::isRecording() {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return recorder.recording();
+}
+
+// ===== 运维控制 =====
+
+bool Scheduler::resolveClient(const std::string& client, std::string& clientKey, std::string& error) {
+    if (client.find(':') != std::string::npos) {
+        clientKey = client;
+        return true;
+    }
+    std::vector<std::string> matches;
+    {
+        std::lock_guard<std::mutex> lock(policyMutex);
+        for (const auto& entry : attached) {
+            if (entry.first.compare(entry.first.find(':') + 1, std::string::npos, client) == 0) {
+                matches.push_back(entry.first);
+            }
+        }
+    }
+    if (matches.size() == 1) {
+        clientKey = matches[0];
+        return true;
+    }
+    error = matches.empty() ? "no online client '" + client + "' (use <type>:<id> for offline clients)"
+                            : "'" + client + "' is ambiguous, use <type>:<id>";
+    return false;
+}
+
+ClientControl Scheduler::getClientControl(const std::string& clientKey) {
+    std::shared_ptr<const ControlTable> table = std::atomic_load(&controls);
+    auto it = table->clients.find(clientKey);
+    return it != table->clients.end() ? it->second : ClientControl();
+}
+
+void Scheduler::setClientControl(const std::string& clientKey, const ClientControl& control) {
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        std::shared_ptr<const ControlTable> current = std::atomic_load(&controls);
+        std::shared_ptr<ControlTable> next = std::make_shared<ControlTable>(*current);
+        next->version = current->version + 1;
+        if (control.isDefault()) next->clients.erase(clientKey);
+        else next->clients[clientKey] = control;
+        std::atomic_store(&controls, std::shared_ptr<const ControlTable>(next));
+        controlVersion.store(next->version, std::memory_order_release);
+    }
+    controlCv.notify_all();
+
+    std::lock_guard<std::mutex> lock(policyMutex);
+    int64_t now = monoNowNs();
+    policy->onClientControl(clientKey, control, now);
+    recorder.recordControl(now, clientKey, control);
+    recorder.maybeCheckpoint(*policy);
+}
+
+bool Scheduler::admit(IChannel& channel, SessionStats& stats, const std::string& clientKey, uint64_t& seenVersion,
+                      ClientControl& control, double& tokens, int64_t& refillNs) {
+    for (;;) {
+        // 快速路径: 版本未变且没有暂停/配额时只有一次原子读
+        uint64_t version = controlVersion.load(std::memory_order_acquire);
+        if (version != seenVersion) {
+            std::shared_ptr<const ControlTable> table = std::atomic_load(&controls);
+            auto it = table->clients.find(clientKey);
+            ClientControl next = it != table->clients.end() ? it->second : ClientControl();
+            if (next.quota != control.quota) {
+                tokens = next.quota;
+                refillNs = monoNowNs();
+            }
+            control = next;
+            seenVersion = table->version;
+            stats.paused.store(control.paused, std::memory_order_relaxed);
+        }
+        if (!control.paused && control.quota == 0) return true;
+        if (!running || !channel.isConnected()) return false;
+
+        channel.flush();
+        int64_t now = monoNowNs();
+        int64_t waitNs = CONTROL_WAIT_MS * 1000000ll;
+        if (!control.paused) {
+            // 令牌桶: 每秒补充 quota 个，最多积攒 1 秒
+            tokens += static_cast<double>(now - refillNs) * control.quota / 1e9;
+            if (tokens > control.quota) tokens = control.quota;
+            refillNs = now;
+            if (tokens >= 1) {
+                tokens -= 1;
+                return true;
+            }
+            int64_t needNs = static_cast<int64_t>((1 - tokens) * 1e9 / control.quota) + 1;
+            if (needNs < waitNs) waitNs = needNs;
+        }
+        waitingSessions.fetch_add(1, std::memory_order_relaxed);
+        stats.waiting.store(true, std::memory_order_relaxed);
+        {
+            std::unique_lock<std::mutex> lock(controlMutex);
+            if (controlVersion.load(std::memory_order_relaxed) == seenVersion) {
+                controlCv.wait_for(lock, std::chrono::nanoseconds(waitNs));
+            }
+        }
+        stats.waiting.store(false, std::memory_order_relaxed);
+        waitingSessions.fetch_sub(1, std::memory_order_relaxed);
+        stats.throttledNs.fetch_add(static_cast<uint64_t>(monoNowNs() - now), std::memory_order_relaxed);
+    }
+}
+
+void Scheduler::hold(IChannel& channel, SessionStats& stats, int64_t holdNs) {
+    channel.flush();
+    int64_t start = monoNowNs();
+    int64_t deadline = start + holdNs;
+    for (int64_t now = start; now < deadline && running && channel.isConnected(); now = monoNowNs()) {
+        int64_t sliceNs = std::min<int64_t>(deadline - now, CONTROL_WAIT_MS * 1000000ll);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(sliceNs));
+    }
+    stats.heldNs.fetch_add(static_cast<uint64_t>(monoNowNs() - start), std::memory_order_relaxed);
+}
+
+std::string Scheduler::listClients() {
+    std::shared_ptr<const ControlTable> table = std::atomic_load(&controls);
+    int64_t now = monoNowNs();
+
+    std::ostringstream ss;
+    ss << std::left << std::setw(8) << "SESSION" << std::setw(36) << "CLIENT" << std::setw(9) << "PHASE"
+       << std::setw(8) << "STATE" << std::right << std::setw(12) << "KERNELS" << std::setw(11) << "RATE/s"
+       << std::setw(13) << "THROTTLED_ms" << "  CONTROL\n";
+    std::map<std::string, bool> online;
+    // 会话统计随会话的内存区释放，整个列出过程持锁
+    std::unique_lock<std::mutex> sessionsLock(sessionsMutex);
+    for (const auto& entry : sessions) {
+        SessionStats* stats = entry.second;
+        uint64_t kernels = stats->kernels.load(std::memory_order_relaxed);
+        int64_t sinceNs = stats->listedNs ? stats->listedNs : stats->startNs;
+        uint64_t sinceKernels = stats->listedNs ? stats->listedKernels : 0;
+        double rate = now > sinceNs ? (kernels - sinceKernels) * 1e9 / (now - sinceNs) : 0;
+        stats->listedKernels = kernels;
+        stats->listedNs = now;
+
+        auto it = table->clients.find(stats->clientKey);
+        online[stats->clientKey] = true;
+        ss << std::left << std::setw(8) << ("#" + std::to_string(stats->sessionId)) << std::setw(36) << stats->clientKey
+           << std::setw(9) << phaseName(static_cast<ClientPhase>(stats->phase.load(std::memory_order_relaxed)))
+           << std::setw(8) << (stats->paused.load(std::memory_order_relaxed) ? "paused" : "running") << std::right
+           << std::setw(12) << kernels << std::setw(11) << std::fixed << std::setprecision(1) << rate
+           << std::setw(13) << stats->throttledNs.load(std::memory_order_relaxed) / 1000000 << "  "
+           << (it != table->clients.end() ? formatControl(it->second) : "-") << "\n";
+    }
+    sessionsLock.unlock();
+    // 设置了控制参数但当前不在线的客户端
+    for (const auto& entry : table->clients) {
+        if (online.count(entry.first)) continue;
+        ss << std::left << std::setw(8) << "-" << std::setw(36) << entry.first << std::setw(9) << "-"
+           << std::setw(8) << "offline" << std::right << std::setw(12) << "-" << std::setw(11) << "-"
+           << std::setw(13) << "-" << "  " << formatControl(entry.second) << "\n";
+    }
+    return ss.str();
+}
+
+std::string Scheduler::statistics() {
+    size_t phases[3] = {0, 0, 0};
+    size_t paused = 0, count = 0;
+    uint64_t throttledNs = 0, heldNs = 0;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        for (const auto& entry : sessions) {
+            int phase = entry.second->phase.load(std::memory_order_relaxed);
+            phases[phase >= 0 && phase < 3 ? phase : 0]++;
+            if (entry.second->paused.load(std::memory_order_relaxed)) paused++;
+            throttledNs += entry.second->throttledNs.load(std::memory_order_relaxed);
+            heldNs += entry.second->heldNs.load(std::memory_order_relaxed);
+            count++;
+        }
+    }
+    size_t costFamilies, costCapacity, predictorFamilies;
+    double predictorError;
+    {
+        std::lock_guard<std::mutex> lock(policyMutex);
+        costFamilies = costStore.size();
+        costCapacity = costStore.capacity();
+        predictorFamilies = predictor.families();
+        predictorError = predictor.recentError();
+    }
+    ArenaPoolStats arenas = arenaPoolStats();
+    std::shared_ptr<const ControlTable> table = std::atomic_load(&controls);
+    std::ostringstream ss;
+    ss << "policy " << policyName() << "\n"
+       << "sessions " << count << " (prefill " << phases[1] << ", decode " << phases[2] << ", unknown "
+       << phases[0] << ", paused " << paused << ")\n"
+       << "kernels " << totalKernels.load(std::memory_order_relaxed) << "\n"
+       << "throttled_ms " << throttledNs / 1000000 << " (online sessions)\n"
+       << "held_ms " << heldNs / 1000000 << " (online sessions)\n"
+       << "controls " << table->clients.size() << " (version " << table->version << ")\n"
+       << "cost_store " << costFamilies << "/" << costCapacity << " entries\n"
+       << "predictor " << predictorFamilies << " families, recent error " << std::fixed << std::setprecision(1)
+       << predictorError * 100 << "%\n"
+       << "session_arenas " << arenas.liveArenas << " (" << arenas.liveBytes / 1024 << " KiB), pooled chunks "
+       << arenas.pooledChunks << ", mapped " << arenas.mapped << ", reused " << arenas.reused << "\n"
+       << "recording " << (isRecording() ? "on" : "off") << "\n";
+    return ss.str();
+}
+
+std::string Scheduler::describePredictor() {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return predictor.describe();
+}
+
+std::string Scheduler::describePolicy() {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return policy->describe();
 }
 
-std::pair<bool, std::string> Scheduler::makeDecision(const std::string& kernelType) {
-    // 核心调度算法
-    return {true, "OK"};
+LoadCounters Scheduler::loadCounters() {
+    LoadCounters c;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        for (const auto& entry : sessions) {
+            ClientPhase phase = static_cast<ClientPhase>(entry.second->phase.load(std::memory_order_relaxed));
+            if (phase == ClientPhase::Prefill) c.prefill++;
+            else if (phase == ClientPhase::Decode) c.decode++;
+        }
+        c.sessions = static_cast<uint32_t>(sessions.size());
+    }
+    c.waiting = waitingSessions.load(std::memory_order_relaxed);
+    c.kernels = totalKernels.load(std::memory_order_relaxed);
+    c.busyNs = busyNs.load(std::memory_order_relaxed);
+    return c;
 }
 
-std::vector<std::string> split(const std::string& s, char delimiter) {
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream(s);
-    while (std::getline(tokenStream, token, delimiter)) {
-        tokens.push_back(token);
+namespace {
+
+// 消息中的一个字段: 指向接收缓冲区内部，不复制
+struct Field {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    bool empty() const { return size == 0; }
+    bool equals(const char* s) const { return strlen(s) == size && memcmp(data, s, size) == 0; }
+    bool equals(const std::string& s) const { return s.size() == size && memcmp(data, s.data(), size) == 0; }
+    // 数字字段之后是 '|' 或消息结尾，strtoll 在此停下
+    long long toLL() const { return size ? strtoll(data, nullptr, 10) : 0; }
+};
+
+constexpr size_t MAX_FIELDS = 5;
+
+// 按 '|' 切分，最多 MAX_FIELDS 个字段 (之后的内容忽略)；与 getline 切分一致，末尾的空字段不计
+size_t splitFields(const std::string& s, Field (&out)[MAX_FIELDS]) {
+    size_t n = 0;
+    const char* p = s.data();
+    const char* end = p + s.size();
+    while (p < end && n < MAX_FIELDS) {
+        const char* bar = static_cast<const char*>(memchr(p, '|', end - p));
+        const char* stop = bar ? bar : end;
+        out[n].data = p;
+        out[n].size = stop - p;
+        n++;
+        if (!bar) break;
+        p = bar + 1;
     }
-    return tokens;
+    return n;
+}
+
+void appendInt(ArenaString& out, long long v) {
+    char buf[24];
+    int len = snprintf(buf, sizeof(buf), "%lld", v);
+    out.append(buf, len);
 }
 
+} // namespace
+
 void Scheduler::onNewClient(std::unique_ptr<IChannel> channel) {
-    LogManager::instance().sessionIdIncrement();
-    // 转移 channel 所有权给线程
+    // 转移 channel 所有权给线程；会话号在锁内分配，避免并发接入的会话读到同一个号
     std::lock_guard<std::mutex> lock(threadsMutex);
-    workers.emplace_back(&Scheduler::clientHandler, this, std::move(channel));
+    LogManager::instance().sessionIdIncrement();
+    long long sessionId = LogManager::instance().getSessionId();
+    workers.emplace_back(&Scheduler::clientHandler, this, std::move(channel), sessionId);
 }
 
-void Scheduler::clientHandler(std::unique_ptr<IChannel> channel) {
+void Scheduler::clientHandler(std::unique_ptr<IChannel> channel, long long sessionId) {
     std::stringstream ss;
-    long long sessionId = LogManager::instance().getSessionId();
     std::string clientKey = channel->getType() + ":" + channel->getId();
     ss << "[Scheduler] Session #" << sessionId << " started for " 
        << clientKey << " (SHM: " << channel->getName() << ")";
     std::cout << ss.str() << std::endl;
 
+    // 会话内存区: 在本线程建立，页面落在本线程所在的 NUMA 节点；会话结束时整体归还
+    SessionArena arena;
+
+    attachClient(clientKey, channel->getType());
+    activeSessions++;
+    SessionStats* stats = arena.create<SessionStats>();
+    stats->sessionId = sessionId;
+    stats->clientKey = clientKey;
+    stats->startNs = monoNowNs();
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions[sessionId] = stats;
+    }
     channel->setReady();
 
+    // 控制参数的本地副本 (版本变化时刷新) 与配额令牌桶
+    uint64_t controlSeen = ~0ull;
+    ClientControl control;
+    double tokens = 0;
+    int64_t refillNs = 0;
+
+    // 会话期间处理线程的缺页 (通道已在接入时预取时应接近 0)
+    long minorStart, majorStart;
+    threadFaults(minorStart, majorStart);
+
+    // 热路径上的缓冲区在会话内复用: 稳态下接收、解析、决策、记日志、回复都不分配内存
     std::string message;
     std::string the_unique_id;
+    std::string model = channel->getType();
+    std::string telemetryKernel;
+    ArenaString line{ArenaAllocator<char>(arena)};
+    std::string launchText;
+    std::string response;
+    PolicyRequest req{clientKey, std::string(), std::string(), LaunchMeta(), 0};
+    Field parts[MAX_FIELDS];
+    // 预留到常见长度，reqId 位数增长等不会在稳态中触发扩容
+    message.reserve(STREAM_MAX_FRAME);
+    line.reserve(512);
+    response.reserve(128);
+    // 当前 unique_id 的日志器，只在 unique_id 变化时向 LogManager 查询
+    std::string loggerId;
+    std::shared_ptr<Logger> logger;
+    // 最近一条带启动参数的请求: 遥测没有附带参数时按 reqId 沿用 (通常紧跟在请求之后)
+    LaunchMeta lastLaunch;
+    long long lastLaunchReq = -1;
+    bool launchWarned = false;
     while (running && channel->isConnected()) {
         // 阻塞接收 (底层实现忙等待)
         if (!channel->recvBlocking(message)) {
@@ -70,39 +599,106 @@ void Scheduler::clientHandler(std::unique_ptr<IChannel> channel) {
             message.pop_back();
         }
 
-        auto parts = split(message, '|');
-        if (parts.size() < 3) {
+        size_t numParts = splitFields(message, parts);
+        if (numParts < 3) {
             continue;
         }
 
-        std::string kernelType = parts[0];     
-        std::string reqId = parts[1];  
-        std::string client_id = parts[2];
-        std::string unique_id = parts.size() >=4 ? parts[3] : client_id;
+        // 启动参数在请求与遥测中都是第 5 个字段
+        LaunchMeta& launch = req.launch;
+        launch = LaunchMeta();
+        if (numParts >= 5 && !parseLaunchMeta(parts[4].data, parts[4].data + parts[4].size, launch) &&
+            !launchWarned) {
+            launchWarned = true;
+            std::cout << "[Scheduler] " << clientKey << " sent malformed launch metadata '"
+                      << std::string(parts[4].data, parts[4].size) << "', ignoring it" << std::endl;
+        }
+
+        // 遥测: 客户端上报 kernel 实际耗时，不回复
+        if (parts[0].equals(TELEMETRY_PREFIX)) {
+            if (numParts >= 4) {
+                int64_t durationNs = parts[3].toLL();
+                if (durationNs > 0) {
+                    stats->busyNs.fetch_add(static_cast<uint64_t>(durationNs), std::memory_order_relaxed);
+                }
+                if (launch.empty() && lastLaunchReq >= 0 && parts[2].toLL() == lastLaunchReq) {
+                    launch = lastLaunch;
+                }
+                telemetryKernel.assign(parts[1].data, parts[1].size);
+                reportTelemetry(clientKey, model, telemetryKernel, launch, durationNs);
+            }
+            continue;
+        }
+        // 模型声明，不回复
+        if (parts[0].equals(MODEL_PREFIX)) {
+            if (!parts[1].empty() && !parts[1].equals(model)) {
+                model.assign(parts[1].data, parts[1].size);
+                setClientModel(clientKey, model);
+            }
+            continue;
+        }
+
+        req.kernelType.assign(parts[0].data, parts[0].size);
+        req.reqId.assign(parts[1].data, parts[1].size);
+        const Field& client_id = parts[2];
+        const Field& unique_id = numParts >= 4 ? parts[3] : client_id;
         if (the_unique_id.empty()) {
-            the_unique_id = unique_id;
+            the_unique_id.assign(unique_id.data, unique_id.size);
+        }
+        if (!logger || !unique_id.equals(loggerId)) {
+            loggerId.assign(unique_id.data, unique_id.size);
+            logger = LogManager::instance().getLogger(loggerId);
         }
 
-        LogManager::instance().getLogger(unique_id)->kernelIdIncrement();
-        long long kernelId = LogManager::instance().getLogger(unique_id)->getKernelId();
-        LogManager::instance().getLogger(unique_id)->recordKernelStat(kernelType);
+        logger->kernelIdIncrement();
+        long long kernelId = logger->getKernelId();
+        logger->recordKernelStat(req.kernelType);
 
-        ss.str("");
-        ss << "Kernel " << kernelId << ": " << kernelType << " from " << client_id;
-        LogManager::instance().getLogger(unique_id)->write(ss.str());
+        line.assign("Kernel ");
+        appendInt(line, kernelId);
+        line.append(": ").append(req.kernelType.data(), req.kernelType.size()).append(" from ")
+            .append(client_id.data, client_id.size);
+        if (!launch.empty()) {
+            formatLaunchMeta(launch, launchText);
+            line.append(" [").append(launchText.data(), launchText.size()).append("]");
+            lastLaunch = launch;
+            lastLaunchReq = strtoll(req.reqId.c_str(), nullptr, 10);
+        }
+        logger->write(line.data(), line.size());
+
+        ClientPhase phase = inferPhase(req.kernelType);
+        if (phase != ClientPhase::Unknown) stats->phase.store(static_cast<int>(phase), std::memory_order_relaxed);
+        // 暂停或超出配额时在这里等待，客户端的 kernel 随之阻塞
+        if (!admit(*channel, *stats, clientKey, controlSeen, control, tokens, refillNs)) break;
+        stats->kernels.fetch_add(1, std::memory_order_relaxed);
+        totalKernels.fetch_add(1, std::memory_order_relaxed);
 
         // 决策
-        auto decision = makeDecision(kernelType);
+        req.predictedNs = 0;
+        PolicyDecision decision = makeDecision(req, model);
+        // 策略要求扣住时推迟回复 (如重 kernel 等待其他客户端的重 kernel 做完)
+        if (decision.holdNs > 0) hold(*channel, *stats, decision.holdNs);
         
         // 构建响应
-        std::string response = reqId + "|" + (decision.first ? "1" : "0") + "|" + decision.second + "\n";
+        response.assign(req.reqId).append(decision.allow ? "|1|" : "|0|").append(decision.reason).append("\n");
         
         if (!channel->sendBlocking(response)) {
-            LogManager::instance().getLogger(unique_id)->write("[Scheduler] Send timeout for " + clientKey);
+            logger->write("[Scheduler] Send timeout for " + clientKey);
         }
     }
+    logger.reset();
+    detachClient(clientKey);
+    activeSessions--;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions.erase(sessionId);
+    }
+    stats->~SessionStats();
     LogManager::instance().removeLogger(the_unique_id);
+    long minorEnd, majorEnd;
+    threadFaults(minorEnd, majorEnd);
     ss.str("");
-    ss << "[Scheduler] Session #" << sessionId << " ended (" << clientKey << ")";
+    ss << "[Scheduler] Session #" << sessionId << " ended (" << clientKey << "), faults "
+       << (minorEnd - minorStart) << " minor / " << (majorEnd - majorStart) << " major";
     std::cout << ss.str() << std::endl;
 }
\ No newline at end of file
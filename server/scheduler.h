@@ -1,33 +1,161 @@
 #pragma once
 #include "ipc.h"
+#include "policy.h"
+#include "recorder.h"
+#include "cost_store.h"
+#include "stats_shm.h"
+#include "predictor.h"
 #include <vector>
 #include <thread>
 #include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <condition_variable>
+
+// 运行阶段 (ClientPhase，定义在 stats_shm.h)，由 attention kernel 的名字推断
+const char* phaseName(ClientPhase phase);
+ClientPhase inferPhase(const std::string& kernelType);
+
+// 本节点负载的累计计数 (联邦层按两次采样之差计算速率与利用率)
+struct LoadCounters {
+    uint32_t sessions = 0;
+    uint32_t prefill = 0;
+    uint32_t decode = 0;
+    uint32_t waiting = 0;        // 正被暂停或配额挡住的会话
+    uint64_t kernels = 0;
+    uint64_t busyNs = 0;         // 遥测上报的 kernel 耗时之和
+};
 
 class Scheduler {
 public:
-    Scheduler();
+    // recordEvents 为 0 时关闭决策录制
+    Scheduler(std::unique_ptr<IPolicy> policy, size_t recordEvents);
     ~Scheduler();
 
     // 收到新连接的回调
     void onNewClient(std::unique_ptr<IChannel> channel);
-    
+
     // 停止所有服务
     void stop();
-    
+
     // 获取活跃连接数
     size_t getActiveCount();
 
+    // 换用新的策略实例 (SIGHUP / reload)，不断开客户端: 已接入的客户端会重新 attach 到新策略，
+    // 录制从此刻以新策略重新开始
+    void replacePolicy(std::unique_ptr<IPolicy> next);
+    std::string policyName();
+    // 当前策略是否解释控制字段 (IPolicy::honoursControl)
+    bool policyHonours(const std::string& field);
+
+    // 打开 kernel 代价模型存储 (在接入客户端之前调用)；未打开时不保存也不加载先验
+    bool openCostStore(const std::string& path, size_t capacity);
+    // 创建统计共享内存，之后由 tick 线程每 STATS_PUBLISH_MS 发布一次在线客户端的计数
+    bool openStatsShm(const std::string& name);
+
+    // 导出决策录制 (windowNs > 0 时只导出最近一段时间)
+    bool dumpRecording(const std::string& path, int64_t windowNs);
+    // 暂停/恢复决策录制
+    void setRecording(bool on);
+    bool isRecording();
+
+    // ===== 运维控制 (控制套接字) =====
+    // client 可以是完整的 "<type>:<uniqueId>"，也可以是在线客户端中唯一的 uniqueId；失败时 error 给出原因
+    bool resolveClient(const std::string& client, std::string& clientKey, std::string& error);
+    ClientControl getClientControl(const std::string& clientKey);
+    // 发布新的控制表并通知策略；会话线程在下一条请求时看到新版本
+    void setClientControl(const std::string& clientKey, const ClientControl& control);
+
+    // 在线客户端列表 (速率为距上次列出的平均值) 与汇总统计
+    std::string listClients();
+    std::string statistics();
+    // 耗时预测器的逐族误差
+    std::string describePredictor();
+    // 当前策略的状态表 (策略没有时为空)
+    std::string describePolicy();
+    LoadCounters loadCounters();
+
 private:
-    void clientHandler(std::unique_ptr<IChannel> channel);
-    
-    // 业务逻辑
-    std::pair<bool, std::string> makeDecision(const std::string& kernelType);
+    // 控制表: 不可变快照，整体替换；会话线程只在版本号变化时重新读取
+    struct ControlTable {
+        uint64_t version = 0;
+        std::map<std::string, ClientControl> clients;
+    };
+
+    // 单个会话的计数，由会话线程更新、控制线程读取
+    struct SessionStats {
+        long long sessionId = 0;
+        std::string clientKey;
+        int64_t startNs = 0;
+        std::atomic<uint64_t> kernels{0};
+        std::atomic<uint64_t> throttledNs{0};
+        std::atomic<uint64_t> heldNs{0};         // 策略要求扣住回复的时间
+        std::atomic<int> phase{0};
+        std::atomic<bool> paused{false};
+        std::atomic<bool> waiting{false};        // 正在 admit 中等待
+        std::atomic<uint64_t> busyNs{0};         // 遥测耗时之和
+        // 上次列出时的快照 (仅控制线程访问)
+        uint64_t listedKernels = 0;
+        int64_t listedNs = 0;
+    };
+
+    // 按控制参数放行一条请求: 暂停时等待恢复，超出配额时等待令牌；会话结束时返回 false
+    bool admit(IChannel& channel, SessionStats& stats, const std::string& clientKey, uint64_t& seenVersion,
+               ClientControl& control, double& tokens, int64_t& refillNs);
+    // 按决策的 holdNs 扣住回复 (分段睡眠，停止或断开时提前返回)
+    void hold(IChannel& channel, SessionStats& stats, int64_t holdNs);
+
+    void clientHandler(std::unique_ptr<IChannel> channel, long long sessionId);
+    void tickLoop();
+    void publishStats(int64_t nowNs);
+
+    // 业务逻辑 (串行调用策略并录制输入)；决策前填入 req.predictedNs
+    PolicyDecision makeDecision(PolicyRequest& req, const std::string& model);
+    void reportTelemetry(const std::string& clientKey, const std::string& model, const std::string& kernelType,
+                         const LaunchMeta& launch, int64_t durationNs);
+    void attachClient(const std::string& clientKey, const std::string& clientType);
+    // 客户端声明模型 ("#M")，换用该模型的先验
+    void setClientModel(const std::string& clientKey, const std::string& model);
+    // 把模型的历史代价逐族交给策略 (policyMutex 内调用)，返回族数
+    size_t deliverPriors(const std::string& clientKey, const std::string& model, int64_t nowNs);
+    void detachClient(const std::string& clientKey);
+
+    // 策略与录制器共用一把锁，录制顺序即策略调用顺序
+    std::mutex policyMutex;
+    std::unique_ptr<IPolicy> policy;
+    DecisionRecorder recorder;
+    // 已接入的客户端 (clientKey -> clientType, 会话数)，换策略时重新 attach
+    std::map<std::string, std::pair<std::string, int>> attached;
+    // 客户端声明的模型 (未声明时为客户端类型)
+    std::map<std::string, std::string> models;
+    // 代价模型存储，在 policyMutex 内更新
+    CostStore costStore;
+    int64_t costSyncNs = 0;
+    // 形状感知的耗时预测，由遥测在线更新，在 policyMutex 内访问
+    LatencyPredictor predictor;
+
+    // 统计共享内存，只由 tick 线程发布
+    std::mutex statsMutex;
+    StatsPublisher statsPublisher;
+    int64_t statsPublishNs = 0;
+
+    std::mutex controlMutex;
+    std::condition_variable controlCv;
+    std::shared_ptr<const ControlTable> controls;   // std::atomic_load/atomic_store
+    std::atomic<uint64_t> controlVersion{0};
+
+    std::mutex sessionsMutex;
+    // 会话统计位于各会话的内存区中，只在 sessionsMutex 内访问；会话线程先移除再释放
+    std::map<long long, SessionStats*> sessions;
+    std::atomic<uint64_t> totalKernels{0};
+    std::atomic<uint64_t> busyNs{0};
+    std::atomic<uint32_t> waitingSessions{0};
 
     // 线程管理
     std::atomic<bool> running{true};
     std::mutex threadsMutex;
     std::vector<std::thread> workers;
+    std::atomic<size_t> activeSessions{0};
+    std::thread tickThread;
 };
\ No newline at end of file
@@ -0,0 +1,417 @@
+#include "shm_client.h"
+#include "memfd_proto.h"
+#include "stream_proto.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// 忙等待时每隔若干次让出 CPU，避免与调度器线程在同一核上互相饿死
+inline void spinPause(unsigned& spins) {
+    if ((++spins & 0xff) == 0) {
+        sched_yield();
+    } else {
+        __asm__ __volatile__("pause" ::: "memory");
+    }
+}
+
+uint32_t envU32(const char* name, uint32_t fallback) {
+    const char* v = std::getenv(name);
+    return (v && *v) ? static_cast<uint32_t>(strtoul(v, nullptr, 10)) : fallback;
+}
+
+uint32_t floorPow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p <= v / 2) p <<= 1;
+    return p;
+}
+
+inline long long elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+ShmClient::ShmClient(const std::string& type, const std::string& id)
+    : clientType(type), uniqueId(id), model(std::getenv("KS_MODEL") ? std::getenv("KS_MODEL") : ""), registry(nullptr),
+      wantSlotCount(envU32("KS_SLOT_COUNT", SPSC_QUEUE_SIZE)), wantSlotSize(envU32("KS_SLOT_SIZE", SPSC_MSG_SIZE)),
+      reattachMs(static_cast<int>(envU32("KS_REATTACH_MS", CLIENT_REATTACH_MS))),
+      transport(Transport::Shm), memfdSocketPath(defaultMemfdSocketPath()), memfdSock(-1), streamAddress("tcp"),
+      streamSock(-1), streamInPos(0), slot(-1), heartbeat(&localHeartbeat) {
+    const char* spec = std::getenv("KS_TRANSPORT");
+    if (spec && *spec && !setTransport(spec)) {
+        std::cerr << "[ShmClient] Unknown KS_TRANSPORT '" << spec << "', using shm" << std::endl;
+    }
+}
+
+ShmClient::~ShmClient() {
+    disconnect();
+}
+
+bool ShmClient::openRegistry(int timeoutMs) {
+    // 调度器可能把注册表放在 hugetlbfs 上，先找大页文件
+    std::string name = std::string(SHM_NAME_SCHEDULER) + get_user_suffix();
+    std::string hugePath = hugePagePath(name);
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        // 注册表大小取决于调度器配置的容量，映射整个对象
+        if ((!hugePath.empty() && openSegment(hugePath, 0, registrySegment, clientSegmentFlags())) ||
+            openSegment(name, 0, registrySegment, clientSegmentFlags())) {
+            registry = static_cast<ClientRegistry*>(registrySegment.addr);
+            // 旧版调度器的注册表更小、没有 magic，不会被当成可用的注册表
+            if (registrySegment.length >= sizeof(ClientRegistry) && registry->magic == REGISTRY_MAGIC &&
+                registry->layout_version == REGISTRY_LAYOUT_VERSION &&
+                registry->scheduler_ready.load(std::memory_order_acquire) &&
+                registry->segment_capacity > 0 &&
+                registrySegment.length >= registryBytes(registry->segment_capacity)) {
+                return true;
+            }
+            unmapSegment(registrySegment);
+            registry = nullptr;
+        }
+        if (timeoutMs >= 0 && elapsedMs(start) > timeoutMs) return false;
+        usleep(10000);
+    }
+}
+
+void ShmClient::setGeometry(uint32_t slotCount, uint32_t slotSize) {
+    if (slotCount) wantSlotCount = slotCount;
+    if (slotSize) wantSlotSize = slotSize;
+}
+
+void ShmClient::setTransport(Transport t, const std::string& address) {
+    transport = t;
+    if (address.empty()) return;
+    if (t == Transport::Memfd) memfdSocketPath = address;
+    else if (t == Transport::Stream) streamAddress = address;
+}
+
+bool ShmClient::setTransport(const std::string& spec) {
+    StreamAddress addr;
+    if (spec == "shm") setTransport(Transport::Shm);
+    else if (spec == "memfd") setTransport(Transport::Memfd);
+    else if (parseStreamAddress(spec, addr)) setTransport(Transport::Stream, spec);
+    else return false;
+    return true;
+}
+
+// 连接调度器的流式套接字并完成 HELLO / READY 握手
+bool ShmClient::connectStream(int timeoutMs) {
+    StreamAddress addr;
+    if (!parseStreamAddress(streamAddress, addr)) return false;
+    auto start = std::chrono::steady_clock::now();
+    while ((streamSock = ::connectStream(addr)) == -1) {
+        if (timeoutMs >= 0 && elapsedMs(start) > timeoutMs) return false;
+        usleep(10000);
+    }
+    std::string hello = "HELLO|" + clientType + "|" + uniqueId;
+    appendFrame(streamOut, hello.data(), hello.size());
+    std::string reply;
+    int remaining = timeoutMs < 0 ? -1 : std::max(0, timeoutMs - static_cast<int>(elapsedMs(start)));
+    if (!flushStream() || !readFrame(reply, remaining) || reply != "READY") return false;
+    shmName = addr.toString();
+    return true;
+}
+
+bool ShmClient::flushStream() {
+    if (streamOut.empty()) return true;
+    bool ok = writeFull(streamSock, streamOut.data(), streamOut.size());
+    streamOut.clear();
+    return ok;
+}
+
+bool ShmClient::readFrame(std::string& out, int timeoutMs) {
+    auto start = std::chrono::steady_clock::now();
+    while (streamSock != -1) {
+        int r = takeFrame(streamIn, streamInPos, out);
+        if (r > 0) return true;
+        if (r < 0) break;
+        streamIn.erase(0, streamInPos);
+        streamInPos = 0;
+        int wait = timeoutMs < 0 ? -1 : std::max(0, timeoutMs - static_cast<int>(elapsedMs(start)));
+        struct pollfd pfd;
+        pfd.fd = streamSock;
+        pfd.events = POLLIN;
+        int n = poll(&pfd, 1, wait);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        char buf[16384];
+        ssize_t got = ::recv(streamSock, buf, sizeof(buf), 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        streamIn.append(buf, static_cast<size_t>(got));
+    }
+    // 调度器关闭了连接或发来非法帧
+    if (streamSock != -1) {
+        close(streamSock);
+        streamSock = -1;
+    }
+    return false;
+}
+
+// 连接调度器的 memfd 套接字，发送身份与期望几何，映射收到的通道
+bool ShmClient::connectMemfd(int timeoutMs) {
+    struct sockaddr_un addr;
+    if (memfdSocketPath.size() >= sizeof(addr.sun_path)) return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, memfdSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        memfdSock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (memfdSock == -1) return false;
+        if (::connect(memfdSock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0) break;
+        close(memfdSock);
+        memfdSock = -1;
+        if (timeoutMs >= 0 && elapsedMs(start) > timeoutMs) return false;
+        usleep(10000);
+    }
+
+    std::string reply;
+    int fd = -1;
+    std::string reg = "REG|" + clientType + "|" + uniqueId + "|" + std::to_string(wantSlotCount) + "|" +
+                      std::to_string(wantSlotSize);
+    if (!sendMessage(memfdSock, reg) || !recvMessage(memfdSock, reply, &fd) || reply.compare(0, 3, "OK|") != 0 ||
+        fd == -1) {
+        if (fd != -1) close(fd);
+        return false;
+    }
+    bool ok = mapSegmentFd(fd, channelSegment, clientSegmentFlags());
+    close(fd);
+    std::string error;
+    if (!ok || !bindChannel(channelSegment.addr, channelSegment.length, MAX_SLOT_COUNT, MAX_SLOT_SIZE, view, error)) {
+        unmapSegment(channelSegment);
+        return false;
+    }
+    shmName = "memfd:" + clientType + "_" + uniqueId + "_" + std::to_string(getpid());
+    return true;
+}
+
+bool ShmClient::createChannel() {
+    const char* prefix = (clientType == "sglang") ? SHM_NAME_PREFIX_SGLANG : SHM_NAME_PREFIX_PYTORCH;
+    shmName = std::string(prefix) + uniqueId + "_" + std::to_string(getpid());
+
+    // 按调度器公布的上限收紧几何
+    uint32_t slotCount = floorPow2(std::min(std::max(wantSlotCount, MIN_SLOT_COUNT), registry->max_slot_count));
+    uint32_t slotSize = std::min(std::max(wantSlotSize, MIN_SLOT_SIZE), registry->max_slot_size);
+    if (!validGeometry(slotCount, slotSize, registry->max_slot_count, registry->max_slot_size)) return false;
+
+    shm_unlink(shmName.c_str());
+    std::string hugePath = hugePagePath(shmName);
+    if (!hugePath.empty()) unlinkSegment(hugePath);
+    // 注册表中的 shm_name 字段装不下的大页路径会回退到普通 shm
+    if (!createSegment(shmName, channelBytes(slotCount, slotSize), sizeof(ClientRegistryEntry::shm_name),
+                       true, hugePagesRequested(), channelSegment, clientSegmentFlags())) {
+        return false;
+    }
+    formatChannel(channelSegment.addr, slotCount, slotSize, view);
+    return true;
+}
+
+// 在已开放的段中用 CAS 抢占 alloc_bits 的空位；都满了则 CAS 开放下一段。
+// 填写完元数据后再置 active 并登记 pending，保证调度器看到时条目内容已完整
+bool ShmClient::claimSlot() {
+    while (true) {
+        uint32_t count = registry->segment_count.load(std::memory_order_acquire);
+        for (uint32_t s = 0; s < count; s++) {
+            RegistrySegment* seg = registrySegmentAt(registry, s);
+            uint64_t bits = seg->alloc_bits.load(std::memory_order_relaxed);
+            while (~bits != 0) {
+                int b = __builtin_ctzll(~bits);
+                uint64_t bit = 1ull << b;
+                if (!seg->alloc_bits.compare_exchange_weak(bits, bits | bit, std::memory_order_acq_rel)) continue;
+                publishSlot(s, b);
+                return true;
+            }
+        }
+        if (count >= registry->segment_capacity) return false;
+        registry->segment_count.compare_exchange_strong(count, count + 1, std::memory_order_acq_rel);
+    }
+}
+
+void ShmClient::publishSlot(uint32_t segIndex, int bit) {
+    RegistrySegment* seg = registrySegmentAt(registry, segIndex);
+    auto& entry = seg->entries[bit];
+    std::memset(entry.shm_name, 0, sizeof(entry.shm_name));
+    std::memset(entry.client_type, 0, sizeof(entry.client_type));
+    std::memset(entry.unique_id, 0, sizeof(entry.unique_id));
+    std::strncpy(entry.shm_name, shmName.c_str(), sizeof(entry.shm_name) - 1);
+    std::strncpy(entry.client_type, clientType.c_str(), sizeof(entry.client_type) - 1);
+    std::strncpy(entry.unique_id, uniqueId.c_str(), sizeof(entry.unique_id) - 1);
+    entry.last_heartbeat.store(monotonicNs(), std::memory_order_relaxed);
+    entry.client_pid.store(static_cast<int64_t>(getpid()), std::memory_order_relaxed);
+    entry.client_start.store(processStartTime(getpid()), std::memory_order_relaxed);
+    entry.generation.fetch_add(1, std::memory_order_relaxed);
+    entry.active.store(true, std::memory_order_release);
+    seg->pending_bits.fetch_or(1ull << bit, std::memory_order_acq_rel);
+    registry->pending_segments.fetch_or(1ull << segIndex, std::memory_order_acq_rel);
+    registry->version.fetch_add(1, std::memory_order_acq_rel);
+    slot = static_cast<int>(segIndex * REGISTRY_SEGMENT_SLOTS + bit);
+    heartbeat = &entry.last_heartbeat;
+}
+
+bool ShmClient::connect(int timeoutMs) {
+    if (isConnected()) return true;
+    auto start = std::chrono::steady_clock::now();
+    if (transport == Transport::Stream) {
+        if (!connectStream(timeoutMs)) {
+            disconnect();
+            return false;
+        }
+    } else if (transport == Transport::Memfd) {
+        if (!connectMemfd(timeoutMs)) {
+            disconnect();
+            return false;
+        }
+    } else {
+        if (!openRegistry(timeoutMs)) return false;
+        if (!createChannel() || !claimSlot()) {
+            disconnect();
+            return false;
+        }
+    }
+    unsigned spins = 0;
+    while (streamSock == -1 && !view.schedulerReady->load(std::memory_order_acquire)) {
+        if (timeoutMs >= 0 && elapsedMs(start) > timeoutMs) {
+            disconnect();
+            return false;
+        }
+        spinPause(spins);
+    }
+    if (!model.empty() && !post(std::string(MODEL_PREFIX) + "|" + model + "|0")) {
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+void ShmClient::disconnect() {
+    if (registry && slot >= 0) {
+        RegistrySegment* seg = registrySegmentAt(registry, slot / REGISTRY_SEGMENT_SLOTS);
+        int bit = slot % REGISTRY_SEGMENT_SLOTS;
+        auto& entry = seg->entries[bit];
+        entry.active.store(false, std::memory_order_release);
+        entry.client_pid.store(0, std::memory_order_release);
+        seg->alloc_bits.fetch_and(~(1ull << bit), std::memory_order_acq_rel);
+        registry->version.fetch_add(1, std::memory_order_acq_rel);
+        slot = -1;
+        heartbeat = &localHeartbeat;
+    }
+    if (channelSegment.addr) {
+        view.clientConnected->store(false, std::memory_order_release);
+        unmapSegment(channelSegment);
+        view = ChannelView();
+        if (memfdSock == -1) unlinkSegment(shmName);
+    }
+    if (streamSock != -1) {
+        flushStream();
+        close(streamSock);
+        streamSock = -1;
+        streamIn.clear();
+        streamInPos = 0;
+    }
+    streamOut.clear();
+    if (memfdSock != -1) {
+        // 关闭注册连接即通知调度器断开，memfd 随最后一个映射释放
+        close(memfdSock);
+        memfdSock = -1;
+    }
+    if (registry) {
+        unmapSegment(registrySegment);
+        registry = nullptr;
+    }
+}
+
+bool ShmClient::trySend(const char* data, size_t len) {
+    // 流式传输只追加到输出缓冲，recv / request 时一起写出
+    if (streamSock != -1) {
+        if (len > STREAM_MAX_FRAME) return false;
+        appendFrame(streamOut, data, len);
+        return true;
+    }
+    // 环会截断超长消息，截掉的 reqId/clientId 会让调度器无法应答，直接拒绝
+    if (len >= view.request.slotSize()) return false;
+    return view.request.tryPush(data, len);
+}
+
+// 调度器交接或以 --restart 重启期间 scheduler_ready 短暂为 false，等它恢复而不是立即失败
+bool ShmClient::waitScheduler() {
+    if (view.schedulerReady->load(std::memory_order_acquire)) return true;
+    auto start = std::chrono::steady_clock::now();
+    while (!view.schedulerReady->load(std::memory_order_acquire)) {
+        if (elapsedMs(start) > reattachMs) return false;
+        usleep(1000);
+    }
+    return true;
+}
+
+bool ShmClient::recv(char* out, size_t cap, int timeoutMs) {
+    if (streamSock != -1) {
+        std::string frame;
+        if (!flushStream() || !readFrame(frame, timeoutMs) || cap == 0) return false;
+        size_t len = std::min(frame.size(), cap - 1);
+        std::memcpy(out, frame.data(), len);
+        out[len] = '\0';
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    unsigned spins = 0;
+    while (!view.response.tryPop(out, cap)) {
+        if (!waitScheduler()) return false;
+        if (timeoutMs >= 0 && (spins & 0xfff) == 0 && elapsedMs(start) > timeoutMs) return false;
+        spinPause(spins);
+    }
+    return true;
+}
+
+bool ShmClient::post(const std::string& msg) {
+    if (streamSock != -1) return trySend(msg.data(), msg.size());
+    if (!isConnected() || msg.size() >= view.request.slotSize()) return false;
+    unsigned spins = 0;
+    while (!trySend(msg.data(), msg.size())) {
+        if (!waitScheduler()) return false;
+        spinPause(spins);
+    }
+    return true;
+}
+
+bool ShmClient::request(const std::string& msg, std::string& response) {
+    if (streamSock != -1) {
+        return trySend(msg.data(), msg.size()) && flushStream() && readFrame(response, -1);
+    }
+    if (!isConnected() || msg.size() >= view.request.slotSize()) return false;
+    heartbeat->store(monotonicNs(), std::memory_order_relaxed);
+    unsigned spins = 0;
+    while (!trySend(msg.data(), msg.size())) {
+        if (!waitScheduler()) return false;
+        spinPause(spins);
+    }
+    // 调度器重启后可能重新应答它已应答过的请求，跳过 reqId 不匹配的响应
+    size_t idStart = msg.find('|');
+    size_t idLen = idStart == std::string::npos ? 0 : msg.find('|', idStart + 1) - idStart - 1;
+    while (true) {
+        while (!view.response.tryPop(response)) {
+            if (!waitScheduler()) return false;
+            spinPause(spins);
+        }
+        if (idLen == 0 || (response.compare(0, idLen, msg, idStart + 1, idLen) == 0 &&
+                           response.size() > idLen && response[idLen] == '|')) {
+            return true;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "config.h"
+#include "shm_segment.h"
+#include "spsc_ring.h"
+
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @brief 共享内存协议的客户端实现
+ * 注册流程与 pytorch/sglang 侧拦截器一致: 创建通道 -> 抢占注册表空位 (分配位图 CAS) -> 等待调度器就绪。
+ * 供基准测试、PGO 训练等合成客户端使用。
+ * 设置 KS_HUGE_PAGES=1 时通道优先放在 hugetlbfs 上；通道默认预取并 mlock (KS_SHM_PIN=0 关闭)。
+ * 通道几何默认 SPSC_QUEUE_SIZE x SPSC_MSG_SIZE，可用 setGeometry 或 KS_SLOT_COUNT / KS_SLOT_SIZE 指定，
+ * 连接时按调度器公布的上限收紧。
+ * 调度器重启期间请求会等待其恢复 (最长 KS_REATTACH_MS，默认 10 s)。
+ * KS_TRANSPORT=memfd (或 setTransport) 时改走 Unix 套接字注册，由调度器下发 memfd 通道，不经过注册表。
+ * KS_TRANSPORT=tcp[:<host>:<port>] / unix[:<path>] 时不使用共享内存，改走流式套接字 (stream_proto.h)；
+ * 此时 post 的消息随下一次请求一起写出。
+ * KS_MODEL (或 setModel) 非空时连接后声明模型名，调度器据此加载该模型的 kernel 代价先验。
+ */
+class ShmClient {
+public:
+    ShmClient(const std::string& clientType, const std::string& uniqueId);
+    ~ShmClient();
+
+    ShmClient(const ShmClient&) = delete;
+    ShmClient& operator=(const ShmClient&) = delete;
+
+    enum class Transport { Shm, Memfd, Stream };
+
+    // 在 connect 之前调用；slotCount 向下取整到 2 的幂
+    void setGeometry(uint32_t slotCount, uint32_t slotSize);
+    // 在 connect 之前调用；address 为 memfd 套接字路径或流式地址 ("tcp:..." / "unix:...")，空时使用默认值
+    void setTransport(Transport transport, const std::string& address = std::string());
+    // "shm" | "memfd" | "tcp[:...]" | "unix[:...]"，无法识别时返回 false
+    bool setTransport(const std::string& spec);
+    // 在 connect 之前调用
+    void setModel(const std::string& model) { this->model = model; }
+
+    // 创建通道并登记到注册表，等待调度器就绪；timeoutMs < 0 表示一直等待
+    bool connect(int timeoutMs = 5000);
+
+    // 注销并删除通道
+    void disconnect();
+
+    // 发送一条请求并阻塞等待响应 (消息须短于槽位大小)
+    bool request(const std::string& msg, std::string& response);
+
+    // 发送一条不需要响应的消息 (遥测 "#T|..."、模型声明 "#M|...")，环满时等待
+    bool post(const std::string& msg);
+
+    // 底层收发 (环满或消息超过槽位大小时返回 false)
+    bool trySend(const char* data, size_t len);
+    bool recv(char* out, size_t cap, int timeoutMs = -1);
+
+    bool isConnected() const { return channelSegment.addr != nullptr || streamSock != -1; }
+    uint32_t slotCount() const { return view.slotCount; }
+    uint32_t slotSize() const { return view.slotSize; }
+    bool usesHugePages() const { return channelSegment.hugePages; }
+    const ShmSegment& getChannelSegment() const { return channelSegment; }
+    const std::string& getShmName() const { return shmName; }
+    int getSlot() const { return slot; }
+
+private:
+    bool connectMemfd(int timeoutMs);
+    bool connectStream(int timeoutMs);
+    // 流式传输: 读一帧 (timeoutMs < 0 一直等待)，连接断开时关闭套接字
+    bool readFrame(std::string& out, int timeoutMs);
+    bool flushStream();
+    bool openRegistry(int timeoutMs);
+    bool createChannel();
+    bool claimSlot();
+    void publishSlot(uint32_t segIndex, int bit);
+    bool waitScheduler();
+
+    std::string clientType;
+    std::string uniqueId;
+    std::string shmName;
+    std::string model;
+    ShmSegment registrySegment;
+    ShmSegment channelSegment;
+    ClientRegistry* registry;
+    ChannelView view;
+    uint32_t wantSlotCount;
+    uint32_t wantSlotSize;
+    int reattachMs;
+    Transport transport;
+    std::string memfdSocketPath;
+    int memfdSock;
+    std::string streamAddress;
+    int streamSock;
+    std::string streamIn;
+    size_t streamInPos;
+    std::string streamOut;
+    int slot;
+    // 注册表条目的心跳 (未注册时指向本地变量，免去热路径上的判断)
+    std::atomic<uint64_t>* heartbeat;
+    std::atomic<uint64_t> localHeartbeat{0};
+};
@@ -3,86 +3,72 @@
 #include "shm_core.h"
 
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <algorithm>
 #include <csignal>
+#include <climits>
 #include <sstream>
 
 // ======================= ShmChannel =======================
 
-ShmChannel::ShmChannel(ClientChannelStruct* ptr, std::string name, std::string type, std::string id, pid_t pid)
-    : channelPtr(ptr), shmName(name), clientType(type), uniqueId(id), clientPid(pid) {}
+ShmChannel::ShmChannel(const ShmSegment& seg, const ChannelView& v, std::string name, std::string type, std::string id, pid_t pid,
+                       std::shared_ptr<std::atomic<bool>> revokedFlag)
+    : segment(seg), view(v), shmName(name), clientType(type), uniqueId(id), clientPid(pid), revoked(revokedFlag),
+      uncommitted(false) {}
 
 ShmChannel::~ShmChannel() {
-    if (channelPtr) {
-        channelPtr->scheduler_ready.store(false, std::memory_order_release);
-        munmap(channelPtr, sizeof(ClientChannelStruct));
+    if (segment.addr) {
+        view.schedulerReady->store(false, std::memory_order_release);
+        unmapSegment(segment);
     }
 }
 
 void ShmChannel::unlink() {
-    shm_unlink(shmName.c_str());
+    unlinkSegment(shmName);
 }
 
 void ShmChannel::setReady() {
-    if (channelPtr) channelPtr->scheduler_ready.store(true, std::memory_order_release);
+    if (segment.addr) view.schedulerReady->store(true, std::memory_order_release);
 }
 
 bool ShmChannel::isConnected() {
-    if (!channelPtr)
+    if (!segment.addr)
         return false;
-    if (!channelPtr->client_connected.load(std::memory_order_acquire))
+    if (revoked && revoked->load(std::memory_order_relaxed))
+        return false;
+    if (!view.clientConnected->load(std::memory_order_acquire))
         return false;
     if (clientPid > 0 && kill(clientPid, 0) != 0 && errno != EPERM)
         return false;
     return true;
 }
 
-bool ShmChannel::spsc_try_pop(char* out_data, size_t max_len) {
-    auto& q = channelPtr->request_queue;
-    uint64_t head = q.head.load(std::memory_order_relaxed);
-    if (head == q.tail.load(std::memory_order_acquire)) return false;
-
-    size_t copy_len = strlen(q.buffer[head]);
-    if (copy_len >= max_len) copy_len = max_len - 1;
-    memcpy(out_data, q.buffer[head], copy_len);
-    out_data[copy_len] = '\0';
-
-    q.head.store((head + 1) % SPSC_QUEUE_SIZE, std::memory_order_release);
-    return true;
-}
-
-bool ShmChannel::spsc_try_push(const char* data, size_t len) {
-    auto& q = channelPtr->response_queue;
-    uint64_t tail = q.tail.load(std::memory_order_relaxed);
-    uint64_t next_tail = (tail + 1) % SPSC_QUEUE_SIZE;
-    if (next_tail == q.head.load(std::memory_order_acquire)) return false;
-
-    size_t copy_len = (len < SPSC_MSG_SIZE - 1) ? len : (SPSC_MSG_SIZE - 1);
-    memcpy(q.buffer[tail], data, copy_len);
-    q.buffer[tail][copy_len] = '\0';
-
-    q.tail.store(next_tail, std::memory_order_release);
-    return true;
-}
-
+// 请求在会话取下一条时才出队: 处理 (并应答) 完成之前调度器崩溃或交接，
+// 接管的调度器会重新处理这条请求，客户端按 reqId 丢弃重复的响应
 bool ShmChannel::recvBlocking(std::string& outMsg) {
-    char buffer[SPSC_MSG_SIZE];
+    if (uncommitted) {
+        view.request.commit();
+        uncommitted = false;
+    }
     // 忙等待实现，保留原有的性能特性
-    while (!spsc_try_pop(buffer, SPSC_MSG_SIZE)) {
+    while (!view.request.peek(outMsg)) {
         if (!isConnected()) return false;
         __asm__ __volatile__("pause" ::: "memory");
     }
-    outMsg = std::string(buffer);
+    uncommitted = true;
     return true;
 }
 
 bool ShmChannel::sendBlocking(const std::string& msg) {
     // 简单的超时机制 (例如 5秒)
     int attempts = 0;
-    while (!spsc_try_push(msg.c_str(), msg.length())) {
+    while (!view.response.tryPush(msg.c_str(), msg.length())) {
         if (attempts++ > 5000000) return false;
         __asm__ __volatile__("pause" ::: "memory");
     }
@@ -91,38 +77,80 @@ bool ShmChannel::sendBlocking(const std::string& msg) {
 
 // ======================= ShmServer =======================
 
-std::string get_user_suffix() {
-    const char* u = std::getenv("USER");
-    return (u && *u) ? std::string("_") + u : "_nouser";
+ShmServer::ShmServer(bool hugePages, int flags)
+    : running(false), useHugePages(hugePages), segmentFlags(flags),
+      maxSlotCount(MAX_SLOT_COUNT), maxSlotSize(MAX_SLOT_SIZE),
+      segmentCapacity(DEFAULT_REGISTERED_CLIENTS / REGISTRY_SEGMENT_SLOTS),
+      leaseNs(static_cast<uint64_t>(CLIENT_LEASE_MS) * 1000000ull), restart(false), keepRegistry(false),
+      registry(nullptr) {}
+
+void ShmServer::setRestart(bool enable) {
+    restart = enable;
+}
+
+void ShmServer::handOff() {
+    keepRegistry = true;
+}
+
+void ShmServer::setLease(int leaseMs) {
+    leaseNs = static_cast<uint64_t>(std::max(leaseMs, 1)) * 1000000ull;
+}
+
+uint64_t ShmServer::reclaimedSlots() const {
+    return registry ? registry->reclaimed_slots.load(std::memory_order_relaxed) : 0;
 }
 
-ShmServer::ShmServer() : running(false), registry(nullptr) {}
+void ShmServer::setChannelLimits(uint32_t slotCount, uint32_t slotSize) {
+    maxSlotCount = std::max(MIN_SLOT_COUNT, std::min(slotCount, MAX_SLOT_COUNT));
+    maxSlotSize = std::max(MIN_SLOT_SIZE, std::min(slotSize, MAX_SLOT_SIZE));
+    if (registry) {
+        registry->max_slot_count = maxSlotCount;
+        registry->max_slot_size = maxSlotSize;
+    }
+}
+
+void ShmServer::setMaxClients(size_t maxClients) {
+    size_t segments = (maxClients + REGISTRY_SEGMENT_SLOTS - 1) / REGISTRY_SEGMENT_SLOTS;
+    segmentCapacity = static_cast<uint32_t>(std::max<size_t>(1, std::min(segments, MAX_REGISTRY_SEGMENTS)));
+}
 
 std::string ShmServer::getRegistryName() {
     return std::string(SHM_NAME_SCHEDULER) + get_user_suffix();
 }
 
 bool ShmServer::init() {
+    if (restart && reattachRegistry()) return true;
+
+    // 客户端先找大页注册表再找普通注册表，先清掉两处的残留，避免客户端连到旧的注册表
     std::string name = getRegistryName();
-    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0666);
-    if (fd == -1) {
-        perror("shm_open registry");
-        return false;
-    }
-    if (ftruncate(fd, sizeof(ClientRegistry)) == -1) {
-        perror("ftruncate registry");
-        close(fd);
+    std::string hugePath = hugePagePath(name);
+    if (!hugePath.empty()) unlinkSegment(hugePath);
+
+    if (!createSegment(name, registryBytes(segmentCapacity), PATH_MAX, false, useHugePages, registrySegment, segmentFlags)) {
+        perror("create registry");
         return false;
     }
-    void* ptr = mmap(nullptr, sizeof(ClientRegistry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    close(fd);
-    if (ptr == MAP_FAILED) return false;
+    if (registrySegment.hugePages) unlinkSegment(getRegistryName());
+    registryName = name;
+
+    // 上次运行崩溃的客户端留下的通道，注册表重建后已没有条目指向它们
+    sweepOrphanChannels();
 
-    registry = static_cast<ClientRegistry*>(ptr);
-    registry->init();
+    registry = static_cast<ClientRegistry*>(registrySegment.addr);
+    registry->init(segmentCapacity);
+    for (uint32_t s = 0; s < segmentCapacity; s++) {
+        registrySegmentAt(registry, s)->init();
+    }
+    registry->max_slot_count = maxSlotCount;
+    registry->max_slot_size = maxSlotSize;
+    registry->scheduler_pid.store(getpid(), std::memory_order_relaxed);
     registry->scheduler_ready.store(true, std::memory_order_release);
     
-    std::cout << "[ShmServer] Registry initialized: " << name << std::endl;
+    std::cout << "[ShmServer] Registry initialized: " << name << " (" << segmentCapacity * REGISTRY_SEGMENT_SLOTS
+              << " clients)" << (registrySegment.hugePages ? " (2 MiB huge pages)" : "") << std::endl;
+    if (useHugePages && !registrySegment.hugePages) {
+        std::cout << "[ShmServer] Huge pages unavailable, using 4 KiB pages" << std::endl;
+    }
     return true;
 }
 
@@ -130,11 +158,82 @@ ShmServer::~ShmServer() {
     stop();
     if (registry) {
         registry->scheduler_ready.store(false, std::memory_order_release);
-        munmap(registry, sizeof(ClientRegistry));
-        shm_unlink(getRegistryName().c_str());
+        registry->scheduler_pid.store(0, std::memory_order_release);
+        unmapSegment(registrySegment);
+        if (!keepRegistry) unlinkSegment(registryName);
+        registry = nullptr;
     }
 }
 
+// 沿用上一个调度器留下的注册表: 校验布局，保留全部条目，把已分配的条目重新标记为待接入
+bool ShmServer::reattachRegistry() {
+    auto start = std::chrono::steady_clock::now();
+    std::string name = getRegistryName();
+    std::string hugePath = hugePagePath(name);
+    std::vector<std::string> candidates;
+    if (!hugePath.empty()) candidates.push_back(hugePath);
+    candidates.push_back(name);
+
+    for (const std::string& candidate : candidates) {
+        ShmSegment seg;
+        if (!openSegment(candidate, 0, seg, segmentFlags)) continue;
+        ClientRegistry* reg = static_cast<ClientRegistry*>(seg.addr);
+        std::string error;
+        if (seg.length < sizeof(ClientRegistry) || reg->magic != REGISTRY_MAGIC) {
+            error = "bad magic";
+        } else if (reg->layout_version != REGISTRY_LAYOUT_VERSION) {
+            error = "layout version " + std::to_string(reg->layout_version) + ", expected " +
+                    std::to_string(REGISTRY_LAYOUT_VERSION);
+        } else if (reg->segment_capacity == 0 || reg->segment_capacity > MAX_REGISTRY_SEGMENTS ||
+                   seg.length < registryBytes(reg->segment_capacity) ||
+                   reg->segment_count.load() > reg->segment_capacity) {
+            error = "inconsistent capacity";
+        } else {
+            int64_t owner = reg->scheduler_pid.load(std::memory_order_acquire);
+            if (owner > 0 && owner != getpid() && (kill(static_cast<pid_t>(owner), 0) == 0 || errno != ESRCH)) {
+                error = "scheduler pid " + std::to_string(owner) + " is still running";
+            }
+        }
+        if (!error.empty()) {
+            std::cerr << "[ShmServer] Cannot reattach " << candidate << ": " << error << std::endl;
+            unmapSegment(seg);
+            continue;
+        }
+
+        registrySegment = seg;
+        registryName = candidate;
+        registry = reg;
+        if (segmentCapacity != reg->segment_capacity) {
+            std::cout << "[ShmServer] Keeping existing registry capacity of "
+                      << reg->segment_capacity * REGISTRY_SEGMENT_SLOTS << " clients" << std::endl;
+        }
+        segmentCapacity = reg->segment_capacity;
+        registry->max_slot_count = maxSlotCount;
+        registry->max_slot_size = maxSlotSize;
+        registry->scheduler_pid.store(getpid(), std::memory_order_relaxed);
+        uint32_t generation = registry->generation.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        int live = 0;
+        uint32_t count = registry->segment_count.load(std::memory_order_acquire);
+        for (uint32_t s = 0; s < count; s++) {
+            RegistrySegment* rs = registrySegmentAt(registry, s);
+            uint64_t bits = rs->alloc_bits.load(std::memory_order_acquire);
+            if (!bits) continue;
+            live += __builtin_popcountll(bits);
+            rs->pending_bits.fetch_or(bits, std::memory_order_acq_rel);
+            registry->pending_segments.fetch_or(1ull << s, std::memory_order_acq_rel);
+        }
+        registry->scheduler_ready.store(true, std::memory_order_release);
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[ShmServer] Reattached registry " << candidate << " (generation " << generation << ", "
+                  << live << " clients) in " << us / 1000.0 << " ms" << std::endl;
+        return true;
+    }
+    std::cout << "[ShmServer] No reusable registry, starting fresh" << std::endl;
+    return false;
+}
+
 void ShmServer::start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) {
     callback = onNewClient;
     running.store(true);
@@ -142,58 +241,97 @@ void ShmServer::start(std::function<void(std::unique_ptr<IChannel>)> onNewClient
 }
 
 void ShmServer::stop() {
-    running.store(false);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running.store(false);
+    }
+    wakeCv.notify_all();
     if (scannerThread.joinable()) scannerThread.join();
+    // 结束所有会话 (空闲会话否则会一直等待下一条请求)
+    std::lock_guard<std::mutex> lock(internalMutex);
+    for (auto& served : activeSlots) {
+        served.second.revoked->store(true, std::memory_order_relaxed);
+    }
 }
 
 void ShmServer::scannerLoop() {
-    uint32_t lastVersion = 0;
+    auto lastReap = std::chrono::steady_clock::now();
     while (running.load()) {
         if (!registry) { usleep(100000); continue; }
 
-        uint32_t currentVersion = registry->version.load(std::memory_order_acquire);
-        if (currentVersion != lastVersion) {
-            for (size_t i = 0; i < MAX_REGISTERED_CLIENTS; i++) {
-                if (registry->entries[i].active.load(std::memory_order_acquire)) {
-                    discoverClient(i);
+        // 只访问有新注册的段与条目，不线性扫描整个注册表
+        uint64_t segments = registry->pending_segments.exchange(0, std::memory_order_acq_rel);
+        while (segments) {
+            uint32_t s = static_cast<uint32_t>(__builtin_ctzll(segments));
+            segments &= segments - 1;
+            if (s >= segmentCapacity) continue;
+            RegistrySegment* seg = registrySegmentAt(registry, s);
+            uint64_t pending = seg->pending_bits.exchange(0, std::memory_order_acq_rel);
+            while (pending) {
+                int b = __builtin_ctzll(pending);
+                pending &= pending - 1;
+                if (seg->entries[b].active.load(std::memory_order_acquire)) {
+                    discoverClient(static_cast<int>(s * REGISTRY_SEGMENT_SLOTS + b), seg->entries[b]);
                 }
             }
-            lastVersion = currentVersion;
         }
         cleanupDisconnected();
-        usleep(100000);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReap >= std::chrono::milliseconds(REAPER_INTERVAL_MS)) {
+            reapStaleSlots();
+            lastReap = now;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCv.wait_for(lock, std::chrono::milliseconds(100), [this] { return !running.load(); });
     }
 }
 
-void ShmServer::discoverClient(int slot) {
+void ShmServer::discoverClient(int slot, ClientRegistryEntry& entry) {
     std::lock_guard<std::mutex> lock(internalMutex);
     
-    // 检查是否已经在服务 (简单检查，实际生产可能需要更复杂的映射)
-    for (int s : activeSlots) {
-        if (s == slot)
+    uint64_t generation = entry.generation.load(std::memory_order_relaxed);
+    auto served = activeSlots.find(slot);
+    if (served != activeSlots.end()) {
+        if (served->second.generation == generation)
             return;
+        // 条目已被新客户端复用，旧会话不再有效
+        served->second.revoked->store(true, std::memory_order_relaxed);
     }
 
-    auto& entry = registry->entries[slot];
     std::string shmName(entry.shm_name);
     
-    // 打开客户端通道
-    int fd = shm_open(shmName.c_str(), O_RDWR, 0666);
-    if (fd == -1) 
-        return;
+    // 打开客户端通道 (shm 名或 hugetlbfs 文件路径)，在接入时就把缺页处理完，
+    // 避免新客户端的前几条 kernel 承担缺页开销
+    ShmSegment seg;
+    if (openSegment(shmName, 0, seg, segmentFlags)) {
+        std::shared_ptr<std::atomic<bool>> revoked(new std::atomic<bool>(false));
+        activeSlots[slot] = ServedSlot{generation, revoked};
 
-    void* ptr = mmap(nullptr, sizeof(ClientChannelStruct), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    close(fd);
-    
-    if (ptr != MAP_FAILED) {
-        activeSlots.push_back(slot);
+        // 校验客户端选择的几何；不合规的通道不提供服务 (客户端会等待超时)
+        ChannelView view;
+        std::string error;
+        if (!bindChannel(seg.addr, seg.length, maxSlotCount, maxSlotSize, view, error)) {
+            std::cerr << "[ShmServer] Rejected " << shmName << ": " << error << std::endl;
+            unmapSegment(seg);
+            return;
+        }
+        std::cout << "[ShmServer] Attached " << shmName << ": layout " << view.layoutVersion << ", "
+                  << view.slotCount << "x" << view.slotSize << " slots, " << seg.length / 1024 << " KiB";
+        if (segmentFlags) {
+            std::cout << ", " << seg.minorFaults << " minor / " << seg.majorFaults << " major faults at attach"
+                      << (seg.locked ? ", locked" : "");
+        }
+        std::cout << std::endl;
         
         auto channel = std::unique_ptr<IChannel>(new ShmChannel(
-            static_cast<ClientChannelStruct*>(ptr),
+            seg,
+            view,
             shmName,
             entry.client_type,
             entry.unique_id,
-            static_cast<pid_t>(entry.client_pid)
+            static_cast<pid_t>(entry.client_pid),
+            revoked
         ));
         
         // 通知上层
@@ -201,18 +339,115 @@ void ShmServer::discoverClient(int slot) {
     }
 }
 
-// 这里的逻辑简化：只负责清理 registry 中的 active 标志
-// 实际的 Channel 对象生命周期由 Scheduler 管理，当 Scheduler 发现 Channel 断开时会释放对象
+// 只把已注销或已被换代的槽位从 activeSlots 中移除；回收崩溃客户端的槽位 (删除通道、释放位图)
+// 由 reapStaleSlots/reclaimSlot 负责。Channel 对象的生命周期由 Scheduler 管理
 void ShmServer::cleanupDisconnected() {
     std::lock_guard<std::mutex> lock(internalMutex);
     auto it = activeSlots.begin();
     while (it != activeSlots.end()) {
-        int slot = *it;
-        bool stillActive = registry->entries[slot].active.load(std::memory_order_acquire);
+        auto& entry = registrySegmentAt(registry, it->first / REGISTRY_SEGMENT_SLOTS)->entries[it->first % REGISTRY_SEGMENT_SLOTS];
+        bool stillActive = entry.active.load(std::memory_order_acquire) &&
+                           entry.generation.load(std::memory_order_relaxed) == it->second.generation;
         if (!stillActive) {
             it = activeSlots.erase(it);
         } else {
             ++it;
         }
     }
-}
\ No newline at end of file
+}
+
+// ===== 崩溃客户端回收 =====
+
+// 心跳已超过租约，且进程不存在或 pid 已被其他进程复用 (启动时间不同)
+bool ShmServer::ownerDead(const ClientRegistryEntry& entry, uint64_t nowNs) {
+    uint64_t heartbeat = entry.last_heartbeat.load(std::memory_order_relaxed);
+    if (nowNs < heartbeat + leaseNs) return false;
+    int64_t pid = entry.client_pid.load(std::memory_order_relaxed);
+    if (pid <= 0) return true;
+    if (kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH) return true;
+    uint64_t start = entry.client_start.load(std::memory_order_relaxed);
+    uint64_t actual = processStartTime(static_cast<int>(pid));
+    return start != 0 && actual != 0 && actual != start;
+}
+
+// 遍历已分配的条目 (按分配位图，不访问空闲条目)
+void ShmServer::reapStaleSlots() {
+    uint64_t nowNs = monotonicNs();
+    uint32_t count = std::min(registry->segment_count.load(std::memory_order_acquire), segmentCapacity);
+    std::unordered_map<int, uint64_t> suspects;
+    for (uint32_t s = 0; s < count; s++) {
+        RegistrySegment* seg = registrySegmentAt(registry, s);
+        uint64_t bits = seg->alloc_bits.load(std::memory_order_acquire);
+        while (bits) {
+            int b = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            auto& entry = seg->entries[b];
+            if (!ownerDead(entry, nowNs)) continue;
+
+            int slot = static_cast<int>(s * REGISTRY_SEGMENT_SLOTS + b);
+            uint64_t generation = entry.generation.load(std::memory_order_relaxed);
+            auto prev = suspectSlots.find(slot);
+            if (prev != suspectSlots.end() && prev->second == generation) {
+                reclaimSlot(s, b, entry.active.load(std::memory_order_acquire) ? "owner exited" : "registration abandoned");
+            } else {
+                suspects[slot] = generation;
+            }
+        }
+    }
+    suspectSlots.swap(suspects);
+}
+
+// 结束服务端会话、删除通道对象，并把条目还给分配位图
+void ShmServer::reclaimSlot(uint32_t segIndex, int bit, const char* reason) {
+    RegistrySegment* seg = registrySegmentAt(registry, segIndex);
+    auto& entry = seg->entries[bit];
+    int slot = static_cast<int>(segIndex * REGISTRY_SEGMENT_SLOTS + bit);
+    std::string shmName(entry.shm_name, strnlen(entry.shm_name, sizeof(entry.shm_name)));
+    int64_t pid = entry.client_pid.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(internalMutex);
+        auto served = activeSlots.find(slot);
+        if (served != activeSlots.end()) {
+            served->second.revoked->store(true, std::memory_order_relaxed);
+            activeSlots.erase(served);
+        }
+    }
+    if (!shmName.empty()) unlinkSegment(shmName);
+
+    entry.active.store(false, std::memory_order_release);
+    entry.client_pid.store(0, std::memory_order_relaxed);
+    std::memset(entry.shm_name, 0, sizeof(entry.shm_name));
+    seg->alloc_bits.fetch_and(~(1ull << bit), std::memory_order_acq_rel);
+    registry->version.fetch_add(1, std::memory_order_acq_rel);
+    uint64_t total = registry->reclaimed_slots.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    std::cout << "[ShmServer] Reclaimed slot " << slot << " (pid " << pid << ", " << reason << ")"
+              << (shmName.empty() ? "" : ", unlinked " + shmName) << ", total reclaimed " << total << std::endl;
+}
+
+// 删除进程已不存在的客户端通道 (/ks_<type>_<id>_<pid>)，包括 hugetlbfs 上的
+void ShmServer::sweepOrphanChannels() {
+    std::vector<std::string> dirs = {"/dev/shm"};
+    if (!hugetlbfsMount().empty()) dirs.push_back(hugetlbfsMount());
+    int removed = 0;
+    for (const std::string& dir : dirs) {
+        DIR* d = opendir(dir.c_str());
+        if (!d) continue;
+        while (struct dirent* e = readdir(d)) {
+            std::string name(e->d_name);
+            if (name.compare(0, 3, "ks_") != 0) continue;
+            size_t us = name.rfind('_');
+            if (us == std::string::npos || us + 1 >= name.size()) continue;
+            char* end = nullptr;
+            long pid = strtol(name.c_str() + us + 1, &end, 10);
+            if (*end != '\0' || pid <= 0) continue;
+            if (kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH) continue;
+            std::string path = dir + "/" + name;
+            if (unlink(path.c_str()) == 0) removed++;
+        }
+        closedir(d);
+    }
+    if (removed > 0) {
+        std::cout << "[ShmServer] Removed " << removed << " orphaned client channels" << std::endl;
+    }
+}
@@ -2,15 +2,21 @@
 
 #include "ipc.h"
 #include "config.h"
+#include "shm_segment.h"
+#include "spsc_ring.h"
 
 #include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <thread>
-#include <vector>
+#include <unordered_map>
 #include <mutex>
 
 class ShmChannel : public IChannel {
 public:
-    ShmChannel(ClientChannelStruct* ptr, std::string name, std::string type, std::string id, pid_t pid);
+    // revoked: 由 ShmServer 在回收条目或停止服务时置位，会话随即结束
+    ShmChannel(const ShmSegment& seg, const ChannelView& view, std::string name, std::string type, std::string id, pid_t pid,
+               std::shared_ptr<std::atomic<bool>> revoked);
     ~ShmChannel();
 
     bool recvBlocking(std::string& outMsg) override;
@@ -26,38 +32,77 @@ public:
     void unlink();
 
 private:
-    ClientChannelStruct* channelPtr;
+    ShmSegment segment;
+    ChannelView view;
     std::string shmName;
     std::string clientType;
     std::string uniqueId;
     pid_t clientPid;
-
-    // 辅助 SPSC 逻辑
-    bool spsc_try_pop(char* out_data, size_t max_len);
-    bool spsc_try_push(const char* data, size_t len);
+    std::shared_ptr<std::atomic<bool>> revoked;
+    // 上一条请求已 peek 但尚未出队 (在取下一条时提交)
+    bool uncommitted;
 };
 
 class ShmServer : public IIPCServer {
 public:
-    ShmServer();
+    // hugePages: 注册表放在 hugetlbfs 上 (不可用时回退到普通 shm)
+    // segmentFlags: 注册表与通道的映射选项 (SegmentFlags)，默认接入时预取并 mlock
+    explicit ShmServer(bool hugePages = false, int segmentFlags = SEG_PIN);
     ~ShmServer();
 
     bool init() override;
     void start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) override;
     void stop() override;
 
+    // 客户端可选择的通道几何上限 (运行中调用只影响之后接入的通道)
+    void setChannelLimits(uint32_t maxSlotCount, uint32_t maxSlotSize);
+    // 在 init 之前调用: 注册表容量 (按 64 个条目一段向上取整)
+    void setMaxClients(size_t maxClients);
+    // 客户端租约 (ms)，可在运行中调用
+    void setLease(int leaseMs);
+    // 在 init 之前调用: 校验并沿用已有注册表，重新接入其中的活跃客户端 (失败时新建)
+    void setRestart(bool restart);
+    // 退出时保留注册表与通道，交给下一个以 --restart 启动的调度器
+    void handOff();
+
+    uint64_t reclaimedSlots() const;
+
 private:
     void scannerLoop();
-    void discoverClient(int slot);
+    void discoverClient(int slot, ClientRegistryEntry& entry);
     void cleanupDisconnected();
+    void reapStaleSlots();
+    bool ownerDead(const ClientRegistryEntry& entry, uint64_t nowNs);
+    void reclaimSlot(uint32_t segIndex, int bit, const char* reason);
+    void sweepOrphanChannels();
+    bool reattachRegistry();
     std::string getRegistryName();
 
     std::atomic<bool> running;
+    bool useHugePages;
+    int segmentFlags;
+    std::atomic<uint32_t> maxSlotCount;
+    std::atomic<uint32_t> maxSlotSize;
+    uint32_t segmentCapacity;
+    std::atomic<uint64_t> leaseNs;
+    bool restart;
+    bool keepRegistry;
+    ShmSegment registrySegment;
+    std::string registryName;
     ClientRegistry* registry;
     std::thread scannerThread;
+    // 扫描线程的等待，stop 时立即唤醒
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
     std::function<void(std::unique_ptr<IChannel>)> callback;
 
-    // 记录正在服务的 slot，防止重复创建
+    struct ServedSlot {
+        uint64_t generation;
+        std::shared_ptr<std::atomic<bool>> revoked;
+    };
+    // 正在服务的 slot，防止重复创建 (条目被新客户端复用时代数不同)
     std::mutex internalMutex;
-    std::vector<int> activeSlots; 
+    std::unordered_map<int, ServedSlot> activeSlots;
+    // 上一轮判定为失效的 slot -> 注册代数，连续两轮失效才回收，避开正在注册的客户端
+    std::unordered_map<int, uint64_t> suspectSlots;
 };
\ No newline at end of file
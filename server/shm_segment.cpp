@@ -0,0 +1,230 @@
+#include "shm_segment.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef MFD_HUGE_2MB
+#define MFD_HUGE_2MB (21 << 26)   // log2(2 MiB) << MFD_HUGE_SHIFT，旧 glibc 未导出
+#endif
+
+namespace {
+
+bool isPath(const std::string& name) {
+    return name.size() > 1 && name.find('/', 1) != std::string::npos;
+}
+
+size_t roundUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+int openFd(const std::string& name, int flags) {
+    return isPath(name) ? open(name.c_str(), flags, 0666) : shm_open(name.c_str(), flags, 0666);
+}
+
+// 映射 fd 的前 length 字节，按 flags 预取与锁定，并统计期间的缺页
+bool mapFd(int fd, size_t length, bool hugePages, int flags, ShmSegment& seg) {
+    long minor0, major0;
+    threadFaults(minor0, major0);
+
+    int mapFlags = MAP_SHARED | ((flags & SEG_POPULATE) ? MAP_POPULATE : 0);
+    void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, mapFlags, fd, 0);
+    if (ptr == MAP_FAILED) return false;
+
+    if (flags & SEG_POPULATE) {
+        // MAP_POPULATE 失败不会报错，逐页读一次兜底
+        size_t step = hugePages ? HUGE_PAGE_SIZE : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const volatile char* p = static_cast<const volatile char*>(ptr);
+        for (size_t off = 0; off < length; off += step) (void)p[off];
+    }
+    seg.locked = false;
+    if (flags & SEG_MLOCK) {
+        if (mlock(ptr, length) == 0) {
+            seg.locked = true;
+        } else {
+            static bool warned = false;
+            if (!warned) {
+                warned = true;
+                perror("[ShmSegment] mlock (raise 'ulimit -l' to lock channels)");
+            }
+        }
+    }
+
+    long minor1, major1;
+    threadFaults(minor1, major1);
+    seg.addr = ptr;
+    seg.length = length;
+    seg.hugePages = hugePages;
+    seg.minorFaults = minor1 - minor0;
+    seg.majorFaults = major1 - major0;
+    return true;
+}
+
+// 创建 fd 并映射 length 字节，失败时删除刚创建的对象
+bool createAndMap(const std::string& name, size_t length, bool exclusive, bool hugePages, int flags, ShmSegment& seg) {
+    int openFlags = O_RDWR | O_CREAT | (exclusive ? O_EXCL : 0);
+    int fd = openFd(name, openFlags);
+    if (fd == -1) return false;
+    if (ftruncate(fd, static_cast<off_t>(length)) == -1) {
+        close(fd);
+        unlinkSegment(name);
+        return false;
+    }
+    bool ok = mapFd(fd, length, hugePages, flags, seg);
+    close(fd);
+    if (!ok) unlinkSegment(name);
+    return ok;
+}
+
+} // namespace
+
+std::string hugetlbfsMount() {
+    static const std::string mount = []() -> std::string {
+        const char* env = std::getenv("KS_HUGETLBFS");
+        if (env) return env;
+        std::ifstream in("/proc/mounts");
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string dev, dir, type, opts;
+            if (!(fields >> dev >> dir >> type >> opts) || type != "hugetlbfs") continue;
+            // 未指定 pagesize 时为系统默认大页 (x86_64 上即 2 MiB)
+            if (opts.find("pagesize=") == std::string::npos || opts.find("pagesize=2M") != std::string::npos) {
+                return dir;
+            }
+        }
+        return std::string();
+    }();
+    return mount;
+}
+
+std::string hugePagePath(const std::string& shmName) {
+    std::string mount = hugetlbfsMount();
+    if (mount.empty() || shmName.empty()) return std::string();
+    return mount + "/" + (shmName[0] == '/' ? shmName.substr(1) : shmName);
+}
+
+void threadFaults(long& minor, long& major) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) == 0) {
+        minor = ru.ru_minflt;
+        major = ru.ru_majflt;
+    } else {
+        minor = major = 0;
+    }
+}
+
+uint64_t processStartTime(int pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+    if (!std::getline(in, stat)) return 0;
+    // comm 可能含空格，从最后一个 ')' 之后开始数: 其后第 1 项为 state (第 3 项)
+    size_t pos = stat.rfind(')');
+    if (pos == std::string::npos) return 0;
+    std::istringstream fields(stat.substr(pos + 1));
+    std::string field;
+    for (int i = 3; i <= 22 && (fields >> field); i++) {
+        if (i == 22) return strtoull(field.c_str(), nullptr, 10);
+    }
+    return 0;
+}
+
+uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+bool hugePagesRequested() {
+    const char* env = std::getenv("KS_HUGE_PAGES");
+    return env && std::strcmp(env, "0") != 0 && *env;
+}
+
+int clientSegmentFlags() {
+    const char* env = std::getenv("KS_SHM_PIN");
+    return (env && std::strcmp(env, "0") == 0) ? 0 : SEG_PIN;
+}
+
+bool createSegment(std::string& name, size_t size, size_t maxName, bool exclusive, bool hugePages, ShmSegment& seg,
+                   int flags) {
+    if (hugePages) {
+        std::string path = hugePagePath(name);
+        if (!path.empty() && path.size() < maxName) {
+            if (!exclusive) unlink(path.c_str());
+            if (createAndMap(path, roundUp(size, HUGE_PAGE_SIZE), exclusive, true, flags, seg)) {
+                name = path;
+                return true;
+            }
+        }
+        // 没有挂载点、名字过长或大页池耗尽，回退到 4 KiB 页
+    }
+    return createAndMap(name, size, exclusive, false, flags, seg);
+}
+
+bool openSegment(const std::string& name, size_t size, ShmSegment& seg, int flags) {
+    int fd = openFd(name, O_RDWR);
+    if (fd == -1) return false;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0 || static_cast<size_t>(st.st_size) < size) {
+        close(fd);
+        return false;
+    }
+    // hugetlbfs 的映射长度必须是大页的整数倍，直接映射整个文件；size 为 0 时也映射整个对象
+    size_t length = (isPath(name) || size == 0) ? static_cast<size_t>(st.st_size) : size;
+    bool ok = mapFd(fd, length, isPath(name), flags, seg);
+    close(fd);
+    return ok;
+}
+
+bool createMemfdSegment(const std::string& name, size_t size, bool hugePages, ShmSegment& seg, int flags, int& fd) {
+    fd = -1;
+    if (hugePages) {
+        fd = memfd_create(name.c_str(), MFD_CLOEXEC | MFD_HUGETLB | MFD_HUGE_2MB);
+        if (fd != -1 && (ftruncate(fd, static_cast<off_t>(roundUp(size, HUGE_PAGE_SIZE))) == -1 ||
+                         !mapFd(fd, roundUp(size, HUGE_PAGE_SIZE), true, flags, seg))) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd != -1) return true;
+        // 大页池耗尽或内核不支持，回退到 4 KiB 页
+    }
+    fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+    if (fd == -1) return false;
+    if (ftruncate(fd, static_cast<off_t>(size)) == -1 || !mapFd(fd, size, false, flags, seg)) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool mapSegmentFd(int fd, ShmSegment& seg, int flags) {
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) return false;
+    // hugetlbfs 上的 memfd 按大页对齐
+    bool hugePages = static_cast<size_t>(st.st_blksize) >= HUGE_PAGE_SIZE;
+    return mapFd(fd, static_cast<size_t>(st.st_size), hugePages, flags, seg);
+}
+
+void unmapSegment(ShmSegment& seg) {
+    if (seg.addr) {
+        if (seg.locked) munlock(seg.addr, seg.length);
+        munmap(seg.addr, seg.length);
+    }
+    seg.addr = nullptr;
+    seg.length = 0;
+    seg.locked = false;
+}
+
+void unlinkSegment(const std::string& name) {
+    if (isPath(name)) unlink(name.c_str());
+    else shm_unlink(name.c_str());
+}
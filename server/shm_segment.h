@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// ============================================================
+//  共享内存段 (注册表与客户端通道共用)
+//  段名以 '/' 开头且不再含 '/' 时为 POSIX shm 对象 (/dev/shm, 4 KiB 页)；
+//  其余视为文件路径，用于 hugetlbfs 挂载点下的 2 MiB 大页文件。
+//  大页段的大小按大页对齐，映射长度以 length 为准。
+// ============================================================
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// 映射选项: 映射时预先触发全部缺页 (MAP_POPULATE + 逐页访问)，并锁定在内存中不被换出
+enum SegmentFlags {
+    SEG_POPULATE = 1 << 0,
+    SEG_MLOCK = 1 << 1,
+    SEG_PIN = SEG_POPULATE | SEG_MLOCK,
+};
+
+struct ShmSegment {
+    void* addr = nullptr;
+    size_t length = 0;
+    bool hugePages = false;
+    bool locked = false;
+    // 映射与预取过程中本线程发生的缺页数
+    long minorFaults = 0;
+    long majorFaults = 0;
+};
+
+// 当前线程累计的缺页数 (getrusage RUSAGE_THREAD)
+void threadFaults(long& minor, long& major);
+
+// 进程启动时间 (/proc/<pid>/stat 第 22 项，时钟节拍)，进程不存在时返回 0
+uint64_t processStartTime(int pid);
+
+// CLOCK_MONOTONIC 纳秒，跨进程可比较 (注册表心跳)
+uint64_t monotonicNs();
+
+// 2 MiB hugetlbfs 挂载点 ($KS_HUGETLBFS 优先，其次 /proc/mounts)，没有时返回空串
+std::string hugetlbfsMount();
+
+// shm 名对应的大页文件路径，没有可用挂载点时返回空串
+std::string hugePagePath(const std::string& shmName);
+
+// 客户端是否请求大页通道 ($KS_HUGE_PAGES=1)
+bool hugePagesRequested();
+
+// 客户端映射选项: 默认预取并锁定，$KS_SHM_PIN=0 时关闭
+int clientSegmentFlags();
+
+/**
+ * @brief 创建并映射一个段
+ * @param name      输入为 shm 名；使用大页时改写为实际的文件路径
+ * @param maxName   name 的最大长度 (注册表字段容量)，超出时不使用大页
+ * @param exclusive 是否要求对象不存在 (O_EXCL)
+ * @param hugePages 优先使用 hugetlbfs，不可用或大页不足时回退到普通 shm
+ */
+bool createSegment(std::string& name, size_t size, size_t maxName, bool exclusive, bool hugePages, ShmSegment& seg,
+                   int flags = 0);
+
+// 映射一个已存在的段 (size 为 0 时映射整个对象)
+bool openSegment(const std::string& name, size_t size, ShmSegment& seg, int flags = 0);
+
+/**
+ * @brief 创建匿名的 memfd 段 (通过 Unix 套接字传递 fd，最后一个 fd 与映射释放后自动回收)
+ * @param hugePages 优先使用 MFD_HUGETLB 的 2 MiB 大页，不可用时回退
+ * @param fd        输出 memfd，由调用方关闭
+ */
+bool createMemfdSegment(const std::string& name, size_t size, bool hugePages, ShmSegment& seg, int flags, int& fd);
+
+// 映射收到的 fd (整个对象)
+bool mapSegmentFd(int fd, ShmSegment& seg, int flags = 0);
+
+void unmapSegment(ShmSegment& seg);
+void unlinkSegment(const std::string& name);
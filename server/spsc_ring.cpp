@@ -0,0 +1,92 @@
+#include "spsc_ring.h"
+
+#include <cstddef>
+
+bool validGeometry(uint32_t slotCount, uint32_t slotSize, uint32_t maxSlotCount, uint32_t maxSlotSize) {
+    if (slotCount < MIN_SLOT_COUNT || slotCount > maxSlotCount || (slotCount & (slotCount - 1)) != 0) return false;
+    if (slotSize < MIN_SLOT_SIZE || slotSize > maxSlotSize) return false;
+    return channelBytes(slotCount, slotSize) <= MAX_CHANNEL_BYTES;
+}
+
+void formatChannel(void* base, uint32_t slotCount, uint32_t slotSize, ChannelView& view) {
+    ChannelHeader* h = static_cast<ChannelHeader*>(base);
+    h->layout_version = CHANNEL_LAYOUT_VERSION;
+    h->slot_count = slotCount;
+    h->slot_size = slotSize;
+    h->total_size = channelBytes(slotCount, slotSize);
+    h->request_head.store(0, std::memory_order_relaxed);
+    h->request_tail.store(0, std::memory_order_relaxed);
+    h->response_head.store(0, std::memory_order_relaxed);
+    h->response_tail.store(0, std::memory_order_relaxed);
+    h->scheduler_ready.store(false, std::memory_order_relaxed);
+    h->client_connected.store(true, std::memory_order_relaxed);
+    // magic 最后写入；调度器在注册表 active (release) 之后才读取头部
+    h->magic = CHANNEL_MAGIC;
+
+    char* slots = static_cast<char*>(base) + sizeof(ChannelHeader);
+    view.request.bind(&h->request_head, &h->request_tail, slots, slotCount, slotSize, false);
+    view.response.bind(&h->response_head, &h->response_tail, slots + static_cast<size_t>(slotCount) * slotSize,
+                       slotCount, slotSize, false);
+    view.clientConnected = &h->client_connected;
+    view.schedulerReady = &h->scheduler_ready;
+    view.layoutVersion = CHANNEL_LAYOUT_VERSION;
+    view.slotCount = slotCount;
+    view.slotSize = slotSize;
+}
+
+bool bindChannel(void* base, size_t length, uint32_t maxSlotCount, uint32_t maxSlotSize,
+                 ChannelView& view, std::string& error) {
+    if (length < sizeof(uint32_t)) {
+        error = "segment too small";
+        return false;
+    }
+    const ChannelHeader* h = static_cast<const ChannelHeader*>(base);
+
+    if (h->magic != CHANNEL_MAGIC) {
+        // 旧布局: 固定几何
+        if (length < sizeof(ClientChannelStruct)) {
+            error = "unknown layout (bad magic, too small for layout 1)";
+            return false;
+        }
+        ClientChannelStruct* c = static_cast<ClientChannelStruct*>(base);
+        view.request.bind(&c->request_queue.head, &c->request_queue.tail, &c->request_queue.buffer[0][0],
+                          SPSC_QUEUE_SIZE, SPSC_MSG_SIZE, true);
+        view.response.bind(&c->response_queue.head, &c->response_queue.tail, &c->response_queue.buffer[0][0],
+                           SPSC_QUEUE_SIZE, SPSC_MSG_SIZE, true);
+        view.clientConnected = &c->client_connected;
+        view.schedulerReady = &c->scheduler_ready;
+        view.layoutVersion = 1;
+        view.slotCount = SPSC_QUEUE_SIZE;
+        view.slotSize = SPSC_MSG_SIZE;
+        return true;
+    }
+
+    if (length < sizeof(ChannelHeader)) {
+        error = "segment smaller than channel header";
+        return false;
+    }
+    if (h->layout_version != CHANNEL_LAYOUT_VERSION) {
+        error = "unsupported layout version " + std::to_string(h->layout_version);
+        return false;
+    }
+    if (!validGeometry(h->slot_count, h->slot_size, maxSlotCount, maxSlotSize)) {
+        error = "geometry " + std::to_string(h->slot_count) + "x" + std::to_string(h->slot_size) + " outside limits";
+        return false;
+    }
+    if (h->total_size != channelBytes(h->slot_count, h->slot_size) || h->total_size > length) {
+        error = "total_size " + std::to_string(h->total_size) + " inconsistent with geometry or segment length";
+        return false;
+    }
+
+    ChannelHeader* w = static_cast<ChannelHeader*>(base);
+    char* slots = static_cast<char*>(base) + sizeof(ChannelHeader);
+    view.request.bind(&w->request_head, &w->request_tail, slots, h->slot_count, h->slot_size, false);
+    view.response.bind(&w->response_head, &w->response_tail, slots + static_cast<size_t>(h->slot_count) * h->slot_size,
+                       h->slot_count, h->slot_size, false);
+    view.clientConnected = &w->client_connected;
+    view.schedulerReady = &w->scheduler_ready;
+    view.layoutVersion = CHANNEL_LAYOUT_VERSION;
+    view.slotCount = h->slot_count;
+    view.slotSize = h->slot_size;
+    return true;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "config.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// ============================================================
+//  共享内存 SPSC 环 (调度器与客户端共用)
+//  同时支持两种布局:
+//    - 版本 2: 几何可变，head/tail 自由递增，下标用掩码计算，所有槽位都可用
+//    - 版本 1: 旧的固定布局，head/tail 存放取模后的下标，留一个空槽区分满/空
+// ============================================================
+
+class SpscRing {
+public:
+    SpscRing() : head_(nullptr), tail_(nullptr), slots_(nullptr), count_(0), size_(0), mask_(0), legacy_(false) {}
+
+    void bind(std::atomic<uint64_t>* head, std::atomic<uint64_t>* tail, char* slots,
+              uint32_t slotCount, uint32_t slotSize, bool legacy) {
+        head_ = head;
+        tail_ = tail;
+        slots_ = slots;
+        count_ = slotCount;
+        size_ = slotSize;
+        mask_ = slotCount - 1;
+        legacy_ = legacy;
+    }
+
+    uint32_t slotSize() const { return size_; }
+
+    // 生产者: 超过槽位容量的消息被截断
+    bool tryPush(const char* data, size_t len) {
+        uint64_t tail = tail_->load(std::memory_order_relaxed);
+        uint64_t head = head_->load(std::memory_order_acquire);
+        uint64_t next = advance(tail);
+        if (legacy_ ? next == head : tail - head == count_) return false;
+
+        char* slot = slotAt(tail);
+        size_t copyLen = (len < size_ - 1) ? len : (size_ - 1);
+        memcpy(slot, data, copyLen);
+        slot[copyLen] = '\0';
+        tail_->store(next, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者
+    bool tryPop(std::string& out) {
+        uint64_t head = head_->load(std::memory_order_relaxed);
+        if (head == tail_->load(std::memory_order_acquire)) return false;
+        const char* slot = slotAt(head);
+        out.assign(slot, strnlen(slot, size_));
+        head_->store(advance(head), std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(char* out, size_t cap) {
+        uint64_t head = head_->load(std::memory_order_relaxed);
+        if (head == tail_->load(std::memory_order_acquire)) return false;
+        const char* slot = slotAt(head);
+        size_t copyLen = strnlen(slot, size_);
+        if (copyLen >= cap) copyLen = cap - 1;
+        memcpy(out, slot, copyLen);
+        out[copyLen] = '\0';
+        head_->store(advance(head), std::memory_order_release);
+        return true;
+    }
+
+    // 读取队首但不出队；处理完成后再 commit，崩溃时未提交的消息由接管者重新处理
+    bool peek(std::string& out) const {
+        uint64_t head = head_->load(std::memory_order_relaxed);
+        if (head == tail_->load(std::memory_order_acquire)) return false;
+        const char* slot = slotAt(head);
+        out.assign(slot, strnlen(slot, size_));
+        return true;
+    }
+
+    void commit() {
+        head_->store(advance(head_->load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+private:
+    uint64_t advance(uint64_t pos) const {
+        return legacy_ ? (pos + 1) % count_ : pos + 1;
+    }
+
+    char* slotAt(uint64_t pos) const {
+        return slots_ + static_cast<size_t>(legacy_ ? pos : (pos & mask_)) * size_;
+    }
+
+    std::atomic<uint64_t>* head_;
+    std::atomic<uint64_t>* tail_;
+    char* slots_;
+    uint32_t count_;
+    uint32_t size_;
+    uint64_t mask_;
+    bool legacy_;
+};
+
+/**
+ * @brief 一个已映射通道的视图 (两个环 + 握手标志)
+ */
+struct ChannelView {
+    SpscRing request;
+    SpscRing response;
+    std::atomic<bool>* clientConnected = nullptr;
+    std::atomic<bool>* schedulerReady = nullptr;
+    uint32_t layoutVersion = 0;
+    uint32_t slotCount = 0;
+    uint32_t slotSize = 0;
+};
+
+// 几何是否合法 (2 的幂槽数、槽大小与总大小在上下限之内)
+bool validGeometry(uint32_t slotCount, uint32_t slotSize, uint32_t maxSlotCount, uint32_t maxSlotSize);
+
+// 客户端: 在新建的段上写入版本 2 头部并初始化两个环
+void formatChannel(void* base, uint32_t slotCount, uint32_t slotSize, ChannelView& view);
+
+/**
+ * @brief 调度器: 识别并校验客户端通道布局
+ * @param length 段的实际映射长度
+ * @param error  校验失败的原因
+ */
+bool bindChannel(void* base, size_t length, uint32_t maxSlotCount, uint32_t maxSlotSize,
+                 ChannelView& view, std::string& error);
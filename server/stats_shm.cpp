@@ -0,0 +1,197 @@
+#include "stats_shm.h"
+#include "config.h"
+#include "shm_segment.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+void copyField(char* dst, size_t cap, const std::string& src) {
+    size_t n = std::min(src.size(), cap - 1);
+    std::memcpy(dst, src.data(), n);
+    std::memset(dst + n, 0, cap - n);
+}
+
+std::string readField(const char* src, size_t cap) {
+    return std::string(src, strnlen(src, cap));
+}
+
+} // namespace
+
+std::string statsShmName() {
+    return "/kernel_scheduler_stats" + get_user_suffix();
+}
+
+// ===== StatsPublisher =====
+
+StatsPublisher::StatsPublisher()
+    : base_(nullptr), length_(0), header_(nullptr), entries_(nullptr), fullWarned_(false) {}
+
+StatsPublisher::~StatsPublisher() {
+    close();
+}
+
+bool StatsPublisher::open(const std::string& name) {
+    close();
+    // 总是新建: 仍映射着旧段的读者看到发布时间停止更新后会重新打开
+    unlinkSegment(name);
+    std::string segName = name;
+    ShmSegment seg;
+    size_t length = sizeof(StatsHeader) + STATS_MAX_CLIENTS * sizeof(StatsEntry);
+    if (!createSegment(segName, length, segName.size() + 1, true, false, seg)) {
+        std::cerr << "[Stats] Cannot create " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    name_ = segName;
+    base_ = seg.addr;
+    length_ = seg.length;
+    std::memset(base_, 0, length_);
+    header_ = static_cast<StatsHeader*>(base_);
+    entries_ = reinterpret_cast<StatsEntry*>(static_cast<char*>(base_) + sizeof(StatsHeader));
+    header_->capacity = static_cast<uint32_t>(STATS_MAX_CLIENTS);
+    header_->entrySize = sizeof(StatsEntry);
+    header_->version = STATS_VERSION;
+    header_->writerPid = static_cast<uint32_t>(getpid());
+    // magic 最后写，读者据此判断段已初始化
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = STATS_MAGIC;
+    return true;
+}
+
+void StatsPublisher::close() {
+    if (!base_) return;
+    munmap(base_, length_);
+    unlinkSegment(name_);
+    base_ = nullptr;
+    header_ = nullptr;
+    entries_ = nullptr;
+    slots_.clear();
+}
+
+void StatsPublisher::write(StatsEntry& e, const ClientStats& c) {
+    e.seq.store(e.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.phase = static_cast<uint32_t>(c.phase);
+    copyField(e.clientKey, sizeof(e.clientKey), c.clientKey);
+    copyField(e.model, sizeof(e.model), c.model);
+    e.sessions = c.sessions;
+    e.waiting = c.waiting;
+    e.paused = c.paused ? 1 : 0;
+    e.kernels = c.kernels;
+    e.busyNs = c.busyNs;
+    e.seq.store(e.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void StatsPublisher::publish(const std::vector<ClientStats>& clients, uint64_t nowNs) {
+    if (!header_) return;
+    std::unordered_map<std::string, uint32_t> next;
+    std::vector<bool> taken(STATS_MAX_CLIENTS, false);
+    for (const auto& entry : slots_) taken[entry.second] = true;
+
+    uint32_t used = header_->used.load(std::memory_order_relaxed);
+    for (const auto& c : clients) {
+        auto it = slots_.find(c.clientKey);
+        uint32_t slot;
+        if (it != slots_.end()) {
+            slot = it->second;
+            slots_.erase(it);
+        } else {
+            // 优先复用空槽；槽位不足时多出的客户端不发布
+            slot = 0;
+            while (slot < STATS_MAX_CLIENTS && taken[slot]) slot++;
+            if (slot == STATS_MAX_CLIENTS) {
+                if (!fullWarned_) std::cerr << "[Stats] Table full, some clients are not published" << std::endl;
+                fullWarned_ = true;
+                continue;
+            }
+            taken[slot] = true;
+        }
+        next[c.clientKey] = slot;
+        write(entries_[slot], c);
+        used = std::max(used, slot + 1);
+    }
+    // 剩下的是已下线的客户端
+    for (const auto& entry : slots_) write(entries_[entry.second], ClientStats());
+    slots_.swap(next);
+    header_->used.store(used, std::memory_order_release);
+    header_->publishedNs.store(nowNs, std::memory_order_release);
+}
+
+// ===== StatsReader =====
+
+StatsReader::StatsReader() : base_(nullptr), length_(0), header_(nullptr), entries_(nullptr) {}
+
+StatsReader::~StatsReader() {
+    close();
+}
+
+bool StatsReader::open(const std::string& name) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) return false;
+    struct stat st;
+    size_t length = sizeof(StatsHeader) + STATS_MAX_CLIENTS * sizeof(StatsEntry);
+    if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(StatsHeader)) {
+        ::close(fd);
+        return false;
+    }
+    length = std::min(length, static_cast<size_t>(st.st_size));
+    void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+    const StatsHeader* header = static_cast<const StatsHeader*>(addr);
+    if (header->magic != STATS_MAGIC || header->version != STATS_VERSION ||
+        header->entrySize != sizeof(StatsEntry) ||
+        sizeof(StatsHeader) + static_cast<size_t>(header->capacity) * sizeof(StatsEntry) > length) {
+        munmap(addr, length);
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    base_ = addr;
+    length_ = length;
+    header_ = header;
+    entries_ = reinterpret_cast<const StatsEntry*>(static_cast<const char*>(addr) + sizeof(StatsHeader));
+    return true;
+}
+
+void StatsReader::close() {
+    if (base_) munmap(base_, length_);
+    base_ = nullptr;
+    header_ = nullptr;
+    entries_ = nullptr;
+}
+
+bool StatsReader::snapshot(std::vector<ClientStats>& out, uint64_t& publishedNs) const {
+    out.clear();
+    if (!header_) return false;
+    publishedNs = header_->publishedNs.load(std::memory_order_acquire);
+    uint32_t used = std::min(header_->used.load(std::memory_order_acquire), header_->capacity);
+    for (uint32_t i = 0; i < used; i++) {
+        const StatsEntry& e = entries_[i];
+        // 写者每 STATS_PUBLISH_MS 才改写一次，重试几次总能读到稳定的版本
+        for (int attempt = 0; attempt < 8; attempt++) {
+            uint32_t before = e.seq.load(std::memory_order_acquire);
+            if (before & 1u) continue;
+            ClientStats c;
+            c.clientKey = readField(e.clientKey, sizeof(e.clientKey));
+            c.model = readField(e.model, sizeof(e.model));
+            c.phase = static_cast<int>(e.phase);
+            c.sessions = e.sessions;
+            c.waiting = e.waiting;
+            c.paused = e.paused != 0;
+            c.kernels = e.kernels;
+            c.busyNs = e.busyNs;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.seq.load(std::memory_order_relaxed) != before) continue;
+            if (!c.clientKey.empty()) out.push_back(c);
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================
+//  统计共享内存 (调度器 -> 路由器等只读消费者)
+//  段 = StatsHeader + capacity 个 StatsEntry，每个在线客户端 (clientKey) 一个条目，
+//  字段为累计计数，消费者按两次读取之差计算速率与利用率。
+//  唯一的写者是调度器的 tick 线程；每个条目自带 seqlock (奇数表示写入中)，
+//  读者在映射上原地读取，seq 前后一致才采用。条目下线时清空 key，槽位可被复用。
+// ============================================================
+
+constexpr uint32_t STATS_MAGIC = 0x5453534b;     // "KSST"
+constexpr uint32_t STATS_VERSION = 1;
+constexpr size_t STATS_MAX_CLIENTS = 256;
+
+// 客户端运行阶段，由 attention kernel 的名字推断 (StatsEntry::phase 存其整数值)
+enum class ClientPhase : int { Unknown = 0, Prefill = 1, Decode = 2 };
+
+// 统计段名: /kernel_scheduler_stats_$USER
+std::string statsShmName();
+
+struct StatsHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t entrySize;
+    std::atomic<uint64_t> publishedNs;   // 最近一次发布 (CLOCK_MONOTONIC)，读者据此判断调度器是否还活着
+    std::atomic<uint32_t> used;          // 曾用过的最大槽位数，读者只需扫描前 used 个
+    uint32_t writerPid;
+    uint64_t reserved[4];
+};
+
+struct StatsEntry {
+    std::atomic<uint32_t> seq;
+    uint32_t phase;                      // ClientPhase 的整数值
+    char clientKey[64];                  // "<type>:<uniqueId>"，空表示空槽
+    char model[48];
+    uint32_t sessions;                   // 该客户端的在线会话数
+    uint32_t waiting;                    // 正被暂停或配额挡住的会话数
+    uint32_t paused;
+    uint32_t reserved;
+    uint64_t kernels;                    // 累计 kernel 数 (在线会话)
+    uint64_t busyNs;                     // 累计遥测耗时 (在线会话)
+    uint64_t reserved2[5];
+};
+static_assert(sizeof(StatsEntry) == 192, "StatsEntry layout");
+
+// 一个客户端的统计 (发布与读取共用)
+struct ClientStats {
+    std::string clientKey;
+    std::string model;
+    int phase = 0;
+    uint32_t sessions = 0;
+    uint32_t waiting = 0;
+    bool paused = false;
+    uint64_t kernels = 0;
+    uint64_t busyNs = 0;
+};
+
+/**
+ * @brief 写端: 创建段并周期性发布全部在线客户端
+ */
+class StatsPublisher {
+public:
+    StatsPublisher();
+    ~StatsPublisher();
+
+    StatsPublisher(const StatsPublisher&) = delete;
+    StatsPublisher& operator=(const StatsPublisher&) = delete;
+
+    bool open(const std::string& name);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    // 用本次的客户端集合覆盖上次: 新客户端占用空槽，消失的客户端清空槽位
+    void publish(const std::vector<ClientStats>& clients, uint64_t nowNs);
+
+private:
+    void write(StatsEntry& e, const ClientStats& c);
+
+    std::string name_;
+    void* base_;
+    size_t length_;
+    StatsHeader* header_;
+    StatsEntry* entries_;
+    std::unordered_map<std::string, uint32_t> slots_;   // clientKey -> 槽位
+    bool fullWarned_;
+};
+
+/**
+ * @brief 读端: 只读映射，原地读取条目
+ */
+class StatsReader {
+public:
+    StatsReader();
+    ~StatsReader();
+
+    StatsReader(const StatsReader&) = delete;
+    StatsReader& operator=(const StatsReader&) = delete;
+
+    // 段不存在 (调度器未启动) 时返回 false，可稍后重试
+    bool open(const std::string& name);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    // 读取全部非空条目；publishedNs 为调度器最近一次发布的时间
+    bool snapshot(std::vector<ClientStats>& out, uint64_t& publishedNs) const;
+
+private:
+    void* base_;
+    size_t length_;
+    const StatsHeader* header_;
+    const StatsEntry* entries_;
+};
@@ -0,0 +1,191 @@
+#include "stream_proto.h"
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool fillUnix(const std::string& path, struct sockaddr_un& addr) {
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+bool fillInet(const StreamAddress& a, struct sockaddr_in& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(a.port));
+    if (inet_pton(AF_INET, a.host.c_str(), &addr.sin_addr) == 1) return true;
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    if (getaddrinfo(a.host.c_str(), nullptr, &hints, &res) != 0 || !res) return false;
+    addr.sin_addr = reinterpret_cast<struct sockaddr_in*>(res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+    return true;
+}
+
+} // namespace
+
+std::string StreamAddress::toString() const {
+    return isUnix ? "unix:" + path : "tcp:" + host + ":" + std::to_string(port);
+}
+
+std::string defaultStreamSocketPath() {
+    return std::string(CONTROL_SOCKET_PREFIX) + get_user_suffix() + ".stream";
+}
+
+bool parseStreamAddress(const std::string& spec, StreamAddress& out) {
+    out = StreamAddress();
+    if (spec == "unix" || spec.compare(0, 5, "unix:") == 0) {
+        out.isUnix = true;
+        out.path = spec.size() > 5 ? spec.substr(5) : defaultStreamSocketPath();
+        return true;
+    }
+    if (spec != "tcp" && spec.compare(0, 4, "tcp:") != 0) return false;
+    std::string rest = spec.size() > 4 ? spec.substr(4) : std::string();
+    size_t colon = rest.rfind(':');
+    std::string port = colon == std::string::npos ? rest : rest.substr(colon + 1);
+    out.host = colon == std::string::npos || colon == 0 ? std::string(LOCALHOST) : rest.substr(0, colon);
+    out.port = port.empty() ? SCHEDULER_PORT : atoi(port.c_str());
+    return out.port > 0 && out.port < 65536;
+}
+
+int listenStream(const StreamAddress& a) {
+    int fd;
+    bool ok;
+    if (a.isUnix) {
+        struct sockaddr_un addr;
+        if (!fillUnix(a.path, addr)) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) return -1;
+        unlink(a.path.c_str());
+        mode_t old = umask(0077);
+        ok = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+        umask(old);
+    } else {
+        struct sockaddr_in addr;
+        if (!fillInet(a, addr)) return -1;
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) return -1;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        ok = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+    if (!ok || listen(fd, 128) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+int connectStream(const StreamAddress& a) {
+    int fd;
+    if (a.isUnix) {
+        struct sockaddr_un addr;
+        if (!fillUnix(a.path, addr)) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) return -1;
+        if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in addr;
+        if (!fillInet(a, addr)) return -1;
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) return -1;
+        if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+std::string streamPeerName(int fd, bool isUnix) {
+    if (isUnix) {
+        struct ucred cred;
+        socklen_t len = sizeof(cred);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0) return "unix:pid" + std::to_string(cred.pid);
+        return "unix:?";
+    }
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    char ip[INET_ADDRSTRLEN] = "?";
+    if (getpeername(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0) {
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        return std::string("tcp:") + ip + ":" + std::to_string(ntohs(addr.sin_port));
+    }
+    return "tcp:?";
+}
+
+bool parseHello(const std::string& frame, std::string& type, std::string& id) {
+    size_t a = frame.find('|');
+    if (a == std::string::npos || frame.compare(0, a, "HELLO") != 0) return false;
+    size_t b = frame.find('|', a + 1);
+    if (b == std::string::npos || frame.find('|', b + 1) != std::string::npos) return false;
+    type = frame.substr(a + 1, b - a - 1);
+    id = frame.substr(b + 1);
+    return (type == "sglang" || type == "pytorch") && !id.empty();
+}
+
+void appendFrame(std::string& buf, const char* data, size_t len) {
+    unsigned char header[4] = {static_cast<unsigned char>(len), static_cast<unsigned char>(len >> 8),
+                               static_cast<unsigned char>(len >> 16), static_cast<unsigned char>(len >> 24)};
+    buf.append(reinterpret_cast<const char*>(header), sizeof(header));
+    buf.append(data, len);
+}
+
+int takeFrame(const std::string& buf, size_t& offset, std::string& out) {
+    if (buf.size() - offset < 4) return 0;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buf.data() + offset);
+    uint32_t len = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    if (len > STREAM_MAX_FRAME) return -1;
+    if (buf.size() - offset - 4 < len) return 0;
+    out.assign(buf, offset + 4, len);
+    offset += 4 + len;
+    return 1;
+}
+
+bool writeFull(int fd, const char* data, size_t len, int stopFd, int timeoutMs) {
+    int flags = MSG_NOSIGNAL | (timeoutMs >= 0 ? MSG_DONTWAIT : 0);
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, flags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && timeoutMs >= 0) {
+            struct pollfd fds[2];
+            fds[0].fd = fd;
+            fds[0].events = POLLOUT;
+            fds[1].fd = stopFd;
+            fds[1].events = POLLIN;
+            int r = poll(fds, stopFd >= 0 ? 2 : 1, timeoutMs);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0 || (stopFd >= 0 && fds[1].revents)) return false;
+            continue;
+        }
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// ============================================================
+//  流式传输协议 (TCP 或 Unix 域流套接字，容器内无法共享 /dev/shm 时使用)
+//  帧: 4 字节小端长度 + 负载，负载即共享内存通道上的文本消息。
+//  客户端先发 "HELLO|<type>|<uniqueId>"，调度器在会话开始时回复 "READY"；
+//  之后的请求/遥测/模型声明帧与应答帧同共享内存协议。
+//  客户端可以连续发送多帧 (流水线)，调度器按批读取，批内的应答攒在一起一次写出。
+// ============================================================
+
+struct StreamAddress {
+    bool isUnix = false;
+    std::string path;       // Unix 套接字路径
+    std::string host;       // TCP 地址 (IPv4 点分或主机名)
+    int port = 0;
+
+    std::string toString() const;
+};
+
+// 默认 Unix 流套接字: /tmp/kernel_scheduler_<user>.stream
+std::string defaultStreamSocketPath();
+
+/**
+ * @brief 解析地址: "tcp:<host>:<port>" / "tcp:<port>" / "tcp" (127.0.0.1:SCHEDULER_PORT)，
+ *        "unix:<path>" / "unix" (默认路径)
+ */
+bool parseStreamAddress(const std::string& spec, StreamAddress& out);
+
+// 监听 (TCP 开启 SO_REUSEADDR；Unix 套接字替换残留文件，权限 0600)，返回非阻塞 fd 或 -1
+int listenStream(const StreamAddress& addr);
+
+// 连接并开启 TCP_NODELAY，返回阻塞 fd 或 -1
+int connectStream(const StreamAddress& addr);
+
+// 对端描述: TCP 为 "tcp:<ip>:<port>"，Unix 套接字为 "unix:pid<n>" (SO_PEERCRED)
+std::string streamPeerName(int fd, bool isUnix);
+
+// 解析握手帧 "HELLO|<type>|<uniqueId>"，type 只接受 sglang / pytorch
+bool parseHello(const std::string& frame, std::string& type, std::string& id);
+
+// 在 buf 末尾追加一帧
+void appendFrame(std::string& buf, const char* data, size_t len);
+
+/**
+ * @brief 从 buf 的 offset 处取出一帧
+ * @return 1 取到一帧 (offset 前移)；0 数据不完整；-1 帧长超过 STREAM_MAX_FRAME
+ */
+int takeFrame(const std::string& buf, size_t& offset, std::string& out);
+
+// 写出全部数据 (阻塞 fd)。timeoutMs >= 0 时不在 send 上阻塞，而是同时等待可写与 stopFd，
+// 连续 timeoutMs 没有进展或 stopFd 可读即放弃
+bool writeFull(int fd, const char* data, size_t len, int stopFd = -1, int timeoutMs = -1);
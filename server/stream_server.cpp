@@ -0,0 +1,274 @@
+#include "stream_server.h"
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t STREAM_READ_BYTES = 64 * 1024;
+
+} // namespace
+
+// ======================= StreamStop =======================
+
+StreamStop::StreamStop() : stopped(false), fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+StreamStop::~StreamStop() {
+    if (fd != -1) close(fd);
+}
+
+void StreamStop::signal() {
+    stopped.store(true);
+    uint64_t one = 1;
+    ssize_t ignored = write(fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+// ======================= StreamChannel =======================
+
+StreamChannel::StreamChannel(int fd, std::string name, std::string type, std::string id, std::string pending,
+                             std::shared_ptr<StreamStop> stop)
+    : fd(fd), name(std::move(name)), clientType(std::move(type)), uniqueId(std::move(id)), inBuf(std::move(pending)),
+      inPos(0), closed(false), stop(std::move(stop)) {
+    // 单帧一定放得下，应答变长 (reqId 多一位) 时不在热路径上扩容
+    outBuf.reserve(STREAM_MAX_FRAME + 4);
+}
+
+StreamChannel::~StreamChannel() {
+    if (!closed) flush();
+    close(fd);
+}
+
+bool StreamChannel::recvBlocking(std::string& outMsg) {
+    while (!closed) {
+        int r = takeFrame(inBuf, inPos, outMsg);
+        if (r > 0) return true;
+        if (r < 0) {
+            std::cerr << "[StreamServer] " << name << ": oversized frame, closing" << std::endl;
+            closed = true;
+            return false;
+        }
+        // 输入取空: 先把这一批的应答写出，再阻塞等待下一批
+        inBuf.erase(0, inPos);
+        inPos = 0;
+        flush();
+        if (closed) return false;
+
+        struct pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = stop->fd;
+        fds[1].events = POLLIN;
+        int n = poll(fds, 2, STREAM_POLL_MS);
+        if (n < 0 && errno != EINTR) closed = true;
+        if (n <= 0 || stop->stopped.load(std::memory_order_relaxed)) return false;
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) return false;
+
+        size_t old = inBuf.size();
+        inBuf.resize(old + STREAM_READ_BYTES);
+        ssize_t got = recv(fd, &inBuf[old], STREAM_READ_BYTES, 0);
+        if (got < 0 && errno == EINTR) got = 0;
+        if (got <= 0 && !(got < 0 && errno == EAGAIN)) {
+            inBuf.resize(old);
+            closed = true;
+            return false;
+        }
+        inBuf.resize(old + static_cast<size_t>(got > 0 ? got : 0));
+    }
+    return false;
+}
+
+bool StreamChannel::sendBlocking(const std::string& msg) {
+    if (closed) return false;
+    appendFrame(outBuf, msg.data(), msg.size());
+    if (outBuf.size() >= STREAM_FLUSH_BYTES) flush();
+    return !closed;
+}
+
+void StreamChannel::flush() {
+    if (outBuf.empty() || closed) return;
+    if (!writeFull(fd, outBuf.data(), outBuf.size(), stop->fd, STREAM_SEND_TIMEOUT_MS)) {
+        if (!stop->stopped.load(std::memory_order_relaxed)) {
+            std::cerr << "[StreamServer] " << name << ": not reading replies, closing" << std::endl;
+        }
+        closed = true;
+    }
+    outBuf.clear();
+}
+
+bool StreamChannel::isConnected() {
+    return !closed && !stop->stopped.load(std::memory_order_relaxed);
+}
+
+void StreamChannel::setReady() {
+    static const char ready[] = "READY";
+    appendFrame(outBuf, ready, sizeof(ready) - 1);
+    flush();
+}
+
+// ======================= StreamServer =======================
+
+StreamServer::StreamServer(const std::vector<StreamAddress>& addrs)
+    : addresses(addrs), epollFd(-1), stopSignal(std::make_shared<StreamStop>()), running(false) {}
+
+StreamServer::~StreamServer() {
+    stop();
+    for (auto& conn : pending) close(conn.first);
+    pending.clear();
+    for (const auto& l : listenFds) {
+        close(l.first);
+    }
+    for (const auto& a : addresses) {
+        if (a.isUnix) unlink(a.path.c_str());
+    }
+    if (epollFd != -1) close(epollFd);
+}
+
+bool StreamServer::init() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1 || stopSignal->fd == -1) {
+        perror("[StreamServer] epoll/eventfd");
+        return false;
+    }
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = stopSignal->fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, stopSignal->fd, &ev);
+
+    for (const auto& a : addresses) {
+        int fd = listenStream(a);
+        if (fd == -1) {
+            std::cerr << "[StreamServer] Cannot listen on " << a.toString() << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        listenFds.emplace_back(fd, a.isUnix);
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        std::cout << "[StreamServer] Listening on " << a.toString() << std::endl;
+    }
+    return true;
+}
+
+void StreamServer::start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) {
+    callback = onNewClient;
+    running.store(true);
+    loopThread = std::thread(&StreamServer::eventLoop, this);
+}
+
+void StreamServer::stop() {
+    running.store(false);
+    // 同时唤醒监听线程与所有阻塞在 poll 上的会话
+    stopSignal->signal();
+    if (loopThread.joinable()) loopThread.join();
+}
+
+void StreamServer::eventLoop() {
+    struct epoll_event events[32];
+    while (running.load()) {
+        // 有未握手的连接时定期醒来检查超时
+        int n = epoll_wait(epollFd, events, 32, pending.empty() ? -1 : STREAM_POLL_MS);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == stopSignal->fd) continue;
+            bool isListen = false;
+            for (const auto& l : listenFds) {
+                if (l.first == fd) {
+                    acceptClients(fd, l.second);
+                    isListen = true;
+                    break;
+                }
+            }
+            if (!isListen) readHello(fd);
+        }
+        if (!pending.empty()) expirePending();
+    }
+}
+
+void StreamServer::acceptClients(int listenFd, bool isUnix) {
+    int conn;
+    while ((conn = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        if (!isUnix) {
+            int one = 1;
+            setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        Pending& p = pending[conn];
+        p.name = streamPeerName(conn, isUnix);
+        p.accepted = std::chrono::steady_clock::now();
+        struct epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = conn;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, conn, &ev);
+    }
+}
+
+void StreamServer::readHello(int conn) {
+    auto it = pending.find(conn);
+    if (it == pending.end()) return;
+    Pending& p = it->second;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(conn, buf, sizeof(buf), 0)) > 0) p.buf.append(buf, static_cast<size_t>(n));
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        dropPending(conn);
+        return;
+    }
+
+    size_t offset = 0;
+    std::string hello;
+    int r = takeFrame(p.buf, offset, hello);
+    if (r == 0) return;
+    std::string type, id;
+    if (r < 0 || !parseHello(hello, type, id)) {
+        std::cerr << "[StreamServer] Rejected " << p.name << ": malformed HELLO" << std::endl;
+        std::string reply;
+        appendFrame(reply, "ERR|malformed hello", 19);
+        ssize_t ignored = send(conn, reply.data(), reply.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        (void)ignored;
+        dropPending(conn);
+        return;
+    }
+
+    // 握手完成: 交给会话线程阻塞读写
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn, nullptr);
+    fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) & ~O_NONBLOCK);
+    std::string name = p.name;
+    std::string rest = p.buf.substr(offset);
+    pending.erase(it);
+
+    std::cout << "[StreamServer] Attached " << name << " (" << type << ":" << id << ")" << std::endl;
+    auto channel = std::unique_ptr<IChannel>(new StreamChannel(conn, name, type, id, rest, stopSignal));
+    if (callback) callback(std::move(channel));
+}
+
+void StreamServer::dropPending(int conn) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn, nullptr);
+    close(conn);
+    pending.erase(conn);
+}
+
+void StreamServer::expirePending() {
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::milliseconds(STREAM_HELLO_TIMEOUT_MS);
+    std::vector<int> expired;
+    for (const auto& conn : pending) {
+        if (conn.second.accepted < deadline) expired.push_back(conn.first);
+    }
+    for (int conn : expired) {
+        std::cerr << "[StreamServer] Dropped " << pending[conn].name << ": no HELLO within "
+                  << STREAM_HELLO_TIMEOUT_MS << " ms" << std::endl;
+        dropPending(conn);
+    }
+}
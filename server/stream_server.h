@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ipc.h"
+#include "stream_proto.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 服务停止信号: 会话线程在 poll 时一并等待 fd，stop 后立即醒来
+struct StreamStop {
+    StreamStop();
+    ~StreamStop();
+    void signal();
+
+    std::atomic<bool> stopped;
+    int fd;
+};
+
+/**
+ * @brief 流式套接字上的通道
+ * 按批读取: 一次 recv 可能带来多条流水线请求，逐条交给会话；
+ * 应答先攒在输出缓冲里，输入取空 (即将阻塞) 或缓冲超过 STREAM_FLUSH_BYTES 时一次写出；
+ * 客户端不读应答、STREAM_SEND_TIMEOUT_MS 内写不出去时关闭通道，stop 时也不再等待。
+ */
+class StreamChannel : public IChannel {
+public:
+    // pending: 握手时已读到的 HELLO 之后的数据
+    StreamChannel(int fd, std::string name, std::string type, std::string id, std::string pending,
+                  std::shared_ptr<StreamStop> stop);
+    ~StreamChannel();
+
+    bool recvBlocking(std::string& outMsg) override;
+    bool sendBlocking(const std::string& msg) override;
+    bool isConnected() override;
+    void setReady() override;
+    void flush() override;
+
+    std::string getId() const override { return uniqueId; }
+    std::string getType() const override { return clientType; }
+    std::string getName() const override { return name; }
+
+private:
+    int fd;
+    std::string name;
+    std::string clientType;
+    std::string uniqueId;
+    std::string inBuf;
+    size_t inPos;
+    std::string outBuf;
+    bool closed;
+    std::shared_ptr<StreamStop> stop;
+};
+
+/**
+ * @brief TCP / Unix 流套接字服务 (协议见 stream_proto.h)
+ * 与 ShmServer 并行运行，接受的连接完成 HELLO 握手后交给同一个 Scheduler::onNewClient。
+ * 监听线程只负责 accept 与握手，会话线程直接在套接字上阻塞读写。
+ */
+class StreamServer : public IIPCServer {
+public:
+    explicit StreamServer(const std::vector<StreamAddress>& addresses);
+    ~StreamServer();
+
+    bool init() override;
+    void start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) override;
+    void stop() override;
+
+private:
+    struct Pending {
+        std::string name;
+        std::string buf;
+        std::chrono::steady_clock::time_point accepted;
+    };
+
+    void eventLoop();
+    void acceptClients(int listenFd, bool isUnix);
+    void readHello(int conn);
+    void dropPending(int conn);
+    void expirePending();
+
+    std::vector<StreamAddress> addresses;
+    std::vector<std::pair<int, bool>> listenFds;     // fd, 是否 Unix 套接字
+    int epollFd;
+    std::shared_ptr<StreamStop> stopSignal;
+    std::atomic<bool> running;
+    std::thread loopThread;
+    std::function<void(std::unique_ptr<IChannel>)> callback;
+    // 尚未完成握手的连接 (只由监听线程访问)，STREAM_HELLO_TIMEOUT_MS 内没发完 HELLO 即断开
+    std::unordered_map<int, Pending> pending;
+};
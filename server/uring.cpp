@@ -0,0 +1,187 @@
+#include "uring.h"
+#include "config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int uringSetup(unsigned entries, struct io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int uringRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+template <typename T>
+T* at(void* base, unsigned offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+Uring::Uring()
+    : fd_(-1), sqpoll_(false), entries_(0), sqRing_(nullptr), sqRingBytes_(0), cqRing_(nullptr), cqRingBytes_(0),
+      sqes_(nullptr), sqesBytes_(0), sqHead_(nullptr), sqTail_(nullptr), sqFlags_(nullptr), sqArray_(nullptr),
+      sqMask_(0), sqLocalTail_(0), cqHead_(nullptr), cqTail_(nullptr), cqMask_(0), cqes_(nullptr), bufRing_(nullptr),
+      bufRingBytes_(0), bufferBase_(nullptr), bufferCount_(0), bufferBytes_(0) {}
+
+Uring::~Uring() {
+    close();
+}
+
+bool Uring::init(unsigned entries, unsigned buffers, unsigned bufferBytes, bool sqpoll) {
+    struct io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    if (sqpoll) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = URING_SQPOLL_IDLE_MS;
+    }
+    // 失败路径保留 errno 供调用方报告
+    auto fail = [this]() {
+        int saved = errno;
+        close();
+        errno = saved;
+        return false;
+    };
+    fd_ = uringSetup(entries, &p);
+    if (fd_ < 0) {
+        // ENOSYS: 内核没有 io_uring；EPERM: 被 sysctl kernel.io_uring_disabled 或 seccomp 禁用
+        fd_ = -1;
+        return false;
+    }
+    sqpoll_ = sqpoll;
+    entries_ = p.sq_entries;
+
+    sqRingBytes_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingBytes_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) sqRingBytes_ = cqRingBytes_ = std::max(sqRingBytes_, cqRingBytes_);
+    sqRing_ = mmap(nullptr, sqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        return fail();
+    }
+    if (single) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                       IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            cqRing_ = nullptr;
+            return fail();
+        }
+    }
+    sqesBytes_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return fail();
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    sqHead_ = at<unsigned>(sqRing_, p.sq_off.head);
+    sqTail_ = at<unsigned>(sqRing_, p.sq_off.tail);
+    sqFlags_ = at<unsigned>(sqRing_, p.sq_off.flags);
+    sqArray_ = at<unsigned>(sqRing_, p.sq_off.array);
+    sqMask_ = *at<unsigned>(sqRing_, p.sq_off.ring_mask);
+    sqLocalTail_ = *sqTail_;
+    cqHead_ = at<unsigned>(cqRing_, p.cq_off.head);
+    cqTail_ = at<unsigned>(cqRing_, p.cq_off.tail);
+    cqMask_ = *at<unsigned>(cqRing_, p.cq_off.ring_mask);
+    cqes_ = at<struct io_uring_cqe>(cqRing_, p.cq_off.cqes);
+
+    // 接收缓冲区环: 环本身与缓冲区各占一段匿名内存，环按页对齐
+    bufferCount_ = buffers;
+    bufferBytes_ = bufferBytes;
+    bufRingBytes_ = buffers * sizeof(struct io_uring_buf);
+    void* ring = mmap(nullptr, bufRingBytes_ + static_cast<size_t>(buffers) * bufferBytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (ring == MAP_FAILED) return fail();
+    bufRing_ = static_cast<struct io_uring_buf_ring*>(ring);
+    bufferBase_ = static_cast<char*>(ring) + bufRingBytes_;
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+    reg.ring_entries = buffers;
+    reg.bgid = BUFFER_GROUP;
+    if (uringRegister(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) return fail();
+    bufRing_->tail = 0;
+    for (unsigned i = 0; i < buffers; i++) recycleBuffer(static_cast<uint16_t>(i));
+    return true;
+}
+
+void Uring::close() {
+    if (bufRing_) munmap(bufRing_, bufRingBytes_ + static_cast<size_t>(bufferCount_) * bufferBytes_);
+    if (sqes_) munmap(sqes_, sqesBytes_);
+    if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqRingBytes_);
+    if (sqRing_) munmap(sqRing_, sqRingBytes_);
+    if (fd_ != -1) ::close(fd_);
+    fd_ = -1;
+    bufRing_ = nullptr;
+    bufferBase_ = nullptr;
+    sqes_ = nullptr;
+    cqRing_ = sqRing_ = nullptr;
+}
+
+struct io_uring_sqe* Uring::getSqe() {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqLocalTail_ - head < entries_) {
+            unsigned index = sqLocalTail_ & sqMask_;
+            struct io_uring_sqe* sqe = &sqes_[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqArray_[index] = index;
+            sqLocalTail_++;
+            return sqe;
+        }
+        submit(0);
+    }
+    return nullptr;
+}
+
+int Uring::submit(unsigned waitNr) {
+    unsigned published = *sqTail_;
+    unsigned toSubmit = sqLocalTail_ - published;
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+    unsigned flags = waitNr ? IORING_ENTER_GETEVENTS : 0;
+    if (sqpoll_) {
+        // 发布尾指针与读取 NEED_WAKEUP 之间需要全屏障，否则可能错过刚进入休眠的内核线程
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (__atomic_load_n(sqFlags_, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) flags |= IORING_ENTER_SQ_WAKEUP;
+        if (flags == 0) return static_cast<int>(toSubmit);
+        toSubmit = 0;
+    } else if (toSubmit == 0 && waitNr == 0) {
+        return 0;
+    }
+    int r;
+    do {
+        r = uringEnter(fd_, toSubmit, waitNr, flags);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+void Uring::recycleBuffer(uint16_t id) {
+    unsigned short tail = bufRing_->tail;
+    // 不用 bufRing_->bufs: 头文件的柔性数组在 C++ 下前面多了一个空结构体，偏移不是 0
+    struct io_uring_buf& b = reinterpret_cast<struct io_uring_buf*>(bufRing_)[tail & (bufferCount_ - 1)];
+    b.addr = reinterpret_cast<uint64_t>(bufferBase_ + static_cast<size_t>(id) * bufferBytes_);
+    b.len = bufferBytes_;
+    b.bid = id;
+    __atomic_store_n(&bufRing_->tail, static_cast<unsigned short>(tail + 1), __ATOMIC_RELEASE);
+}
+
+std::string Uring::describe() const {
+    return "io_uring (" + std::to_string(entries_) + " entries, " + std::to_string(bufferCount_) + " x " +
+           std::to_string(bufferBytes_ / 1024) + " KiB buffers" + (sqpoll_ ? ", sqpoll)" : ")");
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <string>
+
+// ============================================================
+//  io_uring 最小封装 (直接系统调用，不依赖 liburing)
+//  只由一个线程提交与收割: 提交队列尾指针与完成队列头指针都只在本线程更新。
+//  接收缓冲区通过 IORING_REGISTER_PBUF_RING 注册给内核，
+//  multishot recv 由内核从中挑选缓冲区，用完后调用 recycleBuffer 归还。
+// ============================================================
+
+class Uring {
+public:
+    Uring();
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    /**
+     * @brief 创建 ring 并注册接收缓冲区
+     * @param sqpoll 由内核线程轮询提交队列，提交时通常不需要系统调用
+     * @return 内核不支持 io_uring 或缺少所需特性 (5.19 以前没有缓冲区环) 时返回 false
+     */
+    bool init(unsigned entries, unsigned buffers, unsigned bufferBytes, bool sqpoll);
+
+    // 取一个空的提交项，队列满时先提交再重试
+    struct io_uring_sqe* getSqe();
+
+    /**
+     * @brief 提交已填好的提交项，并等待至少 waitNr 个完成
+     * SQPOLL 模式下内核线程醒着且不需要等待时不进入内核
+     */
+    int submit(unsigned waitNr);
+
+    // 依次处理已到达的完成项，返回处理的个数
+    template <typename Fn>
+    unsigned drain(Fn fn) {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned n = 0;
+        for (; head != tail; head++, n++) fn(cqes_[head & cqMask_]);
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    bool hasCompletions() const {
+        return *cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    }
+
+    // 接收缓冲区 (完成项 flags 高 16 位为缓冲区编号)
+    static constexpr uint16_t BUFFER_GROUP = 0;
+    const char* buffer(uint16_t id) const { return bufferBase_ + static_cast<size_t>(id) * bufferBytes_; }
+    void recycleBuffer(uint16_t id);
+
+    bool sqpoll() const { return sqpoll_; }
+    // 例如 "io_uring (256 entries, 256 x 16 KiB buffers, sqpoll)"
+    std::string describe() const;
+
+private:
+    void close();
+
+    int fd_;
+    bool sqpoll_;
+    unsigned entries_;
+    void* sqRing_;
+    size_t sqRingBytes_;
+    void* cqRing_;
+    size_t cqRingBytes_;
+    struct io_uring_sqe* sqes_;
+    size_t sqesBytes_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqFlags_;
+    unsigned* sqArray_;
+    unsigned sqMask_;
+    unsigned sqLocalTail_;     // 已填写但尚未发布的尾指针
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe* cqes_;
+
+    struct io_uring_buf_ring* bufRing_;
+    size_t bufRingBytes_;
+    char* bufferBase_;
+    unsigned bufferCount_;
+    unsigned bufferBytes_;
+};
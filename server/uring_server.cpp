@@ -0,0 +1,451 @@
+#include "uring_server.h"
+#include "config.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// user_data 高 32 位为操作类型，低 32 位为连接编号 (accept 为监听套接字下标)
+enum UringOp : uint64_t {
+    OP_ACCEPT = 1,
+    OP_RECV = 2,
+    OP_SEND = 3,
+    OP_WAKE = 4,
+};
+
+// SQPOLL 模式下阻塞等待完成之前先轮询完成队列的次数
+constexpr unsigned URING_SPIN_ROUNDS = 4096;
+
+uint64_t userData(UringOp op, uint32_t id) {
+    return (static_cast<uint64_t>(op) << 32) | id;
+}
+
+} // namespace
+
+// ======================= UringMailbox =======================
+
+UringMailbox::UringMailbox() : signalled(false), stopped(false), fd(eventfd(0, EFD_CLOEXEC)) {}
+
+UringMailbox::~UringMailbox() {
+    if (fd != -1) close(fd);
+}
+
+void UringMailbox::post(const std::shared_ptr<UringConn>& conn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirty.push_back(conn);
+    }
+    // 事件循环读走 eventfd 之前的多次投递只唤醒一次
+    if (!signalled.exchange(true)) wake();
+}
+
+void UringMailbox::wake() {
+    uint64_t one = 1;
+    ssize_t ignored = write(fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+// ======================= UringChannel =======================
+
+UringChannel::UringChannel(std::shared_ptr<UringConn> conn, std::string name, std::string type, std::string id,
+                           std::shared_ptr<UringMailbox> mailbox)
+    : conn(std::move(conn)), name(std::move(name)), clientType(std::move(type)), uniqueId(std::move(id)), inPos(0),
+      closed(false), mailbox(std::move(mailbox)) {
+    // 三个缓冲 (outBuf / queued / sending) 轮换交换，都预留一帧，应答变长时不在热路径上扩容
+    outBuf.reserve(STREAM_MAX_FRAME + 4);
+}
+
+UringChannel::~UringChannel() {
+    flush();
+    bool post;
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        conn->detached = true;
+        post = !conn->dirty;
+        conn->dirty = true;
+    }
+    if (post) mailbox->post(conn);
+}
+
+bool UringChannel::recvBlocking(std::string& outMsg) {
+    while (!closed) {
+        int r = takeFrame(inBuf, inPos, outMsg);
+        if (r > 0) return true;
+        if (r < 0) {
+            std::cerr << "[UringServer] " << name << ": oversized frame, closing" << std::endl;
+            closed = true;
+            return false;
+        }
+        // 输入取空: 先把这一批的应答交给事件循环，再等待下一批
+        inBuf.erase(0, inPos);
+        inPos = 0;
+        flush();
+
+        std::unique_lock<std::mutex> lock(conn->mutex);
+        if (conn->in.empty() && !conn->closed.load() && !mailbox->stopped.load()) {
+            conn->cv.wait_for(lock, std::chrono::milliseconds(STREAM_POLL_MS));
+        }
+        if (mailbox->stopped.load()) return false;
+        if (conn->in.empty()) {
+            if (conn->closed.load()) closed = true;
+            return false;
+        }
+        if (inBuf.empty()) inBuf.swap(conn->in);
+        else inBuf.append(conn->in);
+        conn->in.clear();
+    }
+    return false;
+}
+
+bool UringChannel::sendBlocking(const std::string& msg) {
+    if (closed) return false;
+    appendFrame(outBuf, msg.data(), msg.size());
+    if (outBuf.size() >= STREAM_FLUSH_BYTES) flush();
+    return !closed;
+}
+
+void UringChannel::flush() {
+    if (outBuf.empty()) return;
+    bool post = false;
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (conn->closed.load()) {
+            closed = true;
+        } else {
+            if (conn->queued.empty()) conn->queued.swap(outBuf);
+            else conn->queued.append(outBuf);
+            post = !conn->dirty;
+            conn->dirty = true;
+        }
+    }
+    outBuf.clear();
+    if (post) mailbox->post(conn);
+}
+
+bool UringChannel::isConnected() {
+    return !closed && !mailbox->stopped.load(std::memory_order_relaxed);
+}
+
+void UringChannel::setReady() {
+    static const char ready[] = "READY";
+    appendFrame(outBuf, ready, sizeof(ready) - 1);
+    flush();
+}
+
+// ======================= UringServer =======================
+
+UringServer::UringServer(const std::vector<StreamAddress>& addrs, bool sqpoll)
+    : addresses(addrs), sqpoll(sqpoll), multishotRecv(true), wakeValue(0), mailbox(std::make_shared<UringMailbox>()),
+      running(false), nextConnId(1) {}
+
+UringServer::~UringServer() {
+    stop();
+    for (auto& kv : conns) close(kv.second.fd);
+    conns.clear();
+    for (const auto& l : listenFds) close(l.first);
+    for (const auto& a : addresses) {
+        if (a.isUnix) unlink(a.path.c_str());
+    }
+}
+
+bool UringServer::init() {
+    if (mailbox->fd == -1) {
+        perror("[UringServer] eventfd");
+        return false;
+    }
+    if (!ring.init(URING_ENTRIES, URING_BUFFERS, URING_BUFFER_BYTES, sqpoll)) {
+        if (!sqpoll) {
+            std::cerr << "[UringServer] io_uring unavailable: " << strerror(errno) << std::endl;
+            return false;
+        }
+        // SQPOLL 在较旧的内核上需要特权，退回普通提交
+        std::cerr << "[UringServer] SQPOLL unavailable (" << strerror(errno) << "), submitting with io_uring_enter"
+                  << std::endl;
+        sqpoll = false;
+        if (!ring.init(URING_ENTRIES, URING_BUFFERS, URING_BUFFER_BYTES, false)) {
+            std::cerr << "[UringServer] io_uring unavailable: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    for (const auto& a : addresses) {
+        int fd = listenStream(a);
+        if (fd == -1) {
+            std::cerr << "[UringServer] Cannot listen on " << a.toString() << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        listenFds.emplace_back(fd, a.isUnix);
+        std::cout << "[UringServer] Listening on " << a.toString() << " via " << ring.describe() << std::endl;
+    }
+    return true;
+}
+
+void UringServer::start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) {
+    callback = onNewClient;
+    running.store(true);
+    loopThread = std::thread(&UringServer::eventLoop, this);
+}
+
+void UringServer::stop() {
+    running.store(false);
+    mailbox->stopped.store(true);
+    mailbox->wake();
+    if (loopThread.joinable()) loopThread.join();
+}
+
+void UringServer::eventLoop() {
+    for (size_t i = 0; i < listenFds.size(); i++) armAccept(i);
+    armWake();
+    while (running.load()) {
+        if (sqpoll) {
+            // 内核线程醒着时提交不进入内核，完成也先轮询一会儿
+            ring.submit(0);
+            for (unsigned spins = 1; !ring.hasCompletions() && spins < URING_SPIN_ROUNDS; spins++) {
+                if ((spins & 0xff) == 0) sched_yield();
+            }
+        }
+        if (!ring.hasCompletions() && ring.submit(1) < 0 && errno != EBUSY) {
+            perror("[UringServer] io_uring_enter");
+            break;
+        }
+        ring.drain([this](const struct io_uring_cqe& cqe) { handle(cqe); });
+    }
+    // 唤醒仍在等待输入的会话
+    for (auto& kv : conns) {
+        if (!kv.second.shared) continue;
+        kv.second.shared->closed.store(true);
+        std::lock_guard<std::mutex> lock(kv.second.shared->mutex);
+        kv.second.shared->cv.notify_all();
+    }
+}
+
+void UringServer::handle(const struct io_uring_cqe& cqe) {
+    uint32_t id = static_cast<uint32_t>(cqe.user_data);
+    switch (cqe.user_data >> 32) {
+    case OP_ACCEPT: onAccept(id, cqe); break;
+    case OP_RECV: onRecv(id, cqe); break;
+    case OP_SEND: onSend(id, cqe); break;
+    case OP_WAKE: onWake(); break;
+    default: break;
+    }
+}
+
+void UringServer::armAccept(size_t listenIndex) {
+    struct io_uring_sqe* sqe = ring.getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenFds[listenIndex].first;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = userData(OP_ACCEPT, static_cast<uint32_t>(listenIndex));
+}
+
+void UringServer::armWake() {
+    struct io_uring_sqe* sqe = ring.getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = mailbox->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeValue);
+    sqe->len = sizeof(wakeValue);
+    sqe->user_data = userData(OP_WAKE, 0);
+}
+
+void UringServer::armRecv(uint32_t id, Conn& c) {
+    struct io_uring_sqe* sqe = ring.getSqe();
+    if (!sqe) {
+        closeConn(c);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c.fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = Uring::BUFFER_GROUP;
+    sqe->ioprio = multishotRecv ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = userData(OP_RECV, id);
+    c.recvArmed = true;
+}
+
+void UringServer::armSend(uint32_t id, Conn& c) {
+    struct io_uring_sqe* sqe = ring.getSqe();
+    if (!sqe) {
+        closeConn(c);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = c.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(c.sending.data() + c.sent);
+    sqe->len = static_cast<uint32_t>(c.sending.size() - c.sent);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData(OP_SEND, id);
+    c.sendInFlight = true;
+}
+
+void UringServer::onAccept(size_t listenIndex, const struct io_uring_cqe& cqe) {
+    if (!(cqe.flags & IORING_CQE_F_MORE) && running.load()) {
+        if (cqe.res == -EINVAL) {
+            std::cerr << "[UringServer] Multishot accept unsupported, no longer accepting on "
+                      << addresses[listenIndex].toString() << std::endl;
+        } else {
+            armAccept(listenIndex);
+        }
+    }
+    if (cqe.res < 0) return;
+
+    int fd = cqe.res;
+    bool isUnix = listenFds[listenIndex].second;
+    if (!isUnix) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    uint32_t id = nextConnId++;
+    Conn& c = conns[id];
+    c.fd = fd;
+    c.name = streamPeerName(fd, isUnix);
+    armRecv(id, c);
+    releaseIfIdle(id);
+}
+
+void UringServer::onRecv(uint32_t id, const struct io_uring_cqe& cqe) {
+    auto it = conns.find(id);
+    bool hasBuffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+    uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (it == conns.end()) {
+        if (hasBuffer) ring.recycleBuffer(bid);
+        return;
+    }
+    Conn& c = it->second;
+    if (!(cqe.flags & IORING_CQE_F_MORE)) c.recvArmed = false;
+
+    if (cqe.res > 0 && hasBuffer) {
+        onData(id, c, ring.buffer(bid), static_cast<size_t>(cqe.res));
+        ring.recycleBuffer(bid);
+        if (!c.closing && !c.recvArmed) armRecv(id, c);
+    } else if (cqe.res == -ENOBUFS) {
+        // 缓冲区暂时用尽 (归还前的一瞬)，重新挂上
+        if (!c.closing && !c.recvArmed) armRecv(id, c);
+    } else if (cqe.res == -EINVAL && multishotRecv && !c.recvArmed) {
+        std::cerr << "[UringServer] Multishot recv unsupported, re-arming recv per completion" << std::endl;
+        multishotRecv = false;
+        armRecv(id, c);
+    } else {
+        // 0 为对端关闭
+        closeConn(c);
+    }
+    releaseIfIdle(id);
+}
+
+void UringServer::onSend(uint32_t id, const struct io_uring_cqe& cqe) {
+    auto it = conns.find(id);
+    if (it == conns.end()) return;
+    Conn& c = it->second;
+    c.sendInFlight = false;
+    if (cqe.res < 0) {
+        closeConn(c);
+    } else if (!c.closing) {
+        c.sent += static_cast<size_t>(cqe.res);
+        if (c.sent < c.sending.size()) {
+            armSend(id, c);
+        } else {
+            c.sending.clear();
+            c.sent = 0;
+            pullQueued(id, c);
+        }
+    }
+    releaseIfIdle(id);
+}
+
+void UringServer::onWake() {
+    mailbox->signalled.store(false);
+    {
+        std::lock_guard<std::mutex> lock(mailbox->mutex);
+        woken.swap(mailbox->dirty);
+    }
+    if (running.load()) {
+        armWake();
+        for (const auto& shared : woken) {
+            auto it = conns.find(shared->id);
+            if (it == conns.end() || it->second.shared != shared) continue;
+            pullQueued(shared->id, it->second);
+            releaseIfIdle(shared->id);
+        }
+    }
+    woken.clear();
+}
+
+void UringServer::onData(uint32_t id, Conn& c, const char* data, size_t len) {
+    if (c.shared) {
+        {
+            std::lock_guard<std::mutex> lock(c.shared->mutex);
+            c.shared->in.append(data, len);
+        }
+        c.shared->cv.notify_one();
+        return;
+    }
+
+    // 握手
+    c.hello.append(data, len);
+    size_t offset = 0;
+    std::string hello, type, uniqueId;
+    int r = takeFrame(c.hello, offset, hello);
+    if (r == 0) return;
+    if (r < 0 || !parseHello(hello, type, uniqueId)) {
+        std::cerr << "[UringServer] Rejected " << c.name << ": malformed HELLO" << std::endl;
+        std::string reply;
+        appendFrame(reply, "ERR|malformed hello", 19);
+        ssize_t ignored = send(c.fd, reply.data(), reply.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        (void)ignored;
+        closeConn(c);
+        return;
+    }
+
+    c.shared = std::make_shared<UringConn>(id, c.fd);
+    c.shared->in = c.hello.substr(offset);
+    c.shared->queued.reserve(STREAM_MAX_FRAME + 4);
+    c.sending.reserve(STREAM_MAX_FRAME + 4);
+    c.hello.clear();
+    std::cout << "[UringServer] Attached " << c.name << " (" << type << ":" << uniqueId << ")" << std::endl;
+    auto channel = std::unique_ptr<IChannel>(new UringChannel(c.shared, c.name, type, uniqueId, mailbox));
+    if (callback) callback(std::move(channel));
+}
+
+void UringServer::pullQueued(uint32_t id, Conn& c) {
+    if (c.sendInFlight || c.closing) return;
+    bool detached;
+    {
+        std::lock_guard<std::mutex> lock(c.shared->mutex);
+        c.sending.swap(c.shared->queued);
+        c.shared->dirty = false;
+        detached = c.shared->detached;
+    }
+    if (!c.sending.empty()) armSend(id, c);
+    else if (detached) closeConn(c);
+}
+
+void UringServer::closeConn(Conn& c) {
+    if (c.closing) return;
+    c.closing = true;
+    if (c.shared) {
+        c.shared->closed.store(true);
+        std::lock_guard<std::mutex> lock(c.shared->mutex);
+        c.shared->cv.notify_all();
+    }
+    // 让在途的 recv / send 尽快完成，全部完成后再关闭 fd
+    shutdown(c.fd, SHUT_RDWR);
+}
+
+void UringServer::releaseIfIdle(uint32_t id) {
+    auto it = conns.find(id);
+    if (it == conns.end()) return;
+    Conn& c = it->second;
+    if (!c.closing || c.recvArmed || c.sendInFlight) return;
+    close(c.fd);
+    conns.erase(it);
+}
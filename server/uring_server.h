@@ -0,0 +1,138 @@
+#pragma once
+
+#include "ipc.h"
+#include "stream_proto.h"
+#include "uring.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 会话线程与事件循环共享的连接状态 (字段受 mutex 保护)
+struct UringConn {
+    UringConn(uint32_t id, int fd) : id(id), fd(fd), closed(false), detached(false), dirty(false) {}
+
+    const uint32_t id;
+    const int fd;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string in;                 // 事件循环收到、会话尚未取走的字节
+    std::string queued;             // 会话写出、等待事件循环提交的应答
+    std::atomic<bool> closed;       // 对端断开或出错
+    bool detached;                  // 通道已销毁，写完 queued 后关闭连接
+    bool dirty;                     // 已投递给事件循环，尚未处理
+};
+
+// 会话线程向事件循环投递有待写数据的连接，并通过 eventfd 唤醒它
+struct UringMailbox {
+    UringMailbox();
+    ~UringMailbox();
+    void post(const std::shared_ptr<UringConn>& conn);
+    void wake();
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<UringConn>> dirty;
+    std::atomic<bool> signalled;    // 已写过 eventfd、事件循环尚未读取
+    std::atomic<bool> stopped;
+    int fd;
+};
+
+/**
+ * @brief io_uring 后端上的流式通道
+ * 会话线程不直接读写套接字: 输入由事件循环的 multishot recv 填入 UringConn::in，
+ * 应答攒批后交给事件循环提交 send，一条连接上同时只有一个 send 在途。
+ */
+class UringChannel : public IChannel {
+public:
+    UringChannel(std::shared_ptr<UringConn> conn, std::string name, std::string type, std::string id,
+                 std::shared_ptr<UringMailbox> mailbox);
+    ~UringChannel();
+
+    bool recvBlocking(std::string& outMsg) override;
+    bool sendBlocking(const std::string& msg) override;
+    bool isConnected() override;
+    void setReady() override;
+    void flush() override;
+
+    std::string getId() const override { return uniqueId; }
+    std::string getType() const override { return clientType; }
+    std::string getName() const override { return name; }
+
+private:
+    std::shared_ptr<UringConn> conn;
+    std::string name;
+    std::string clientType;
+    std::string uniqueId;
+    std::string inBuf;
+    size_t inPos;
+    std::string outBuf;
+    bool closed;
+    std::shared_ptr<UringMailbox> mailbox;
+};
+
+/**
+ * @brief 基于 io_uring 的 TCP / Unix 流套接字服务 (协议见 stream_proto.h)
+ * 一个 ring 服务全部连接: multishot accept 接入，multishot recv 从注册的缓冲区环收数据，
+ * 每轮把本轮产生的 recv/send 提交项合并为一次 io_uring_enter。
+ * 可选 SQPOLL，由内核线程取提交队列，热路径上不再需要系统调用。
+ * 内核不支持 io_uring 时 init 返回 false，由调用方退回 epoll 的 StreamServer。
+ */
+class UringServer : public IIPCServer {
+public:
+    UringServer(const std::vector<StreamAddress>& addresses, bool sqpoll);
+    ~UringServer();
+
+    bool init() override;
+    void start(std::function<void(std::unique_ptr<IChannel>)> onNewClient) override;
+    void stop() override;
+
+private:
+    // 只由事件循环访问
+    struct Conn {
+        int fd = -1;
+        std::string name;
+        std::string hello;                    // 握手完成前收到的数据
+        std::shared_ptr<UringConn> shared;    // 握手完成后创建
+        std::string sending;                  // 在途 send 的数据
+        size_t sent = 0;
+        bool recvArmed = false;
+        bool sendInFlight = false;
+        bool closing = false;
+    };
+
+    void eventLoop();
+    void handle(const struct io_uring_cqe& cqe);
+    void armAccept(size_t listenIndex);
+    void armWake();
+    void armRecv(uint32_t id, Conn& c);
+    void armSend(uint32_t id, Conn& c);
+    void onAccept(size_t listenIndex, const struct io_uring_cqe& cqe);
+    void onRecv(uint32_t id, const struct io_uring_cqe& cqe);
+    void onSend(uint32_t id, const struct io_uring_cqe& cqe);
+    void onWake();
+    void onData(uint32_t id, Conn& c, const char* data, size_t len);
+    void pullQueued(uint32_t id, Conn& c);
+    void closeConn(Conn& c);
+    void releaseIfIdle(uint32_t id);
+
+    std::vector<StreamAddress> addresses;
+    std::vector<std::pair<int, bool>> listenFds;     // fd, 是否 Unix 套接字
+    bool sqpoll;
+    Uring ring;
+    bool multishotRecv;                               // 6.0 以前的内核退回单次 recv
+    uint64_t wakeValue;
+    std::shared_ptr<UringMailbox> mailbox;
+    // 与 mailbox->dirty 交换的另一半，处理完清空后保留容量，投递时两边都不再分配
+    std::vector<std::shared_ptr<UringConn>> woken;
+    std::atomic<bool> running;
+    std::thread loopThread;
+    std::function<void(std::unique_ptr<IChannel>)> callback;
+    std::unordered_map<uint32_t, Conn> conns;
+    uint32_t nextConnId;
+};